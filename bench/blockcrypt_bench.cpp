@@ -0,0 +1,564 @@
+// blockcrypt_bench: throughput sweep over message sizes, modes, directions, key sizes and
+// thread counts, reported as GB/s and cycles/byte, with JSON output and a baseline check.
+//
+//   blockcrypt_bench [--modes ecb,cbc,ctr,gcm,xts] [--min-size 16] [--max-size 1G]
+//                    [--threads 1,8] [--key-bits 128,192,256] [--backend aesni]
+//                    [--time-ms 200] [--ghz 3.0] [--json out.json]
+//                    [--baseline old.json] [--threshold 10] [--quick]
+//
+// Exit status: 0 on success, 1 on bad arguments, 3 if a result is slower than the baseline
+// by more than the threshold.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "blockcrypt.hpp"
+#include "CBC.hpp"
+#include "CTR.hpp"
+#include "ECB.hpp"
+#include "GCM.hpp"
+#include "XTS.hpp"
+#include "parallel.hpp"
+#include "threadpool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+using Op = std::function<void()>;
+
+// One line of the sweep: everything except the message size
+struct Case
+{
+    std::string mode;
+    std::string direction; // enc, dec
+    int key_bits;
+    std::size_t threads;
+    std::string backend;
+    std::function<Op(std::vector<uint8_t> &buffer)> prepare; // builds the operation for one buffer
+};
+
+struct Result
+{
+    std::string mode, direction, backend;
+    int key_bits = 0;
+    std::size_t threads = 0, bytes = 0, iterations = 0;
+    double ns_per_op = 0, gbps = 0, cycles_per_byte = -1; // cycles < 0: not measured
+};
+
+struct Settings
+{
+    std::vector<std::string> modes = {"ecb", "cbc", "ctr", "gcm", "xts"};
+    std::vector<int> key_bits = {128, 192, 256};
+    std::vector<std::size_t> threads;
+    std::size_t min_size = 16;
+    std::size_t max_size = std::size_t(1) << 30;
+    double seconds = 0.2; // measuring time per (case, size)
+    double ghz = 0;       // > 0: derive cycles from time at this clock instead of the TSC
+    BlockCryptBackend backend = BlockCryptBackend::Auto;
+    std::string json_path, baseline_path;
+    double threshold = 10; // percent
+};
+
+void print_usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --modes LIST      Modes to run: ecb,cbc,ctr,gcm,xts (default: all)\n"
+              << "  --min-size N      Smallest message, e.g. 16, 4K (default: 16)\n"
+              << "  --max-size N      Largest message, e.g. 64M, 1G (default: 1G); sizes grow 4x\n"
+              << "  --threads LIST    Thread counts, e.g. 1,8 (default: 1 and all cores)\n"
+              << "  --key-bits LIST   128,192,256 (default: all; modes skip sizes they lack)\n"
+              << "  --backend NAME    auto, reference, ttable, aesni, bitsliced, vperm (default: auto)\n"
+              << "  --time-ms N       Measuring time per case and size (default: 200)\n"
+              << "  --ghz F           Report cycles at this clock instead of TSC ticks\n"
+              << "  --json FILE       Write the results as JSON\n"
+              << "  --baseline FILE   Compare with an earlier --json file...\n"
+              << "  --threshold PCT   ...and fail if any result is more than PCT% slower (default: 10)\n"
+              << "  --quick           Sizes up to 64 KB, 20 ms per case (smoke test)\n";
+}
+
+// "16", "4K", "64M", "1G" -> bytes
+std::size_t parse_size(const std::string &text)
+{
+    std::size_t pos = 0;
+    unsigned long long value = std::stoull(text, &pos);
+    if (pos < text.size())
+    {
+        switch (text[pos])
+        {
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        default: throw std::invalid_argument("bad size: " + text);
+        }
+    }
+    return static_cast<std::size_t>(value);
+}
+
+std::vector<std::string> split(const std::string &text)
+{
+    std::vector<std::string> parts;
+    std::istringstream in(text);
+    std::string part;
+    while (std::getline(in, part, ','))
+    {
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+std::string size_label(std::size_t bytes)
+{
+    if (bytes >= (1u << 30) && bytes % (1u << 30) == 0)
+        return std::to_string(bytes >> 30) + "G";
+    if (bytes >= (1u << 20) && bytes % (1u << 20) == 0)
+        return std::to_string(bytes >> 20) + "M";
+    if (bytes >= (1u << 10) && bytes % (1u << 10) == 0)
+        return std::to_string(bytes >> 10) + "K";
+    return std::to_string(bytes);
+}
+
+uint64_t ticks()
+{
+#ifdef BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Runs `op` in samples of `iterations` calls, doubling the count until one sample takes a
+// twentieth of the budget, then keeps sampling until the budget is spent. The median sample
+// is reported, which keeps one-off interruptions (page faults, migrations) out of it.
+Result measure(const Op &op, std::size_t bytes, const Settings &settings)
+{
+    using Clock = std::chrono::steady_clock;
+    op(); // warm-up: page faults, lazy initialisation, caches
+
+    std::size_t iterations = 1;
+    std::vector<std::pair<double, double>> samples; // seconds and ticks per op
+    double spent = 0;
+    while (true)
+    {
+        uint64_t t0 = ticks();
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            op();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        uint64_t t1 = ticks();
+        spent += seconds;
+
+        if (seconds < settings.seconds / 20 && iterations < (std::size_t(1) << 30))
+        {
+            samples.clear(); // calibration sample; too short to trust
+            iterations *= 2;
+            continue;
+        }
+        samples.emplace_back(seconds / iterations, static_cast<double>(t1 - t0) / iterations);
+        if (spent >= settings.seconds && samples.size() >= 3)
+            break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto median = samples[samples.size() / 2];
+
+    Result r;
+    r.bytes = bytes;
+    r.iterations = iterations * samples.size();
+    r.ns_per_op = median.first * 1e9;
+    r.gbps = static_cast<double>(bytes) / median.first / 1e9;
+    if (settings.ghz > 0)
+        r.cycles_per_byte = median.first * settings.ghz * 1e9 / static_cast<double>(bytes);
+#ifdef BENCH_HAVE_TSC
+    else
+        r.cycles_per_byte = median.second / static_cast<double>(bytes);
+#endif
+    return r;
+}
+
+template <typename Cipher>
+std::shared_ptr<const Cipher> make_cipher(BlockCryptBackend backend)
+{
+    typename Cipher::Key key{};
+    for (std::size_t i = 0; i < key.size(); ++i)
+        key[i] = static_cast<uint8_t>(i * 7 + 1);
+    return std::make_shared<const Cipher>(key, backend);
+}
+
+const BlockCrypt::Key bench_key = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                   0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+const BlockCrypt::Block bench_iv = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+// ECB, CBC and CTR on one key size, single-threaded. Sizes in the sweep are block multiples,
+// so everything runs unpadded on the raw buffer.
+template <std::size_t KeyBytes>
+void add_serial_modes(std::vector<Case> &cases, const Settings &settings, const std::vector<std::string> &modes)
+{
+    using Cipher = BasicBlockCrypt<KeyBytes>;
+    auto aes = make_cipher<Cipher>(settings.backend);
+    int bits = static_cast<int>(KeyBytes * 8);
+    std::string backend = Cipher::backendName(aes->backend());
+    auto wanted = [&](const char *mode) { return std::find(modes.begin(), modes.end(), mode) != modes.end(); };
+
+    if (wanted("ecb"))
+    {
+        cases.push_back({"ecb", "enc", bits, 1, backend, [aes](std::vector<uint8_t> &buf) -> Op
+                         { return [aes, &buf] { aes->encryptBlocks(buf.data(), buf.data(), buf.size() / 16); }; }});
+        cases.push_back({"ecb", "dec", bits, 1, backend, [aes](std::vector<uint8_t> &buf) -> Op
+                         { return [aes, &buf] { aes->decryptBlocks(buf.data(), buf.data(), buf.size() / 16); }; }});
+    }
+    if (wanted("cbc"))
+    {
+        cases.push_back({"cbc", "enc", bits, 1, backend, [aes](std::vector<uint8_t> &buf) -> Op
+                         { return [aes, &buf] { BC::encryptCBC(*aes, bench_iv, buf.data(), buf.size(), buf.data(), buf.size(), false); }; }});
+        cases.push_back({"cbc", "dec", bits, 1, backend, [aes](std::vector<uint8_t> &buf) -> Op
+                         { return [aes, &buf] { BC::decryptCBC(*aes, bench_iv, buf.data(), buf.size(), buf.data(), buf.size(), false); }; }});
+    }
+    if (wanted("ctr"))
+    {
+        // Encryption and decryption are the same operation
+        cases.push_back({"ctr", "enc", bits, 1, backend, [aes](std::vector<uint8_t> &buf) -> Op
+                         { return [aes, &buf] { BC::cryptCTR(*aes, BC::makeCounterBlock({1, 2, 3, 4, 5, 6, 7, 8}), 0, buf.data(), buf.size()); }; }});
+    }
+}
+
+// XTS on 4 KB sectors (one sector of the message size below that)
+template <std::size_t KeyBytes>
+void add_xts(std::vector<Case> &cases, const Settings &settings, const std::vector<std::size_t> &thread_counts)
+{
+    typename BC::BasicXTS<KeyBytes>::Key k1{}, k2{};
+    for (std::size_t i = 0; i < KeyBytes; ++i)
+    {
+        k1[i] = static_cast<uint8_t>(i);
+        k2[i] = static_cast<uint8_t>(0x80 + i);
+    }
+    auto xts = std::make_shared<const BC::BasicXTS<KeyBytes>>(k1, k2, settings.backend);
+    int bits = static_cast<int>(KeyBytes * 8);
+    std::string backend = BlockCrypt::backendName(xts->backend());
+
+    for (std::size_t threads : thread_counts)
+    {
+        std::shared_ptr<BC::ThreadPool> pool;
+        if (threads > 1)
+            pool = std::make_shared<BC::ThreadPool>(threads);
+        for (bool decrypt : {false, true})
+        {
+            cases.push_back({"xts", decrypt ? "dec" : "enc", bits, threads, backend, [xts, pool, decrypt](std::vector<uint8_t> &buf) -> Op
+            {
+                return [xts, pool, decrypt, &buf]
+                {
+                    std::size_t sector = std::min<std::size_t>(4096, buf.size());
+                    std::size_t count = buf.size() / sector;
+                    if (pool && decrypt)
+                        xts->decryptSectors(0, buf.data(), sector, count, *pool);
+                    else if (pool)
+                        xts->encryptSectors(0, buf.data(), sector, count, *pool);
+                    else if (decrypt)
+                        xts->decryptSectors(0, buf.data(), sector, count);
+                    else
+                        xts->encryptSectors(0, buf.data(), sector, count);
+                };
+            }});
+        }
+    }
+}
+
+std::vector<Case> build_cases(const Settings &settings)
+{
+    std::vector<Case> cases;
+    auto wanted = [&](const char *mode)
+    { return std::find(settings.modes.begin(), settings.modes.end(), mode) != settings.modes.end(); };
+    auto has_bits = [&](int bits)
+    { return std::find(settings.key_bits.begin(), settings.key_bits.end(), bits) != settings.key_bits.end(); };
+
+    if (has_bits(128))
+        add_serial_modes<16>(cases, settings, settings.modes);
+    if (has_bits(192))
+        add_serial_modes<24>(cases, settings, settings.modes);
+    if (has_bits(256))
+        add_serial_modes<32>(cases, settings, settings.modes);
+
+    // Multi-threaded variants exist for AES-128 ECB, CBC decryption and CTR (BC::*Parallel)
+    std::string auto_backend = BlockCrypt::backendName(BlockCrypt(bench_key).backend());
+    for (std::size_t threads : settings.threads)
+    {
+        if (threads <= 1 || !has_bits(128))
+            continue;
+        auto pool = std::make_shared<BC::ThreadPool>(threads);
+        if (wanted("ecb"))
+        {
+            cases.push_back({"ecb", "enc", 128, threads, auto_backend, [pool](std::vector<uint8_t> &buf) -> Op
+                             { return [pool, &buf] { BC::encryptECBParallel(buf, bench_key, *pool, false); }; }});
+            cases.push_back({"ecb", "dec", 128, threads, auto_backend, [pool](std::vector<uint8_t> &buf) -> Op
+                             { return [pool, &buf] { BC::decryptECBParallel(buf, bench_key, *pool, false); }; }});
+        }
+        if (wanted("cbc"))
+        {
+            cases.push_back({"cbc", "dec", 128, threads, auto_backend, [pool](std::vector<uint8_t> &buf) -> Op
+                             { return [pool, &buf] { BC::decryptCBCParallel(buf, bench_key, bench_iv, *pool, false); }; }});
+        }
+        if (wanted("ctr"))
+        {
+            cases.push_back({"ctr", "enc", 128, threads, auto_backend, [pool](std::vector<uint8_t> &buf) -> Op
+                             { return [pool, &buf] { BC::cryptCTRParallel(buf, bench_key, BC::makeCounterBlock({1, 2, 3, 4, 5, 6, 7, 8}), *pool); }; }});
+        }
+    }
+
+    if (wanted("gcm") && has_bits(128))
+    {
+        auto gcm = std::make_shared<const BC::GCM>(bench_key, settings.backend);
+        std::string backend = BlockCrypt::backendName(BlockCrypt(bench_key, settings.backend).backend());
+        static const uint8_t iv[12] = {0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88};
+        cases.push_back({"gcm", "enc", 128, 1, backend, [gcm](std::vector<uint8_t> &buf) -> Op
+                         { return [gcm, &buf] { gcm->encrypt(iv, sizeof(iv), nullptr, 0, buf.data(), buf.size()); }; }});
+        // Opening consumes the ciphertext, so every call first restores it; the copy is
+        // included in the time
+        cases.push_back({"gcm", "dec", 128, 1, backend, [gcm](std::vector<uint8_t> &buf) -> Op
+        {
+            auto sealed = std::make_shared<std::vector<uint8_t>>(buf);
+            auto tag = gcm->encrypt(iv, sizeof(iv), nullptr, 0, sealed->data(), sealed->size());
+            return [gcm, sealed, tag, &buf]
+            {
+                std::memcpy(buf.data(), sealed->data(), buf.size());
+                gcm->decrypt(iv, sizeof(iv), nullptr, 0, buf.data(), buf.size(), tag);
+            };
+        }});
+    }
+
+    if (wanted("xts"))
+    {
+        if (has_bits(128))
+            add_xts<16>(cases, settings, settings.threads);
+        if (has_bits(256))
+            add_xts<32>(cases, settings, settings.threads);
+    }
+
+    // Group the output by mode, then direction, key size and thread count
+    std::stable_sort(cases.begin(), cases.end(), [](const Case &a, const Case &b)
+    { return std::tie(a.mode, a.direction, a.key_bits, a.threads) < std::tie(b.mode, b.direction, b.key_bits, b.threads); });
+    return cases;
+}
+
+// The identity of a result across runs
+std::string result_key(const std::string &mode, const std::string &direction, int key_bits, std::size_t threads,
+                        const std::string &backend, std::size_t bytes)
+{
+    return mode + "/" + direction + "/" + std::to_string(key_bits) + "/" + std::to_string(threads) + "t/" + backend +
+           "/" + std::to_string(bytes);
+}
+
+void write_json(const std::string &path, const std::vector<Result> &results, const Settings &settings)
+{
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("Cannot write " + path);
+    out << "{\n  \"tool\": \"blockcrypt_bench\",\n"
+        << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+        << "  \"cycles\": \"" << (settings.ghz > 0 ? "derived from --ghz" : "TSC ticks") << "\",\n"
+        << "  \"results\": [\n";
+    char line[512];
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        // One result per line; read_baseline relies on it
+        std::snprintf(line, sizeof(line),
+                      "    {\"mode\": \"%s\", \"direction\": \"%s\", \"key_bits\": %d, \"threads\": %zu, "
+                      "\"backend\": \"%s\", \"bytes\": %zu, \"iterations\": %zu, \"ns_per_op\": %.1f, "
+                      "\"gbps\": %.4f, \"cycles_per_byte\": %.3f}%s\n",
+                      r.mode.c_str(), r.direction.c_str(), r.key_bits, r.threads, r.backend.c_str(), r.bytes,
+                      r.iterations, r.ns_per_op, r.gbps, r.cycles_per_byte, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+// Reads a file written by write_json: result key -> GB/s
+std::map<std::string, double> read_baseline(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot read baseline " + path);
+
+    auto field = [](const std::string &line, const std::string &name) -> std::string
+    {
+        std::size_t at = line.find("\"" + name + "\": ");
+        if (at == std::string::npos)
+            return {};
+        at += name.size() + 4;
+        if (line[at] == '"')
+            return line.substr(at + 1, line.find('"', at + 1) - at - 1);
+        return line.substr(at, line.find_first_of(",}", at) - at);
+    };
+
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.find("\"mode\"") == std::string::npos)
+            continue;
+        baseline[result_key(field(line, "mode"), field(line, "direction"), std::stoi(field(line, "key_bits")),
+                            std::stoul(field(line, "threads")), field(line, "backend"),
+                            std::stoul(field(line, "bytes")))] = std::stod(field(line, "gbps"));
+    }
+    return baseline;
+}
+
+int main(int argc, char *argv[])
+{
+    Settings settings;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--modes" && has_value)
+                settings.modes = split(argv[++i]);
+            else if (arg == "--min-size" && has_value)
+                settings.min_size = parse_size(argv[++i]);
+            else if (arg == "--max-size" && has_value)
+                settings.max_size = parse_size(argv[++i]);
+            else if (arg == "--threads" && has_value)
+            {
+                settings.threads.clear();
+                for (const std::string &t : split(argv[++i]))
+                    settings.threads.push_back(std::stoul(t));
+            }
+            else if (arg == "--key-bits" && has_value)
+            {
+                settings.key_bits.clear();
+                for (const std::string &b : split(argv[++i]))
+                    settings.key_bits.push_back(std::stoi(b));
+            }
+            else if (arg == "--backend" && has_value)
+            {
+                std::string name = argv[++i];
+                bool found = false;
+                for (auto b : {BlockCryptBackend::Auto, BlockCryptBackend::Reference, BlockCryptBackend::TTable,
+                               BlockCryptBackend::AESNI, BlockCryptBackend::Bitsliced, BlockCryptBackend::VPerm})
+                {
+                    if (name == BlockCrypt::backendName(b))
+                    {
+                        settings.backend = b;
+                        found = true;
+                    }
+                }
+                if (!found || !BlockCrypt::supports(settings.backend))
+                    throw std::invalid_argument("backend not available: " + name);
+            }
+            else if (arg == "--time-ms" && has_value)
+                settings.seconds = std::stod(argv[++i]) / 1000.0;
+            else if (arg == "--ghz" && has_value)
+                settings.ghz = std::stod(argv[++i]);
+            else if (arg == "--json" && has_value)
+                settings.json_path = argv[++i];
+            else if (arg == "--baseline" && has_value)
+                settings.baseline_path = argv[++i];
+            else if (arg == "--threshold" && has_value)
+                settings.threshold = std::stod(argv[++i]);
+            else if (arg == "--quick")
+            {
+                settings.max_size = 64 * 1024;
+                settings.seconds = 0.02;
+            }
+            else if (arg == "-h" || arg == "--help")
+            {
+                print_usage(argv[0]);
+                return 0;
+            }
+            else
+                throw std::invalid_argument("unknown or incomplete option: " + arg);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (settings.threads.empty())
+    {
+        settings.threads.push_back(1);
+        std::size_t cores = std::thread::hardware_concurrency();
+        if (cores > 1)
+            settings.threads.push_back(cores);
+    }
+    settings.min_size = std::max<std::size_t>(16, settings.min_size / 16 * 16);
+
+    std::vector<Case> cases = build_cases(settings);
+    std::vector<Result> results;
+
+    std::printf("%-5s %-4s %4s %4s %-10s %8s %12s %9s %8s\n", "mode", "dir", "key", "thr", "backend", "size",
+                "ns/op", "GB/s", "cyc/B");
+    for (std::size_t bytes = settings.min_size; bytes <= settings.max_size; bytes *= 4)
+    {
+        std::vector<uint8_t> buffer(bytes, 0x5a);
+        for (const Case &c : cases)
+        {
+            Result r = measure(c.prepare(buffer), bytes, settings);
+            r.mode = c.mode;
+            r.direction = c.direction;
+            r.key_bits = c.key_bits;
+            r.threads = c.threads;
+            r.backend = c.backend;
+            results.push_back(r);
+
+            char cycles[32] = "n/a";
+            if (r.cycles_per_byte >= 0)
+                std::snprintf(cycles, sizeof(cycles), "%.2f", r.cycles_per_byte);
+            std::printf("%-5s %-4s %4d %4zu %-10s %8s %12.1f %9.3f %8s\n", r.mode.c_str(), r.direction.c_str(),
+                        r.key_bits, r.threads, r.backend.c_str(), size_label(bytes).c_str(), r.ns_per_op, r.gbps, cycles);
+            std::fflush(stdout);
+        }
+    }
+
+    try
+    {
+        if (!settings.json_path.empty())
+            write_json(settings.json_path, results, settings);
+
+        if (settings.baseline_path.empty())
+            return 0;
+
+        std::map<std::string, double> baseline = read_baseline(settings.baseline_path);
+        std::size_t compared = 0, regressions = 0;
+        for (const Result &r : results)
+        {
+            auto it = baseline.find(result_key(r.mode, r.direction, r.key_bits, r.threads, r.backend, r.bytes));
+            if (it == baseline.end() || it->second <= 0)
+                continue;
+            ++compared;
+            double change = (r.gbps / it->second - 1.0) * 100.0;
+            if (change < -settings.threshold)
+            {
+                ++regressions;
+                std::printf("REGRESSION %-5s %-4s %4d %4zut %8s: %.3f -> %.3f GB/s (%+.1f%%)\n", r.mode.c_str(),
+                            r.direction.c_str(), r.key_bits, r.threads, size_label(r.bytes).c_str(), it->second,
+                            r.gbps, change);
+            }
+        }
+        std::printf("%zu results compared with %s, %zu slower than -%.1f%%\n", compared,
+                    settings.baseline_path.c_str(), regressions, settings.threshold);
+        return regressions == 0 ? 0 : 3;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -3,10 +3,131 @@
 
 #include <cstdint>
 
-extern const uint8_t sBox[256];
-extern const uint8_t invSBox[256];
+// All AES tables are generated at compile time from the GF(2^8) arithmetic below, so they
+// land in .rodata with no startup work and can be used inside constant expressions (e.g.
+// the constexpr key schedule in blockcrypt.hpp). constants/BlockCryptConstants.cpp checks
+// them against FIPS-197 with static_asserts.
+namespace BCTables
+{
+    // Multiplication by x in GF(2^8) modulo the AES polynomial x^8 + x^4 + x^3 + x + 1
+    constexpr uint8_t xtime(uint8_t a)
+    {
+        return static_cast<uint8_t>((a << 1) ^ ((a & 0x80) ? 0x1b : 0x00));
+    }
 
-extern const uint8_t rcon[11];
+    // Carry-less "Russian peasant" multiplication in GF(2^8)
+    constexpr uint8_t gmul(uint8_t a, uint8_t b)
+    {
+        uint8_t p = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (b & 1)
+                p ^= a;
+            a = xtime(a);
+            b >>= 1;
+        }
+        return p;
+    }
+
+    constexpr uint8_t rotl8(uint8_t x, int n)
+    {
+        return static_cast<uint8_t>((x << n) | (x >> (8 - n)));
+    }
+
+    constexpr uint32_t packWord(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
+    {
+        return (static_cast<uint32_t>(b0) << 24) | (static_cast<uint32_t>(b1) << 16) |
+               (static_cast<uint32_t>(b2) << 8) | static_cast<uint32_t>(b3);
+    }
+
+    constexpr uint32_t rotr32(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    struct alignas(64) Tables
+    {
+        uint8_t sBox[256];
+        uint8_t invSBox[256];
+        uint8_t rcon[11];
+
+        // Encryption T-tables: Te0[x] packs the MixColumns column (2·S[x], S[x], S[x], 3·S[x])
+        // as a big-endian word; Te1..Te3 are the same words rotated right by 8, 16 and 24 bits.
+        uint32_t Te0[256], Te1[256], Te2[256], Te3[256];
+
+        // Decryption T-tables: Td0[x] packs the InvMixColumns column (14·Si[x], 9·Si[x],
+        // 13·Si[x], 11·Si[x]) with Si the inverse S-Box; Td1..Td3 are rotations of Td0.
+        uint32_t Td0[256], Td1[256], Td2[256], Td3[256];
+    };
+
+    constexpr Tables generate()
+    {
+        Tables t{};
+
+        // Walk the multiplicative group with the generator 3: p = 3^i and q = 3^-i, so q is
+        // always the inverse of p. S[p] is the FIPS-197 affine transform of that inverse.
+        uint8_t p = 1, q = 1;
+        do
+        {
+            p = static_cast<uint8_t>(p ^ xtime(p)); // p *= 3
+            q ^= static_cast<uint8_t>(q << 1);      // q /= 3 (multiply by 0xf6)
+            q ^= static_cast<uint8_t>(q << 2);
+            q ^= static_cast<uint8_t>(q << 4);
+            if (q & 0x80)
+                q ^= 0x09;
+            t.sBox[p] = static_cast<uint8_t>(q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63);
+        } while (p != 1);
+        t.sBox[0] = 0x63; // 0 has no inverse; the affine transform of 0
+
+        for (int x = 0; x < 256; ++x)
+            t.invSBox[t.sBox[x]] = static_cast<uint8_t>(x);
+
+        // rcon[i] = x^(i-1); rcon[0] is unused
+        uint8_t r = 1;
+        for (int i = 1; i < 11; ++i)
+        {
+            t.rcon[i] = r;
+            r = xtime(r);
+        }
+
+        for (int x = 0; x < 256; ++x)
+        {
+            uint8_t s = t.sBox[x];
+            uint32_t e = packWord(gmul(s, 2), s, s, gmul(s, 3));
+            t.Te0[x] = e;
+            t.Te1[x] = rotr32(e, 8);
+            t.Te2[x] = rotr32(e, 16);
+            t.Te3[x] = rotr32(e, 24);
+
+            uint8_t si = t.invSBox[x];
+            uint32_t d = packWord(gmul(si, 14), gmul(si, 9), gmul(si, 13), gmul(si, 11));
+            t.Td0[x] = d;
+            t.Td1[x] = rotr32(d, 8);
+            t.Td2[x] = rotr32(d, 16);
+            t.Td3[x] = rotr32(d, 24);
+        }
+        return t;
+    }
+
+    inline constexpr Tables kTables = generate();
+} // namespace BCTables
+
+// The tables under their usual names (references into BCTables::kTables)
+inline constexpr const uint8_t (&sBox)[256] = BCTables::kTables.sBox;
+inline constexpr const uint8_t (&invSBox)[256] = BCTables::kTables.invSBox;
+
+inline constexpr const uint8_t (&rcon)[11] = BCTables::kTables.rcon;
+
+// Round tables for the 32-bit word engine (SubBytes + ShiftRows + MixColumns fused)
+inline constexpr const uint32_t (&Te0)[256] = BCTables::kTables.Te0;
+inline constexpr const uint32_t (&Te1)[256] = BCTables::kTables.Te1;
+inline constexpr const uint32_t (&Te2)[256] = BCTables::kTables.Te2;
+inline constexpr const uint32_t (&Te3)[256] = BCTables::kTables.Te3;
+
+inline constexpr const uint32_t (&Td0)[256] = BCTables::kTables.Td0;
+inline constexpr const uint32_t (&Td1)[256] = BCTables::kTables.Td1;
+inline constexpr const uint32_t (&Td2)[256] = BCTables::kTables.Td2;
+inline constexpr const uint32_t (&Td3)[256] = BCTables::kTables.Td3;
 
 constexpr uint8_t BLOCK_SIZE = 16;
 constexpr uint8_t KEY_SIZE = 16;
@@ -0,0 +1,112 @@
+// blockcryptd: local encryption service on a Unix domain socket (see "Encryption daemon" in
+// the README and protocol.hpp for the wire format).
+//
+//   blockcryptd [-s /tmp/blockcryptd.sock] [-m 600] [-w workers] [--batch 64]
+//               [--max-payload 16M] [--max-keys 256] [--max-inflight 64M]
+//
+// Runs in the foreground until SIGINT/SIGTERM, then prints its counters to stderr.
+
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "server.hpp"
+
+namespace
+{
+    BCDaemon::Server *running = nullptr;
+
+    void on_signal(int)
+    {
+        if (running != nullptr)
+            running->stop();
+    }
+} // namespace
+
+void print_usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  -s, --socket PATH   Socket to listen on (default: /tmp/blockcryptd.sock)\n"
+              << "  -m, --mode OCTAL    Permissions of the socket file (default: 600)\n"
+              << "  -w, --workers N     Worker threads (default: one per core)\n"
+              << "      --batch N       Requests a worker takes at once (default: 64)\n"
+              << "      --max-payload N Largest request in bytes; K/M suffixes (default: 16M)\n"
+              << "      --max-keys N    Keys one connection may hold loaded (default: 256)\n"
+              << "      --max-inflight N Request bytes one connection may have queued; K/M suffixes (default: 64M)\n";
+}
+
+// "4096", "64K", "16M" -> bytes
+std::size_t parse_size(const std::string &text)
+{
+    std::size_t pos = 0;
+    unsigned long long value = std::stoull(text, &pos);
+    if (pos < text.size())
+    {
+        if (text[pos] == 'K' || text[pos] == 'k')
+            value <<= 10;
+        else if (text[pos] == 'M' || text[pos] == 'm')
+            value <<= 20;
+        else
+            throw std::invalid_argument("bad size: " + text);
+    }
+    return static_cast<std::size_t>(value);
+}
+
+int main(int argc, char *argv[])
+{
+    BCDaemon::ServerOptions options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if ((arg == "-s" || arg == "--socket") && has_value)
+                options.socketPath = argv[++i];
+            else if ((arg == "-m" || arg == "--mode") && has_value)
+                options.socketMode = static_cast<unsigned>(std::stoul(argv[++i], nullptr, 8));
+            else if ((arg == "-w" || arg == "--workers") && has_value)
+                options.workers = static_cast<unsigned>(std::stoul(argv[++i]));
+            else if (arg == "--batch" && has_value)
+                options.maxBatch = std::max<std::size_t>(1, std::stoul(argv[++i]));
+            else if (arg == "--max-payload" && has_value)
+                options.maxPayload = parse_size(argv[++i]);
+            else if (arg == "--max-keys" && has_value)
+                options.maxKeys = std::stoul(argv[++i]);
+            else if (arg == "--max-inflight" && has_value)
+                options.maxInFlightBytes = parse_size(argv[++i]);
+            else if (arg == "-h" || arg == "--help")
+            {
+                print_usage(argv[0]);
+                return 0;
+            }
+            else
+                throw std::invalid_argument("unknown or incomplete option: " + arg);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        BCDaemon::Server server(options);
+        running = &server;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        std::cerr << "blockcryptd listening on " << options.socketPath << "\n";
+        server.run();
+        running = nullptr;
+        std::cerr << server.stats().format();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+    return 0;
+}
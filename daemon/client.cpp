@@ -0,0 +1,143 @@
+#include "client.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace BCDaemon
+{
+    Client::Client(const std::string &socketPath) : path(socketPath)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+            throw std::runtime_error("Socket path '" + socketPath + "' is empty or too long");
+        std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            std::string reason = std::strerror(errno);
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error("Cannot connect to '" + socketPath + "': " + reason);
+        }
+    }
+
+    Client::~Client()
+    {
+        ::close(fd);
+    }
+
+    void Client::writeAll(const uint8_t *header, const uint8_t *prefix, const uint8_t *data, std::size_t length)
+    {
+        iovec iov[3] = {{const_cast<uint8_t *>(header), kRequestHeaderBytes},
+                        {const_cast<uint8_t *>(prefix), prefix != nullptr ? kPrefixBytes : 0},
+                        {const_cast<uint8_t *>(data), length}};
+        iovec *next = iov;
+        std::size_t count = 3;
+        while (count != 0)
+        {
+            msghdr msg{};
+            msg.msg_iov = next;
+            msg.msg_iovlen = count;
+            ssize_t n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Cannot send to '" + path + "': " + std::strerror(errno));
+            }
+            std::size_t left = static_cast<std::size_t>(n);
+            while (count != 0 && left >= next->iov_len)
+            {
+                left -= next->iov_len;
+                ++next;
+                --count;
+            }
+            if (count != 0)
+            {
+                next->iov_base = static_cast<uint8_t *>(next->iov_base) + left;
+                next->iov_len -= left;
+            }
+        }
+    }
+
+    void Client::readAll(uint8_t *out, std::size_t length)
+    {
+        while (length != 0)
+        {
+            ssize_t n = ::recv(fd, out, length, 0);
+            if (n == 0)
+                throw std::runtime_error("Connection to '" + path + "' closed by the server");
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Cannot read from '" + path + "': " + std::strerror(errno));
+            }
+            out += n;
+            length -= static_cast<std::size_t>(n);
+        }
+    }
+
+    uint32_t Client::send(Op op, uint32_t keyId, const uint8_t *prefix, const uint8_t *data, std::size_t length,
+                          uint8_t flags)
+    {
+        RequestHeader h;
+        h.length = static_cast<uint32_t>(length + (prefix != nullptr ? kPrefixBytes : 0));
+        h.id = nextId++;
+        h.op = op;
+        h.flags = flags;
+        h.keyId = keyId;
+        uint8_t header[kRequestHeaderBytes];
+        encodeRequest(h, header);
+        writeAll(header, prefix, data, length);
+        return h.id;
+    }
+
+    Response Client::receive()
+    {
+        uint8_t header[kResponseHeaderBytes];
+        readAll(header, sizeof(header));
+        ResponseHeader h = decodeResponse(header);
+        Response r;
+        r.id = h.id;
+        r.status = h.status;
+        r.payload.resize(h.length);
+        readAll(r.payload.data(), r.payload.size());
+        return r;
+    }
+
+    std::vector<uint8_t> Client::call(Op op, uint32_t keyId, const uint8_t *prefix, const uint8_t *data,
+                                      std::size_t length, uint8_t flags)
+    {
+        send(op, keyId, prefix, data, length, flags);
+        Response r = receive(); // the only request in flight
+        if (r.status != Status::Ok)
+            throw std::runtime_error("blockcryptd: " + std::string(r.payload.begin(), r.payload.end()));
+        return std::move(r.payload);
+    }
+
+    uint32_t Client::loadKey(const uint8_t *key, std::size_t length)
+    {
+        std::vector<uint8_t> id = call(Op::LoadKey, 0, nullptr, key, length);
+        if (id.size() != 4)
+            throw std::runtime_error("blockcryptd: malformed LoadKey response");
+        return getU32(id.data());
+    }
+
+    void Client::unloadKey(uint32_t keyId)
+    {
+        call(Op::UnloadKey, keyId, nullptr, nullptr, 0);
+    }
+
+    std::string Client::stats()
+    {
+        std::vector<uint8_t> text = call(Op::Stats, 0, nullptr, nullptr, 0);
+        return std::string(text.begin(), text.end());
+    }
+} // namespace BCDaemon
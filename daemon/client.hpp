@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "protocol.hpp"
+
+namespace BCDaemon
+{
+    struct Response
+    {
+        uint32_t id = 0;
+        Status status = Status::Ok;
+        std::vector<uint8_t> payload; // output data, or the error message
+    };
+
+    /**
+     * @brief Blocking client for one blockcryptd connection.
+     *
+     * send() and receive() can be used separately to keep several requests in flight on
+     * the connection (responses may come back in any order; match them by id). The
+     * convenience calls send one request and wait for its answer. Not thread-safe: give
+     * every thread its own Client.
+     */
+    class Client
+    {
+    public:
+        // @throws std::runtime_error if no server is listening on `socketPath`.
+        explicit Client(const std::string &socketPath);
+        ~Client();
+
+        Client(const Client &) = delete;
+        Client &operator=(const Client &) = delete;
+
+        /**
+         * Queues one request and returns its id.
+         *
+         * @param prefix IV (CBC) or initial counter block (CTR); nullptr for other ops.
+         * @param data Request data (the key for LoadKey).
+         */
+        uint32_t send(Op op, uint32_t keyId, const uint8_t *prefix, const uint8_t *data, std::size_t length,
+                      uint8_t flags = 0);
+
+        // Waits for the next response. @throws std::runtime_error if the connection is closed.
+        Response receive();
+
+        // Expands `key` (16, 24 or 32 bytes) on the server and returns its id on this connection
+        uint32_t loadKey(const uint8_t *key, std::size_t length);
+
+        // Frees an id returned by loadKey (also done for all of them when the connection closes)
+        void unloadKey(uint32_t keyId);
+
+        /**
+         * One request, one answer.
+         * @throws std::runtime_error with the server's message if the status is not Ok.
+         */
+        std::vector<uint8_t> call(Op op, uint32_t keyId, const uint8_t *prefix, const uint8_t *data,
+                                  std::size_t length, uint8_t flags = 0);
+
+        std::string stats(); // the server's "name value" lines
+
+    private:
+        void writeAll(const uint8_t *header, const uint8_t *prefix, const uint8_t *data, std::size_t length);
+        void readAll(uint8_t *out, std::size_t length);
+
+        int fd = -1;
+        uint32_t nextId = 1;
+        std::string path;
+    };
+} // namespace BCDaemon
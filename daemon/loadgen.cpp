@@ -0,0 +1,319 @@
+// blockcrypt_loadgen: load generator for blockcryptd. Every connection runs on its own
+// thread and keeps `depth` requests in flight; reports throughput and client-side latency
+// percentiles, optionally checks every response against the library.
+//
+//   blockcrypt_loadgen [-s /tmp/blockcryptd.sock | --inprocess] [-c 4] [-d 16] [-n 10000]
+//                      [--size 256] [--op cbc-encrypt] [--key-bits 128] [--verify] [--stats]
+//
+// Exit status: 0 on success, 1 on bad arguments, 2 if a request failed or (with --verify)
+// returned wrong data.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "CBC.hpp"
+#include "CTR.hpp"
+#include "ECB.hpp"
+#include "client.hpp"
+#include "server.hpp"
+
+struct Settings
+{
+    std::string socket_path = "/tmp/blockcryptd.sock";
+    bool in_process = false;
+    unsigned workers = 0; // with --inprocess
+    unsigned connections = 4;
+    std::size_t depth = 16;
+    std::size_t requests = 10000; // per connection
+    std::size_t size = 256;
+    std::string op = "cbc-encrypt";
+    int key_bits = 128;
+    bool verify = false;
+    bool show_stats = false;
+};
+
+void print_usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  -s, --socket PATH   Server socket (default: /tmp/blockcryptd.sock)\n"
+              << "      --inprocess     Start a server in this process on a private socket\n"
+              << "  -w, --workers N     With --inprocess: server worker threads (default: one per core)\n"
+              << "  -c, --connections N Concurrent connections, one thread each (default: 4)\n"
+              << "  -d, --depth N       Requests in flight per connection (default: 16)\n"
+              << "  -n, --requests N    Requests per connection (default: 10000)\n"
+              << "      --size N        Data bytes per request (default: 256)\n"
+              << "      --op NAME       cbc-encrypt, cbc-decrypt, ctr, ecb-encrypt (default: cbc-encrypt)\n"
+              << "      --key-bits N    128, 192 or 256 (default: 128)\n"
+              << "      --verify        Check every response against the library\n"
+              << "      --stats         Print the server's counters afterwards\n";
+}
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// IV / counter block of request number `n` on a connection, so responses are all different
+BlockCrypt::Block prefix_for(std::size_t n)
+{
+    BlockCrypt::Block b{};
+    for (int i = 0; i < 8; ++i)
+        b[i] = uint8_t(n >> (8 * i));
+    return b;
+}
+
+struct Result
+{
+    std::vector<uint64_t> latencies; // ns
+    std::size_t failures = 0;
+    std::string first_error;
+};
+
+// What the server must answer for request `n`, computed with the library
+template <std::size_t KeyBytes>
+std::vector<uint8_t> expected_output(const Settings &s, const BasicBlockCrypt<KeyBytes> &aes,
+                                     const std::vector<uint8_t> &plain, std::size_t n)
+{
+    std::vector<uint8_t> out = plain;
+    if (s.op == "cbc-encrypt")
+        BC::encryptCBC(out, aes, prefix_for(n));
+    else if (s.op == "ctr")
+        BC::cryptCTR(aes, prefix_for(n), 0, out.data(), out.size());
+    else if (s.op == "ecb-encrypt")
+        BC::encryptECB(out, aes);
+    return out; // cbc-decrypt: the plaintext
+}
+
+template <std::size_t KeyBytes>
+void run_connection(const Settings &s, const std::string &path, unsigned index, Result &result)
+{
+    typename BasicBlockCrypt<KeyBytes>::Key key{};
+    key[0] = 0x42;
+    BasicBlockCrypt<KeyBytes> aes(key);
+
+    std::vector<uint8_t> plain(s.size);
+    for (std::size_t i = 0; i < plain.size(); ++i)
+        plain[i] = uint8_t(i * 31 + index);
+
+    BCDaemon::Op op = BCDaemon::Op::EncryptCBC;
+    const std::vector<uint8_t> *data = &plain;
+    std::vector<uint8_t> cipher;
+    if (s.op == "cbc-decrypt")
+    {
+        op = BCDaemon::Op::DecryptCBC;
+        cipher = plain;
+        BC::encryptCBC(cipher, aes, prefix_for(0)); // every request sends this ciphertext
+        data = &cipher;
+    }
+    else if (s.op == "ctr")
+        op = BCDaemon::Op::CTR;
+    else if (s.op == "ecb-encrypt")
+        op = BCDaemon::Op::EncryptECB;
+    bool has_prefix = op != BCDaemon::Op::EncryptECB;
+
+    BCDaemon::Client client(path);
+    uint32_t key_id = client.loadKey(key.data(), key.size());
+
+    std::vector<uint64_t> sent_at(s.requests);
+    std::size_t sent = 0, received = 0;
+    uint32_t first_id = 0;
+    std::vector<uint8_t> fixed; // expected output when it does not depend on the request
+    if (s.verify && (op == BCDaemon::Op::DecryptCBC || op == BCDaemon::Op::EncryptECB))
+        fixed = expected_output(s, aes, plain, 0);
+
+    result.latencies.reserve(s.requests);
+    while (received < s.requests)
+    {
+        while (sent < s.requests && sent - received < s.depth)
+        {
+            BlockCrypt::Block prefix = prefix_for(op == BCDaemon::Op::DecryptCBC ? 0 : sent);
+            sent_at[sent] = now_ns();
+            uint32_t id = client.send(op, key_id, has_prefix ? prefix.data() : nullptr, data->data(), data->size());
+            if (sent == 0)
+                first_id = id;
+            ++sent;
+        }
+
+        BCDaemon::Response r = client.receive();
+        std::size_t n = r.id - first_id;
+        if (n >= sent)
+            throw std::runtime_error("response to an unknown request id");
+        result.latencies.push_back(now_ns() - sent_at[n]);
+        ++received;
+
+        if (r.status != BCDaemon::Status::Ok)
+        {
+            if (result.failures++ == 0)
+                result.first_error = std::string(r.payload.begin(), r.payload.end());
+        }
+        else if (s.verify && r.payload != (fixed.empty() ? expected_output(s, aes, plain, n) : fixed))
+        {
+            if (result.failures++ == 0)
+                result.first_error = "wrong output for request " + std::to_string(n);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Settings s;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if ((arg == "-s" || arg == "--socket") && has_value)
+                s.socket_path = argv[++i];
+            else if (arg == "--inprocess")
+                s.in_process = true;
+            else if ((arg == "-w" || arg == "--workers") && has_value)
+                s.workers = static_cast<unsigned>(std::stoul(argv[++i]));
+            else if ((arg == "-c" || arg == "--connections") && has_value)
+                s.connections = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+            else if ((arg == "-d" || arg == "--depth") && has_value)
+                s.depth = std::max<std::size_t>(1, std::stoul(argv[++i]));
+            else if ((arg == "-n" || arg == "--requests") && has_value)
+                s.requests = std::max<std::size_t>(1, std::stoul(argv[++i]));
+            else if (arg == "--size" && has_value)
+                s.size = std::stoul(argv[++i]);
+            else if (arg == "--op" && has_value)
+                s.op = argv[++i];
+            else if (arg == "--key-bits" && has_value)
+                s.key_bits = std::stoi(argv[++i]);
+            else if (arg == "--verify")
+                s.verify = true;
+            else if (arg == "--stats")
+                s.show_stats = true;
+            else if (arg == "-h" || arg == "--help")
+            {
+                print_usage(argv[0]);
+                return 0;
+            }
+            else
+                throw std::invalid_argument("unknown or incomplete option: " + arg);
+        }
+        if (s.op != "cbc-encrypt" && s.op != "cbc-decrypt" && s.op != "ctr" && s.op != "ecb-encrypt")
+            throw std::invalid_argument("unknown op: " + s.op);
+        if (s.key_bits != 128 && s.key_bits != 192 && s.key_bits != 256)
+            throw std::invalid_argument("key bits must be 128, 192 or 256");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<BCDaemon::Server> server;
+    std::thread server_thread;
+    if (s.in_process)
+    {
+        BCDaemon::ServerOptions options;
+        options.socketPath = "/tmp/blockcrypt_loadgen_" + std::to_string(::getpid()) + ".sock";
+        options.workers = s.workers;
+        server = std::make_unique<BCDaemon::Server>(options);
+        server_thread = std::thread([&] { server->run(); });
+        s.socket_path = options.socketPath;
+    }
+
+    std::vector<Result> results(s.connections);
+    std::vector<std::thread> threads;
+    std::mutex error_lock;
+    std::string connect_error;
+    uint64_t start = now_ns();
+    for (unsigned c = 0; c < s.connections; ++c)
+    {
+        threads.emplace_back([&, c]
+        {
+            try
+            {
+                if (s.key_bits == 128)
+                    run_connection<16>(s, s.socket_path, c, results[c]);
+                else if (s.key_bits == 192)
+                    run_connection<24>(s, s.socket_path, c, results[c]);
+                else
+                    run_connection<32>(s, s.socket_path, c, results[c]);
+            }
+            catch (const std::exception &e)
+            {
+                std::lock_guard<std::mutex> guard(error_lock);
+                connect_error = e.what();
+            }
+        });
+    }
+    for (std::thread &t : threads)
+        t.join();
+    double seconds = static_cast<double>(now_ns() - start) / 1e9;
+
+    std::string server_stats;
+    if (s.show_stats && connect_error.empty())
+    {
+        try
+        {
+            server_stats = BCDaemon::Client(s.socket_path).stats();
+        }
+        catch (const std::exception &e)
+        {
+            connect_error = e.what();
+        }
+    }
+    if (server)
+    {
+        server->stop();
+        server_thread.join();
+    }
+
+    std::vector<uint64_t> all;
+    std::size_t failures = 0;
+    std::string first_error;
+    for (const Result &r : results)
+    {
+        all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+        failures += r.failures;
+        if (first_error.empty())
+            first_error = r.first_error;
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile_us = [&](double p)
+    {
+        if (all.empty())
+            return 0.0;
+        std::size_t i = std::min(all.size() - 1, static_cast<std::size_t>(p / 100.0 * static_cast<double>(all.size())));
+        return static_cast<double>(all[i]) / 1e3;
+    };
+
+    char line[256];
+    double mib = static_cast<double>(all.size()) * static_cast<double>(s.size) / (1024.0 * 1024.0);
+    std::snprintf(line, sizeof(line), "%s, %zu B, %u connections x depth %zu: %zu requests in %.3f s\n", s.op.c_str(),
+                  s.size, s.connections, s.depth, all.size(), seconds);
+    std::cout << line;
+    std::snprintf(line, sizeof(line), "%.0f requests/s, %.2f MiB/s; latency p50 %.1f us, p99 %.1f us, p99.9 %.1f us\n",
+                  seconds > 0 ? static_cast<double>(all.size()) / seconds : 0.0, seconds > 0 ? mib / seconds : 0.0,
+                  percentile_us(50), percentile_us(99), percentile_us(99.9));
+    std::cout << line;
+    if (!server_stats.empty())
+        std::cout << "server:\n" << server_stats;
+
+    if (!connect_error.empty())
+    {
+        std::cerr << connect_error << "\n";
+        return 2;
+    }
+    if (failures != 0)
+    {
+        std::cerr << failures << " failed requests, first: " << first_error << "\n";
+        return 2;
+    }
+    return 0;
+}
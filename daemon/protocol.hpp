@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Wire format of blockcryptd (see "Encryption daemon" in the README).
+ *
+ * A client sends request frames and reads response frames on one stream socket. Every
+ * frame is a fixed header followed by `length` payload bytes; integers are little-endian.
+ * Requests on one connection may be pipelined and may be answered out of order: the
+ * response carries the request's `id`.
+ *
+ *   request  (16 bytes): u32 length | u32 id | u8 op | u8 flags | u16 reserved | u32 keyId
+ *   response (12 bytes): u32 length | u32 id | u8 status | 3 bytes reserved
+ *
+ * Request payloads:
+ *   LoadKey            16, 24 or 32 key bytes; the response payload is the u32 keyId to use
+ *                      in later requests on this connection (ids are per connection, and
+ *                      every load returns a new one)
+ *   UnloadKey          empty, with the keyId in the header; frees the id
+ *   EncryptCBC/DecryptCBC  16-byte IV, then the data
+ *   CTR                16-byte initial counter block, then the data
+ *   EncryptECB/DecryptECB  the data
+ *   Stats              empty; the response payload is "name value" text lines
+ *
+ * A successful response carries the output data; an error response a message text.
+ */
+namespace BCDaemon
+{
+    enum class Op : uint8_t
+    {
+        LoadKey = 1,
+        EncryptCBC = 2,
+        DecryptCBC = 3,
+        CTR = 4,
+        EncryptECB = 5,
+        DecryptECB = 6,
+        Stats = 7,
+        UnloadKey = 8,
+    };
+
+    enum class Status : uint8_t
+    {
+        Ok = 0,
+        BadRequest = 1, // unknown op, malformed payload
+        UnknownKey = 2, // keyId was not returned by LoadKey on this connection, or unloaded
+        Failed = 3,     // the operation threw, e.g. bad padding on decryption
+        KeyTableFull = 4, // the connection holds ServerOptions::maxKeys keys
+    };
+
+    // Request flags
+    constexpr uint8_t kNoPadding = 0x01; // CBC/ECB without PKCS#7 (data must be block aligned)
+
+    constexpr std::size_t kRequestHeaderBytes = 16;
+    constexpr std::size_t kResponseHeaderBytes = 12;
+    constexpr std::size_t kPrefixBytes = 16; // IV or counter block in front of CBC/CTR data
+
+    struct RequestHeader
+    {
+        uint32_t length = 0;
+        uint32_t id = 0;
+        Op op = Op::Stats;
+        uint8_t flags = 0;
+        uint32_t keyId = 0;
+    };
+
+    struct ResponseHeader
+    {
+        uint32_t length = 0;
+        uint32_t id = 0;
+        Status status = Status::Ok;
+    };
+
+    inline void putU32(uint8_t *p, uint32_t v)
+    {
+        p[0] = uint8_t(v);
+        p[1] = uint8_t(v >> 8);
+        p[2] = uint8_t(v >> 16);
+        p[3] = uint8_t(v >> 24);
+    }
+
+    inline uint32_t getU32(const uint8_t *p)
+    {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    inline void encodeRequest(const RequestHeader &h, uint8_t *out)
+    {
+        putU32(out, h.length);
+        putU32(out + 4, h.id);
+        out[8] = static_cast<uint8_t>(h.op);
+        out[9] = h.flags;
+        out[10] = 0;
+        out[11] = 0;
+        putU32(out + 12, h.keyId);
+    }
+
+    inline RequestHeader decodeRequest(const uint8_t *in)
+    {
+        RequestHeader h;
+        h.length = getU32(in);
+        h.id = getU32(in + 4);
+        h.op = static_cast<Op>(in[8]);
+        h.flags = in[9];
+        h.keyId = getU32(in + 12);
+        return h;
+    }
+
+    inline void encodeResponse(const ResponseHeader &h, uint8_t *out)
+    {
+        putU32(out, h.length);
+        putU32(out + 4, h.id);
+        out[8] = static_cast<uint8_t>(h.status);
+        out[9] = 0;
+        out[10] = 0;
+        out[11] = 0;
+    }
+
+    inline ResponseHeader decodeResponse(const uint8_t *in)
+    {
+        ResponseHeader h;
+        h.length = getU32(in);
+        h.id = getU32(in + 4);
+        h.status = static_cast<Status>(in[8]);
+        return h;
+    }
+} // namespace BCDaemon
@@ -0,0 +1,871 @@
+#include "server.hpp"
+#include "CBC.hpp"
+#include "CTR.hpp"
+#include "ECB.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace BCDaemon
+{
+    namespace
+    {
+        constexpr std::size_t kReadChunk = 64 * 1024; // free space offered to each recv
+        constexpr std::size_t kMaxIov = 64;           // iovecs per sendmsg (two per response)
+
+        uint64_t now()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now().time_since_epoch())
+                                             .count());
+        }
+
+        [[noreturn]] void fail(const std::string &what, const std::string &path)
+        {
+            throw std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+        }
+
+        // Same log2 buckets as BCStats (see BCStats::kBuckets)
+        void addLatency(BCStats::Timing &t, uint64_t ns)
+        {
+            ++t.calls;
+            t.nanoseconds += ns;
+            std::size_t bucket = ns == 0 ? 0 : static_cast<std::size_t>(63 - __builtin_clzll(ns));
+            ++t.histogram[std::min(bucket, BCStats::kBuckets - 1)];
+        }
+
+        bool hasPrefix(Op op)
+        {
+            return op == Op::EncryptCBC || op == Op::DecryptCBC || op == Op::CTR;
+        }
+    } // namespace
+
+    struct Server::KeyEntry
+    {
+        std::unique_ptr<BlockCrypt> aes128;
+        std::unique_ptr<BlockCrypt192> aes192;
+        std::unique_ptr<BlockCrypt256> aes256;
+
+        // Calls f with the context of whichever key size this entry holds
+        template <typename F>
+        void with(F &&f) const
+        {
+            if (aes128)
+                f(*aes128);
+            else if (aes192)
+                f(*aes192);
+            else
+                f(*aes256);
+        }
+    };
+
+    struct Server::Outgoing
+    {
+        uint8_t header[kResponseHeaderBytes];
+        BC::PooledBuffer body;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::size_t sent = 0; // of header + body[begin, end)
+
+        std::size_t total() const { return kResponseHeaderBytes + (end - begin); }
+    };
+
+    struct Server::Connection
+    {
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection() { ::close(fd); } // only here, so a worker never writes to a reused descriptor
+
+        const int fd;
+
+        // Loop thread only
+        std::vector<uint8_t> rx;
+        std::size_t rxUsed = 0;
+
+        // Shared with the workers
+        std::mutex lock;
+        std::deque<Outgoing> tx;
+        std::size_t inFlight = 0;      // requests queued or being processed
+        std::size_t inFlightBytes = 0; // their payload buffers
+        bool closed = false;
+        bool reading = true;  // EPOLLIN armed
+        bool writing = false; // EPOLLOUT armed
+        bool resumeQueued = false;
+
+        // Keys loaded on this connection by the id LoadKey returned (workers only)
+        std::mutex keysLock;
+        std::unordered_map<uint32_t, std::shared_ptr<const KeyEntry>> keys;
+        uint32_t nextKeyId = 1;
+    };
+
+    struct Server::Tally
+    {
+        uint64_t requests = 0, errors = 0, bytesIn = 0, bytesOut = 0, multiBufferJobs = 0;
+        BCStats::Timing latency;
+    };
+
+    std::string ServerStats::format() const
+    {
+        char text[1024];
+        double seconds = uptimeSeconds > 0 ? uptimeSeconds : 1e-9;
+        double meanUs = latency.calls == 0 ? 0.0 : static_cast<double>(latency.nanoseconds) / latency.calls / 1e3;
+        std::snprintf(text, sizeof(text),
+                      "uptime_seconds %.3f\n"
+                      "connections %llu\n"
+                      "active_connections %llu\n"
+                      "requests %llu\n"
+                      "errors %llu\n"
+                      "bytes_in %llu\n"
+                      "bytes_out %llu\n"
+                      "batches %llu\n"
+                      "multi_buffer_jobs %llu\n"
+                      "keys %llu\n"
+                      "requests_per_second %.1f\n"
+                      "mib_per_second %.2f\n"
+                      "latency_mean_us %.1f\n"
+                      "latency_p50_us %.1f\n"
+                      "latency_p99_us %.1f\n",
+                      uptimeSeconds, static_cast<unsigned long long>(connections),
+                      static_cast<unsigned long long>(activeConnections), static_cast<unsigned long long>(requests),
+                      static_cast<unsigned long long>(errors), static_cast<unsigned long long>(bytesIn),
+                      static_cast<unsigned long long>(bytesOut), static_cast<unsigned long long>(batches),
+                      static_cast<unsigned long long>(multiBufferJobs), static_cast<unsigned long long>(keys),
+                      static_cast<double>(requests) / seconds, static_cast<double>(bytesIn) / (1024.0 * 1024.0) / seconds,
+                      meanUs, static_cast<double>(latency.percentileNs(50)) / 1e3,
+                      static_cast<double>(latency.percentileNs(99)) / 1e3);
+        return text;
+    }
+
+    Server::Server(const ServerOptions &opts) : options(opts), startNs(now())
+    {
+        BlockCrypt::Key secret;
+        std::random_device rd;
+        for (uint8_t &b : secret)
+            b = static_cast<uint8_t>(rd());
+        fingerprintKey = std::make_unique<BlockCrypt>(secret);
+        std::fill(secret.begin(), secret.end(), 0);
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (options.socketPath.empty() || options.socketPath.size() >= sizeof(addr.sun_path))
+            throw std::runtime_error("Socket path '" + options.socketPath + "' is empty or too long");
+        std::memcpy(addr.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+        const sockaddr *sa = reinterpret_cast<const sockaddr *>(&addr);
+
+        try
+        {
+            listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd < 0)
+                fail("Cannot create socket", options.socketPath);
+            if (::bind(listenFd, sa, sizeof(addr)) != 0)
+            {
+                if (errno != EADDRINUSE)
+                    fail("Cannot bind", options.socketPath);
+                // Someone answering there is a live server; otherwise the file is left over
+                int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                bool live = probe >= 0 && ::connect(probe, sa, sizeof(addr)) == 0;
+                if (probe >= 0)
+                    ::close(probe);
+                if (live)
+                    throw std::runtime_error("A server is already listening on '" + options.socketPath + "'");
+                ::unlink(options.socketPath.c_str());
+                if (::bind(listenFd, sa, sizeof(addr)) != 0)
+                    fail("Cannot bind", options.socketPath);
+            }
+            if (::chmod(options.socketPath.c_str(), options.socketMode) != 0 || ::listen(listenFd, SOMAXCONN) != 0)
+                fail("Cannot listen on", options.socketPath);
+
+            epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+            wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (epollFd < 0 || wakeFd < 0)
+                fail("Cannot create event queue for", options.socketPath);
+            for (int fd : {listenFd, wakeFd})
+            {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = fd;
+                if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+                    fail("Cannot watch", options.socketPath);
+            }
+        }
+        catch (...)
+        {
+            for (int fd : {listenFd, epollFd, wakeFd})
+            {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+            throw;
+        }
+
+        unsigned count = options.workers != 0 ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < count; ++i)
+            workers.emplace_back(&Server::workerLoop, this);
+    }
+
+    Server::~Server()
+    {
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            workersStopping = true;
+        }
+        queueReady.notify_all();
+        for (std::thread &t : workers)
+            t.join();
+
+        queue.clear();
+        parsed.clear();
+        resumed.clear();
+        connections.clear();
+        ::close(epollFd);
+        ::close(wakeFd);
+        ::close(listenFd);
+        ::unlink(options.socketPath.c_str());
+    }
+
+    void Server::stop()
+    {
+        stopping.store(true);
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written; // the counter is already non-zero if this fails
+    }
+
+    void Server::run()
+    {
+        epoll_event events[64];
+        while (!stopping.load())
+        {
+            int n = ::epoll_wait(epollFd, events, 64, -1);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                fail("epoll_wait failed on", options.socketPath);
+            }
+
+            for (int i = 0; i < n; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (fd == listenFd)
+                {
+                    accept();
+                    continue;
+                }
+                if (fd == wakeFd)
+                {
+                    uint64_t value;
+                    while (::read(wakeFd, &value, sizeof(value)) > 0)
+                    {
+                    }
+                    std::vector<std::shared_ptr<Connection>> ready;
+                    {
+                        std::lock_guard<std::mutex> guard(resumeLock);
+                        ready.swap(resumed);
+                    }
+                    for (const std::shared_ptr<Connection> &conn : ready)
+                    {
+                        {
+                            std::lock_guard<std::mutex> guard(conn->lock);
+                            conn->resumeQueued = false;
+                            if (conn->closed)
+                                continue;
+                            conn->reading = true;
+                            updateEvents(*conn);
+                        }
+                        parse(conn); // frames already buffered when reading paused
+                    }
+                    continue;
+                }
+
+                auto it = connections.find(fd);
+                if (it == connections.end())
+                    continue;
+                std::shared_ptr<Connection> conn = it->second;
+                if (events[i].events & EPOLLOUT)
+                {
+                    std::lock_guard<std::mutex> guard(conn->lock);
+                    flush(*conn);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    readable(conn);
+            }
+
+            // Everything read in this round goes to the workers in one go, so a worker can
+            // take requests of several connections as one batch
+            if (!parsed.empty())
+            {
+                std::size_t count = parsed.size();
+                {
+                    std::lock_guard<std::mutex> guard(queueLock);
+                    for (Job &job : parsed)
+                        queue.push_back(std::move(job));
+                }
+                parsed.clear();
+                if (count > options.maxBatch)
+                    queueReady.notify_all();
+                else
+                    queueReady.notify_one();
+            }
+        }
+    }
+
+    void Server::accept()
+    {
+        for (;;)
+        {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return; // EAGAIN, or a failed connection that the client will notice
+
+            auto conn = std::make_shared<Connection>(fd);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+                continue; // conn closes the descriptor
+            connections.emplace(fd, std::move(conn));
+
+            std::lock_guard<std::mutex> guard(statsLock);
+            ++counters.connections;
+            ++counters.activeConnections;
+        }
+    }
+
+    void Server::readable(const std::shared_ptr<Connection> &conn)
+    {
+        // One recv per event: level-triggered epoll comes back for the rest, and a busy
+        // connection cannot starve the others
+        if (conn->rx.size() - conn->rxUsed < kReadChunk)
+            conn->rx.resize(conn->rxUsed + kReadChunk);
+        ssize_t n = ::recv(conn->fd, conn->rx.data() + conn->rxUsed, conn->rx.size() - conn->rxUsed, 0);
+        if (n > 0)
+        {
+            conn->rxUsed += static_cast<std::size_t>(n);
+            parse(conn);
+        }
+        else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            close(conn);
+    }
+
+    void Server::parse(const std::shared_ptr<Connection> &conn)
+    {
+        std::size_t pos = 0;
+        while (conn->rxUsed - pos >= kRequestHeaderBytes)
+        {
+            RequestHeader h = decodeRequest(conn->rx.data() + pos);
+            if (h.length > options.maxPayload)
+            {
+                close(conn); // the stream cannot be resynchronised
+                return;
+            }
+            std::size_t frame = kRequestHeaderBytes + h.length;
+            if (conn->rxUsed - pos < frame)
+            {
+                if (conn->rx.size() < frame)
+                    conn->rx.resize(frame + kReadChunk); // room for the whole frame once it is moved to the front
+                break;
+            }
+
+            // Encryption pads in place: one spare block
+            bool pads = h.op == Op::EncryptCBC || h.op == Op::EncryptECB;
+            std::size_t bytes = h.length + (pads ? BLOCK_SIZE : 0);
+            {
+                // A frame always goes through on an idle connection, even one above the byte limit
+                std::lock_guard<std::mutex> guard(conn->lock);
+                if (conn->inFlight >= options.maxInFlight ||
+                    (conn->inFlight != 0 && conn->inFlightBytes + bytes > options.maxInFlightBytes))
+                {
+                    conn->reading = false; // resumed by a worker, see respond()
+                    updateEvents(*conn);
+                    break;
+                }
+                ++conn->inFlight;
+                conn->inFlightBytes += bytes;
+            }
+
+            Job job;
+            job.conn = conn;
+            job.header = h;
+            job.receivedNs = now();
+            job.bytes = bytes;
+            job.payload = BC::BufferPool::instance().acquire(bytes, BC::BufferPool::Use::Sensitive);
+            job.payload.resize(h.length);
+            if (h.length != 0)
+                std::memcpy(job.payload.data(), conn->rx.data() + pos + kRequestHeaderBytes, h.length);
+            parsed.push_back(std::move(job));
+            pos += frame;
+        }
+
+        if (pos != 0)
+        {
+            std::memmove(conn->rx.data(), conn->rx.data() + pos, conn->rxUsed - pos);
+            conn->rxUsed -= pos;
+        }
+        if (conn->rxUsed == 0 && conn->rx.size() > 4 * kReadChunk)
+            std::vector<uint8_t>().swap(conn->rx); // drop the room made for a large frame
+    }
+
+    void Server::close(const std::shared_ptr<Connection> &conn)
+    {
+        {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            conn->closed = true;
+            conn->tx.clear();
+        }
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+        connections.erase(conn->fd);
+
+        std::lock_guard<std::mutex> guard(statsLock);
+        --counters.activeConnections;
+    }
+
+    // Called with conn.lock held
+    void Server::updateEvents(Connection &conn)
+    {
+        if (conn.closed)
+            return;
+        epoll_event ev{};
+        ev.events = (conn.reading ? EPOLLIN : 0u) | (conn.writing ? EPOLLOUT : 0u);
+        ev.data.fd = conn.fd;
+        ::epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+    }
+
+    // Called with conn.lock held: writes queued responses until done or the socket is full
+    void Server::flush(Connection &conn)
+    {
+        while (!conn.tx.empty() && !conn.closed)
+        {
+            iovec iov[kMaxIov];
+            std::size_t count = 0;
+            for (auto it = conn.tx.begin(); it != conn.tx.end() && count + 2 <= kMaxIov; ++it)
+            {
+                std::size_t skip = it->sent;
+                if (skip < kResponseHeaderBytes)
+                {
+                    iov[count++] = {it->header + skip, kResponseHeaderBytes - skip};
+                    skip = 0;
+                }
+                else
+                    skip -= kResponseHeaderBytes;
+                if (it->end - it->begin > skip)
+                    iov[count++] = {it->body.data() + it->begin + skip, it->end - it->begin - skip};
+            }
+
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            ssize_t n = ::sendmsg(conn.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    if (!conn.writing)
+                    {
+                        conn.writing = true;
+                        updateEvents(conn);
+                    }
+                    return;
+                }
+                conn.tx.clear(); // peer gone; the loop sees the hangup and closes
+                break;
+            }
+
+            std::size_t left = static_cast<std::size_t>(n);
+            while (left != 0)
+            {
+                Outgoing &out = conn.tx.front();
+                std::size_t take = std::min(left, out.total() - out.sent);
+                out.sent += take;
+                left -= take;
+                if (out.sent == out.total())
+                    conn.tx.pop_front();
+            }
+        }
+
+        if (conn.writing)
+        {
+            conn.writing = false;
+            updateEvents(conn);
+        }
+    }
+
+    void Server::workerLoop()
+    {
+        std::vector<Job> jobs;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(queueLock);
+                queueReady.wait(lock, [&] { return workersStopping || !queue.empty(); });
+                if (workersStopping)
+                    return;
+                std::size_t take = std::min(options.maxBatch, queue.size());
+                for (std::size_t i = 0; i < take; ++i)
+                {
+                    jobs.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+                if (!queue.empty())
+                    queueReady.notify_one();
+            }
+            process(jobs);
+            jobs.clear();
+        }
+    }
+
+    void Server::process(std::vector<Job> &jobs)
+    {
+        Tally tally;
+
+        // CBC encryptions grouped by key and padding go through the multi-buffer kernel. Keys
+        // are resolved per request (ids are per connection) and grouped by the shared entry, so
+        // connections that loaded the same key still batch together.
+        struct Keyed
+        {
+            Job *job;
+            std::shared_ptr<const KeyEntry> key;
+        };
+        std::vector<Keyed> cbc;
+        for (Job &job : jobs)
+        {
+            const RequestHeader &h = job.header;
+            bool pad = (h.flags & kNoPadding) == 0;
+            if (h.op == Op::EncryptCBC && h.length >= kPrefixBytes && (pad || (h.length - kPrefixBytes) % BLOCK_SIZE == 0))
+            {
+                std::shared_ptr<const KeyEntry> key = findKey(*job.conn, h.keyId);
+                if (key == nullptr)
+                    respondError(job, Status::UnknownKey, "unknown key id", tally);
+                else
+                    cbc.push_back({&job, std::move(key)});
+            }
+            else
+                runSingle(job, tally);
+        }
+        std::less<const KeyEntry *> before;
+        std::stable_sort(cbc.begin(), cbc.end(), [&](const Keyed &a, const Keyed &b)
+                         { return a.key != b.key ? before(a.key.get(), b.key.get())
+                                                 : a.job->header.flags < b.job->header.flags; });
+
+        std::vector<BC::CBCJob> batch;
+        for (std::size_t first = 0; first < cbc.size();)
+        {
+            std::size_t last = first + 1;
+            while (last < cbc.size() && cbc[last].key == cbc[first].key &&
+                   cbc[last].job->header.flags == cbc[first].job->header.flags)
+                ++last;
+
+            batch.clear();
+            for (std::size_t i = first; i < last; ++i)
+            {
+                BC::PooledBuffer &p = cbc[i].job->payload;
+                BlockCrypt::Block iv;
+                std::memcpy(iv.data(), p.data(), BLOCK_SIZE);
+                batch.push_back({p.data() + kPrefixBytes, p.data() + kPrefixBytes, p.size() - kPrefixBytes, iv});
+            }
+            bool pad = (cbc[first].job->header.flags & kNoPadding) == 0;
+            cbc[first].key->with([&](const auto &aes) { BC::encryptCBCBatch(aes, batch.data(), batch.size(), pad); });
+
+            if (last - first > 1)
+                tally.multiBufferJobs += last - first;
+            for (std::size_t i = first; i < last; ++i)
+                respond(*cbc[i].job, Status::Ok, kPrefixBytes, kPrefixBytes + batch[i - first].written, tally);
+            first = last;
+        }
+
+        std::lock_guard<std::mutex> guard(statsLock);
+        ++counters.batches;
+        counters.requests += tally.requests;
+        counters.errors += tally.errors;
+        counters.bytesIn += tally.bytesIn;
+        counters.bytesOut += tally.bytesOut;
+        counters.multiBufferJobs += tally.multiBufferJobs;
+        counters.latency.calls += tally.latency.calls;
+        counters.latency.nanoseconds += tally.latency.nanoseconds;
+        for (std::size_t i = 0; i < BCStats::kBuckets; ++i)
+            counters.latency.histogram[i] += tally.latency.histogram[i];
+    }
+
+    void Server::runSingle(Job &job, Tally &tally)
+    {
+        const RequestHeader &h = job.header;
+        BC::PooledBuffer &p = job.payload;
+        bool pad = (h.flags & kNoPadding) == 0;
+
+        if (h.op == Op::LoadKey)
+        {
+            Status status = Status::Ok;
+            uint32_t id = loadKey(*job.conn, p.data(), p.size(), status);
+            std::memset(p.data(), 0, p.size()); // the raw key
+            if (status != Status::Ok)
+            {
+                respondError(job, status, status == Status::BadRequest ? "key must be 16, 24 or 32 bytes" : "key table full", tally);
+                return;
+            }
+            p.resize(4);
+            putU32(p.data(), id);
+            respond(job, Status::Ok, 0, 4, tally);
+            return;
+        }
+        if (h.op == Op::UnloadKey)
+        {
+            if (!unloadKey(*job.conn, h.keyId))
+            {
+                respondError(job, Status::UnknownKey, "unknown key id", tally);
+                return;
+            }
+            respond(job, Status::Ok, 0, 0, tally);
+            return;
+        }
+        if (h.op == Op::Stats)
+        {
+            std::string text = stats().format();
+            p = BC::BufferPool::instance().acquire(text.size());
+            std::memcpy(p.data(), text.data(), text.size());
+            respond(job, Status::Ok, 0, text.size(), tally);
+            return;
+        }
+        if (h.op != Op::DecryptCBC && h.op != Op::CTR && h.op != Op::EncryptECB && h.op != Op::DecryptECB &&
+            h.op != Op::EncryptCBC)
+        {
+            respondError(job, Status::BadRequest, "unknown op", tally);
+            return;
+        }
+        if (hasPrefix(h.op) && p.size() < kPrefixBytes)
+        {
+            respondError(job, Status::BadRequest, "missing IV or counter block", tally);
+            return;
+        }
+        std::shared_ptr<const KeyEntry> key = findKey(*job.conn, h.keyId);
+        if (key == nullptr)
+        {
+            respondError(job, Status::UnknownKey, "unknown key id", tally);
+            return;
+        }
+
+        try
+        {
+            BlockCrypt::Block prefix{};
+            if (hasPrefix(h.op))
+                std::memcpy(prefix.data(), p.data(), BLOCK_SIZE);
+            uint8_t *data = p.data() + (hasPrefix(h.op) ? kPrefixBytes : 0);
+            std::size_t length = p.size() - (hasPrefix(h.op) ? kPrefixBytes : 0);
+            std::size_t begin = hasPrefix(h.op) ? kPrefixBytes : 0;
+            std::size_t end = 0;
+
+            key->with([&](const auto &aes)
+            {
+                switch (h.op)
+                {
+                case Op::EncryptCBC: // only if not block aligned without padding: throws
+                    end = begin + BC::encryptCBC(aes, prefix, data, length, data, p.capacity() - begin, pad);
+                    break;
+                case Op::DecryptCBC:
+                    end = begin + BC::decryptCBC(aes, prefix, data, length, data, length, pad);
+                    break;
+                case Op::CTR:
+                    BC::cryptCTR(aes, prefix, 0, data, length);
+                    end = begin + length;
+                    break;
+                case Op::EncryptECB:
+                    BC::encryptECB(p, aes, pad);
+                    end = p.size();
+                    break;
+                default:
+                    BC::decryptECB(p, aes, pad);
+                    end = p.size();
+                    break;
+                }
+            });
+            respond(job, Status::Ok, begin, end, tally);
+        }
+        catch (const std::exception &e)
+        {
+            respondError(job, Status::Failed, e.what(), tally);
+        }
+    }
+
+    void Server::respondError(Job &job, Status status, const std::string &message, Tally &tally)
+    {
+        job.payload = BC::BufferPool::instance().acquire(message.size());
+        std::memcpy(job.payload.data(), message.data(), message.size());
+        respond(job, status, 0, message.size(), tally);
+    }
+
+    void Server::respond(Job &job, Status status, std::size_t begin, std::size_t end, Tally &tally)
+    {
+        const RequestHeader &h = job.header;
+        ++tally.requests;
+        if (status != Status::Ok)
+            ++tally.errors;
+        else if (h.op != Op::LoadKey && h.op != Op::UnloadKey && h.op != Op::Stats)
+        {
+            tally.bytesIn += h.length - (hasPrefix(h.op) ? kPrefixBytes : 0);
+            tally.bytesOut += end - begin;
+        }
+
+        Outgoing out;
+        encodeResponse({static_cast<uint32_t>(end - begin), h.id, status}, out.header);
+        out.body = std::move(job.payload);
+        out.begin = begin;
+        out.end = end;
+
+        Connection &conn = *job.conn;
+        std::lock_guard<std::mutex> guard(conn.lock);
+        addLatency(tally.latency, now() - job.receivedNs);
+        if (!conn.closed)
+        {
+            conn.tx.push_back(std::move(out));
+            if (!conn.writing)
+                flush(conn); // otherwise the loop is already waiting for room
+        }
+
+        // Resume a paused connection once half of its requests (and bytes) are answered
+        --conn.inFlight;
+        conn.inFlightBytes -= job.bytes;
+        if (!conn.reading && !conn.closed && !conn.resumeQueued && conn.inFlight <= options.maxInFlight / 2 &&
+            conn.inFlightBytes <= options.maxInFlightBytes / 2)
+        {
+            conn.resumeQueued = true;
+            {
+                std::lock_guard<std::mutex> resumeGuard(resumeLock);
+                resumed.push_back(job.conn);
+            }
+            uint64_t one = 1;
+            ssize_t written = ::write(wakeFd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    std::shared_ptr<const Server::KeyEntry> Server::findKey(Connection &conn, uint32_t id) const
+    {
+        std::lock_guard<std::mutex> guard(conn.keysLock);
+        auto it = conn.keys.find(id);
+        return it == conn.keys.end() ? nullptr : it->second;
+    }
+
+    // CBC-MAC under the per-server random key over a length block and the key bytes: equal
+    // keys match, but the table holds no key material and cannot be probed without the secret
+    std::string Server::fingerprint(const uint8_t *key, std::size_t length) const
+    {
+        uint8_t message[3 * BLOCK_SIZE] = {};
+        message[0] = static_cast<uint8_t>(length);
+        std::memcpy(message + BLOCK_SIZE, key, length);
+        std::size_t total = BLOCK_SIZE + (length + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+        BC::encryptCBC(*fingerprintKey, BlockCrypt::Block{}, message, total, message, sizeof(message), false);
+        std::string tag(reinterpret_cast<const char *>(message + total - BLOCK_SIZE), BLOCK_SIZE);
+        std::memset(message, 0, sizeof(message));
+        return tag;
+    }
+
+    uint32_t Server::loadKey(Connection &conn, const uint8_t *key, std::size_t length, Status &status)
+    {
+        if (length != 16 && length != 24 && length != 32)
+        {
+            status = Status::BadRequest;
+            return 0;
+        }
+        {
+            std::lock_guard<std::mutex> guard(conn.keysLock);
+            if (conn.keys.size() >= options.maxKeys)
+            {
+                status = Status::KeyTableFull;
+                return 0;
+            }
+        }
+
+        std::string tag = fingerprint(key, length);
+        std::shared_ptr<const KeyEntry> entry;
+        {
+            std::shared_lock<std::shared_mutex> guard(keysLock);
+            auto it = sharedKeys.find(tag);
+            if (it != sharedKeys.end())
+                entry = it->second.lock();
+        }
+        if (entry == nullptr)
+        {
+            // Expanded outside the lock; a concurrent load of the same key keeps the first entry
+            auto fresh = std::make_shared<KeyEntry>();
+            if (length == 16)
+            {
+                BlockCrypt::Key k;
+                std::memcpy(k.data(), key, length);
+                fresh->aes128 = std::make_unique<BlockCrypt>(k);
+            }
+            else if (length == 24)
+            {
+                BlockCrypt192::Key k;
+                std::memcpy(k.data(), key, length);
+                fresh->aes192 = std::make_unique<BlockCrypt192>(k);
+            }
+            else
+            {
+                BlockCrypt256::Key k;
+                std::memcpy(k.data(), key, length);
+                fresh->aes256 = std::make_unique<BlockCrypt256>(k);
+            }
+
+            std::unique_lock<std::shared_mutex> guard(keysLock);
+            std::weak_ptr<const KeyEntry> &slot = sharedKeys[tag];
+            entry = slot.lock();
+            if (entry == nullptr)
+            {
+                entry = std::move(fresh);
+                slot = entry;
+            }
+            if (sharedKeys.size() >= sweepAt)
+            {
+                for (auto it = sharedKeys.begin(); it != sharedKeys.end();)
+                    it = it->second.expired() ? sharedKeys.erase(it) : std::next(it);
+                sweepAt = std::max<std::size_t>(64, 2 * sharedKeys.size());
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(conn.keysLock);
+        if (conn.keys.size() >= options.maxKeys) // a concurrent LoadKey on the same connection
+        {
+            status = Status::KeyTableFull;
+            return 0;
+        }
+        uint32_t id;
+        do
+            id = conn.nextKeyId++;
+        while (id == 0 || conn.keys.count(id) != 0); // 0 is never valid; skip live ids after a wrap
+        conn.keys.emplace(id, std::move(entry));
+        return id;
+    }
+
+    bool Server::unloadKey(Connection &conn, uint32_t id)
+    {
+        std::lock_guard<std::mutex> guard(conn.keysLock);
+        return conn.keys.erase(id) != 0; // running jobs keep their own reference
+    }
+
+    ServerStats Server::stats() const
+    {
+        ServerStats s;
+        {
+            std::lock_guard<std::mutex> guard(statsLock);
+            s = counters;
+        }
+        {
+            std::shared_lock<std::shared_mutex> guard(keysLock);
+            for (const auto &entry : sharedKeys)
+                s.keys += entry.second.expired() ? 0 : 1;
+        }
+        s.uptimeSeconds = static_cast<double>(now() - startNs) / 1e9;
+        return s;
+    }
+} // namespace BCDaemon
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "blockcrypt.hpp"
+#include "bufferpool.hpp"
+#include "protocol.hpp"
+#include "stats.hpp"
+
+namespace BCDaemon
+{
+    struct ServerOptions
+    {
+        std::string socketPath = "/tmp/blockcryptd.sock";
+        unsigned socketMode = 0600;                     // permissions of the socket file
+        unsigned workers = 0;                           // 0: one per core
+        std::size_t maxBatch = 64;                      // requests a worker takes from the queue at once
+        std::size_t maxPayload = std::size_t(16) << 20; // larger frames close the connection
+        std::size_t maxKeys = 256;                      // loaded keys per connection (UnloadKey frees one)
+        std::size_t maxInFlight = 1024;                 // requests per connection; reading pauses beyond it
+        std::size_t maxInFlightBytes = std::size_t(64) << 20; // payload bytes per connection, likewise
+    };
+
+    struct ServerStats
+    {
+        uint64_t connections = 0; // accepted since start
+        uint64_t activeConnections = 0;
+        uint64_t requests = 0;        // answered, including errors
+        uint64_t errors = 0;          // answered with a status other than Ok
+        uint64_t bytesIn = 0;         // request data bytes (without IV/counter prefixes)
+        uint64_t bytesOut = 0;        // response data bytes
+        uint64_t batches = 0;         // queue pops by a worker
+        uint64_t multiBufferJobs = 0; // CBC encryptions run side by side with another
+        uint64_t keys = 0;            // distinct resident expanded keys
+        double uptimeSeconds = 0;
+        BCStats::Timing latency; // frame received -> response queued, per request
+
+        // "name value" lines, the payload of a Stats response
+        std::string format() const;
+    };
+
+    /**
+     * @brief Local encryption service on a Unix domain socket.
+     *
+     * One thread runs an epoll loop that accepts connections, cuts the byte streams into
+     * request frames (see protocol.hpp) and queues them; a pool of workers takes up to
+     * maxBatch queued requests at a time. CBC encryptions under the same key in one take are
+     * handed to BC::encryptCBCBatch together, so many small concurrent requests fill the
+     * multi-buffer kernel instead of running one serial chain each; everything else runs
+     * request by request on the buffer-based APIs. Workers write responses themselves and
+     * leave what the socket does not accept to the loop (EPOLLOUT).
+     *
+     * Keys are expanded by LoadKey and stay resident until the connection unloads them or
+     * closes, so client processes neither link the library nor pay for key expansion per
+     * request. Key ids are private to the connection that loaded the key: another client
+     * cannot use them, and has no way to learn which keys are loaded. Connections that load
+     * the same key share one expanded context (found through a keyed fingerprint of the key,
+     * never the key bytes), so their CBC encryptions still batch together. Request and
+     * response data live in BC::BufferPool buffers, transformed in place.
+     */
+    class Server
+    {
+    public:
+        /**
+         * Creates and binds the socket (a stale socket file left by a dead server is replaced).
+         * @throws std::runtime_error if the socket cannot be created or another server is
+         *         already listening on the path.
+         */
+        explicit Server(const ServerOptions &options);
+        ~Server(); // stops, joins the workers and removes the socket file
+
+        Server(const Server &) = delete;
+        Server &operator=(const Server &) = delete;
+
+        // Serves until stop() is called
+        void run();
+
+        // Makes run() return; async-signal-safe (a single write to an eventfd)
+        void stop();
+
+        ServerStats stats() const;
+
+    private:
+        struct KeyEntry;
+        struct Outgoing;
+        struct Connection;
+        struct Tally;
+
+        struct Job
+        {
+            std::shared_ptr<Connection> conn;
+            RequestHeader header;
+            BC::PooledBuffer payload; // transformed in place and sent back as the response
+            uint64_t receivedNs = 0;
+            std::size_t bytes = 0; // charged to the connection's in-flight bytes
+        };
+
+        void accept();
+        void readable(const std::shared_ptr<Connection> &conn);
+        void parse(const std::shared_ptr<Connection> &conn);
+        void close(const std::shared_ptr<Connection> &conn);
+        void flush(Connection &conn);
+        void updateEvents(Connection &conn);
+
+        void workerLoop();
+        void process(std::vector<Job> &jobs);
+        void runSingle(Job &job, Tally &tally);
+        void respond(Job &job, Status status, std::size_t begin, std::size_t end, Tally &tally);
+        void respondError(Job &job, Status status, const std::string &message, Tally &tally);
+        std::shared_ptr<const KeyEntry> findKey(Connection &conn, uint32_t id) const;
+        uint32_t loadKey(Connection &conn, const uint8_t *key, std::size_t length, Status &status);
+        bool unloadKey(Connection &conn, uint32_t id);
+        std::string fingerprint(const uint8_t *key, std::size_t length) const;
+
+        ServerOptions options;
+        int listenFd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;
+        std::atomic<bool> stopping{false};
+        uint64_t startNs = 0;
+
+        std::unordered_map<int, std::shared_ptr<Connection>> connections; // loop thread only
+        std::vector<Job> parsed; // frames of one epoll round, queued together (loop thread only)
+
+        std::mutex queueLock;
+        std::condition_variable queueReady;
+        std::deque<Job> queue;
+        bool workersStopping = false;
+        std::vector<std::thread> workers;
+
+        // Connections whose in-flight count dropped below the limit; the loop resumes reading
+        std::mutex resumeLock;
+        std::vector<std::shared_ptr<Connection>> resumed;
+
+        // Expanded keys shared by the connections that loaded them, by keyed fingerprint; an
+        // entry dies with the last connection table (or running job) holding it
+        std::unique_ptr<BlockCrypt> fingerprintKey; // random per server
+        mutable std::shared_mutex keysLock;
+        mutable std::unordered_map<std::string, std::weak_ptr<const KeyEntry>> sharedKeys;
+        std::size_t sweepAt = 64; // sharedKeys size that triggers dropping expired entries
+
+        mutable std::mutex statsLock;
+        ServerStats counters;
+    };
+} // namespace BCDaemon
@@ -0,0 +1,128 @@
+#include <catch2/catch_all.hpp>
+#include "CBC.hpp"
+#include "client.hpp"
+#include "server.hpp"
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    // A server on a private socket, run on its own thread for the duration of a test
+    struct RunningServer
+    {
+        explicit RunningServer(BCDaemon::ServerOptions options)
+        {
+            options.socketPath = "/tmp/blockcryptd_test_" + std::to_string(::getpid()) + ".sock";
+            options.workers = 2;
+            path = options.socketPath;
+            server = std::make_unique<BCDaemon::Server>(options);
+            thread = std::thread([this] { server->run(); });
+        }
+        ~RunningServer()
+        {
+            server->stop();
+            thread.join();
+        }
+
+        std::string path;
+        std::unique_ptr<BCDaemon::Server> server;
+        std::thread thread;
+    };
+
+    uint64_t statValue(const std::string &stats, const std::string &name)
+    {
+        std::size_t pos = stats.find(name + " ");
+        if (pos == std::string::npos)
+            throw std::runtime_error("no " + name + " in stats");
+        return std::stoull(stats.substr(pos + name.size() + 1));
+    }
+} // namespace
+
+// ------------ Daemon key handles ------------
+/*
+    Key ids belong to the connection that loaded the key: another connection cannot use or
+    unload them, and a full table on one connection leaves the others unaffected. Connections
+    loading the same key share one expanded context, which lives until the last of them
+    unloads it or disconnects.
+*/
+TEST_CASE("Daemon key ids are private to their connection", "[daemon]")
+{
+    BCDaemon::ServerOptions options;
+    options.maxKeys = 3;
+    RunningServer running(options);
+
+    BlockCrypt::Key key{};
+    key[0] = 0x42;
+    BlockCrypt::Block iv{};
+    std::vector<uint8_t> data(40, 7), expected = data;
+    BC::encryptCBC(expected, key, iv);
+
+    BCDaemon::Client a(running.path), b(running.path);
+    uint32_t idA = a.loadKey(key.data(), key.size());
+    REQUIRE(a.call(BCDaemon::Op::EncryptCBC, idA, iv.data(), data.data(), data.size()) == expected);
+
+    // Connection b never loaded a key: every id is unknown to it
+    for (uint32_t id = 0; id < 8; ++id)
+    {
+        b.send(BCDaemon::Op::EncryptCBC, id, iv.data(), data.data(), data.size());
+        REQUIRE(b.receive().status == BCDaemon::Status::UnknownKey);
+    }
+    REQUIRE_THROWS_AS(b.unloadKey(idA), std::runtime_error);
+
+    // The same key on b gets its own id but shares the expanded context
+    uint32_t idB = b.loadKey(key.data(), key.size());
+    REQUIRE(b.call(BCDaemon::Op::EncryptCBC, idB, iv.data(), data.data(), data.size()) == expected);
+    REQUIRE(statValue(a.stats(), "keys") == 1);
+
+    // A full table is per connection, and unloading frees a slot
+    BlockCrypt::Key other = key;
+    for (int i = 1; i < 3; ++i)
+    {
+        other[1] = uint8_t(i);
+        a.loadKey(other.data(), other.size());
+    }
+    a.send(BCDaemon::Op::LoadKey, 0, nullptr, other.data(), other.size());
+    REQUIRE(a.receive().status == BCDaemon::Status::KeyTableFull);
+    other[1] = 9;
+    REQUIRE(b.loadKey(other.data(), other.size()) != 0);
+    a.unloadKey(idA);
+    a.send(BCDaemon::Op::EncryptCBC, idA, iv.data(), data.data(), data.size());
+    REQUIRE(a.receive().status == BCDaemon::Status::UnknownKey);
+    REQUIRE(a.loadKey(key.data(), key.size()) != 0);
+
+    // b still holds the shared key after a unloaded it
+    REQUIRE(b.call(BCDaemon::Op::EncryptCBC, idB, iv.data(), data.data(), data.size()) == expected);
+}
+
+// ------------ Daemon in-flight byte limit ------------
+/*
+    A connection that pipelines more request bytes than maxInFlightBytes is paused rather
+    than buffered without bound, and resumes as responses go out: every request is answered.
+*/
+TEST_CASE("Daemon bounds the bytes a connection has in flight", "[daemon]")
+{
+    BCDaemon::ServerOptions options;
+    options.maxInFlightBytes = 64 * 1024;
+    RunningServer running(options);
+
+    BlockCrypt::Key key{};
+    BlockCrypt::Block iv{};
+    std::vector<uint8_t> data(20'000, 3), expected = data;
+    BC::encryptCBC(expected, key, iv);
+
+    BCDaemon::Client client(running.path);
+    uint32_t id = client.loadKey(key.data(), key.size());
+    constexpr int kRequests = 200; // 4 MB pipelined, 3 frames fit the limit
+    std::thread sender([&]
+    {
+        for (int i = 0; i < kRequests; ++i)
+            client.send(BCDaemon::Op::EncryptCBC, id, iv.data(), data.data(), data.size());
+    });
+    int ok = 0;
+    for (int i = 0; i < kRequests; ++i)
+        ok += client.receive().payload == expected ? 1 : 0;
+    sender.join();
+    REQUIRE(ok == kRequests);
+}
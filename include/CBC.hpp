@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include "../include/blockcrypt.hpp"
+#include "../include/bufferpool.hpp"
 
 namespace BC
 {
@@ -20,6 +23,211 @@ namespace BC
      * @param data The encrypted input buffer (must be a multiple of 16 bytes). Modified in-place with plaintext.
      * @param key The symmetric AES key that was used to encrypt the original message.
      * @param iv The initialization vector used during encryption. Required for correct decryption of the first block.
+     * @param lanes Blocks kept in flight per AES round (see BlockCrypt::decryptBlocks); 0 uses the engine default.
      */
-    void decryptCBC(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad = true);
+    void decryptCBC(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad = true, std::size_t lanes = 0);
+
+    /**
+     * encryptCBC/decryptCBC with a prebuilt cipher context, so the key schedule is expanded
+     * once and reused across messages (see BC::KeyCache for many keys). Instantiated for
+     * AES-128, AES-192 and AES-256 contexts.
+     *
+     * @param aes Cipher context holding the expanded key.
+     */
+    template <std::size_t KeyBytes>
+    void encryptCBC(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad = true);
+    template <std::size_t KeyBytes>
+    void decryptCBC(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad = true, std::size_t lanes = 0);
+
+    /**
+     * The same on a BC::PooledBuffer (see BufferPool). Padding is added within the buffer's
+     * capacity, so a buffer acquired for the padded length and resized to the plaintext
+     * length is encrypted without touching the allocator.
+     */
+    template <std::size_t KeyBytes>
+    void encryptCBC(PooledBuffer &data, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad = true);
+    template <std::size_t KeyBytes>
+    void decryptCBC(PooledBuffer &data, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad = true, std::size_t lanes = 0);
+
+    /**
+     * Buffer-based CBC encryption into caller-owned memory: no allocation and no resize.
+     * The PKCS#7 padding is written directly into the last output block.
+     *
+     * @param in Plaintext.
+     * @param length Plaintext size in bytes (a multiple of 16 when pad is false).
+     * @param out Destination; may equal `in` (in place), must not otherwise overlap it.
+     * @param capacity Size of `out`; at least BCPad::paddedLength(length) with padding,
+     *                 `length` without.
+     * @return Number of ciphertext bytes written.
+     * @throws std::runtime_error if `capacity` is too small or the input is misaligned.
+     */
+    template <std::size_t KeyBytes>
+    std::size_t encryptCBC(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv,
+                           const uint8_t *in, std::size_t length, uint8_t *out, std::size_t capacity, bool pad = true);
+
+    /**
+     * Buffer-based CBC decryption into caller-owned memory. The padding is checked and
+     * reported through the return value instead of resizing anything, and the last block
+     * goes through a stack buffer, so `out` only needs room for the actual plaintext.
+     *
+     * @param in Ciphertext (a multiple of 16 bytes).
+     * @param out Destination; may equal `in` (in place), must not otherwise overlap it.
+     * @param capacity Size of `out`; the unpadded plaintext must fit.
+     * @return Plaintext length (padding excluded).
+     * @throws std::runtime_error on misaligned input, corrupt padding or a too small `out`.
+     */
+    template <std::size_t KeyBytes>
+    std::size_t decryptCBC(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv,
+                           const uint8_t *in, std::size_t length, uint8_t *out, std::size_t capacity,
+                           bool pad = true, std::size_t lanes = 0);
+
+    /**
+     * @brief Decrypts only plaintext bytes [offset, offset + length) of a CBC message.
+     *
+     * Plaintext block j depends on ciphertext blocks j-1 and j alone (block -1 being the IV),
+     * so only the blocks overlapping the range are decrypted: serving 4 KB out of a 1 GB
+     * object costs 257 block decryptions instead of 67 million. With padding the range is
+     * clipped to the unpadded length; the final block is decrypted and its padding checked
+     * only when the range reaches it.
+     *
+     * @param in The whole ciphertext (a multiple of 16 bytes).
+     * @param inLength Ciphertext size in bytes.
+     * @param offset First plaintext byte wanted.
+     * @param out Destination for up to `length` bytes; must not overlap `in`.
+     * @param length Bytes wanted.
+     * @param pad The message carries PKCS#7 padding.
+     * @return Bytes written: less than `length` only when the range passes the end of the
+     *         plaintext (0 if `offset` is at or past it).
+     * @throws std::runtime_error on misaligned input, or corrupt padding when the range
+     *         reaches the final block.
+     */
+    template <std::size_t KeyBytes>
+    std::size_t decryptCBCRange(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv,
+                                const uint8_t *in, std::size_t inLength, uint64_t offset,
+                                uint8_t *out, std::size_t length, bool pad = true, std::size_t lanes = 0);
+
+    // The same returning a vector (shorter than `length` at the end of the plaintext)
+    template <std::size_t KeyBytes>
+    std::vector<uint8_t> decryptCBCRange(const std::vector<uint8_t> &ciphertext, const BasicBlockCrypt<KeyBytes> &aes,
+                                         const BlockCrypt::Block &iv, uint64_t offset, std::size_t length,
+                                         bool pad = true);
+
+    // One message of a multi-buffer CBC batch (see encryptCBCBatch)
+    struct CBCJob
+    {
+        const uint8_t *in;
+        uint8_t *out; // room for BCPad::paddedLength(length) bytes (length without padding); may equal in
+        std::size_t length;
+        BlockCrypt::Block iv;
+        std::size_t written = 0; // set to the ciphertext length once the job is done
+    };
+
+    /**
+     * @brief Multi-buffer CBC encryption of many independent messages.
+     *
+     * Each message is a serial CBC chain, but chains of different messages are independent:
+     * up to `lanes` messages are encrypted side by side, one block of each per step, through a
+     * single encryptBlocks call (so AES-NI/T-table interleave them and the bitsliced kernel fills
+     * its groups). When a message finishes, the next job takes over its lane. The output of
+     * every job is identical to encryptCBC on that message alone.
+     *
+     * @param jobs Messages to encrypt; `written` is filled in for each.
+     * @param count Number of jobs.
+     * @param pad Apply PKCS#7 padding (if false, every length must be a multiple of 16).
+     * @param lanes Messages in flight (1..16); 0 picks the engine's width (8 for AES-NI,
+     *              4 for T-table, the bitsliced group size for Bitsliced/VPerm).
+     * @throws std::runtime_error if a job is not block aligned without padding (before any
+     *         output is written).
+     */
+    template <std::size_t KeyBytes>
+    void encryptCBCBatch(const BasicBlockCrypt<KeyBytes> &aes, CBCJob *jobs, std::size_t count,
+                         bool pad = true, std::size_t lanes = 0);
+
+    /**
+     * @brief Streaming CBC encryption with constant memory.
+     *
+     * Carries the expanded key, the chaining block and up to 15 bytes of an incomplete block
+     * between update() calls, so input can arrive in chunks of any size (socket reads, file
+     * blocks) and never has to be gathered in one buffer. final() applies PKCS#7 padding
+     * through BCPad. The concatenated output equals encryptCBC over the concatenated input.
+     */
+    class CBCEncryptor
+    {
+    public:
+        CBCEncryptor(const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad = true);
+        CBCEncryptor(const BlockCrypt &aes, const BlockCrypt::Block &iv, bool pad = true); // reuses an expanded key
+
+        /**
+         * Encrypts every complete block available so far.
+         *
+         * @param in Next chunk of plaintext.
+         * @param length Chunk size in bytes (any size).
+         * @param out Destination with room for length + 15 bytes; may equal `in`.
+         * @return Number of ciphertext bytes written (a multiple of 16).
+         */
+        std::size_t update(const uint8_t *in, std::size_t length, uint8_t *out);
+
+        /**
+         * Pads and encrypts the remaining bytes.
+         *
+         * @param out Destination with room for 16 bytes.
+         * @return Bytes written: 16 with padding, 0 without.
+         * @throws std::runtime_error without padding if the input was not block aligned.
+         */
+        std::size_t final(uint8_t *out);
+
+        // Append the produced ciphertext to `out`
+        void update(const std::vector<uint8_t> &in, std::vector<uint8_t> &out);
+        void final(std::vector<uint8_t> &out);
+
+    private:
+        BlockCrypt aes;
+        BlockCrypt::Block prev;    // last ciphertext block (the IV at first)
+        BlockCrypt::Block partial; // buffered bytes of an incomplete block
+        std::size_t partialLen = 0;
+        bool pad;
+    };
+
+    /**
+     * @brief Streaming CBC decryption with constant memory; the counterpart of CBCEncryptor.
+     *
+     * With padding enabled the last complete block is held back until final(), since only
+     * then is it known to be the padding block. Decryption of the released blocks goes
+     * through the same batched multi-block path as decryptCBC.
+     */
+    class CBCDecryptor
+    {
+    public:
+        CBCDecryptor(const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad = true);
+        CBCDecryptor(const BlockCrypt &aes, const BlockCrypt::Block &iv, bool pad = true);
+
+        /**
+         * Decrypts every block that can be released so far.
+         *
+         * @param in Next chunk of ciphertext (any size).
+         * @param length Chunk size in bytes.
+         * @param out Destination with room for length + 15 bytes; may equal `in`.
+         * @return Number of plaintext bytes written (a multiple of 16).
+         */
+        std::size_t update(const uint8_t *in, std::size_t length, uint8_t *out);
+
+        /**
+         * Decrypts the held-back block and strips its padding.
+         *
+         * @param out Destination with room for 16 bytes.
+         * @return Plaintext bytes written (0..15 with padding, 0 without).
+         * @throws std::runtime_error if the ciphertext was not block aligned or the padding is corrupt.
+         */
+        std::size_t final(uint8_t *out);
+
+        void update(const std::vector<uint8_t> &in, std::vector<uint8_t> &out);
+        void final(std::vector<uint8_t> &out);
+
+    private:
+        BlockCrypt aes;
+        BlockCrypt::Block prev;
+        BlockCrypt::Block pending; // incomplete block, or the held-back last block
+        std::size_t pendingLen = 0;
+        bool pad;
+    };
 } // namespace BC (BlockCrypt)
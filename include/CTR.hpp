@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../include/blockcrypt.hpp"
+
+namespace BC
+{
+    using Nonce = std::array<uint8_t, 8>;
+
+    /**
+     * Builds an initial CTR counter block: the 8-byte nonce followed by the 64-bit block
+     * counter in big-endian order.
+     *
+     * @param nonce Per-message value; must never repeat under the same key.
+     * @param counter Index of the first keystream block (usually 0).
+     */
+    BlockCrypt::Block makeCounterBlock(const Nonce &nonce, uint64_t counter = 0);
+
+    /**
+     * Encrypts or decrypts (the operation is identical) `length` bytes of an AES-CTR stream
+     * in place, starting at byte `offset` of that stream.
+     *
+     * The keystream block for stream byte `offset` is E(counter + offset / 16), with the
+     * counter block incremented as a 128-bit big-endian integer (NIST SP 800-38A). Any byte
+     * range can therefore be processed on its own, without touching the bytes before it.
+     * Counter blocks are generated in batches and encrypted together through
+     * BlockCrypt::encryptBlocks. No padding is involved: the output has the input's length.
+     *
+     * @param aes Cipher holding the expanded key (AES-128, AES-192 or AES-256).
+     * @param counter Initial counter block (see makeCounterBlock), i.e. the one for offset 0.
+     * @param offset Position of data[0] within the stream, in bytes.
+     * @param data Bytes to transform in place.
+     * @param length Number of bytes.
+     */
+    template <std::size_t KeyBytes>
+    void cryptCTR(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &counter, uint64_t offset, uint8_t *data, std::size_t length);
+
+    /**
+     * Encrypts or decrypts a whole buffer (or a part of a stream starting at `offset`) with AES-CTR.
+     *
+     * @param data Bytes to transform in place.
+     * @param key The symmetric AES key.
+     * @param counter Initial counter block (see makeCounterBlock).
+     * @param offset Position of data[0] within the stream, in bytes.
+     */
+    void cryptCTR(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &counter, uint64_t offset = 0);
+} // namespace BC (BlockCrypt)
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include "../include/blockcrypt.hpp"
+#include "../include/bufferpool.hpp"
+
+namespace BC
+{
+    /**
+     * Encrypts data using AES in ECB mode with PKCS#7 padding.
+     *
+     * Every block is encrypted independently, so the whole buffer goes through
+     * BlockCrypt::encryptBlocks in one call (bitsliced groups on CPUs without AES-NI).
+     *
+     * @param data The plaintext buffer to encrypt. Modified in-place with padded ciphertext.
+     * @param key The symmetric encryption key used by AES.
+     * @param pad Whether to apply PKCS#7 padding (if false, data must be block aligned).
+     */
+    void encryptECB(std::vector<uint8_t> &data, const BlockCrypt::Key &key, bool pad = true);
+
+    /**
+     * Decrypts ECB-mode AES ciphertext and removes PKCS#7 padding.
+     *
+     * @param data The encrypted input buffer (must be a multiple of 16 bytes). Modified in-place with plaintext.
+     * @param key The symmetric AES key that was used to encrypt the original message.
+     * @param pad Whether to strip PKCS#7 padding after decryption.
+     * @throws std::runtime_error if the buffer is not block aligned or the padding is corrupt.
+     */
+    void decryptECB(std::vector<uint8_t> &data, const BlockCrypt::Key &key, bool pad = true);
+
+    // encryptECB/decryptECB with a prebuilt cipher context (no key expansion per call);
+    // instantiated for AES-128, AES-192 and AES-256 contexts
+    template <std::size_t KeyBytes>
+    void encryptECB(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad = true);
+    template <std::size_t KeyBytes>
+    void decryptECB(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad = true);
+
+    // The same on a BC::PooledBuffer; padding is added within its capacity (see encryptCBC)
+    template <std::size_t KeyBytes>
+    void encryptECB(PooledBuffer &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad = true);
+    template <std::size_t KeyBytes>
+    void decryptECB(PooledBuffer &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad = true);
+} // namespace BC (BlockCrypt)
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../include/blockcrypt.hpp"
+
+namespace BC
+{
+    namespace detail
+    {
+        class GHash;
+    }
+
+    /**
+     * @brief AES-GCM authenticated encryption (NIST SP 800-38D) with 128-bit tags.
+     *
+     * Holds the expanded key and the GHASH tables for H, so one instance can seal or open
+     * many messages. Encryption and authentication run in a single pass: the buffer is
+     * processed a few kilobytes at a time, each batch is encrypted with the CTR keystream and
+     * hashed while it is still in L1, so every byte is read from memory once. GHASH uses
+     * PCLMULQDQ (eight blocks per reduction) when the CPU has it and a 4-bit table otherwise.
+     */
+    class GCM
+    {
+    public:
+        using Tag = std::array<uint8_t, 16>;
+
+        /**
+         * @param key The symmetric AES key.
+         * @param backend AES engine (see BlockCrypt::Backend). GHASH uses PCLMULQDQ with Auto and
+         *                AESNI when available; any software backend also gets the table GHASH.
+         */
+        explicit GCM(const BlockCrypt::Key &key, BlockCrypt::Backend backend = BlockCrypt::Backend::Auto);
+        ~GCM();
+
+        GCM(const GCM &) = delete;
+        GCM &operator=(const GCM &) = delete;
+
+        // SP 800-38D: len(P) <= 2^39 - 256 bits; len(A), len(IV) <= 2^64 - 1 bits
+        static constexpr uint64_t kMaxDataBytes = ((uint64_t(1) << 32) - 2) * 16;
+        static constexpr uint64_t kMaxAadBytes = (uint64_t(1) << 61) - 1;
+
+        /**
+         * Encrypts `length` bytes in place and returns the authentication tag.
+         *
+         * @param iv Nonce; 12 bytes is the recommended (and fastest) size, any non-zero length works.
+         * @param aad Additional data that is authenticated but not encrypted (may be null if aadLen is 0).
+         * @throws std::runtime_error past the SP 800-38D limits, before anything is touched:
+         *         kMaxDataBytes of data (the 32-bit counter would wrap into J0), kMaxAadBytes
+         *         of AAD or IV (their bit lengths must fit GHASH's 64-bit length fields).
+         */
+        Tag encrypt(const uint8_t *iv, std::size_t ivLen, const uint8_t *aad, std::size_t aadLen,
+                    uint8_t *data, std::size_t length) const;
+
+        /**
+         * Verifies the tag and decrypts `length` bytes in place.
+         *
+         * @throws std::runtime_error if the tag does not match; the buffer is zeroed so no
+         *         unauthenticated plaintext is released. Same length limits as encrypt().
+         */
+        void decrypt(const uint8_t *iv, std::size_t ivLen, const uint8_t *aad, std::size_t aadLen,
+                     uint8_t *data, std::size_t length, const Tag &tag) const;
+
+    private:
+        BlockCrypt::Block initialCounter(const uint8_t *iv, std::size_t ivLen) const;
+        Tag finish(detail::GHash &hash, const BlockCrypt::Block &j0, std::size_t aadLen, std::size_t length) const;
+
+        BlockCrypt aes;
+        BlockCrypt::Block h;
+        std::unique_ptr<detail::GHash> ghash; // tables for H; copied per call
+    };
+
+    /**
+     * Encrypts data in place with AES-GCM and returns the 16-byte tag.
+     *
+     * @param data The plaintext buffer. Modified in-place with ciphertext of the same length.
+     * @param key The symmetric AES key.
+     * @param iv The nonce (12 bytes recommended); must never repeat under the same key.
+     * @param aad Additional authenticated data.
+     */
+    GCM::Tag encryptGCM(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const std::vector<uint8_t> &iv,
+                        const std::vector<uint8_t> &aad = {});
+
+    /**
+     * Authenticates and decrypts AES-GCM ciphertext in place.
+     *
+     * @throws std::runtime_error if the tag does not match (data is zeroed).
+     */
+    void decryptGCM(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const std::vector<uint8_t> &iv,
+                    const GCM::Tag &tag, const std::vector<uint8_t> &aad = {});
+} // namespace BC (BlockCrypt)
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "../include/blockcrypt.hpp"
+#include "../include/threadpool.hpp"
+
+namespace BC
+{
+    /**
+     * @brief AES-XTS (IEEE 1619 / NIST SP 800-38E) for sector-granular storage encryption.
+     *
+     * Each sector is encrypted independently under a tweak derived from its sector number,
+     * so any sector can be read or rewritten without touching its neighbours, and the
+     * ciphertext has exactly the plaintext's length (no IV, no padding). Sector lengths that
+     * are not a multiple of 16 bytes use ciphertext stealing for the final partial block.
+     *
+     * The tweaks of a sector are computed up front in batches, so the data blocks go through
+     * BasicBlockCrypt::encryptBlocks/decryptBlocks many at a time and the interleaved engines
+     * stay busy. XTS provides no integrity: a modified sector decrypts to garbage, not an error.
+     * Use the XTS (AES-128) and XTS256 (AES-256) aliases below.
+     */
+    template <std::size_t KeyBytes>
+    class BasicXTS
+    {
+    public:
+        using Cipher = BasicBlockCrypt<KeyBytes>;
+        using Key = typename Cipher::Key;
+
+        /**
+         * @param dataKey Key1, encrypts the data blocks.
+         * @param tweakKey Key2, encrypts the sector numbers into tweaks.
+         * @param backend AES engine for both keys (see BlockCryptBackend).
+         * @throws std::runtime_error if the two keys are equal (SP 800-38E forbids it).
+         */
+        BasicXTS(const Key &dataKey, const Key &tweakKey, BlockCryptBackend backend = BlockCryptBackend::Auto);
+
+        /**
+         * Encrypts/decrypts one sector in place.
+         *
+         * @param sector Data unit number; used as the tweak, little-endian, as in IEEE 1619.
+         * @param data The sector's bytes.
+         * @param length Sector length in bytes; any length >= 16 (partial final blocks use
+         *               ciphertext stealing).
+         * @throws std::runtime_error if length is below one block.
+         */
+        void encryptSector(uint64_t sector, uint8_t *data, std::size_t length) const;
+        void decryptSector(uint64_t sector, uint8_t *data, std::size_t length) const;
+
+        /**
+         * Encrypts/decrypts `count` consecutive sectors of `sectorSize` bytes in place, e.g. a
+         * run of pages. Sector i of the buffer uses the tweak for `firstSector + i`.
+         */
+        void encryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count) const;
+        void decryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count) const;
+
+        /**
+         * Parallel forms of encryptSectors/decryptSectors: the run is split into groups of
+         * roughly kParallelChunkBytes that the pool's workers process in place. Sectors are
+         * independent, so the output is identical to the serial calls.
+         */
+        void encryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count, ThreadPool &pool) const;
+        void decryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count, ThreadPool &pool) const;
+
+        BlockCryptBackend backend() const { return dataCipher.backend(); }
+
+    private:
+        template <bool Decrypt>
+        void cryptSector(uint64_t sector, uint8_t *data, std::size_t length) const;
+        template <bool Decrypt>
+        void cryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count, ThreadPool &pool) const;
+
+        Cipher dataCipher;
+        Cipher tweakCipher;
+    };
+
+    using XTS = BasicXTS<16>;
+    using XTS256 = BasicXTS<32>;
+
+    extern template class BasicXTS<16>;
+    extern template class BasicXTS<32>;
+} // namespace BC (BlockCrypt)
@@ -2,26 +2,103 @@
 #define BLOCKCRYPT_HPP
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include "../constants/BlockCryptConstants.hpp"
 
-class BlockCrypt
+// Implementation behind encrypt()/decrypt(); Auto picks the fastest one the CPU supports
+enum class BlockCryptBackend
 {
+    Auto,
+    Reference, // byte-wise FIPS-197 round functions
+    TTable,    // portable 32-bit T-table engine
+    AESNI,     // x86 AES-NI instructions, selected at runtime via CPUID
+    Bitsliced, // constant-time bitsliced kernel, 4/8/16 blocks per pass (scalar/SSE2/AVX2)
+    VPerm,     // constant-time SSSE3 vector-permute kernel for single blocks, bitsliced for bulk
+};
+
+/**
+ * AES with a KeyBytes-byte key (16, 24 or 32: AES-128, AES-192, AES-256).
+ *
+ * The key size fixes the round count and the schedule length at compile time, so the
+ * round key arrays are exactly sized and every engine runs loops with constant bounds.
+ * Member functions are defined in blockcrypt.cpp and instantiated there for the three
+ * key sizes; use the BlockCrypt, BlockCrypt192 and BlockCrypt256 aliases below.
+ */
+template <std::size_t KeyBytes>
+class BasicBlockCrypt
+{
+    static_assert(KeyBytes == 16 || KeyBytes == 24 || KeyBytes == 32, "AES keys are 16, 24 or 32 bytes");
+
 public:
+    static constexpr std::size_t kKeySize = KeyBytes;
+    static constexpr int kRounds = static_cast<int>(KeyBytes / 4) + 6; // Nr = Nk + 6
+
     using Block = std::array<uint8_t, BLOCK_SIZE>;
-    using Key = std::array<uint8_t, KEY_SIZE>;
+    using Key = std::array<uint8_t, KeyBytes>;
+    using Backend = BlockCryptBackend;
+    using Schedule = std::array<Block, kRounds + 1>; // FIPS-197 round keys, one block per round
+
+    BasicBlockCrypt(const Key &key, Backend backend = Backend::Auto);
 
-    BlockCrypt(const Key &key);
+    /**
+     * Builds a context from round keys computed ahead of time, typically a schedule
+     * produced by expandKey in a constant expression for a compiled-in key. Only the
+     * backend-specific forms of the schedule (T-table words, AESDEC keys, bit planes)
+     * are derived at runtime; the key expansion itself is skipped.
+     */
+    BasicBlockCrypt(const Schedule &schedule, Backend backend = Backend::Auto);
 
-    void encrypt(Block &plaintext);  // function to crypt
-    void decrypt(Block &ciphertext); // function to decrypt
+    /**
+     * FIPS-197 KeyExpansion. constexpr, so a fixed key can be expanded at compile time:
+     *
+     *     static constexpr BlockCrypt::Schedule kSchedule = BlockCrypt::expandKey(kKey);
+     *
+     * puts the round keys in .rodata, ready for the Schedule constructor.
+     */
+    static constexpr Schedule expandKey(const Key &key);
+
+    void encrypt(Block &plaintext) const;  // function to crypt
+    void decrypt(Block &ciphertext) const; // function to decrypt
+
+    /**
+     * Encrypts/decrypts `count` contiguous 16-byte blocks (ECB) from `in` to `out`.
+     * `in` and `out` may point to the same buffer. This is the entry point for raw block
+     * work (key derivation, tokenization, custom counter schemes): one call instead of a
+     * call per block, and the blocks are interleaved inside the engine.
+     *
+     * `lanes` is the number of blocks the AES-NI (1/2/4/8) and T-table (1/2/4) engines keep
+     * in flight per round; 0 picks the engine's default (8 and 4). The bitsliced kernels
+     * always work on their full group width (4/8/16 blocks).
+     */
+    void encryptBlocks(const uint8_t *in, uint8_t *out, std::size_t count, std::size_t lanes = 0) const;
+    void decryptBlocks(const uint8_t *in, uint8_t *out, std::size_t count, std::size_t lanes = 0) const;
+
+    // Byte-wise FIPS-197 round functions, kept as the reference the fast engines are checked against
+    void encryptReference(Block &plaintext) const;
+    void decryptReference(Block &ciphertext) const;
     void printBlock(Block &block, const std::string &message) const;
 
+    Backend backend() const { return engine; }
+    static bool supports(Backend backend); // compiled in and available on this CPU
+    static const char *backendName(Backend backend);
+
 private:
-    std::array<Key, 11> roundKeys;
-    void keyExpansion(const Key &key);
-    void addRoundKey(Block &block, const Key &roundKey) const;
+    static constexpr std::size_t kScheduleWords = 4 * (kRounds + 1);
+
+    Backend engine;
+    Schedule roundKeys;
+    std::array<uint32_t, kScheduleWords> encWords;     // roundKeys as big-endian column words
+    std::array<uint32_t, kScheduleWords> decWords;     // reversed, InvMixColumns-ed schedule for the equivalent inverse cipher
+    std::array<Block, kRounds + 1> niDecKeys;          // the same equivalent-inverse schedule in the byte order AESDEC expects
+    std::array<uint64_t, 8 * (kRounds + 1)> sliceKeys; // round keys as bit planes for the bitsliced kernel
+    static Backend resolveBackend(Backend backend);
+    void deriveSchedules();
+    void wordExpansion();
+    void encryptTTable(Block &plaintext) const;
+    void decryptTTable(Block &ciphertext) const;
+    void addRoundKey(Block &block, const Block &roundKey) const;
     void printRoundKeys() const;
     static inline uint8_t &cell(Block &b, int row, int col);
     static inline uint8_t cell(const Block &b, int row, int col);
@@ -31,8 +108,80 @@ private:
     void invShiftRows(Block &block) const;
     void invSubBytes(Block &block) const;
     void invMixColumns(Block &block) const;
-
-    uint8_t gmul(uint8_t a, uint8_t b) const;
 };
 
+template <std::size_t KeyBytes>
+constexpr typename BasicBlockCrypt<KeyBytes>::Schedule BasicBlockCrypt<KeyBytes>::expandKey(const Key &key)
+{
+    // AES needs 4 * (Nr + 1) words (each word = 4 bytes): 44, 52 or 60 for 128/192/256-bit keys.
+    // The first Nk words are the key itself (Nk = 4, 6 or 8).
+    // Subsequent words are calculated by performing transformations like RotWord, SubWord, and Rcon operations.
+    constexpr int Nk = static_cast<int>(KeyBytes / 4);
+    constexpr int totalWords = static_cast<int>(kScheduleWords);
+
+    // One Rcon per Nk words: Rcon[1..10] for AES-128, fewer for the longer keys
+    static_assert(sizeof(rcon) / sizeof(rcon[0]) > (totalWords - 1) / Nk, "rcon too short for this key size");
+
+    // Word w lives at schedule[w / 4][(w % 4) * 4 ...]
+    Schedule schedule{};
+    for (int i = 0; i < Nk * 4; ++i)
+    {
+        schedule[i / 16][i % 16] = key[i];
+    }
+
+    for (int wordIdx = Nk; wordIdx < totalWords; ++wordIdx)
+    {
+        // Store the previous word in temp
+        uint8_t temp[4] = {};
+        for (int j = 0; j < 4; ++j)
+        {
+            temp[j] = schedule[(wordIdx - 1) / 4][((wordIdx - 1) % 4) * 4 + j];
+        }
+
+        if (wordIdx % Nk == 0)
+        {
+            // RotWord
+            uint8_t t = temp[0];
+            temp[0] = temp[1];
+            temp[1] = temp[2];
+            temp[2] = temp[3];
+            temp[3] = t;
+
+            // SubWord
+            for (int j = 0; j < 4; ++j)
+            {
+                temp[j] = sBox[temp[j]];
+            }
+
+            // add Rcon
+            temp[0] ^= rcon[wordIdx / Nk];
+        }
+        else if (Nk > 6 && wordIdx % Nk == 4)
+        {
+            // AES-256 only: an extra SubWord halfway through each 8-word block
+            for (int j = 0; j < 4; ++j)
+            {
+                temp[j] = sBox[temp[j]];
+            }
+        }
+
+        // XOR with the word Nk positions back
+        int back = wordIdx - Nk;
+        for (int j = 0; j < 4; ++j)
+        {
+            schedule[wordIdx / 4][(wordIdx % 4) * 4 + j] =
+                static_cast<uint8_t>(schedule[back / 4][(back % 4) * 4 + j] ^ temp[j]);
+        }
+    }
+    return schedule;
+}
+
+using BlockCrypt = BasicBlockCrypt<16>;    // AES-128
+using BlockCrypt192 = BasicBlockCrypt<24>; // AES-192
+using BlockCrypt256 = BasicBlockCrypt<32>; // AES-256
+
+extern template class BasicBlockCrypt<16>;
+extern template class BasicBlockCrypt<24>;
+extern template class BasicBlockCrypt<32>;
+
 #endif // BLOCKCRYPT_HPP
\ No newline at end of file
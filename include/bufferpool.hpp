@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BC
+{
+    class BufferPool;
+
+    /**
+     * @brief Move-only working buffer taken from the BufferPool; returned to it on destruction.
+     *
+     * Behaves like a byte vector whose capacity is a pool size class: resize() within the
+     * capacity only changes size(), so e.g. adding CBC padding to a buffer acquired for the
+     * padded length never reallocates. Growing past the capacity moves the contents to a
+     * buffer of a larger class. Contents are uninitialised after acquire().
+     *
+     * A buffer acquired as BufferPool::Use::Sensitive is zeroed up to the largest size() it
+     * ever had before its memory goes back to the pool, so the next acquire() cannot see
+     * plaintext or key material left in it; bytes written past size() are not covered.
+     */
+    class PooledBuffer
+    {
+    public:
+        PooledBuffer() = default;
+        PooledBuffer(PooledBuffer &&other) noexcept;
+        PooledBuffer &operator=(PooledBuffer &&other) noexcept;
+        PooledBuffer(const PooledBuffer &) = delete;
+        PooledBuffer &operator=(const PooledBuffer &) = delete;
+        ~PooledBuffer();
+
+        uint8_t *data() { return base; }
+        const uint8_t *data() const { return base; }
+        std::size_t size() const { return length; }
+        std::size_t capacity() const { return bytes; }
+        bool empty() const { return length == 0; }
+
+        uint8_t *begin() { return base; }
+        uint8_t *end() { return base + length; }
+        const uint8_t *begin() const { return base; }
+        const uint8_t *end() const { return base + length; }
+        uint8_t &operator[](std::size_t i) { return base[i]; }
+        const uint8_t &operator[](std::size_t i) const { return base[i]; }
+
+        // Keeps the first min(size(), n) bytes; new bytes are uninitialised
+        void resize(std::size_t n);
+
+        // Gives the memory back to the pool now (the buffer becomes empty)
+        void release();
+
+    private:
+        friend class BufferPool;
+        PooledBuffer(uint8_t *base, std::size_t length, std::size_t bytes, bool sensitive)
+            : base(base), length(length), bytes(bytes), used(length), sensitive(sensitive) {}
+
+        uint8_t *base = nullptr;
+        std::size_t length = 0;
+        std::size_t bytes = 0; // capacity: the size class, or the exact size of an oversized buffer
+        std::size_t used = 0;  // largest length so far: what release() wipes
+        bool sensitive = false;
+    };
+
+    /**
+     * @brief Process-wide pool of aligned working buffers in power-of-two size classes.
+     *
+     * Every thread keeps a free list per size class, so a steady stream of acquire/release
+     * on one thread is a pointer swap with no lock and no malloc/free. Lists that grow past
+     * a per-thread limit spill into a shared depot (one lock per class), which refills threads
+     * that release fewer buffers than they take, e.g. when buffers are produced on one thread
+     * and consumed on another. A thread's cached buffers move to the depot when it exits.
+     *
+     * Buffers are 64-byte aligned (cache line, widest vector load); from 4 KB on they are
+     * page aligned, which O_DIRECT needs. Memory is obtained on first use and first touched
+     * by the thread that asked for it, so with the usual first-touch NUMA policy a thread's
+     * buffers live on its own node and, thanks to the per-thread lists, stay with it.
+     * Requests above kMaxPooledBytes are served directly by the system allocator.
+     */
+    class BufferPool
+    {
+    public:
+        static constexpr std::size_t kAlignment = 64;
+        static constexpr std::size_t kPageAlignment = 4096;
+        static constexpr unsigned kMinClassShift = 6;  // 64 bytes
+        static constexpr unsigned kMaxClassShift = 26; // 64 MB
+        static constexpr std::size_t kClasses = kMaxClassShift - kMinClassShift + 1;
+        static constexpr std::size_t kMaxPooledBytes = std::size_t(1) << kMaxClassShift;
+
+        struct Stats
+        {
+            uint64_t acquires = 0;
+            uint64_t threadHits = 0;        // served from the calling thread's free list
+            uint64_t depotHits = 0;         // served from the shared depot
+            uint64_t systemAllocations = 0; // new memory from the system (misses, oversized)
+            uint64_t systemFrees = 0;       // memory given back (depot full, oversized, trim)
+            uint64_t bytesInUse = 0;        // capacity of buffers currently handed out
+            uint64_t bytesCached = 0;       // capacity held in free lists and the depot
+        };
+
+        // What a buffer will hold: Sensitive buffers are wiped before they are reused
+        enum class Use
+        {
+            General,
+            Sensitive
+        };
+
+        static BufferPool &instance();
+
+        /**
+         * @param length size() of the returned buffer; its capacity is the next size class.
+         * @param use Sensitive for plaintext, keys or anything else that must not reach the
+         *            next owner of the memory (costs one memset of the used bytes on release).
+         * @throws std::bad_alloc if the system is out of memory.
+         */
+        PooledBuffer acquire(std::size_t length, Use use = Use::General);
+
+        Stats stats() const;
+
+        // Frees the calling thread's cached buffers and the depot (buffers in use are unaffected)
+        void trim();
+
+        // Capacity of the buffer acquire(length) returns
+        static std::size_t capacityFor(std::size_t length);
+
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+    private:
+        friend class PooledBuffer;
+        BufferPool() = default;
+        void release(uint8_t *base, std::size_t bytes);
+    };
+} // namespace BC (BlockCrypt)
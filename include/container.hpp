@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../include/blockcrypt.hpp"
+#include "../include/bufferpool.hpp"
+#include "../include/threadpool.hpp"
+
+/**
+ * Chunked container format ("BLKCRYPT" files).
+ *
+ * The plaintext is cut into chunks of a fixed size (a multiple of 16 bytes, 1 MiB by
+ * default); every chunk is its own CBC chain under an IV derived from a per-file nonce,
+ * IV_i = E_K(nonce XOR le64(i)), so chunks encrypt and decrypt independently and in any
+ * order. Only the last chunk is PKCS#7 padded. All integers are little-endian.
+ *
+ *   header  (64 bytes)  "BLKCRYPT" | u32 version (1) | u32 key bits | u32 chunk bytes |
+ *                       u32 reserved | nonce[16] | key check[8] | reserved[16]
+ *   chunks              CBC ciphertext of chunk 0, 1, ... back to back
+ *   index   (16 bytes per chunk)  u64 file offset | u32 ciphertext bytes | u32 plaintext bytes
+ *   trailer (32 bytes)  u64 index offset | u64 chunk count | u64 plaintext bytes | "BCINDEX\0"
+ *
+ * The key check is the first half of E_K(nonce with its upper 8 bytes inverted), a block no
+ * chunk IV can equal, so a wrong key is reported when the container is opened. Like plain
+ * CBC the format provides confidentiality only: modified ciphertext decrypts to garbage.
+ */
+namespace BCFile
+{
+    constexpr std::size_t kContainerHeaderBytes = 64;
+    constexpr std::size_t kContainerIndexEntryBytes = 16;
+    constexpr std::size_t kContainerTrailerBytes = 32;
+
+    struct ContainerOptions
+    {
+        std::size_t chunkBytes = 1 << 20;       // plaintext per chunk, rounded up to a multiple of 16 (min. 16)
+        std::optional<BlockCrypt::Block> nonce; // per-file IV seed; random (std::random_device) if unset
+    };
+
+    /**
+     * @brief Writes a container from data supplied in pieces of any size.
+     *
+     * Input is gathered into a batch of chunks (two per pool worker) that is encrypted in
+     * parallel on the pool and written with one write() call, so encryption uses every core
+     * while the output stays a sequential stream. finish() writes the padded last chunk, the
+     * index and the trailer; a writer destroyed without finish() leaves a file without an
+     * index, which the reader rejects.
+     */
+    template <std::size_t KeyBytes>
+    class BasicContainerWriter
+    {
+    public:
+        using Cipher = BasicBlockCrypt<KeyBytes>;
+
+        /**
+         * Creates (or truncates) `path` and writes the header.
+         * @throws std::runtime_error if the file cannot be created.
+         */
+        BasicContainerWriter(const std::string &path, const Cipher &aes, BC::ThreadPool &pool,
+                             const ContainerOptions &options = {});
+        ~BasicContainerWriter();
+
+        BasicContainerWriter(const BasicContainerWriter &) = delete;
+        BasicContainerWriter &operator=(const BasicContainerWriter &) = delete;
+
+        // Appends plaintext. @throws std::runtime_error on write errors or after finish().
+        void write(const uint8_t *data, std::size_t length);
+
+        // Completes the file. @throws std::runtime_error on write errors.
+        void finish();
+
+        uint64_t plaintextSize() const { return written; }
+
+    private:
+        void encryptBatch(bool last);
+        void writeAll(const uint8_t *data, std::size_t length);
+
+        Cipher aes;
+        BC::ThreadPool &pool;
+        std::string path;
+        int fd = -1;
+        std::size_t chunkBytes;
+        BlockCrypt::Block nonce;
+        BC::PooledBuffer batch; // batchChunks chunks of plaintext, encrypted in place
+        std::size_t batchChunks;
+        std::size_t batchUsed = 0;
+        uint64_t written = 0;   // plaintext bytes accepted
+        uint64_t fileOffset = 0;
+        std::vector<uint8_t> index;
+        bool finished = false;
+    };
+
+    /**
+     * @brief Random-access reader for a container.
+     *
+     * Opening reads the header, trailer and index and checks the key. read() then decrypts
+     * only the 16-byte blocks overlapping the requested range: CBC decryption of block j needs
+     * just ciphertext blocks j-1 and j (or the chunk IV), so reading the last megabyte of a
+     * 50 GB container touches the last megabyte of the file. Reads use pread and are safe to
+     * call from several threads at once; decryptTo() decodes the whole file in parallel.
+     */
+    template <std::size_t KeyBytes>
+    class BasicContainerReader
+    {
+    public:
+        using Cipher = BasicBlockCrypt<KeyBytes>;
+
+        /**
+         * @throws std::runtime_error if the file cannot be read, is not a container, is
+         *         truncated or inconsistent, was written with another key size, or the key
+         *         does not match.
+         */
+        BasicContainerReader(const std::string &path, const Cipher &aes);
+        ~BasicContainerReader();
+
+        BasicContainerReader(const BasicContainerReader &) = delete;
+        BasicContainerReader &operator=(const BasicContainerReader &) = delete;
+
+        uint64_t size() const { return plainSize; } // plaintext bytes
+        std::size_t chunkSize() const { return chunkBytes; }
+        uint64_t chunkCount() const { return chunks.size(); }
+
+        /**
+         * Decrypts plaintext bytes [offset, offset + length) into `out`.
+         * @return Bytes read: less than `length` only at the end of the plaintext.
+         * @throws std::runtime_error on read errors.
+         */
+        std::size_t read(uint64_t offset, uint8_t *out, std::size_t length) const;
+
+        // Stream-style access through a cursor (not thread-safe, unlike read(offset, ...))
+        void seek(uint64_t offset) { position = offset; }
+        uint64_t tell() const { return position; }
+        std::size_t read(uint8_t *out, std::size_t length);
+
+        /**
+         * Decrypts every chunk into `outPath` (memory-mapped, chunks spread over the pool) and
+         * checks the padding of the last chunk. The output replaces `outPath` only on success
+         * (see MappedFile::createReplacing).
+         * @throws std::runtime_error on I/O errors or corrupt padding.
+         */
+        void decryptTo(const std::string &outPath, BC::ThreadPool &pool) const;
+
+    private:
+        struct Chunk
+        {
+            uint64_t offset;
+            uint32_t cipherBytes;
+            uint32_t plainBytes;
+        };
+
+        BlockCrypt::Block chunkIV(uint64_t chunk) const;
+
+        Cipher aes;
+        std::string path;
+        int fd = -1;
+        std::size_t chunkBytes = 0;
+        uint64_t plainSize = 0;
+        BlockCrypt::Block nonce{};
+        std::vector<Chunk> chunks;
+        uint64_t position = 0;
+    };
+
+    using ContainerWriter = BasicContainerWriter<16>;
+    using ContainerWriter192 = BasicContainerWriter<24>;
+    using ContainerWriter256 = BasicContainerWriter<32>;
+    using ContainerReader = BasicContainerReader<16>;
+    using ContainerReader192 = BasicContainerReader<24>;
+    using ContainerReader256 = BasicContainerReader<32>;
+
+    extern template class BasicContainerWriter<16>;
+    extern template class BasicContainerWriter<24>;
+    extern template class BasicContainerWriter<32>;
+    extern template class BasicContainerReader<16>;
+    extern template class BasicContainerReader<24>;
+    extern template class BasicContainerReader<32>;
+
+    // True if `path` starts with the container magic (for callers that accept both formats)
+    bool isContainer(const std::string &path);
+} // namespace BCFile
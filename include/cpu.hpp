@@ -0,0 +1,28 @@
+#pragma once
+
+namespace BCCpu
+{
+    /**
+     * @brief Instruction-set extensions the cipher backends can use.
+     *
+     * Filled once from CPUID (and XGETBV for the AVX state) the first time
+     * `features()` is called. On non-x86 targets every flag stays false, so the
+     * portable software engine is always chosen.
+     */
+    struct Features
+    {
+        bool sse2 = false;
+        bool ssse3 = false;
+        bool avx2 = false;
+        bool aesni = false;
+        bool pclmul = false;
+    };
+
+    /**
+     * @brief Returns the cached feature set of the CPU the process is running on.
+     *
+     * Thread-safe; detection runs exactly once.
+     */
+    const Features &features();
+
+} // namespace BCCpu
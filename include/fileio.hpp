@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../include/blockcrypt.hpp"
+#include "../include/bufferpool.hpp"
+
+namespace BCFile // BlockCrypt file I/O
+{
+    struct MapOptions
+    {
+        bool hugePages = false; // ask for transparent huge pages on the mappings (MADV_HUGEPAGE)
+    };
+
+    /**
+     * @brief RAII wrapper around a memory-mapped file (POSIX mmap).
+     *
+     * The mapping is advised MADV_SEQUENTIAL, since the cipher walks it front to back, so the
+     * kernel reads ahead aggressively and drops pages behind. A zero-length file has no
+     * mapping: data() is null and size() is 0.
+     */
+    class MappedFile
+    {
+    public:
+        // Maps an existing file read-only
+        static MappedFile openRead(const std::string &path, const MapOptions &options = {});
+
+        // Creates (or truncates) `path`, sizes it to `size` bytes and maps it read-write
+        static MappedFile create(const std::string &path, std::size_t size, const MapOptions &options = {});
+
+        // Maps an existing file read-write after resizing it to `size` bytes (grows with zeros)
+        static MappedFile openReadWrite(const std::string &path, std::size_t size, const MapOptions &options = {});
+
+        /**
+         * Like create(), but maps a temporary file next to `path` (see temporaryPathFor) that
+         * close() renames over `path` (over its target if `path` is a symbolic link). Destroyed without close(), e.g. by an exception while
+         * decrypting, it deletes the temporary, so `path` is never left half written.
+         */
+        static MappedFile createReplacing(const std::string &path, std::size_t size, const MapOptions &options = {});
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile();
+
+        uint8_t *data() { return base; }
+        const uint8_t *data() const { return base; }
+        std::size_t size() const { return length; }
+
+        /**
+         * Unmaps the file and truncates it to `finalSize` bytes (e.g. after stripping padding);
+         * a createReplacing() file is then renamed to its destination.
+         * @throws std::runtime_error if the file cannot be resized or renamed.
+         */
+        void close(std::size_t finalSize);
+
+    private:
+        MappedFile(int fd, std::size_t size, bool writable, const MapOptions &options, const std::string &path);
+        void release() noexcept;
+
+        int fd = -1;
+        uint8_t *base = nullptr;
+        std::size_t length = 0;
+        std::string tempPath;  // createReplacing(): the file actually mapped...
+        std::string finalPath; // ...and its destination
+    };
+
+    // Where a replacement for `path` goes: `path` itself, or the file it links to
+    std::string replacementTarget(const std::string &path);
+
+    /**
+     * Creates an empty, uniquely named file next to `target` (a replacementTarget()), so that
+     * rename() onto `target` is atomic, and returns its name. It gets the permissions of
+     * `target` if that exists, otherwise 0644 less the umask.
+     * @throws std::runtime_error if the directory is not writable.
+     */
+    std::string temporaryPathFor(const std::string &target);
+
+    // True if `path` names an existing regular file (not a pipe, device or directory)
+    bool isRegularFile(const std::string &path);
+
+    // True if both paths name the same existing file
+    bool sameFile(const std::string &a, const std::string &b);
+
+    /**
+     * CBC-encrypts `inPath` into `outPath` with PKCS#7 padding, mapping the input read-only
+     * and the output read-write (pre-sized to the padded length) and encrypting straight
+     * from one mapping to the other.
+     *
+     * @throws std::runtime_error on I/O errors or if both paths name the same file.
+     */
+    void encryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                        const BlockCrypt::Block &iv, const MapOptions &options = {});
+
+    // Same, with an already expanded key (batch jobs expand it once for all files)
+    void encryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                        const BlockCrypt::Block &iv, const MapOptions &options = {});
+
+    /**
+     * CBC-decrypts `inPath` into `outPath` and strips the padding (the output is truncated
+     * to the plaintext length afterwards). The plaintext is written to a temporary file that
+     * replaces `outPath` only once the padding checked out, so a wrong key or corrupt input
+     * leaves `outPath` as it was.
+     *
+     * @throws std::runtime_error on I/O errors, unaligned input or corrupt padding.
+     */
+    void decryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                        const BlockCrypt::Block &iv, const MapOptions &options = {});
+    void decryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                        const BlockCrypt::Block &iv, const MapOptions &options = {});
+
+    /**
+     * Encrypts a file in place: it is grown to the padded length, mapped read-write and
+     * overwritten with its ciphertext.
+     */
+    void encryptFileCBCInPlace(const std::string &path, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                               const MapOptions &options = {});
+    void encryptFileCBCInPlace(const std::string &path, const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                               const MapOptions &options = {});
+
+    /**
+     * Decrypts a file in place and truncates it to the plaintext length. The padding of the
+     * last block is checked before anything is written, so a wrong key or a corrupt file
+     * leaves the file untouched.
+     */
+    void decryptFileCBCInPlace(const std::string &path, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                               const MapOptions &options = {});
+    void decryptFileCBCInPlace(const std::string &path, const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                               const MapOptions &options = {});
+
+    /**
+     * Decrypts plaintext bytes [offset, offset + length) of the CBC file `inPath` (PKCS#7
+     * padded, as written by encryptFileCBC) into `out`. Only the ciphertext blocks covering
+     * the range and the one before them are read, with pread in windows of at most 1 MB, and
+     * the final block's padding is only looked at when the range reaches it (see
+     * BC::decryptCBCRange), so a ranged read of a large object costs its length, not the
+     * object's size.
+     *
+     * @return Bytes written: less than `length` only at the end of the plaintext.
+     * @throws std::runtime_error on I/O errors, unaligned input or corrupt padding.
+     */
+    std::size_t decryptFileCBCRange(const std::string &inPath, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                                    uint64_t offset, uint8_t *out, std::size_t length);
+    std::size_t decryptFileCBCRange(const std::string &inPath, const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                                    uint64_t offset, uint8_t *out, std::size_t length);
+
+    /**
+     * @brief Repeated byte-range reads from one CBC file (see decryptFileCBCRange).
+     *
+     * The file is opened and sized once, and its final block is decrypted and its padding
+     * checked up front: size() is the exact plaintext length, and a wrong key or a damaged
+     * file is reported before any plaintext has been handed out. read() reuses one window
+     * buffer, so reading a long range in steps costs no more than one call for all of it.
+     * Not thread-safe.
+     */
+    class CBCRangeReader
+    {
+    public:
+        // @throws std::runtime_error on I/O errors, unaligned input or corrupt padding
+        CBCRangeReader(const std::string &path, const BlockCrypt &aes, const BlockCrypt::Block &iv);
+        ~CBCRangeReader();
+
+        CBCRangeReader(const CBCRangeReader &) = delete;
+        CBCRangeReader &operator=(const CBCRangeReader &) = delete;
+
+        uint64_t size() const { return plainSize; } // plaintext bytes
+
+        /**
+         * Decrypts plaintext bytes [offset, offset + length) into `out`.
+         * @return Bytes read: less than `length` only at the end of the plaintext.
+         * @throws std::runtime_error on read errors.
+         */
+        std::size_t read(uint64_t offset, uint8_t *out, std::size_t length);
+
+    private:
+        BlockCrypt aes;
+        BlockCrypt::Block iv;
+        std::string path;
+        int fd = -1;
+        std::size_t cipherSize = 0;
+        uint64_t plainSize = 0;
+        BC::PooledBuffer window;
+    };
+
+    struct PipelineOptions
+    {
+        std::size_t chunkBytes = 1 << 20; // bytes per read/encrypt/write step (rounded up to 4 KB)
+        unsigned buffers = 4;             // chunk buffers in the ring (at least 3: read, encrypt, write)
+        bool direct = false;              // O_DIRECT on both files; buffered where the filesystem refuses it
+        bool uring = true;                // io_uring when the kernel allows it; false forces blocking pread/pwrite
+    };
+
+    /**
+     * CBC-encrypts `inPath` into `outPath` through a ring of aligned chunk buffers, so disk
+     * and CPU work overlap: while chunk N is encrypted, chunk N+1 is being read and chunk N-1
+     * written. Reads and writes go through io_uring (see PipelineOptions::uring); the CBC
+     * chain is carried from one chunk to the next, so the output is identical to
+     * encryptFileCBC. Wall-clock time approaches max(I/O, CPU) rather than their sum.
+     *
+     * @throws std::runtime_error on I/O errors or if both paths name the same file.
+     */
+    void encryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options = {});
+    void encryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options = {});
+
+    /**
+     * Pipelined counterpart of decryptFileCBC; the padding is checked on the last chunk and
+     * the output truncated to the plaintext length. Like decryptFileCBC it writes to a
+     * temporary file next to `outPath` and renames it into place only on success, so a wrong
+     * key or corrupt input leaves an existing output untouched (encryption does the same).
+     *
+     * @throws std::runtime_error on I/O errors, unaligned input or corrupt padding.
+     */
+    void decryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options = {});
+    void decryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options = {});
+
+    // True if the pipelined functions can use io_uring here (kernel support, not blocked by seccomp)
+    bool uringAvailable();
+} // namespace BCFile
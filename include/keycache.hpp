@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../include/blockcrypt.hpp"
+
+namespace BC
+{
+    /**
+     * @brief Thread-safe, sharded LRU cache of expanded AES keys.
+     *
+     * A cached BlockCrypt carries both the encryption and the decryption schedule of its
+     * backend, so one entry serves every mode. The cache is split into shards chosen by a
+     * hash of the key bytes, each with its own lock and LRU list, so threads working under
+     * different keys rarely contend. Entries are handed out as shared_ptr: an evicted
+     * schedule stays valid for as long as a caller still uses it.
+     *
+     * The cache keeps raw key bytes in memory for the lifetime of each entry.
+     */
+    class KeyCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+        };
+
+        /**
+         * @param capacity Maximum number of cached keys (spread evenly over the shards).
+         * @param shards Number of independently locked shards.
+         * @param backend Backend the cached contexts are built with.
+         */
+        explicit KeyCache(std::size_t capacity = 4096, std::size_t shards = 16,
+                          BlockCrypt::Backend backend = BlockCrypt::Backend::Auto);
+
+        /**
+         * Returns the expanded context for `key`, expanding and inserting it on a miss (the
+         * least recently used entry of the shard is evicted when the shard is full).
+         */
+        std::shared_ptr<const BlockCrypt> get(const BlockCrypt::Key &key);
+
+        Stats stats() const;     // summed over all shards
+        std::size_t size() const; // number of cached keys
+        void clear();             // drops all entries (counters are kept)
+
+    private:
+        struct KeyHash
+        {
+            std::size_t operator()(const BlockCrypt::Key &key) const;
+        };
+
+        using Entry = std::pair<BlockCrypt::Key, std::shared_ptr<const BlockCrypt>>;
+
+        // Each shard on its own cache lines: the lock and counters of one shard are written on
+        // every lookup and must not false-share with a neighbour's
+        struct alignas(64) Shard
+        {
+            mutable std::mutex lock;
+            std::list<Entry> lru; // most recently used first
+            std::unordered_map<BlockCrypt::Key, std::list<Entry>::iterator, KeyHash> index;
+            std::atomic<uint64_t> hits{0};
+            std::atomic<uint64_t> misses{0};
+            std::atomic<uint64_t> evictions{0};
+        };
+
+        Shard &shardFor(const BlockCrypt::Key &key);
+
+        std::unique_ptr<Shard[]> shards;
+        std::size_t shardCount;
+        std::size_t shardCapacity;
+        BlockCrypt::Backend backend;
+    };
+} // namespace BC (BlockCrypt)
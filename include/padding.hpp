@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -40,4 +41,31 @@ namespace BCPad
      */
     void removePKCS7(std::vector<uint8_t> &buf, std::size_t blk = 16);
 
+    /**
+     * @brief Length of `length` bytes after PKCS#7 padding (always at least one byte more).
+     */
+    inline std::size_t paddedLength(std::size_t length, std::size_t blk = 16)
+    {
+        return length + blk - length % blk;
+    }
+
+    /**
+     * @brief Pads a final block in place, without touching any container.
+     *
+     * Fills bytes [used, blk) of `block` with the padding value; `used` must be < blk.
+     * This is what buffer-based encryptors use to write the padding straight into the
+     * last output block.
+     *
+     * @return The number of padding bytes written (blk - used).
+     */
+    std::size_t writePKCS7(uint8_t *block, std::size_t used, std::size_t blk = 16);
+
+    /**
+     * @brief Validates the PKCS#7 padding at the end of `data` and returns the length
+     * without it. Nothing is modified or resized.
+     *
+     * @throws std::runtime_error if `length` is 0 or the padding is invalid or corrupt.
+     */
+    std::size_t unpaddedLength(const uint8_t *data, std::size_t length, std::size_t blk = 16);
+
 } // namespace BCPad
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../include/blockcrypt.hpp"
+#include "../include/threadpool.hpp"
+
+namespace BC
+{
+    // Bytes per task handed to the pool: small enough that a chunk and its output stay in a
+    // core's L2 cache, large enough that the per-task overhead disappears.
+    constexpr std::size_t kParallelChunkBytes = 64 * 1024;
+
+    /**
+     * Parallel ECB encryption with PKCS#7 padding.
+     *
+     * The (padded) buffer is split into kParallelChunkBytes chunks that the pool's workers
+     * encrypt in place, each with its own copy of the key schedule. Output is identical to
+     * encryptECB.
+     *
+     * @param data The plaintext buffer to encrypt. Modified in-place with padded ciphertext.
+     * @param key The symmetric encryption key used by AES.
+     * @param pool Workers to spread the chunks over.
+     * @param pad Whether to apply PKCS#7 padding (if false, data must be block aligned).
+     */
+    void encryptECBParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, ThreadPool &pool, bool pad = true);
+
+    /**
+     * Parallel ECB decryption; output is identical to decryptECB.
+     *
+     * @throws std::runtime_error if the buffer is not block aligned or the padding is corrupt.
+     */
+    void decryptECBParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, ThreadPool &pool, bool pad = true);
+
+    /**
+     * Parallel CBC decryption; output is identical to decryptCBC.
+     *
+     * Each chunk only needs the ciphertext block right before it as its IV. Those blocks are
+     * collected up front, after which the chunks are fully independent and can be decrypted
+     * in place in any order. (CBC encryption is inherently serial and has no parallel form.)
+     *
+     * @param data The encrypted input buffer (must be a multiple of 16 bytes). Modified in-place with plaintext.
+     * @param key The symmetric AES key that was used to encrypt the original message.
+     * @param iv The initialization vector used during encryption.
+     * @param pool Workers to spread the chunks over.
+     * @param pad Whether to strip PKCS#7 padding after decryption.
+     */
+    void decryptCBCParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                            ThreadPool &pool, bool pad = true);
+
+    /**
+     * Parallel AES-CTR; output is identical to cryptCTR with the same arguments.
+     *
+     * Every chunk computes its own starting counter from its offset in the stream, so the
+     * chunks share nothing but the key.
+     *
+     * @param data Bytes to transform in place.
+     * @param key The symmetric AES key.
+     * @param counter Initial counter block (see makeCounterBlock).
+     * @param pool Workers to spread the chunks over.
+     * @param offset Position of data[0] within the stream, in bytes.
+     */
+    void cryptCTRParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &counter,
+                          ThreadPool &pool, uint64_t offset = 0);
+} // namespace BC (BlockCrypt)
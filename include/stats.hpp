@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace BCStats // BlockCrypt runtime statistics
+{
+    /**
+     * Operations that are counted and timed. A call is attributed to the outermost operation
+     * on its thread: the raw block calls CBC makes internally are not counted again, and the
+     * parallel functions count one call on the calling thread for the whole buffer.
+     */
+    enum class Op : unsigned
+    {
+        EncryptBlocks, // BlockCrypt::encryptBlocks
+        DecryptBlocks, // BlockCrypt::decryptBlocks
+        EncryptECB,    // BC::encryptECB, BC::encryptECBParallel
+        DecryptECB,    // BC::decryptECB, BC::decryptECBParallel
+        EncryptCBC,    // BC::encryptCBC, BC::encryptCBCBatch, BC::CBCEncryptor
+        DecryptCBC,    // BC::decryptCBC, BC::decryptCBCParallel, BC::CBCDecryptor
+        CTR,           // BC::cryptCTR, BC::cryptCTRParallel
+        SealGCM,       // BC::GCM::encrypt, BC::encryptGCM
+        OpenGCM,       // BC::GCM::decrypt, BC::decryptGCM
+        EncryptXTS,    // BC::BasicXTS::encryptSector(s)
+        DecryptXTS,    // BC::BasicXTS::decryptSector(s)
+        Count
+    };
+
+    // Phases of a file transformation (BCFile, and the streaming path of the CLI)
+    enum class Phase : unsigned
+    {
+        Read,   // opening/mapping the input, or waiting for input data
+        Cipher, // the mode itself
+        Write,  // writing, unmapping and truncating the output
+        Count
+    };
+
+    constexpr std::size_t kOps = static_cast<std::size_t>(Op::Count);
+    constexpr std::size_t kPhases = static_cast<std::size_t>(Phase::Count);
+
+    // Histogram bucket i counts durations in [2^i, 2^(i+1)) ns (bucket 0 also holds 0 ns)
+    constexpr std::size_t kBuckets = 40;
+
+    struct Timing
+    {
+        uint64_t calls = 0;
+        uint64_t bytes = 0;
+        uint64_t blocks = 0; // 16-byte blocks touched (partial blocks count as one)
+        uint64_t nanoseconds = 0;
+        std::array<uint64_t, kBuckets> histogram{};
+
+        // Upper bound of the bucket holding the p-th percentile (0 < p <= 100), in ns
+        uint64_t percentileNs(double p) const;
+
+        double gbps() const { return nanoseconds == 0 ? 0.0 : static_cast<double>(bytes) / nanoseconds; }
+    };
+
+    struct Snapshot
+    {
+        std::array<Timing, kOps> ops;
+        std::array<Timing, kPhases> phases;
+        uint64_t keyExpansions = 0; // BlockCrypt constructed from a key (not from a Schedule)
+        uint64_t paddingErrors = 0; // PKCS#7 padding rejected on decryption
+    };
+
+    /**
+     * True if the library was built with BLOCKCRYPT_STATS. Without it nothing is recorded,
+     * the hooks compile to nothing, and snapshot() returns zeros.
+     */
+    bool enabled();
+
+    /**
+     * Sums the counters of every thread, including threads that have exited. Each thread
+     * writes only its own counters, so taking a snapshot never slows down the hot path; a
+     * snapshot taken while other threads are working may miss their latest operations.
+     */
+    Snapshot snapshot();
+
+    /**
+     * Zeroes all counters (of live and exited threads). Safe while other threads are
+     * recording: each thread drops its old counts itself on its next operation, and until
+     * then snapshot() leaves them out. An operation that is in flight during the reset may
+     * be counted on either side of it, but no earlier count ever comes back.
+     */
+    void reset();
+
+    const char *opName(Op op);
+    const char *phaseName(Phase phase);
+
+    /**
+     * Times a file phase on the current thread from construction to stop() or destruction,
+     * also for code outside the library that moves data itself (e.g. reading stdin in the CLI).
+     */
+    class PhaseTimer
+    {
+    public:
+        explicit PhaseTimer(Phase phase, std::size_t bytes = 0);
+        ~PhaseTimer();
+
+        PhaseTimer(const PhaseTimer &) = delete;
+        PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+        void setBytes(std::size_t n) { bytes = n; } // when the size is only known afterwards
+        void stop();                                // records now instead of at destruction
+
+    private:
+        Phase phase;
+        std::size_t bytes;
+        uint64_t start;
+        bool running = true;
+    };
+} // namespace BCStats
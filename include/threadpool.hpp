@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BC
+{
+    /**
+     * @brief Fixed-size work-stealing thread pool for splitting large buffers into chunks.
+     *
+     * `parallelFor` hands every worker a contiguous run of task indices in its own queue.
+     * A worker takes tasks from the front of its queue and, once that is empty, steals from
+     * the back of the others, so uneven chunks (page faults, frequency changes, a busy core)
+     * even out without a shared counter every thread contends on. The calling thread works
+     * as worker 0, so a pool of size 1 spawns no threads at all.
+     */
+    class ThreadPool
+    {
+    public:
+        /**
+         * @param workers Total number of workers, including the calling thread.
+         *                0 uses std::thread::hardware_concurrency().
+         */
+        explicit ThreadPool(std::size_t workers = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        std::size_t size() const { return workerCount; }
+
+        /**
+         * Runs `task(index, worker)` for every index in [0, count) and returns when all of
+         * them have finished. `worker` is in [0, size()) and is stable for the duration of one
+         * task, so callers can keep per-worker state (e.g. a key schedule) in an array.
+         * Calls are serialized; the first exception thrown by a task is rethrown here.
+         */
+        void parallelFor(std::size_t count, const std::function<void(std::size_t index, std::size_t worker)> &task);
+
+    private:
+        // One cache line per queue so owners and thieves of different queues never share a line
+        struct alignas(64) Queue
+        {
+            std::mutex lock;
+            std::deque<std::size_t> tasks;
+        };
+
+        void workerLoop(std::size_t worker);
+        void runTasks(std::size_t worker);
+        bool takeTask(std::size_t worker, std::size_t &index);
+
+        std::size_t workerCount;
+        std::unique_ptr<Queue[]> queues;
+        std::vector<std::thread> threads;
+
+        std::mutex runLock; // one parallelFor at a time
+        std::mutex stateLock;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        std::size_t generation = 0;
+        std::size_t busyWorkers = 0;
+        bool stopping = false;
+        const std::function<void(std::size_t, std::size_t)> *job = nullptr;
+
+        std::mutex errorLock;
+        std::exception_ptr error;
+    };
+} // namespace BC (BlockCrypt)
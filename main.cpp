@@ -4,8 +4,23 @@
 #include <string>
 #include <cstring>   // for std::strcmp
 #include <algorithm> // for std::copy_n
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <cstdio>
+#include <cctype>
+#include <cerrno>
+#include <sys/stat.h>
 #include "blockcrypt.hpp"
 #include "CBC.hpp"
+#include "bufferpool.hpp"
+#include "container.hpp"
+#include "fileio.hpp"
+#include "stats.hpp"
+#include "threadpool.hpp"
 
 using Byte = uint8_t;
 using Block = BlockCrypt::Block;
@@ -36,7 +51,377 @@ void print_usage(const char *prog)
               << "  -i, --iv     IV in hex (default: 000102030405060708090A0B0C0D0E0F)\n"
               << "  -I, --in     Input file (default: stdin)\n"
               << "  -O, --out    Output file (default: stdout)\n"
-              << "  -h, --help   Show this help message\n";
+              << "      --inplace    Encrypt/decrypt the input file in place (requires -I, no -O)\n"
+              << "      --hugepages  Request transparent huge pages for memory-mapped files\n"
+              << "      --uring      Pipelined file I/O: read, encrypt and write chunks concurrently (io_uring)\n"
+              << "      --direct     With --uring: bypass the page cache (O_DIRECT)\n"
+              << "      --chunk-kb N With --uring or --container: chunk size in KiB (default: 1024)\n"
+              << "      --container  Chunked container format: parallel, seekable (encrypt needs -O, decrypt -I)\n"
+              << "  -j, --jobs N With --container: worker threads (default: number of cores)\n"
+              << "      --offset N   With decrypt: first plaintext byte to output (-I must be a file)...\n"
+              << "      --length N   ...and how many (default: to the end); only the blocks covering them are read\n"
+              << "      --stats      Print throughput and a read/cipher/write breakdown to stderr\n"
+              << "  -h, --help   Show this help message\n"
+              << "\n"
+              << "  " << prog << " batch encrypt|decrypt -k key_hex [-i iv_hex] [-j jobs] (-L listfile | -D indir -o outdir)\n"
+              << "Batch options:\n"
+              << "  -k, --key      AES key in hex (required, 32 digits)\n"
+              << "  -L, --list     File with one \"input output\" pair per line\n"
+              << "  -D, --dir      Process every regular file in this directory...\n"
+              << "  -o, --out-dir  ...writing each result under the same name here\n"
+              << "  -j, --jobs     Files processed concurrently (default: number of cores)\n"
+              << "      --stats    Print the phase and operation breakdown after the summary\n";
+}
+
+// --stats: end-to-end throughput, then what the library recorded (phases and BC:: operations,
+// summed over all threads) if it was built with BLOCKCRYPT_STATS
+void print_stats(double seconds, uint64_t bytes)
+{
+    char line[160];
+    double mib = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    std::snprintf(line, sizeof(line), "%.2f MiB in %.3f s (%.1f MiB/s)\n", mib, seconds, seconds > 0 ? mib / seconds : 0.0);
+    std::cerr << line;
+    BC::BufferPool::Stats pool = BC::BufferPool::instance().stats();
+    std::snprintf(line, sizeof(line), "buffer pool: %llu acquires, %llu reused, %llu system allocations, %.2f MiB cached\n",
+                  static_cast<unsigned long long>(pool.acquires),
+                  static_cast<unsigned long long>(pool.threadHits + pool.depotHits),
+                  static_cast<unsigned long long>(pool.systemAllocations),
+                  static_cast<double>(pool.bytesCached) / (1024.0 * 1024.0));
+    std::cerr << line;
+    if (!BCStats::enabled())
+    {
+        std::cerr << "(built without BLOCKCRYPT_STATS; configure with -DBLOCKCRYPT_STATS=ON for the breakdown)\n";
+        return;
+    }
+
+    BCStats::Snapshot s = BCStats::snapshot();
+    uint64_t phase_ns = 0;
+    for (const BCStats::Timing &t : s.phases)
+        phase_ns += t.nanoseconds;
+
+    std::cerr << "phase        calls        MiB    time ms  share    MiB/s\n";
+    for (std::size_t i = 0; i < BCStats::kPhases; ++i)
+    {
+        const BCStats::Timing &t = s.phases[i];
+        double ms = static_cast<double>(t.nanoseconds) / 1e6;
+        double t_mib = static_cast<double>(t.bytes) / (1024.0 * 1024.0);
+        std::snprintf(line, sizeof(line), "%-10s %7llu %10.2f %10.3f %5.1f%% %8.1f\n",
+                      BCStats::phaseName(static_cast<BCStats::Phase>(i)), static_cast<unsigned long long>(t.calls),
+                      t_mib, ms, phase_ns ? 100.0 * static_cast<double>(t.nanoseconds) / static_cast<double>(phase_ns) : 0.0,
+                      ms > 0 ? t_mib / (ms / 1000.0) : 0.0);
+        std::cerr << line;
+    }
+
+    std::cerr << "operation        calls        MiB     blocks    time ms   p50 us   p99 us    GB/s\n";
+    for (std::size_t i = 0; i < BCStats::kOps; ++i)
+    {
+        const BCStats::Timing &t = s.ops[i];
+        if (t.calls == 0)
+            continue;
+        std::snprintf(line, sizeof(line), "%-14s %7llu %10.2f %10llu %10.3f %8.1f %8.1f %7.2f\n",
+                      BCStats::opName(static_cast<BCStats::Op>(i)), static_cast<unsigned long long>(t.calls),
+                      static_cast<double>(t.bytes) / (1024.0 * 1024.0), static_cast<unsigned long long>(t.blocks),
+                      static_cast<double>(t.nanoseconds) / 1e6, static_cast<double>(t.percentileNs(50)) / 1e3,
+                      static_cast<double>(t.percentileNs(99)) / 1e3, t.gbps());
+        std::cerr << line;
+    }
+    std::cerr << "key expansions: " << s.keyExpansions << ", padding errors: " << s.paddingErrors << "\n";
+}
+
+// Parses a whole unsigned decimal option value; false on anything else (no exceptions)
+template <typename T>
+bool parse_number(const char *text, T &value)
+{
+    const char *end = text + std::strlen(text);
+    auto [ptr, ec] = std::from_chars(text, end, value);
+    return ec == std::errc() && ptr == end && ptr != text;
+}
+
+// True if `path` can be written as a regular file: one exists there, or nothing does.
+// Pipes and devices (and paths stat() cannot see for another reason) are streamed instead.
+bool is_file_target(const std::string &path)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0)
+        return S_ISREG(st.st_mode);
+    return errno == ENOENT;
+}
+
+// Reads hex key/IV for the single-file command (invalid -> zeros)
+template <typename Array>
+Array parse_hex_array(const std::string &hex)
+{
+    auto bytes = hex_to_bytes(hex);
+    if (bytes.size() != Array().size())
+        bytes.assign(Array().size(), 0);
+    Array out;
+    std::copy_n(bytes.begin(), out.size(), out.begin());
+    return out;
+}
+
+// Strict variant for batch mode, where a mistyped key would silently encrypt every file under
+// the all-zero key: exactly 2 * size hex digits, false otherwise
+template <typename Array>
+bool parse_hex_exact(const std::string &hex, Array &out)
+{
+    auto is_hex = [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; };
+    if (hex.size() != 2 * out.size() || !std::all_of(hex.begin(), hex.end(), is_hex))
+        return false;
+    std::vector<Byte> bytes = hex_to_bytes(hex);
+    std::copy_n(bytes.begin(), out.size(), out.begin());
+    return true;
+}
+
+// --container: the chunked format of container.hpp. Encryption takes any input (stdin too)
+// and needs an output file; decryption needs a seekable input file and decodes either the
+// whole file (in parallel, straight into a mapped output file) or the requested byte range.
+void run_container(bool encrypt, const Key &key, const std::string &infile, const std::string &outfile,
+                   const BCFile::ContainerOptions &options, std::size_t jobs, uint64_t offset, uint64_t length)
+{
+    const BlockCrypt aes(key);
+    BC::ThreadPool pool(jobs);
+    if (encrypt)
+    {
+        if (outfile.empty())
+            throw std::runtime_error("--container encryption needs an output file (-O)");
+        std::ifstream in_file;
+        if (!infile.empty())
+        {
+            in_file.open(infile, std::ios::binary);
+            if (!in_file)
+                throw std::runtime_error("Cannot open input file: " + infile);
+        }
+        std::istream &in = infile.empty() ? std::cin : in_file;
+
+        BCFile::ContainerWriter writer(outfile, aes, pool, options);
+        BC::PooledBuffer chunk = BC::BufferPool::instance().acquire(
+            std::max<std::size_t>(options.chunkBytes, BLOCK_SIZE), BC::BufferPool::Use::Sensitive);
+        while (in.read(reinterpret_cast<char *>(chunk.data()), chunk.size()) || in.gcount() > 0)
+            writer.write(chunk.data(), static_cast<std::size_t>(in.gcount()));
+        writer.finish();
+        return;
+    }
+
+    if (infile.empty())
+        throw std::runtime_error("--container decryption needs an input file (-I)");
+    BCFile::ContainerReader reader(infile, aes);
+    bool whole = offset == 0 && length >= reader.size();
+    if (whole && !outfile.empty() && is_file_target(outfile))
+    {
+        reader.decryptTo(outfile, pool);
+        return;
+    }
+
+    std::ofstream out_file;
+    if (!outfile.empty())
+    {
+        out_file.open(outfile, std::ios::binary);
+        if (!out_file)
+            throw std::runtime_error("Cannot open output file: " + outfile);
+    }
+    std::ostream &out = outfile.empty() ? std::cout : out_file;
+    BC::PooledBuffer chunk = BC::BufferPool::instance().acquire(reader.chunkSize(), BC::BufferPool::Use::Sensitive);
+    reader.seek(offset);
+    while (length != 0)
+    {
+        std::size_t n = reader.read(chunk.data(), static_cast<std::size_t>(std::min<uint64_t>(length, chunk.size())));
+        if (n == 0)
+            break;
+        out.write(reinterpret_cast<const char *>(chunk.data()), n);
+        length -= n;
+    }
+    out.flush();
+    if (!out)
+        throw std::runtime_error("Cannot write output");
+}
+
+// decrypt --offset/--length on a plain CBC file: BCFile::decryptFileCBCRange reads and
+// decrypts only the blocks covering the range, one pooled window at a time.
+void run_cbc_range(const Key &key, const Block &iv, const std::string &infile, const std::string &outfile,
+                   uint64_t offset, uint64_t length)
+{
+    if (infile.empty() || !BCFile::isRegularFile(infile))
+        throw std::runtime_error("--offset/--length need a regular input file (-I)");
+    // Opens the input once and checks the final block's padding before any output exists
+    BCFile::CBCRangeReader reader(infile, BlockCrypt(key), iv);
+
+    std::ofstream out_file;
+    if (!outfile.empty())
+    {
+        out_file.open(outfile, std::ios::binary);
+        if (!out_file)
+            throw std::runtime_error("Cannot open output file: " + outfile);
+    }
+    std::ostream &out = outfile.empty() ? std::cout : out_file;
+    BC::PooledBuffer chunk = BC::BufferPool::instance().acquire(1 << 20, BC::BufferPool::Use::Sensitive);
+    while (length != 0)
+    {
+        std::size_t want = static_cast<std::size_t>(std::min<uint64_t>(length, chunk.size()));
+        std::size_t n = reader.read(offset, chunk.data(), want);
+        BCStats::PhaseTimer write(BCStats::Phase::Write, n);
+        out.write(reinterpret_cast<const char *>(chunk.data()), n);
+        offset += n;
+        length -= n;
+        if (n < want)
+            break;
+    }
+    out.flush();
+    if (!out)
+        throw std::runtime_error("Cannot write output");
+}
+
+// blockcrypt batch encrypt|decrypt ...: one process, one key expansion, many files.
+// Files are spread over a bounded work-stealing pool; each one goes through the
+// memory-mapped path, so page-in of one file overlaps with encryption of the others.
+int run_batch(int argc, char *argv[])
+{
+    if (argc < 3 || (std::strcmp(argv[2], "encrypt") != 0 && std::strcmp(argv[2], "decrypt") != 0))
+    {
+        std::cerr << "batch needs a mode: encrypt or decrypt\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+    bool do_encrypt = std::strcmp(argv[2], "encrypt") == 0;
+
+    std::string key_hex;
+    std::string iv_hex = "000102030405060708090A0B0C0D0E0F";
+    std::string list_file, in_dir, out_dir;
+    std::size_t jobs = 0;
+    bool show_stats = false;
+    BCFile::MapOptions map_options;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-k" || arg == "--key") && has_value)
+            key_hex = argv[++i];
+        else if ((arg == "-i" || arg == "--iv") && has_value)
+            iv_hex = argv[++i];
+        else if ((arg == "-L" || arg == "--list") && has_value)
+            list_file = argv[++i];
+        else if ((arg == "-D" || arg == "--dir") && has_value)
+            in_dir = argv[++i];
+        else if ((arg == "-o" || arg == "--out-dir") && has_value)
+            out_dir = argv[++i];
+        else if ((arg == "-j" || arg == "--jobs") && has_value)
+        {
+            if (!parse_number(argv[++i], jobs))
+            {
+                std::cerr << "Invalid number for " << arg << ": " << argv[i] << "\n";
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--hugepages")
+            map_options.hugePages = true;
+        else if (arg == "--stats")
+            show_stats = true;
+        else
+        {
+            std::cerr << "Unknown or incomplete option: " << arg << "\n";
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Key key;
+    Block iv;
+    if (!parse_hex_exact(key_hex, key))
+    {
+        std::cerr << (key_hex.empty() ? "batch needs a key (-k)\n" : "batch key must be 32 hex digits\n");
+        return 1;
+    }
+    if (!parse_hex_exact(iv_hex, iv))
+    {
+        std::cerr << "batch IV must be 32 hex digits\n";
+        return 1;
+    }
+
+    // Collect the (input, output) pairs
+    std::vector<std::pair<std::string, std::string>> files;
+    if (!list_file.empty())
+    {
+        std::ifstream list(list_file);
+        if (!list)
+        {
+            std::cerr << "Cannot open list file: " << list_file << "\n";
+            return 1;
+        }
+        std::string line;
+        while (std::getline(list, line))
+        {
+            std::istringstream fields(line);
+            std::string in, out;
+            if (!(fields >> in))
+                continue; // blank line
+            if (!(fields >> out))
+            {
+                std::cerr << "List line without output file: " << line << "\n";
+                return 1;
+            }
+            files.emplace_back(in, out);
+        }
+    }
+    else if (!in_dir.empty() && !out_dir.empty())
+    {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        fs::create_directories(out_dir, ec);
+        for (const fs::directory_entry &entry : fs::directory_iterator(in_dir, ec))
+        {
+            if (entry.is_regular_file())
+                files.emplace_back(entry.path().string(), (fs::path(out_dir) / entry.path().filename()).string());
+        }
+        if (ec)
+        {
+            std::cerr << "Cannot read directory " << in_dir << ": " << ec.message() << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        std::cerr << "batch needs -L listfile or -D indir -o outdir\n";
+        return 1;
+    }
+
+    // Expand the key once; every worker reads the same (immutable) schedule
+    const BlockCrypt aes(key);
+
+    BC::ThreadPool pool(jobs);
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<std::size_t> failed{0};
+    std::mutex report;
+
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(files.size(), [&](std::size_t index, std::size_t)
+    {
+        const auto &job = files[index];
+        try
+        {
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(job.first, ec);
+            if (do_encrypt)
+                BCFile::encryptFileCBC(job.first, job.second, aes, iv, map_options);
+            else
+                BCFile::decryptFileCBC(job.first, job.second, aes, iv, map_options);
+            bytes += ec ? 0 : size;
+        }
+        catch (const std::exception &e)
+        {
+            ++failed;
+            std::lock_guard<std::mutex> guard(report);
+            std::cerr << job.first << ": " << e.what() << '\n';
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double mb = static_cast<double>(bytes.load()) / (1024.0 * 1024.0);
+    std::cerr << (files.size() - failed) << "/" << files.size() << " files, " << mb << " MiB in " << seconds
+              << " s (" << (seconds > 0 ? mb / seconds : 0.0) << " MiB/s, " << pool.size() << " workers)\n";
+    if (show_stats)
+        print_stats(seconds, bytes.load());
+    return failed == 0 ? 0 : 2;
 }
 
 int main(int argc, char *argv[])
@@ -47,6 +432,9 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (std::strcmp(argv[1], "batch") == 0)
+        return run_batch(argc, argv);
+
     bool do_encrypt = false;
     bool do_decrypt = false;
 
@@ -54,6 +442,16 @@ int main(int argc, char *argv[])
     std::string iv_hex = "000102030405060708090A0B0C0D0E0F";
     std::string infile;
     std::string outfile;
+    bool inplace = false;
+    bool pipelined = false;
+    bool show_stats = false;
+    BCFile::MapOptions map_options;
+    BCFile::PipelineOptions pipeline_options;
+    BCFile::ContainerOptions container_options;
+    bool container = false;
+    std::size_t jobs = 0;
+    uint64_t range_offset = 0;
+    uint64_t range_length = UINT64_MAX;
 
     // Determine subcommand
     if (std::strcmp(argv[1], "encrypt") == 0)
@@ -120,6 +518,62 @@ int main(int argc, char *argv[])
                 return 1;
             }
         }
+        else if (arg == "--inplace")
+        {
+            inplace = true;
+        }
+        else if (arg == "--hugepages")
+        {
+            map_options.hugePages = true;
+        }
+        else if (arg == "--uring")
+        {
+            pipelined = true;
+        }
+        else if (arg == "--stats")
+        {
+            show_stats = true;
+        }
+        else if (arg == "--direct")
+        {
+            pipeline_options.direct = true;
+        }
+        else if (arg == "--chunk-kb")
+        {
+            if (i + 1 < argc)
+            {
+                std::size_t kb = 0;
+                if (!parse_number(argv[++i], kb) || kb == 0 || kb > (std::size_t(1) << 20))
+                {
+                    std::cerr << "--chunk-kb needs a size from 1 to 1048576 KiB\n";
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                pipeline_options.chunkBytes = container_options.chunkBytes = kb * 1024;
+            }
+            else
+            {
+                std::cerr << "Missing chunk size\n";
+                return 1;
+            }
+        }
+        else if (arg == "--container")
+        {
+            container = true;
+        }
+        else if ((arg == "-j" || arg == "--jobs" || arg == "--offset" || arg == "--length") && i + 1 < argc)
+        {
+            const char *value = argv[++i];
+            bool ok = arg == "--offset" ? parse_number(value, range_offset)
+                      : arg == "--length" ? parse_number(value, range_length)
+                                          : parse_number(value, jobs);
+            if (!ok)
+            {
+                std::cerr << "Invalid number for " << arg << ": " << value << "\n";
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
         else if (arg == "-h" || arg == "--help")
         {
             print_usage(argv[0]);
@@ -134,37 +588,153 @@ int main(int argc, char *argv[])
     }
 
     // prepare key and iv
-    auto key_bytes = hex_to_bytes(key_hex);
-    if (key_bytes.size() != 16)
-        key_bytes.assign(16, 0);
-    Key key;
-    std::copy_n(key_bytes.begin(), 16, key.begin());
+    Key key = parse_hex_array<Key>(key_hex);
+    Block iv = parse_hex_array<Block>(iv_hex);
 
-    auto iv_bytes = hex_to_bytes(iv_hex);
-    if (iv_bytes.size() != 16)
-        iv_bytes.assign(16, 0);
-    Block iv;
-    std::copy_n(iv_bytes.begin(), 16, iv.begin());
-
-    // read input
-    std::vector<Byte> buffer;
-    if (!infile.empty())
+    if (inplace && (infile.empty() || !outfile.empty()))
+    {
+        std::cerr << "--inplace needs an input file (-I) and no output file\n";
+        return 1;
+    }
+    if (container && (inplace || pipelined))
     {
-        std::ifstream in(infile, std::ios::binary);
-        buffer.assign(std::istreambuf_iterator<char>(in), {});
+        std::cerr << "--container cannot be combined with --inplace or --uring\n";
+        return 1;
     }
-    else
+    bool ranged = range_offset != 0 || range_length != UINT64_MAX;
+    if (ranged && (!do_decrypt || inplace || pipelined))
     {
-        buffer.assign(std::istreambuf_iterator<char>(std::cin), {});
+        std::cerr << "--offset/--length need decrypt without --inplace or --uring\n";
+        return 1;
     }
 
-    // perform operation
+    std::error_code size_error;
+    uint64_t bytes_in = infile.empty() ? 0 : std::filesystem::file_size(infile, size_error);
+    auto start = std::chrono::steady_clock::now();
     try
     {
-        if (do_encrypt)
-            BC::encryptCBC(buffer, key, iv);
-        if (do_decrypt)
-            BC::decryptCBC(buffer, key, iv);
+        bool out_is_file = !outfile.empty() && is_file_target(outfile);
+        bool files = !infile.empty() && BCFile::isRegularFile(infile) && out_is_file;
+
+        // Regular files are memory-mapped and processed straight from one mapping to the
+        // other (or within one, in place); no copy through a std::vector
+        if (container)
+        {
+            run_container(do_encrypt, key, infile, outfile, container_options, jobs, range_offset, range_length);
+        }
+        else if (ranged)
+        {
+            run_cbc_range(key, iv, infile, outfile, range_offset, range_length);
+        }
+        else if (inplace)
+        {
+            if (do_encrypt)
+                BCFile::encryptFileCBCInPlace(infile, key, iv, map_options);
+            else
+                BCFile::decryptFileCBCInPlace(infile, key, iv, map_options);
+        }
+        else if (files && pipelined)
+        {
+            // Disk and CPU overlap: chunk N is encrypted while N+1 is read and N-1 written
+            if (do_encrypt)
+                BCFile::encryptFileCBCPipelined(infile, outfile, key, iv, pipeline_options);
+            else
+                BCFile::decryptFileCBCPipelined(infile, outfile, key, iv, pipeline_options);
+        }
+        else if (files)
+        {
+            if (do_encrypt)
+                BCFile::encryptFileCBC(infile, outfile, key, iv, map_options);
+            else
+                BCFile::decryptFileCBC(infile, outfile, key, iv, map_options);
+        }
+        else
+        {
+            // Everything else (stdin, pipes, stdout, devices) streams in fixed-size chunks
+            std::ifstream in_file;
+            std::ofstream out_file;
+            if (!infile.empty())
+            {
+                in_file.open(infile, std::ios::binary);
+                if (!in_file)
+                {
+                    std::cerr << "Cannot open input file: " << infile << "\n";
+                    return 1;
+                }
+            }
+            // A regular -O file is written under a temporary name next to it and renamed over
+            // it only once final() has accepted the padding, as decryptFileCBC does; a wrong
+            // key then leaves the existing output alone
+            std::string temp_path, target_path;
+            if (!outfile.empty())
+            {
+                if (is_file_target(outfile))
+                {
+                    target_path = BCFile::replacementTarget(outfile);
+                    temp_path = BCFile::temporaryPathFor(target_path);
+                }
+                out_file.open(temp_path.empty() ? outfile : temp_path, std::ios::binary);
+                if (!out_file)
+                {
+                    if (!temp_path.empty())
+                        std::remove(temp_path.c_str());
+                    std::cerr << "Cannot open output file: " << outfile << "\n";
+                    return 1;
+                }
+            }
+            std::istream &in = infile.empty() ? std::cin : in_file;
+            std::ostream &out = outfile.empty() ? std::cout : out_file;
+            try
+            {
+                BC::CBCEncryptor encryptor(key, iv);
+                BC::CBCDecryptor decryptor(key, iv);
+                BC::PooledBuffer chunk = BC::BufferPool::instance().acquire(64 * 1024, BC::BufferPool::Use::Sensitive);
+                BC::PooledBuffer result = BC::BufferPool::instance().acquire(chunk.size() + 16, BC::BufferPool::Use::Sensitive);
+                std::size_t produced;
+                bytes_in = 0; // counted as it arrives
+                size_error.clear();
+                for (;;)
+                {
+                    BCStats::PhaseTimer read(BCStats::Phase::Read);
+                    if (!in.read(reinterpret_cast<char *>(chunk.data()), chunk.size()) && in.gcount() == 0)
+                        break;
+                    std::size_t got = static_cast<std::size_t>(in.gcount());
+                    read.setBytes(got);
+                    read.stop();
+                    bytes_in += got;
+
+                    BCStats::PhaseTimer cipher(BCStats::Phase::Cipher, got);
+                    produced = do_encrypt ? encryptor.update(chunk.data(), got, result.data())
+                                          : decryptor.update(chunk.data(), got, result.data());
+                    cipher.stop();
+
+                    BCStats::PhaseTimer write(BCStats::Phase::Write, produced);
+                    out.write(reinterpret_cast<const char *>(result.data()), produced);
+                    if (!out)
+                        throw std::runtime_error("Cannot write output");
+                }
+                produced = do_encrypt ? encryptor.final(result.data()) : decryptor.final(result.data());
+                BCStats::PhaseTimer write(BCStats::Phase::Write, produced);
+                out.write(reinterpret_cast<const char *>(result.data()), produced);
+                out.flush();
+                if (!out)
+                    throw std::runtime_error("Cannot write output");
+                if (!temp_path.empty())
+                {
+                    out_file.close();
+                    if (!out_file)
+                        throw std::runtime_error("Cannot write output");
+                    if (std::rename(temp_path.c_str(), target_path.c_str()) != 0)
+                        throw std::runtime_error("Cannot replace '" + target_path + "': " + std::strerror(errno));
+                }
+            }
+            catch (...)
+            {
+                if (!temp_path.empty())
+                    std::remove(temp_path.c_str());
+                throw;
+            }
+        }
     }
     catch (const std::exception &e)
     {
@@ -172,15 +742,8 @@ int main(int argc, char *argv[])
         return 2;
     }
 
-    if (!outfile.empty())
-    {
-        std::ofstream out(outfile, std::ios::binary);
-        out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
-    }
-    else
-    {
-        std::cout.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
-    }
-
+    if (show_stats)
+        print_stats(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                    size_error ? 0 : bytes_in);
     return 0;
-}
\ No newline at end of file
+}
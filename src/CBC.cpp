@@ -1,53 +1,566 @@
 #include "../include/CBC.hpp"
 #include "../include/padding.hpp"
+#include "aes_kernels.hpp"
+#include "mode_impl.hpp"
+#include "stats_impl.hpp"
 #include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 namespace BC
 {
     void encryptCBC(std::vector<uint8_t> &buf, const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad)
     {
-        BlockCrypt aes(key);
+        encryptCBC(buf, BlockCrypt(key), iv, pad);
+    }
+
+    template <std::size_t KeyBytes>
+    void encryptCBC(std::vector<uint8_t> &buf, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad)
+    {
+        // Grow once to the final size and encrypt in place
+        std::size_t length = buf.size();
+        buf.resize(pad ? BCPad::paddedLength(length) : length);
+        encryptCBC(aes, iv, buf.data(), length, buf.data(), buf.size(), pad);
+    }
+
+    template <std::size_t KeyBytes>
+    std::size_t encryptCBC(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv,
+                           const uint8_t *in, std::size_t length, uint8_t *out, std::size_t capacity, bool pad)
+    {
+        if (!pad && length % 16 != 0)
+            throw std::runtime_error("CBC input is not a multiple of the block size");
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptCBC, length);
+        std::size_t total = pad ? BCPad::paddedLength(length) : length;
+        if (capacity < total)
+            throw std::runtime_error("CBC output buffer too small");
+
         BlockCrypt::Block prev = iv;
+        std::size_t full = length - length % 16;
+        for (std::size_t i = 0; i < full; i += 16)
+        {
+            BlockCrypt::Block block;
+            detail::xorBytes(block.data(), in + i, prev.data(), 16);
+            aes.encrypt(block);
+            std::memcpy(out + i, block.data(), 16);
+            prev = block;
+        }
+
         if (pad)
-            BCPad::addPKCS7(buf);
+        {
+            // The plaintext tail and its padding are assembled on the stack, never in `in`
+            BlockCrypt::Block last;
+            std::size_t tail = length - full;
+            std::copy_n(in + full, tail, last.begin());
+            BCPad::writePKCS7(last.data(), tail);
+            detail::xorBytes(last.data(), last.data(), prev.data(), 16);
+            aes.encrypt(last);
+            std::memcpy(out + full, last.data(), 16);
+        }
+        return total;
+    }
 
-        for (std::size_t i = 0; i < buf.size(); i += 16)
+    namespace detail
+    {
+        template <std::size_t KeyBytes>
+        void decryptCBCInPlace(const BasicBlockCrypt<KeyBytes> &aes, uint8_t *data, std::size_t blocks,
+                               BlockCrypt::Block &prev, std::size_t lanes)
         {
-            BlockCrypt::Block block;
-            std::copy_n(buf.begin() + i, 16, block.begin());
+            // Unlike encryption, CBC decryption has no dependency between blocks: decrypt a batch
+            // with several blocks in flight (full groups for the bitsliced kernel), then XOR the
+            // whole batch against the ciphertext shifted by one block in a single pass. The last
+            // ciphertext block of the batch is saved first since the batch is written back in place.
+            constexpr std::size_t kBatchBlocks = 64;
+            uint8_t plain[kBatchBlocks * 16];
 
-            for (int b = 0; b < 16; b++)
+            for (std::size_t done = 0; done < blocks;)
             {
-                block[b] ^= prev[b];
+                std::size_t n = std::min(kBatchBlocks, blocks - done);
+                uint8_t *ct = data + done * 16;
+                aes.decryptBlocks(ct, plain, n, lanes);
+
+                xorBytes(plain, plain, prev.data(), 16);
+                xorBytes(plain + 16, plain + 16, ct, (n - 1) * 16);
+                std::memcpy(prev.data(), ct + (n - 1) * 16, 16);
+                std::memcpy(ct, plain, n * 16);
+
+                done += n;
             }
+        }
 
-            aes.encrypt(block);
-            std::copy(block.begin(), block.end(), buf.begin() + i);
-            prev = block;
+        template void decryptCBCInPlace(const BlockCrypt &, uint8_t *, std::size_t, BlockCrypt::Block &, std::size_t);
+        template void decryptCBCInPlace(const BlockCrypt192 &, uint8_t *, std::size_t, BlockCrypt::Block &, std::size_t);
+        template void decryptCBCInPlace(const BlockCrypt256 &, uint8_t *, std::size_t, BlockCrypt::Block &, std::size_t);
+    } // namespace detail
+
+    namespace
+    {
+        // decryptCBCInPlace for separate buffers: the ciphertext stays intact, so it is XORed
+        // straight out of `in` and nothing has to be saved. Batched the same way for locality.
+        template <std::size_t KeyBytes>
+        void decryptCBCBlocks(const BasicBlockCrypt<KeyBytes> &aes, const uint8_t *in, uint8_t *out,
+                              std::size_t blocks, BlockCrypt::Block &prev, std::size_t lanes)
+        {
+            if (in == out)
+            {
+                detail::decryptCBCInPlace(aes, out, blocks, prev, lanes);
+                return;
+            }
+
+            constexpr std::size_t kBatchBlocks = 64;
+            for (std::size_t done = 0; done < blocks;)
+            {
+                std::size_t n = std::min(kBatchBlocks, blocks - done);
+                const uint8_t *ct = in + done * 16;
+                uint8_t *pt = out + done * 16;
+                aes.decryptBlocks(ct, pt, n, lanes);
+
+                detail::xorBytes(pt, pt, prev.data(), 16);
+                detail::xorBytes(pt + 16, pt + 16, ct, (n - 1) * 16);
+                std::memcpy(prev.data(), ct + (n - 1) * 16, 16);
+
+                done += n;
+            }
         }
+    } // namespace
+
+    void decryptCBC(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad, std::size_t lanes)
+    {
+        if (data.size() % 16 != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+
+        decryptCBC(data, BlockCrypt(key), iv, pad, lanes);
     }
 
-    void decryptCBC(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad)
+    template <std::size_t KeyBytes>
+    void decryptCBC(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad, std::size_t lanes)
     {
-        BlockCrypt aes(key);
+        if (data.size() % 16 != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+
+        data.resize(decryptCBC(aes, iv, data.data(), data.size(), data.data(), data.size(), pad, lanes));
+    }
+
+    template <std::size_t KeyBytes>
+    std::size_t decryptCBC(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv,
+                           const uint8_t *in, std::size_t length, uint8_t *out, std::size_t capacity,
+                           bool pad, std::size_t lanes)
+    {
+        if (length % 16 != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptCBC, length);
+        if (!pad)
+        {
+            if (capacity < length)
+                throw std::runtime_error("CBC output buffer too small");
+            BlockCrypt::Block prev = iv;
+            decryptCBCBlocks(aes, in, out, length / 16, prev, lanes);
+            return length;
+        }
+        if (length == 0)
+            throw std::runtime_error("CBC ciphertext is empty, expected at least the padding block");
+
+        // Everything but the last block goes straight to `out`; the last one is decrypted on
+        // the stack so only its unpadded part is copied and `out` never needs the padding room
+        std::size_t head = length - 16;
+        if (capacity < head)
+            throw std::runtime_error("CBC output buffer too small");
+
         BlockCrypt::Block prev = iv;
-        for (std::size_t i = 0; i < data.size(); i += 16)
+        BlockCrypt::Block last;
+        std::memcpy(last.data(), in + head, 16);
+        decryptCBCBlocks(aes, in, out, head / 16, prev, lanes);
+        detail::decryptCBCInPlace(aes, last.data(), 1, prev, 0);
+
+        std::size_t tail = BCPad::unpaddedLength(last.data(), 16);
+        if (capacity < head + tail)
+            throw std::runtime_error("CBC output buffer too small");
+        std::memcpy(out + head, last.data(), tail);
+        return head + tail;
+    }
+
+    template <std::size_t KeyBytes>
+    void encryptCBC(PooledBuffer &buf, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad)
+    {
+        std::size_t length = buf.size();
+        buf.resize(pad ? BCPad::paddedLength(length) : length);
+        encryptCBC(aes, iv, buf.data(), length, buf.data(), buf.size(), pad);
+    }
+
+    template <std::size_t KeyBytes>
+    void decryptCBC(PooledBuffer &buf, const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv, bool pad, std::size_t lanes)
+    {
+        buf.resize(decryptCBC(aes, iv, buf.data(), buf.size(), buf.data(), buf.size(), pad, lanes));
+    }
+
+    template <std::size_t KeyBytes>
+    std::size_t decryptCBCRange(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &iv,
+                                const uint8_t *in, std::size_t inLength, uint64_t offset,
+                                uint8_t *out, std::size_t length, bool pad, std::size_t lanes)
+    {
+        if (inLength % 16 != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+        if (pad && inLength == 0)
+            throw std::runtime_error("CBC ciphertext is empty, expected at least the padding block");
+        if (offset >= inLength || length == 0)
+            return 0;
+
+        std::size_t begin = static_cast<std::size_t>(offset);
+        std::size_t end = begin + std::min(length, inLength - begin);
+
+        // Single block j on the stack, chained to ciphertext block j-1 (or the IV)
+        auto decryptBlock = [&](std::size_t j)
         {
-            BlockCrypt::Block block;
-            std::copy_n(data.begin() + i, 16, block.begin());
+            BlockCrypt::Block prev = iv, block;
+            if (j != 0)
+                std::memcpy(prev.data(), in + (j - 1) * 16, 16);
+            std::memcpy(block.data(), in + j * 16, 16);
+            detail::decryptCBCInPlace(aes, block.data(), 1, prev, 0);
+            return block;
+        };
+
+        // Only a range that reaches the final block needs its padding, which also fixes
+        // where the plaintext ends
+        std::size_t lastBlock = inLength / 16 - 1;
+        BlockCrypt::Block lastPlain{};
+        bool haveLast = pad && end > lastBlock * 16;
+        if (haveLast)
+        {
+            lastPlain = decryptBlock(lastBlock);
+            std::size_t plainLength = lastBlock * 16 + BCPad::unpaddedLength(lastPlain.data(), 16);
+            if (begin >= plainLength)
+                return 0;
+            end = std::min(end, plainLength);
+        }
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptCBC, end - begin);
 
-            BlockCrypt::Block temp = block;
-            aes.decrypt(temp);
+        auto partialBlock = [&](std::size_t pos, std::size_t n)
+        {
+            std::size_t j = pos / 16;
+            BlockCrypt::Block block = haveLast && j == lastBlock ? lastPlain : decryptBlock(j);
+            std::memcpy(out + (pos - begin), block.data() + pos % 16, n);
+        };
+
+        // Unaligned head, whole blocks straight into `out` through the batched path, tail.
+        // The whole blocks never include the padded final block: the plaintext ends inside it.
+        std::size_t pos = begin;
+        if (pos % 16 != 0)
+        {
+            std::size_t n = std::min(16 - pos % 16, end - pos);
+            partialBlock(pos, n);
+            pos += n;
+        }
+        std::size_t whole = (end - pos) / 16;
+        if (whole != 0)
+        {
+            BlockCrypt::Block prev = iv;
+            if (pos != 0)
+                std::memcpy(prev.data(), in + pos - 16, 16);
+            decryptCBCBlocks(aes, in + pos, out + (pos - begin), whole, prev, lanes);
+            pos += whole * 16;
+        }
+        if (pos < end)
+            partialBlock(pos, end - pos);
+        return end - begin;
+    }
 
-            for (int b = 0; b < 16; b++)
+    template <std::size_t KeyBytes>
+    std::vector<uint8_t> decryptCBCRange(const std::vector<uint8_t> &ciphertext, const BasicBlockCrypt<KeyBytes> &aes,
+                                         const BlockCrypt::Block &iv, uint64_t offset, std::size_t length, bool pad)
+    {
+        std::size_t room = offset < ciphertext.size()
+                               ? std::min(length, ciphertext.size() - static_cast<std::size_t>(offset))
+                               : 0;
+        std::vector<uint8_t> out(room);
+        out.resize(decryptCBCRange(aes, iv, ciphertext.data(), ciphertext.size(), offset, out.data(), out.size(), pad));
+        return out;
+    }
+
+    template void encryptCBC(std::vector<uint8_t> &, const BlockCrypt &, const BlockCrypt::Block &, bool);
+    template void encryptCBC(std::vector<uint8_t> &, const BlockCrypt192 &, const BlockCrypt::Block &, bool);
+    template void encryptCBC(std::vector<uint8_t> &, const BlockCrypt256 &, const BlockCrypt::Block &, bool);
+    template void decryptCBC(std::vector<uint8_t> &, const BlockCrypt &, const BlockCrypt::Block &, bool, std::size_t);
+    template void decryptCBC(std::vector<uint8_t> &, const BlockCrypt192 &, const BlockCrypt::Block &, bool, std::size_t);
+    template void decryptCBC(std::vector<uint8_t> &, const BlockCrypt256 &, const BlockCrypt::Block &, bool, std::size_t);
+    template std::size_t encryptCBC(const BlockCrypt &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint8_t *, std::size_t, bool);
+    template std::size_t encryptCBC(const BlockCrypt192 &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint8_t *, std::size_t, bool);
+    template std::size_t encryptCBC(const BlockCrypt256 &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint8_t *, std::size_t, bool);
+    template std::size_t decryptCBC(const BlockCrypt &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint8_t *, std::size_t, bool, std::size_t);
+    template std::size_t decryptCBC(const BlockCrypt192 &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint8_t *, std::size_t, bool, std::size_t);
+    template std::size_t decryptCBC(const BlockCrypt256 &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint8_t *, std::size_t, bool, std::size_t);
+    template void encryptCBC(PooledBuffer &, const BlockCrypt &, const BlockCrypt::Block &, bool);
+    template void encryptCBC(PooledBuffer &, const BlockCrypt192 &, const BlockCrypt::Block &, bool);
+    template void encryptCBC(PooledBuffer &, const BlockCrypt256 &, const BlockCrypt::Block &, bool);
+    template void decryptCBC(PooledBuffer &, const BlockCrypt &, const BlockCrypt::Block &, bool, std::size_t);
+    template void decryptCBC(PooledBuffer &, const BlockCrypt192 &, const BlockCrypt::Block &, bool, std::size_t);
+    template void decryptCBC(PooledBuffer &, const BlockCrypt256 &, const BlockCrypt::Block &, bool, std::size_t);
+    template std::size_t decryptCBCRange(const BlockCrypt &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint64_t, uint8_t *, std::size_t, bool, std::size_t);
+    template std::size_t decryptCBCRange(const BlockCrypt192 &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint64_t, uint8_t *, std::size_t, bool, std::size_t);
+    template std::size_t decryptCBCRange(const BlockCrypt256 &, const BlockCrypt::Block &, const uint8_t *, std::size_t, uint64_t, uint8_t *, std::size_t, bool, std::size_t);
+    template std::vector<uint8_t> decryptCBCRange(const std::vector<uint8_t> &, const BlockCrypt &, const BlockCrypt::Block &, uint64_t, std::size_t, bool);
+    template std::vector<uint8_t> decryptCBCRange(const std::vector<uint8_t> &, const BlockCrypt192 &, const BlockCrypt::Block &, uint64_t, std::size_t, bool);
+    template std::vector<uint8_t> decryptCBCRange(const std::vector<uint8_t> &, const BlockCrypt256 &, const BlockCrypt::Block &, uint64_t, std::size_t, bool);
+
+    template <std::size_t KeyBytes>
+    void encryptCBCBatch(const BasicBlockCrypt<KeyBytes> &aes, CBCJob *jobs, std::size_t count, bool pad, std::size_t lanes)
+    {
+        // Default: as many messages as the engine processes per pass (a full bitsliced group,
+        // 8 AESENC in flight, 4 T-table blocks); the widest is one AVX2 bitsliced group
+        constexpr std::size_t kMaxLanes = 16;
+        if (lanes == 0)
+        {
+            switch (aes.backend())
             {
-                temp[b] ^= prev[b];
+            case BlockCryptBackend::Bitsliced:
+            case BlockCryptBackend::VPerm:
+                lanes = BCKernel::bitsliceParallelBlocks();
+                break;
+            case BlockCryptBackend::TTable:
+                lanes = 4;
+                break;
+            default:
+                lanes = 8;
+                break;
             }
+        }
+        lanes = std::min(lanes, kMaxLanes);
+
+        std::size_t totalBytes = 0;
+        for (std::size_t j = 0; j < count; ++j)
+            totalBytes += jobs[j].length;
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptCBC, totalBytes);
 
-            std::copy(temp.begin(), temp.end(), data.begin() + i);
+        if (!pad)
+        {
+            for (std::size_t j = 0; j < count; ++j)
+            {
+                if (jobs[j].length % 16 != 0)
+                    throw std::runtime_error("CBC input is not a multiple of the block size");
+            }
+        }
+
+        // A lane carries one job: its chaining value and how much ciphertext is already out
+        struct Lane
+        {
+            CBCJob *job;
+            std::size_t pos;
+        };
+        Lane lane[kMaxLanes];
+        uint8_t stage[kMaxLanes * 16];
+        std::size_t active = 0;
+        std::size_t next = 0;
+
+        for (;;)
+        {
+            // Refill free lanes; jobs that produce no output finish on the spot
+            while (active < lanes && next < count)
+            {
+                CBCJob &job = jobs[next++];
+                job.written = pad ? BCPad::paddedLength(job.length) : job.length;
+                if (job.written != 0)
+                    lane[active++] = {&job, 0};
+            }
+            if (active == 0)
+                break;
+
+            // Stage P_i ^ C_(i-1) for every lane, encrypt all of them in one call. C_(i-1) is
+            // read back from the job's output, which also makes in == out safe.
+            for (std::size_t l = 0; l < active; ++l)
+            {
+                const Lane &ln = lane[l];
+                uint8_t *block = stage + l * 16;
+                std::size_t left = ln.job->length - ln.pos;
+                if (left >= 16)
+                {
+                    std::memcpy(block, ln.job->in + ln.pos, 16);
+                }
+                else
+                {
+                    // Last block of a padded message: plaintext tail, then PKCS#7 padding
+                    std::copy_n(ln.job->in + ln.pos, left, block);
+                    BCPad::writePKCS7(block, left);
+                }
+                const uint8_t *prev = ln.pos == 0 ? ln.job->iv.data() : ln.job->out + ln.pos - 16;
+                detail::xorBytes(block, block, prev, 16);
+            }
+            aes.encryptBlocks(stage, stage, active, lanes);
+
+            // Scatter, then drop finished lanes by moving the last active lane into the gap
+            for (std::size_t l = 0; l < active;)
+            {
+                Lane &ln = lane[l];
+                std::memcpy(ln.job->out + ln.pos, stage + l * 16, 16);
+                ln.pos += 16;
+                if (ln.pos == ln.job->written)
+                {
+                    --active;
+                    lane[l] = lane[active];
+                    std::memcpy(stage + l * 16, stage + active * 16, 16);
+                }
+                else
+                {
+                    ++l;
+                }
+            }
+        }
+    }
+
+    template void encryptCBCBatch(const BlockCrypt &, CBCJob *, std::size_t, bool, std::size_t);
+    template void encryptCBCBatch(const BlockCrypt192 &, CBCJob *, std::size_t, bool, std::size_t);
+    template void encryptCBCBatch(const BlockCrypt256 &, CBCJob *, std::size_t, bool, std::size_t);
+
+    namespace
+    {
+        // Shared buffering of update(): emits the first `emit` bytes of pending || in to `out`
+        // (emit must be >= pendingLen) and keeps the rest of `in` as the new pending bytes.
+        // Handles in == out: the kept tail is saved before the forward shift overwrites it.
+        void releaseBytes(uint8_t *pending, std::size_t &pendingLen, const uint8_t *in, std::size_t length,
+                          uint8_t *out, std::size_t emit)
+        {
+            std::size_t fromIn = emit - pendingLen;
+            uint8_t tail[16];
+            std::size_t tailLen = length - fromIn;
+            std::memcpy(tail, in + fromIn, tailLen);
+
+            std::memmove(out + pendingLen, in, fromIn);
+            std::memcpy(out, pending, pendingLen);
+            std::memcpy(pending, tail, tailLen);
+            pendingLen = tailLen;
+        }
+    } // namespace
+
+    CBCEncryptor::CBCEncryptor(const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad)
+        : CBCEncryptor(BlockCrypt(key), iv, pad)
+    {
+    }
+
+    CBCEncryptor::CBCEncryptor(const BlockCrypt &aes, const BlockCrypt::Block &iv, bool pad)
+        : aes(aes), prev(iv), partial{}, pad(pad)
+    {
+    }
+
+    std::size_t CBCEncryptor::update(const uint8_t *in, std::size_t length, uint8_t *out)
+    {
+        if (length == 0)
+            return 0;
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptCBC, length);
+
+        std::size_t total = partialLen + length;
+        std::size_t emit = total - total % 16;
+        if (emit == 0)
+        {
+            std::memcpy(partial.data() + partialLen, in, length);
+            partialLen += length;
+            return 0;
+        }
+
+        releaseBytes(partial.data(), partialLen, in, length, out, emit);
+
+        // Encryption is inherently serial: each block needs the previous ciphertext
+        for (std::size_t i = 0; i < emit; i += 16)
+        {
+            BlockCrypt::Block block;
+            detail::xorBytes(block.data(), out + i, prev.data(), 16);
+            aes.encrypt(block);
+            std::memcpy(out + i, block.data(), 16);
             prev = block;
         }
-        if (pad)
-            BCPad::removePKCS7(data);
+        return emit;
+    }
+
+    std::size_t CBCEncryptor::final(uint8_t *out)
+    {
+        if (!pad)
+        {
+            if (partialLen != 0)
+                throw std::runtime_error("CBC input is not a multiple of the block size");
+            return 0;
+        }
+
+        BlockCrypt::Block last = partial;
+        BCPad::writePKCS7(last.data(), partialLen);
+        partialLen = 0;
+        return update(last.data(), last.size(), out);
+    }
+
+    void CBCEncryptor::update(const std::vector<uint8_t> &in, std::vector<uint8_t> &out)
+    {
+        std::size_t start = out.size();
+        out.resize(start + in.size() + 15);
+        out.resize(start + update(in.data(), in.size(), out.data() + start));
+    }
+
+    void CBCEncryptor::final(std::vector<uint8_t> &out)
+    {
+        std::size_t start = out.size();
+        out.resize(start + 16);
+        out.resize(start + final(out.data() + start));
+    }
+
+    CBCDecryptor::CBCDecryptor(const BlockCrypt::Key &key, const BlockCrypt::Block &iv, bool pad)
+        : CBCDecryptor(BlockCrypt(key), iv, pad)
+    {
+    }
+
+    CBCDecryptor::CBCDecryptor(const BlockCrypt &aes, const BlockCrypt::Block &iv, bool pad)
+        : aes(aes), prev(iv), pending{}, pad(pad)
+    {
+    }
+
+    std::size_t CBCDecryptor::update(const uint8_t *in, std::size_t length, uint8_t *out)
+    {
+        if (length == 0)
+            return 0;
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptCBC, length);
+
+        // Keep the incomplete tail; with padding also keep the last whole block for final()
+        std::size_t total = pendingLen + length;
+        std::size_t keep = total % 16;
+        if (pad && keep == 0 && total != 0)
+            keep = 16;
+        std::size_t emit = total - keep;
+        if (emit == 0)
+        {
+            std::memcpy(pending.data() + pendingLen, in, length);
+            pendingLen += length;
+            return 0;
+        }
+
+        releaseBytes(pending.data(), pendingLen, in, length, out, emit);
+        detail::decryptCBCInPlace(aes, out, emit / 16, prev, 0);
+        return emit;
+    }
+
+    std::size_t CBCDecryptor::final(uint8_t *out)
+    {
+        if (!pad)
+        {
+            if (pendingLen != 0)
+                throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+            return 0;
+        }
+        if (pendingLen != 16)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+
+        BCStats::detail::Nested counted; // the held-back block was counted by update()
+        BlockCrypt::Block last = pending;
+        detail::decryptCBCInPlace(aes, last.data(), 1, prev, 0);
+        pendingLen = 0;
+        std::size_t n = BCPad::unpaddedLength(last.data(), last.size());
+        std::memcpy(out, last.data(), n);
+        return n;
+    }
+
+    void CBCDecryptor::update(const std::vector<uint8_t> &in, std::vector<uint8_t> &out)
+    {
+        std::size_t start = out.size();
+        out.resize(start + in.size() + 15);
+        out.resize(start + update(in.data(), in.size(), out.data() + start));
+    }
+
+    void CBCDecryptor::final(std::vector<uint8_t> &out)
+    {
+        std::size_t start = out.size();
+        out.resize(start + 16);
+        out.resize(start + final(out.data() + start));
     }
 }
@@ -0,0 +1,101 @@
+#include "../include/CTR.hpp"
+#include "mode_impl.hpp"
+#include "stats_impl.hpp"
+#include <algorithm>
+
+namespace BC
+{
+    namespace
+    {
+        // counter += blocks, treating the 16-byte block as one big-endian 128-bit integer
+        BlockCrypt::Block addCounter(BlockCrypt::Block counter, uint64_t blocks)
+        {
+            uint64_t carry = blocks;
+            for (int i = 15; i >= 0 && carry != 0; --i)
+            {
+                uint64_t sum = counter[i] + (carry & 0xff);
+                counter[i] = static_cast<uint8_t>(sum);
+                carry = (carry >> 8) + (sum >> 8);
+            }
+            return counter;
+        }
+
+        // Increments the low 64 bits, carrying into the high 64 bits on wrap-around
+        inline void incrementCounter(uint64_t &hi, uint64_t &lo)
+        {
+            if (++lo == 0)
+                ++hi;
+        }
+
+        inline uint64_t loadBE64(const uint8_t *p)
+        {
+            uint64_t v = 0;
+            for (int i = 0; i < 8; ++i)
+                v = (v << 8) | p[i];
+            return v;
+        }
+
+        inline void storeBE64(uint8_t *p, uint64_t v)
+        {
+            for (int i = 7; i >= 0; --i)
+            {
+                p[i] = static_cast<uint8_t>(v);
+                v >>= 8;
+            }
+        }
+    } // namespace
+
+    BlockCrypt::Block makeCounterBlock(const Nonce &nonce, uint64_t counter)
+    {
+        BlockCrypt::Block block;
+        std::copy(nonce.begin(), nonce.end(), block.begin());
+        storeBE64(block.data() + 8, counter);
+        return block;
+    }
+
+    template <std::size_t KeyBytes>
+    void cryptCTR(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &counter, uint64_t offset, uint8_t *data, std::size_t length)
+    {
+        if (length == 0)
+            return;
+        BCStats::detail::OpTimer timer(BCStats::Op::CTR, length);
+
+        // Enough blocks to fill the widest bitsliced group several times and keep the
+        // interleaved AES-NI path busy, while the keystream stays in L1.
+        constexpr std::size_t kBatchBlocks = 64;
+        uint8_t stream[kBatchBlocks * 16];
+
+        BlockCrypt::Block first = addCounter(counter, offset / 16);
+        uint64_t hi = loadBE64(first.data());
+        uint64_t lo = loadBE64(first.data() + 8);
+        std::size_t skip = static_cast<std::size_t>(offset % 16); // keystream bytes before data[0]
+
+        while (length > 0)
+        {
+            std::size_t blocks = std::min(kBatchBlocks, (skip + length + 15) / 16);
+            for (std::size_t b = 0; b < blocks; ++b)
+            {
+                storeBE64(stream + b * 16, hi);
+                storeBE64(stream + b * 16 + 8, lo);
+                incrementCounter(hi, lo);
+            }
+            aes.encryptBlocks(stream, stream, blocks);
+
+            std::size_t n = std::min(length, blocks * 16 - skip);
+            detail::xorBytes(data, data, stream + skip, n);
+            data += n;
+            length -= n;
+            skip = 0;
+        }
+    }
+
+    template void cryptCTR(const BlockCrypt &, const BlockCrypt::Block &, uint64_t, uint8_t *, std::size_t);
+    template void cryptCTR(const BlockCrypt192 &, const BlockCrypt::Block &, uint64_t, uint8_t *, std::size_t);
+    template void cryptCTR(const BlockCrypt256 &, const BlockCrypt::Block &, uint64_t, uint8_t *, std::size_t);
+
+    void cryptCTR(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &counter, uint64_t offset)
+    {
+        BlockCrypt aes(key);
+        cryptCTR(aes, counter, offset, data.data(), data.size());
+    }
+} // namespace BC
@@ -0,0 +1,86 @@
+#include "../include/ECB.hpp"
+#include "../include/padding.hpp"
+#include "stats_impl.hpp"
+#include <stdexcept>
+
+namespace BC
+{
+    void encryptECB(std::vector<uint8_t> &data, const BlockCrypt::Key &key, bool pad)
+    {
+        encryptECB(data, BlockCrypt(key), pad);
+    }
+
+    template <std::size_t KeyBytes>
+    void encryptECB(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad)
+    {
+        if (pad)
+            BCPad::addPKCS7(data);
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB input is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptECB, data.size());
+        aes.encryptBlocks(data.data(), data.data(), data.size() / BLOCK_SIZE);
+    }
+
+    void decryptECB(std::vector<uint8_t> &data, const BlockCrypt::Key &key, bool pad)
+    {
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB ciphertext is not a multiple of the block size");
+
+        decryptECB(data, BlockCrypt(key), pad);
+    }
+
+    template <std::size_t KeyBytes>
+    void decryptECB(std::vector<uint8_t> &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad)
+    {
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB ciphertext is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptECB, data.size());
+        aes.decryptBlocks(data.data(), data.data(), data.size() / BLOCK_SIZE);
+        if (pad)
+            BCPad::removePKCS7(data);
+    }
+
+    template <std::size_t KeyBytes>
+    void encryptECB(PooledBuffer &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad)
+    {
+        if (pad)
+        {
+            std::size_t length = data.size();
+            std::size_t full = length - length % BLOCK_SIZE;
+            data.resize(BCPad::paddedLength(length));
+            BCPad::writePKCS7(data.data() + full, length - full);
+        }
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB input is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptECB, data.size());
+        aes.encryptBlocks(data.data(), data.data(), data.size() / BLOCK_SIZE);
+    }
+
+    template <std::size_t KeyBytes>
+    void decryptECB(PooledBuffer &data, const BasicBlockCrypt<KeyBytes> &aes, bool pad)
+    {
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB ciphertext is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptECB, data.size());
+        aes.decryptBlocks(data.data(), data.data(), data.size() / BLOCK_SIZE);
+        if (pad)
+            data.resize(BCPad::unpaddedLength(data.data(), data.size()));
+    }
+
+    template void encryptECB(std::vector<uint8_t> &, const BlockCrypt &, bool);
+    template void encryptECB(std::vector<uint8_t> &, const BlockCrypt192 &, bool);
+    template void encryptECB(std::vector<uint8_t> &, const BlockCrypt256 &, bool);
+    template void decryptECB(std::vector<uint8_t> &, const BlockCrypt &, bool);
+    template void decryptECB(std::vector<uint8_t> &, const BlockCrypt192 &, bool);
+    template void decryptECB(std::vector<uint8_t> &, const BlockCrypt256 &, bool);
+    template void encryptECB(PooledBuffer &, const BlockCrypt &, bool);
+    template void encryptECB(PooledBuffer &, const BlockCrypt192 &, bool);
+    template void encryptECB(PooledBuffer &, const BlockCrypt256 &, bool);
+    template void decryptECB(PooledBuffer &, const BlockCrypt &, bool);
+    template void decryptECB(PooledBuffer &, const BlockCrypt192 &, bool);
+    template void decryptECB(PooledBuffer &, const BlockCrypt256 &, bool);
+}
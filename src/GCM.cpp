@@ -0,0 +1,160 @@
+#include "../include/GCM.hpp"
+#include "ghash.hpp"
+#include "mode_impl.hpp"
+#include "stats_impl.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace BC
+{
+    namespace
+    {
+        // Blocks per fused step: the keystream and the data batch (2 x 1 KB) stay in L1 between
+        // the CTR XOR and the GHASH pass over the ciphertext.
+        constexpr std::size_t kBatchBlocks = 64;
+
+        // GCM increments only the low 32 bits of the counter block (inc32)
+        inline void inc32(BlockCrypt::Block &counter)
+        {
+            for (int i = 15; i >= 12; --i)
+            {
+                if (++counter[i] != 0)
+                    break;
+            }
+        }
+
+        void checkLengths(std::size_t ivLen, std::size_t aadLen, std::size_t length)
+        {
+            if (static_cast<uint64_t>(length) > GCM::kMaxDataBytes)
+                throw std::runtime_error("GCM message longer than 2^32 - 2 blocks");
+            if (static_cast<uint64_t>(aadLen) > GCM::kMaxAadBytes || static_cast<uint64_t>(ivLen) > GCM::kMaxAadBytes)
+                throw std::runtime_error("GCM AAD or IV longer than 2^64 - 1 bits");
+        }
+
+        // XORs the keystream for data[0..length) in, counter being the block for data[0]
+        void ctrBatch(const BlockCrypt &aes, BlockCrypt::Block &counter, uint8_t *data, std::size_t length)
+        {
+            uint8_t stream[kBatchBlocks * 16];
+            std::size_t blocks = (length + 15) / 16;
+            for (std::size_t b = 0; b < blocks; ++b)
+            {
+                std::copy(counter.begin(), counter.end(), stream + b * 16);
+                inc32(counter);
+            }
+            aes.encryptBlocks(stream, stream, blocks);
+            detail::xorBytes(data, data, stream, length);
+        }
+    } // namespace
+
+    GCM::GCM(const BlockCrypt::Key &key, BlockCrypt::Backend backend) : aes(key, backend), h{}
+    {
+        aes.encrypt(h);
+        ghash.reset(new detail::GHash(h, aes.backend() == BlockCrypt::Backend::AESNI));
+    }
+
+    GCM::~GCM() = default;
+
+    BlockCrypt::Block GCM::initialCounter(const uint8_t *iv, std::size_t ivLen) const
+    {
+        if (ivLen == 0)
+            throw std::runtime_error("GCM IV must not be empty");
+
+        BlockCrypt::Block j0{};
+        if (ivLen == 12)
+        {
+            std::copy_n(iv, 12, j0.begin());
+            j0[15] = 1;
+            return j0;
+        }
+
+        // Other lengths: J0 = GHASH(IV || 0-pad || 0^64 || [len(IV)]_64)
+        detail::GHash hash = *ghash;
+        hash.reset();
+        hash.update(iv, ivLen);
+        hash.lengths(0, ivLen);
+        return hash.digest();
+    }
+
+    GCM::Tag GCM::finish(detail::GHash &hash, const BlockCrypt::Block &j0, std::size_t aadLen, std::size_t length) const
+    {
+        hash.lengths(aadLen, length);
+        Tag tag = j0;
+        aes.encrypt(tag);
+        detail::xorBytes(tag.data(), tag.data(), hash.digest().data(), 16);
+        return tag;
+    }
+
+    GCM::Tag GCM::encrypt(const uint8_t *iv, std::size_t ivLen, const uint8_t *aad, std::size_t aadLen,
+                          uint8_t *data, std::size_t length) const
+    {
+        checkLengths(ivLen, aadLen, length);
+        BCStats::detail::OpTimer timer(BCStats::Op::SealGCM, length);
+        BlockCrypt::Block j0 = initialCounter(iv, ivLen);
+        BlockCrypt::Block counter = j0;
+        inc32(counter);
+
+        detail::GHash hash = *ghash;
+        hash.reset();
+        if (aadLen != 0)
+            hash.update(aad, aadLen);
+
+        // Fused pass: encrypt a batch, then hash the ciphertext while it is still in cache
+        for (std::size_t done = 0; done < length;)
+        {
+            std::size_t n = std::min(kBatchBlocks * 16, length - done);
+            ctrBatch(aes, counter, data + done, n);
+            hash.update(data + done, n);
+            done += n;
+        }
+        return finish(hash, j0, aadLen, length);
+    }
+
+    void GCM::decrypt(const uint8_t *iv, std::size_t ivLen, const uint8_t *aad, std::size_t aadLen,
+                      uint8_t *data, std::size_t length, const Tag &tag) const
+    {
+        checkLengths(ivLen, aadLen, length);
+        BCStats::detail::OpTimer timer(BCStats::Op::OpenGCM, length);
+        BlockCrypt::Block j0 = initialCounter(iv, ivLen);
+        BlockCrypt::Block counter = j0;
+        inc32(counter);
+
+        detail::GHash hash = *ghash;
+        hash.reset();
+        if (aadLen != 0)
+            hash.update(aad, aadLen);
+
+        // Same single pass, hashing each ciphertext batch before it is decrypted over
+        for (std::size_t done = 0; done < length;)
+        {
+            std::size_t n = std::min(kBatchBlocks * 16, length - done);
+            hash.update(data + done, n);
+            ctrBatch(aes, counter, data + done, n);
+            done += n;
+        }
+
+        // Constant-time comparison; on failure wipe the plaintext before reporting
+        Tag expected = finish(hash, j0, aadLen, length);
+        uint8_t diff = 0;
+        for (int i = 0; i < 16; ++i)
+            diff |= expected[i] ^ tag[i];
+        if (diff != 0)
+        {
+            std::fill(data, data + length, uint8_t(0));
+            throw std::runtime_error("GCM authentication failed");
+        }
+    }
+
+    GCM::Tag encryptGCM(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const std::vector<uint8_t> &iv,
+                        const std::vector<uint8_t> &aad)
+    {
+        GCM gcm(key);
+        return gcm.encrypt(iv.data(), iv.size(), aad.data(), aad.size(), data.data(), data.size());
+    }
+
+    void decryptGCM(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const std::vector<uint8_t> &iv,
+                    const GCM::Tag &tag, const std::vector<uint8_t> &aad)
+    {
+        GCM gcm(key);
+        gcm.decrypt(iv.data(), iv.size(), aad.data(), aad.size(), data.data(), data.size(), tag);
+    }
+} // namespace BC
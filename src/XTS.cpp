@@ -0,0 +1,204 @@
+#include "../include/XTS.hpp"
+#include "../include/parallel.hpp"
+#include "mode_impl.hpp"
+#include "stats_impl.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace BC
+{
+    namespace
+    {
+        // Tweaks computed per pass: enough blocks to keep the interleaved and bitsliced engines
+        // busy while the tweak buffer stays in L1 (same batch size as CTR).
+        constexpr std::size_t kBatchBlocks = 64;
+
+        inline uint64_t loadLE64(const uint8_t *p)
+        {
+            uint64_t v = 0;
+            for (int i = 7; i >= 0; --i)
+                v = (v << 8) | p[i];
+            return v;
+        }
+
+        inline void storeLE64(uint8_t *p, uint64_t v)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                p[i] = static_cast<uint8_t>(v);
+                v >>= 8;
+            }
+        }
+
+        // T *= alpha in GF(2^128): the tweak is a little-endian 128-bit integer shifted left
+        // by one, reduced by x^128 = x^7 + x^2 + x + 1 (0x87) when the top bit falls out
+        inline void multiplyAlpha(uint64_t &lo, uint64_t &hi)
+        {
+            uint64_t carry = hi >> 63;
+            hi = (hi << 1) | (lo >> 63);
+            lo = (lo << 1) ^ (carry * 0x87);
+        }
+
+        inline void storeTweak(uint8_t *p, uint64_t lo, uint64_t hi)
+        {
+            storeLE64(p, lo);
+            storeLE64(p + 8, hi);
+        }
+    } // namespace
+
+    template <std::size_t KeyBytes>
+    BasicXTS<KeyBytes>::BasicXTS(const Key &dataKey, const Key &tweakKey, BlockCryptBackend backend)
+        : dataCipher(dataKey, backend), tweakCipher(tweakKey, backend)
+    {
+        if (dataKey == tweakKey)
+            throw std::runtime_error("XTS data and tweak keys must differ");
+    }
+
+    template <std::size_t KeyBytes>
+    template <bool Decrypt>
+    void BasicXTS<KeyBytes>::cryptSector(uint64_t sector, uint8_t *data, std::size_t length) const
+    {
+        if (length < BLOCK_SIZE)
+            throw std::runtime_error("XTS sector is shorter than one block");
+
+        BlockCrypt::Block t{};
+        storeLE64(t.data(), sector);
+        tweakCipher.encrypt(t);
+        uint64_t lo = loadLE64(t.data());
+        uint64_t hi = loadLE64(t.data() + 8);
+
+        std::size_t full = length / BLOCK_SIZE;
+        std::size_t tail = length % BLOCK_SIZE;
+        // With a partial tail the last full block is handled together with it below
+        std::size_t blocks = tail != 0 ? full - 1 : full;
+
+        uint8_t tweaks[kBatchBlocks * BLOCK_SIZE];
+        uint8_t *p = data;
+        while (blocks > 0)
+        {
+            std::size_t n = std::min(kBatchBlocks, blocks);
+            for (std::size_t b = 0; b < n; ++b)
+            {
+                storeTweak(tweaks + b * BLOCK_SIZE, lo, hi);
+                multiplyAlpha(lo, hi);
+            }
+            std::size_t bytes = n * BLOCK_SIZE;
+            detail::xorBytes(p, p, tweaks, bytes);
+            if (Decrypt)
+                dataCipher.decryptBlocks(p, p, n);
+            else
+                dataCipher.encryptBlocks(p, p, n);
+            detail::xorBytes(p, p, tweaks, bytes);
+            p += bytes;
+            blocks -= n;
+        }
+
+        if (tail == 0)
+            return;
+
+        // Ciphertext stealing: p is the last full block, p + 16 the partial one. Encryption
+        // uses T(m-1) then T(m); decryption undoes them in the opposite order.
+        BlockCrypt::Block tPrev, tLast;
+        storeTweak(tPrev.data(), lo, hi);
+        multiplyAlpha(lo, hi);
+        storeTweak(tLast.data(), lo, hi);
+        const BlockCrypt::Block &first = Decrypt ? tLast : tPrev;
+        const BlockCrypt::Block &second = Decrypt ? tPrev : tLast;
+
+        BlockCrypt::Block cc;
+        detail::xorBytes(cc.data(), p, first.data(), BLOCK_SIZE);
+        if (Decrypt)
+            dataCipher.decrypt(cc);
+        else
+            dataCipher.encrypt(cc);
+        detail::xorBytes(cc.data(), cc.data(), first.data(), BLOCK_SIZE);
+
+        // The partial block takes the head of cc; cc takes the partial block's bytes in return
+        std::swap_ranges(p + BLOCK_SIZE, p + BLOCK_SIZE + tail, cc.begin());
+
+        detail::xorBytes(cc.data(), cc.data(), second.data(), BLOCK_SIZE);
+        if (Decrypt)
+            dataCipher.decrypt(cc);
+        else
+            dataCipher.encrypt(cc);
+        detail::xorBytes(p, cc.data(), second.data(), BLOCK_SIZE);
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicXTS<KeyBytes>::encryptSector(uint64_t sector, uint8_t *data, std::size_t length) const
+    {
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptXTS, length);
+        cryptSector<false>(sector, data, length);
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicXTS<KeyBytes>::decryptSector(uint64_t sector, uint8_t *data, std::size_t length) const
+    {
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptXTS, length);
+        cryptSector<true>(sector, data, length);
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicXTS<KeyBytes>::encryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count) const
+    {
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptXTS, sectorSize * count);
+        for (std::size_t i = 0; i < count; ++i)
+            cryptSector<false>(firstSector + i, data + i * sectorSize, sectorSize);
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicXTS<KeyBytes>::decryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count) const
+    {
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptXTS, sectorSize * count);
+        for (std::size_t i = 0; i < count; ++i)
+            cryptSector<true>(firstSector + i, data + i * sectorSize, sectorSize);
+    }
+
+    template <std::size_t KeyBytes>
+    template <bool Decrypt>
+    void BasicXTS<KeyBytes>::cryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count,
+                                          ThreadPool &pool) const
+    {
+        if (count == 0)
+            return;
+        if (sectorSize < BLOCK_SIZE)
+            throw std::runtime_error("XTS sector is shorter than one block");
+        BCStats::detail::OpTimer timer(Decrypt ? BCStats::Op::DecryptXTS : BCStats::Op::EncryptXTS, sectorSize * count);
+
+        // Per-worker copy of both key schedules, each on its own cache lines (as in parallel.cpp)
+        struct alignas(64) WorkerXTS
+        {
+            BasicXTS xts;
+        };
+        std::vector<WorkerXTS> copies(pool.size(), WorkerXTS{*this});
+
+        std::size_t perTask = std::max<std::size_t>(1, kParallelChunkBytes / sectorSize);
+        std::size_t tasks = (count + perTask - 1) / perTask;
+        pool.parallelFor(tasks, [&](std::size_t task, std::size_t worker)
+        {
+            std::size_t first = task * perTask;
+            std::size_t n = std::min(perTask, count - first);
+            BCStats::detail::Nested counted; // by the calling thread
+            const BasicXTS &xts = copies[worker].xts;
+            for (std::size_t i = first; i < first + n; ++i)
+                xts.template cryptSector<Decrypt>(firstSector + i, data + i * sectorSize, sectorSize);
+        });
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicXTS<KeyBytes>::encryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count,
+                                            ThreadPool &pool) const
+    {
+        cryptSectors<false>(firstSector, data, sectorSize, count, pool);
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicXTS<KeyBytes>::decryptSectors(uint64_t firstSector, uint8_t *data, std::size_t sectorSize, std::size_t count,
+                                            ThreadPool &pool) const
+    {
+        cryptSectors<true>(firstSector, data, sectorSize, count, pool);
+    }
+
+    template class BasicXTS<16>;
+    template class BasicXTS<32>;
+} // namespace BC
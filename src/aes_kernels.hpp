@@ -0,0 +1,97 @@
+#pragma once
+
+// Internal entry points of the instruction-set specific AES kernels.
+// Each kernel lives in its own translation unit so it can be compiled with the
+// matching -m flags while the rest of the library stays baseline x86-64 (or any
+// other architecture). Callers must check BCCpu::features() before using them.
+//
+// The block kernels are templates over the round count (10, 12 or 14 for AES-128,
+// AES-192 and AES-256) so every loop bound is a compile-time constant; the matching
+// translation unit instantiates all three. Round key arrays hold Rounds + 1 keys.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BCKernel
+{
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    /**
+     * Expands a 128-bit key with AESKEYGENASSIST.
+     *
+     * @param key     16 key bytes.
+     * @param encKeys 11 round keys (176 bytes) in FIPS-197 order, usable by aesniEncryptBlock.
+     * @param decKeys 11 round keys for AESDEC: reversed, with AESIMC applied to rounds 1..9.
+     */
+    void aesniExpandKey128(const uint8_t *key, uint8_t *encKeys, uint8_t *decKeys);
+
+    /**
+     * Derives the AESDEC schedule from FIPS-197 round keys expanded elsewhere (used for
+     * AES-192/256, whose schedules do not map onto one AESKEYGENASSIST per round key, and
+     * for contexts built from a precomputed schedule).
+     */
+    template <int Rounds>
+    void aesniInvertKeys(const uint8_t *encKeys, uint8_t *decKeys);
+
+    template <int Rounds>
+    void aesniEncryptBlock(const uint8_t *encKeys, uint8_t *block);
+    template <int Rounds>
+    void aesniDecryptBlock(const uint8_t *decKeys, uint8_t *block);
+
+    /**
+     * Encrypts/decrypts `blocks` independent blocks, interleaving `lanes` of them (1, 2, 4
+     * or 8; rounded down) per round so the AESENC/AESDEC pipeline stays busy. `in` may
+     * equal `out`.
+     */
+    template <int Rounds>
+    void aesniEncryptBlocks(const uint8_t *encKeys, const uint8_t *in, uint8_t *out, std::size_t blocks, std::size_t lanes);
+    template <int Rounds>
+    void aesniDecryptBlocks(const uint8_t *decKeys, const uint8_t *in, uint8_t *out, std::size_t blocks, std::size_t lanes);
+#endif
+
+#ifdef BLOCKCRYPT_HAVE_VPERM
+    // SSSE3 vector-permute kernel: constant-time single-block AES on the FIPS-197
+    // round keys, S-Box computed in GF((2^4)^2) with PSHUFB lookups.
+    template <int Rounds>
+    void vpermEncryptBlock(const uint8_t *roundKeys, uint8_t *block);
+    template <int Rounds>
+    void vpermDecryptBlock(const uint8_t *roundKeys, uint8_t *block);
+#endif
+
+    // Bitsliced constant-time kernel. Always available: the widest of AVX2 (16 blocks),
+    // SSE2 (8 blocks) or plain 64-bit integers (4 blocks) is chosen at runtime.
+    template <int Rounds>
+    constexpr std::size_t kSliceKeyWords = (Rounds + 1) * 8; // round keys x 8 bit planes
+
+    /**
+     * Converts the Rounds + 1 FIPS-197 round keys into kSliceKeyWords<Rounds> bit planes.
+     */
+    template <int Rounds>
+    void bitsliceKeySchedule(const uint8_t *roundKeys, uint64_t *sliceKeys);
+
+    template <int Rounds>
+    void bitsliceEncrypt(const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks);
+    template <int Rounds>
+    void bitsliceDecrypt(const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks);
+
+    // Number of blocks one pass of the selected bitsliced kernel processes
+    std::size_t bitsliceParallelBlocks();
+
+#ifdef BLOCKCRYPT_HAVE_PCLMUL
+    // GHASH with PCLMULQDQ (needs SSSE3 as well). hPowers holds H^1..H^8 in the kernel's
+    // internal byte-swapped form, 16 bytes each.
+    constexpr int kGhashPowers = 8;
+
+    void ghashClmulInit(const uint8_t *h, uint8_t *hPowers);
+
+    /**
+     * Absorbs `blocks` full 16-byte blocks into the GHASH state (normal GCM byte order),
+     * eight blocks per reduction.
+     */
+    void ghashClmul(uint8_t *state, const uint8_t *hPowers, const uint8_t *data, std::size_t blocks);
+#endif
+
+#ifdef BLOCKCRYPT_HAVE_AVX2
+    template <int Rounds>
+    void bitsliceCryptAvx2(bool decrypt, const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks);
+#endif
+} // namespace BCKernel
@@ -0,0 +1,194 @@
+#include "aes_kernels.hpp"
+
+#ifdef BLOCKCRYPT_HAVE_AESNI
+#include <wmmintrin.h> // AES-NI
+#include <emmintrin.h> // SSE2
+
+namespace BCKernel
+{
+    namespace
+    {
+        inline __m128i load(const uint8_t *p)
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        }
+
+        inline void store(uint8_t *p, __m128i v)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+        }
+
+        // One step of the AES-128 schedule: AESKEYGENASSIST already computed
+        // SubWord(RotWord(w3)) ^ Rcon in its top lane; broadcast it and fold in the
+        // running XOR of the previous four words (w0, w0^w1, w0^w1^w2, ...).
+        inline __m128i expandStep(__m128i key, __m128i assist)
+        {
+            assist = _mm_shuffle_epi32(assist, 0xff);
+            key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+            key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+            key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+            return _mm_xor_si128(key, assist);
+        }
+    } // namespace
+
+    void aesniExpandKey128(const uint8_t *key, uint8_t *encKeys, uint8_t *decKeys)
+    {
+        __m128i rk[11];
+        rk[0] = load(key);
+        // The Rcon operand of AESKEYGENASSIST must be an immediate, hence the unrolled chain
+        rk[1] = expandStep(rk[0], _mm_aeskeygenassist_si128(rk[0], 0x01));
+        rk[2] = expandStep(rk[1], _mm_aeskeygenassist_si128(rk[1], 0x02));
+        rk[3] = expandStep(rk[2], _mm_aeskeygenassist_si128(rk[2], 0x04));
+        rk[4] = expandStep(rk[3], _mm_aeskeygenassist_si128(rk[3], 0x08));
+        rk[5] = expandStep(rk[4], _mm_aeskeygenassist_si128(rk[4], 0x10));
+        rk[6] = expandStep(rk[5], _mm_aeskeygenassist_si128(rk[5], 0x20));
+        rk[7] = expandStep(rk[6], _mm_aeskeygenassist_si128(rk[6], 0x40));
+        rk[8] = expandStep(rk[7], _mm_aeskeygenassist_si128(rk[7], 0x80));
+        rk[9] = expandStep(rk[8], _mm_aeskeygenassist_si128(rk[8], 0x1b));
+        rk[10] = expandStep(rk[9], _mm_aeskeygenassist_si128(rk[9], 0x36));
+
+        for (int round = 0; round < 11; ++round)
+        {
+            store(encKeys + round * 16, rk[round]);
+        }
+
+        // AESDEC implements the equivalent inverse cipher, so the middle round keys need InvMixColumns
+        store(decKeys, rk[10]);
+        for (int round = 1; round < 10; ++round)
+        {
+            store(decKeys + round * 16, _mm_aesimc_si128(rk[10 - round]));
+        }
+        store(decKeys + 160, rk[0]);
+    }
+
+    template <int Rounds>
+    void aesniInvertKeys(const uint8_t *encKeys, uint8_t *decKeys)
+    {
+        store(decKeys, load(encKeys + Rounds * 16));
+#pragma GCC unroll 14
+        for (int round = 1; round < Rounds; ++round)
+        {
+            store(decKeys + round * 16, _mm_aesimc_si128(load(encKeys + (Rounds - round) * 16)));
+        }
+        store(decKeys + Rounds * 16, load(encKeys));
+    }
+
+    // The round loops have a compile-time trip count and are unrolled completely, so the
+    // round keys become plain memory operands of AESENC/AESDEC with no loop overhead
+    template <int Rounds>
+    void aesniEncryptBlock(const uint8_t *encKeys, uint8_t *block)
+    {
+        __m128i s = _mm_xor_si128(load(block), load(encKeys));
+#pragma GCC unroll 14
+        for (int round = 1; round < Rounds; ++round)
+        {
+            s = _mm_aesenc_si128(s, load(encKeys + round * 16));
+        }
+        store(block, _mm_aesenclast_si128(s, load(encKeys + Rounds * 16)));
+    }
+
+    template <int Rounds>
+    void aesniDecryptBlock(const uint8_t *decKeys, uint8_t *block)
+    {
+        __m128i s = _mm_xor_si128(load(block), load(decKeys));
+#pragma GCC unroll 14
+        for (int round = 1; round < Rounds; ++round)
+        {
+            s = _mm_aesdec_si128(s, load(decKeys + round * 16));
+        }
+        store(block, _mm_aesdeclast_si128(s, load(decKeys + Rounds * 16)));
+    }
+
+    namespace
+    {
+        // AESENC/AESDEC have a latency of several cycles but can issue every cycle, so a single
+        // block leaves the unit mostly idle. Running N independent blocks through each
+        // round together keeps N instructions in flight; N is a template parameter so the
+        // state array lives entirely in XMM registers.
+        template <int Rounds, std::size_t N, bool Decrypt>
+        inline void cryptGroup(const uint8_t *keys, const uint8_t *in, uint8_t *out)
+        {
+            // The loops over i must be unrolled for s[] to stay in registers, hence the pragmas
+            __m128i s[N];
+            const __m128i k0 = load(keys);
+#pragma GCC unroll 8
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                s[i] = _mm_xor_si128(load(in + i * 16), k0);
+            }
+            for (int round = 1; round < Rounds; ++round)
+            {
+                const __m128i k = load(keys + round * 16);
+#pragma GCC unroll 8
+                for (std::size_t i = 0; i < N; ++i)
+                {
+                    s[i] = Decrypt ? _mm_aesdec_si128(s[i], k) : _mm_aesenc_si128(s[i], k);
+                }
+            }
+            const __m128i kLast = load(keys + Rounds * 16);
+#pragma GCC unroll 8
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                store(out + i * 16, Decrypt ? _mm_aesdeclast_si128(s[i], kLast) : _mm_aesenclast_si128(s[i], kLast));
+            }
+        }
+
+        template <int Rounds, std::size_t N, bool Decrypt>
+        void cryptLanes(const uint8_t *keys, const uint8_t *in, uint8_t *out, std::size_t blocks)
+        {
+            std::size_t i = 0;
+            for (; i + N <= blocks; i += N)
+            {
+                cryptGroup<Rounds, N, Decrypt>(keys, in + i * 16, out + i * 16);
+            }
+            for (; i < blocks; ++i)
+            {
+                cryptGroup<Rounds, 1, Decrypt>(keys, in + i * 16, out + i * 16);
+            }
+        }
+
+        template <int Rounds, bool Decrypt>
+        void cryptBlocks(const uint8_t *keys, const uint8_t *in, uint8_t *out, std::size_t blocks, std::size_t lanes)
+        {
+            if (lanes >= 8)
+                cryptLanes<Rounds, 8, Decrypt>(keys, in, out, blocks);
+            else if (lanes >= 4)
+                cryptLanes<Rounds, 4, Decrypt>(keys, in, out, blocks);
+            else if (lanes >= 2)
+                cryptLanes<Rounds, 2, Decrypt>(keys, in, out, blocks);
+            else
+                cryptLanes<Rounds, 1, Decrypt>(keys, in, out, blocks);
+        }
+    } // namespace
+
+    template <int Rounds>
+    void aesniEncryptBlocks(const uint8_t *encKeys, const uint8_t *in, uint8_t *out, std::size_t blocks, std::size_t lanes)
+    {
+        cryptBlocks<Rounds, false>(encKeys, in, out, blocks, lanes);
+    }
+
+    template <int Rounds>
+    void aesniDecryptBlocks(const uint8_t *decKeys, const uint8_t *in, uint8_t *out, std::size_t blocks, std::size_t lanes)
+    {
+        cryptBlocks<Rounds, true>(decKeys, in, out, blocks, lanes);
+    }
+
+    // AES-128, AES-192 and AES-256
+    template void aesniInvertKeys<10>(const uint8_t *, uint8_t *);
+    template void aesniInvertKeys<12>(const uint8_t *, uint8_t *);
+    template void aesniInvertKeys<14>(const uint8_t *, uint8_t *);
+    template void aesniEncryptBlock<10>(const uint8_t *, uint8_t *);
+    template void aesniEncryptBlock<12>(const uint8_t *, uint8_t *);
+    template void aesniEncryptBlock<14>(const uint8_t *, uint8_t *);
+    template void aesniDecryptBlock<10>(const uint8_t *, uint8_t *);
+    template void aesniDecryptBlock<12>(const uint8_t *, uint8_t *);
+    template void aesniDecryptBlock<14>(const uint8_t *, uint8_t *);
+    template void aesniEncryptBlocks<10>(const uint8_t *, const uint8_t *, uint8_t *, std::size_t, std::size_t);
+    template void aesniEncryptBlocks<12>(const uint8_t *, const uint8_t *, uint8_t *, std::size_t, std::size_t);
+    template void aesniEncryptBlocks<14>(const uint8_t *, const uint8_t *, uint8_t *, std::size_t, std::size_t);
+    template void aesniDecryptBlocks<10>(const uint8_t *, const uint8_t *, uint8_t *, std::size_t, std::size_t);
+    template void aesniDecryptBlocks<12>(const uint8_t *, const uint8_t *, uint8_t *, std::size_t, std::size_t);
+    template void aesniDecryptBlocks<14>(const uint8_t *, const uint8_t *, uint8_t *, std::size_t, std::size_t);
+} // namespace BCKernel
+
+#endif // BLOCKCRYPT_HAVE_AESNI
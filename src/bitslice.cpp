@@ -0,0 +1,141 @@
+#include "aes_kernels.hpp"
+#include "bitslice_impl.hpp"
+#include "../include/cpu.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace BCKernel
+{
+    namespace bitslice
+    {
+        namespace
+        {
+            // Portable word: one 64-bit plane, 4 blocks per call
+            struct W64
+            {
+                static constexpr int lanes = 1;
+                uint64_t v;
+
+                static W64 set(uint64_t x) { return {x}; }
+                static W64 load(const uint64_t *p) { return {p[0]}; }
+                void store(uint64_t *p) const { p[0] = v; }
+
+                template <int N>
+                static W64 shiftLeft(W64 x) { return {x.v << N}; }
+                template <int N>
+                static W64 shiftRight(W64 x) { return {x.v >> N}; }
+
+                friend W64 operator^(W64 a, W64 b) { return {a.v ^ b.v}; }
+                friend W64 operator&(W64 a, W64 b) { return {a.v & b.v}; }
+                friend W64 operator|(W64 a, W64 b) { return {a.v | b.v}; }
+                friend W64 operator~(W64 a) { return {~a.v}; }
+            };
+
+#ifdef __SSE2__
+            // SSE2 word: two 64-bit planes per register, 8 blocks per call
+            struct W128
+            {
+                static constexpr int lanes = 2;
+                __m128i v;
+
+                static W128 set(uint64_t x) { return {_mm_set1_epi64x(static_cast<long long>(x))}; }
+                static W128 load(const uint64_t *p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))}; }
+                void store(uint64_t *p) const { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+
+                template <int N>
+                static W128 shiftLeft(W128 x) { return {_mm_slli_epi64(x.v, N)}; }
+                template <int N>
+                static W128 shiftRight(W128 x) { return {_mm_srli_epi64(x.v, N)}; }
+
+                friend W128 operator^(W128 a, W128 b) { return {_mm_xor_si128(a.v, b.v)}; }
+                friend W128 operator&(W128 a, W128 b) { return {_mm_and_si128(a.v, b.v)}; }
+                friend W128 operator|(W128 a, W128 b) { return {_mm_or_si128(a.v, b.v)}; }
+                friend W128 operator~(W128 a) { return {_mm_xor_si128(a.v, _mm_set1_epi32(-1))}; }
+            };
+#endif
+        } // namespace
+    } // namespace bitslice
+
+    template <int Rounds>
+    void bitsliceKeySchedule(const uint8_t *roundKeys, uint64_t *sliceKeys)
+    {
+        // Every round key is replicated into all 4 block slots so one XOR per plane
+        // adds it to the whole group; the transpose is the same one used for data.
+        using namespace bitslice;
+        for (int round = 0; round <= Rounds; ++round)
+        {
+            uint8_t replicated[64];
+            for (int b = 0; b < 4; ++b)
+            {
+                std::memcpy(replicated + 16 * b, roundKeys + 16 * round, 16);
+            }
+
+            uint64_t w[kPlanes];
+            interleaveIn(w, replicated);
+            W64 q[kPlanes];
+            for (int i = 0; i < kPlanes; ++i)
+                q[i] = W64::set(w[i]);
+            ortho(q);
+            for (int i = 0; i < kPlanes; ++i)
+                sliceKeys[round * kPlanes + i] = q[i].v;
+        }
+    }
+
+    std::size_t bitsliceParallelBlocks()
+    {
+#ifdef BLOCKCRYPT_HAVE_AVX2
+        if (BCCpu::features().avx2)
+            return 16;
+#endif
+#ifdef __SSE2__
+        return 8;
+#else
+        return 4;
+#endif
+    }
+
+    namespace
+    {
+        template <int Rounds>
+        void bitsliceCrypt(bool decrypt, const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks)
+        {
+#ifdef BLOCKCRYPT_HAVE_AVX2
+            if (BCCpu::features().avx2)
+            {
+                bitsliceCryptAvx2<Rounds>(decrypt, sliceKeys, in, out, blocks);
+                return;
+            }
+#endif
+#ifdef __SSE2__
+            bitslice::run<bitslice::W128, Rounds>(decrypt, sliceKeys, in, out, blocks);
+#else
+            bitslice::run<bitslice::W64, Rounds>(decrypt, sliceKeys, in, out, blocks);
+#endif
+        }
+    } // namespace
+
+    template <int Rounds>
+    void bitsliceEncrypt(const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks)
+    {
+        bitsliceCrypt<Rounds>(false, sliceKeys, in, out, blocks);
+    }
+
+    template <int Rounds>
+    void bitsliceDecrypt(const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks)
+    {
+        bitsliceCrypt<Rounds>(true, sliceKeys, in, out, blocks);
+    }
+
+    // AES-128, AES-192 and AES-256
+    template void bitsliceKeySchedule<10>(const uint8_t *, uint64_t *);
+    template void bitsliceKeySchedule<12>(const uint8_t *, uint64_t *);
+    template void bitsliceKeySchedule<14>(const uint8_t *, uint64_t *);
+    template void bitsliceEncrypt<10>(const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceEncrypt<12>(const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceEncrypt<14>(const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceDecrypt<10>(const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceDecrypt<12>(const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceDecrypt<14>(const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+} // namespace BCKernel
@@ -0,0 +1,48 @@
+#include "aes_kernels.hpp"
+#include "bitslice_impl.hpp"
+
+#ifdef BLOCKCRYPT_HAVE_AVX2
+#include <immintrin.h>
+
+namespace BCKernel
+{
+    namespace bitslice
+    {
+        namespace
+        {
+            // AVX2 word: four 64-bit planes per register, 16 blocks per call
+            struct W256
+            {
+                static constexpr int lanes = 4;
+                __m256i v;
+
+                static W256 set(uint64_t x) { return {_mm256_set1_epi64x(static_cast<long long>(x))}; }
+                static W256 load(const uint64_t *p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))}; }
+                void store(uint64_t *p) const { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+
+                template <int N>
+                static W256 shiftLeft(W256 x) { return {_mm256_slli_epi64(x.v, N)}; }
+                template <int N>
+                static W256 shiftRight(W256 x) { return {_mm256_srli_epi64(x.v, N)}; }
+
+                friend W256 operator^(W256 a, W256 b) { return {_mm256_xor_si256(a.v, b.v)}; }
+                friend W256 operator&(W256 a, W256 b) { return {_mm256_and_si256(a.v, b.v)}; }
+                friend W256 operator|(W256 a, W256 b) { return {_mm256_or_si256(a.v, b.v)}; }
+                friend W256 operator~(W256 a) { return {_mm256_xor_si256(a.v, _mm256_set1_epi32(-1))}; }
+            };
+        } // namespace
+    } // namespace bitslice
+
+    template <int Rounds>
+    void bitsliceCryptAvx2(bool decrypt, const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks)
+    {
+        bitslice::run<bitslice::W256, Rounds>(decrypt, sliceKeys, in, out, blocks);
+        _mm256_zeroupper();
+    }
+
+    template void bitsliceCryptAvx2<10>(bool, const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceCryptAvx2<12>(bool, const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+    template void bitsliceCryptAvx2<14>(bool, const uint64_t *, const uint8_t *, uint8_t *, std::size_t);
+} // namespace BCKernel
+
+#endif // BLOCKCRYPT_HAVE_AVX2
@@ -0,0 +1,485 @@
+#pragma once
+
+// Generic bitsliced AES core shared by the scalar, SSE2 and AVX2 builds.
+//
+// The state of 4 blocks is spread over 8 64-bit "planes": plane i holds bit i of
+// every state byte, byte (row r, col c) of block b sitting at bit 16*r + 4*c + b.
+// With that layout SubBytes is a boolean circuit evaluated on whole planes,
+// ShiftRows is a fixed nibble shuffle inside each 16-bit row and MixColumns is a
+// handful of rotations, so no step ever indexes memory with secret data.
+//
+// A word type W bundles W::lanes independent 64-bit planes (1 for plain uint64_t,
+// 2 for SSE2, 4 for AVX2), i.e. one call processes 4 * W::lanes blocks.
+// The round count (10/12/14 for AES-128/192/256) is a template parameter, so the
+// key-plane arrays are sized and the round loops bounded at compile time.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace BCKernel
+{
+    namespace bitslice
+    {
+        constexpr int kPlanes = 8;
+
+        // Per-lane 64-bit shifts; every word type provides them as static member templates
+        template <int N, class W>
+        inline W shl(W x) { return W::template shiftLeft<N>(x); }
+
+        template <int N, class W>
+        inline W shr(W x) { return W::template shiftRight<N>(x); }
+
+        // This header is compiled into translation units built with different -m flags. The
+        // templates below only ever see word types local to each of them, but these plain
+        // functions would be one weak symbol shared by all, and the linker could keep e.g. the
+        // -mavx2 copy for the baseline kernel; internal linkage gives each its own.
+        namespace
+        {
+            inline uint32_t loadLE32(const uint8_t *p)
+            {
+                return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                       (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+            }
+
+            inline void storeLE32(uint8_t *p, uint32_t x)
+            {
+                p[0] = static_cast<uint8_t>(x);
+                p[1] = static_cast<uint8_t>(x >> 8);
+                p[2] = static_cast<uint8_t>(x >> 16);
+                p[3] = static_cast<uint8_t>(x >> 24);
+            }
+
+            // Moves byte i of x to byte 2*i of the result
+            inline uint64_t spreadBytes(uint32_t x)
+            {
+                uint64_t w = x;
+                w = (w | (w << 16)) & 0x0000FFFF0000FFFFULL;
+                w = (w | (w << 8)) & 0x00FF00FF00FF00FFULL;
+                return w;
+            }
+
+            inline uint32_t gatherBytes(uint64_t w)
+            {
+                w &= 0x00FF00FF00FF00FFULL;
+                w = (w | (w >> 8)) & 0x0000FFFF0000FFFFULL;
+                w = (w | (w >> 16)) & 0x00000000FFFFFFFFULL;
+                return static_cast<uint32_t>(w);
+            }
+
+            // Gathers 4 blocks (64 bytes) into the pre-transpose words: word k = 4 * c0 + block
+            // interleaves the bytes of columns c0 and c0 + 2, i.e. byte p holds the state byte
+            // at row p / 2, column 2 * (p & 1) + c0.
+            inline void interleaveIn(uint64_t q[kPlanes], const uint8_t *blocks)
+            {
+                for (int k = 0; k < kPlanes; ++k)
+                {
+                    const uint8_t *col = blocks + 16 * (k & 3) + 4 * (k >> 2);
+                    q[k] = spreadBytes(loadLE32(col)) | (spreadBytes(loadLE32(col + 8)) << 8);
+                }
+            }
+
+            inline void interleaveOut(const uint64_t q[kPlanes], uint8_t *blocks)
+            {
+                for (int k = 0; k < kPlanes; ++k)
+                {
+                    uint8_t *col = blocks + 16 * (k & 3) + 4 * (k >> 2);
+                    storeLE32(col, gatherBytes(q[k]));
+                    storeLE32(col + 8, gatherBytes(q[k] >> 8));
+                }
+            }
+        } // namespace
+
+        template <int S, class W>
+        inline void swapBits(W &x, W &y, W lo, W hi)
+        {
+            W a = x;
+            W b = y;
+            x = (a & lo) | shl<S>(b & lo);
+            y = shr<S>(a & hi) | (b & hi);
+        }
+
+        // 8x8 bit transpose inside every byte lane: afterwards plane i holds bit i of
+        // the bytes that word k held. It is an involution, so it also undoes itself.
+        template <class W>
+        inline void ortho(W q[kPlanes])
+        {
+            const W l1 = W::set(0x5555555555555555ULL), h1 = W::set(0xAAAAAAAAAAAAAAAAULL);
+            const W l2 = W::set(0x3333333333333333ULL), h2 = W::set(0xCCCCCCCCCCCCCCCCULL);
+            const W l4 = W::set(0x0F0F0F0F0F0F0F0FULL), h4 = W::set(0xF0F0F0F0F0F0F0F0ULL);
+
+            swapBits<1>(q[0], q[1], l1, h1);
+            swapBits<1>(q[2], q[3], l1, h1);
+            swapBits<1>(q[4], q[5], l1, h1);
+            swapBits<1>(q[6], q[7], l1, h1);
+
+            swapBits<2>(q[0], q[2], l2, h2);
+            swapBits<2>(q[1], q[3], l2, h2);
+            swapBits<2>(q[4], q[6], l2, h2);
+            swapBits<2>(q[5], q[7], l2, h2);
+
+            swapBits<4>(q[0], q[4], l4, h4);
+            swapBits<4>(q[1], q[5], l4, h4);
+            swapBits<4>(q[2], q[6], l4, h4);
+            swapBits<4>(q[3], q[7], l4, h4);
+        }
+
+        // Boyar–Peralta S-Box circuit (113 gates): GF(2^8) inversion and the affine map
+        // as pure AND/XOR/NOT on the eight planes. q[0] is the least significant bit.
+        template <class W>
+        inline void sbox(W q[kPlanes])
+        {
+            W x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+            W x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+            // Top linear transformation
+            W y14 = x3 ^ x5;
+            W y13 = x0 ^ x6;
+            W y9 = x0 ^ x3;
+            W y8 = x0 ^ x5;
+            W t0 = x1 ^ x2;
+            W y1 = t0 ^ x7;
+            W y4 = y1 ^ x3;
+            W y12 = y13 ^ y14;
+            W y2 = y1 ^ x0;
+            W y5 = y1 ^ x6;
+            W y3 = y5 ^ y8;
+            W t1 = x4 ^ y12;
+            W y15 = t1 ^ x5;
+            W y20 = t1 ^ x1;
+            W y6 = y15 ^ x7;
+            W y10 = y15 ^ t0;
+            W y11 = y20 ^ y9;
+            W y7 = x7 ^ y11;
+            W y17 = y10 ^ y11;
+            W y19 = y10 ^ y8;
+            W y16 = t0 ^ y11;
+            W y21 = y13 ^ y16;
+            W y18 = x0 ^ y16;
+
+            // Non-linear section
+            W t2 = y12 & y15;
+            W t3 = y3 & y6;
+            W t4 = t3 ^ t2;
+            W t5 = y4 & x7;
+            W t6 = t5 ^ t2;
+            W t7 = y13 & y16;
+            W t8 = y5 & y1;
+            W t9 = t8 ^ t7;
+            W t10 = y2 & y7;
+            W t11 = t10 ^ t7;
+            W t12 = y9 & y11;
+            W t13 = y14 & y17;
+            W t14 = t13 ^ t12;
+            W t15 = y8 & y10;
+            W t16 = t15 ^ t12;
+            W t17 = t4 ^ t14;
+            W t18 = t6 ^ t16;
+            W t19 = t9 ^ t14;
+            W t20 = t11 ^ t16;
+            W t21 = t17 ^ y20;
+            W t22 = t18 ^ y19;
+            W t23 = t19 ^ y21;
+            W t24 = t20 ^ y18;
+
+            W t25 = t21 ^ t22;
+            W t26 = t21 & t23;
+            W t27 = t24 ^ t26;
+            W t28 = t25 & t27;
+            W t29 = t28 ^ t22;
+            W t30 = t23 ^ t24;
+            W t31 = t22 ^ t26;
+            W t32 = t31 & t30;
+            W t33 = t32 ^ t24;
+            W t34 = t23 ^ t33;
+            W t35 = t27 ^ t33;
+            W t36 = t24 & t35;
+            W t37 = t36 ^ t34;
+            W t38 = t27 ^ t36;
+            W t39 = t29 & t38;
+            W t40 = t25 ^ t39;
+
+            W t41 = t40 ^ t37;
+            W t42 = t29 ^ t33;
+            W t43 = t29 ^ t40;
+            W t44 = t33 ^ t37;
+            W t45 = t42 ^ t41;
+            W z0 = t44 & y15;
+            W z1 = t37 & y6;
+            W z2 = t33 & x7;
+            W z3 = t43 & y16;
+            W z4 = t40 & y1;
+            W z5 = t29 & y7;
+            W z6 = t42 & y11;
+            W z7 = t45 & y17;
+            W z8 = t41 & y10;
+            W z9 = t44 & y12;
+            W z10 = t37 & y3;
+            W z11 = t33 & y4;
+            W z12 = t43 & y13;
+            W z13 = t40 & y5;
+            W z14 = t29 & y2;
+            W z15 = t42 & y9;
+            W z16 = t45 & y14;
+            W z17 = t41 & y8;
+
+            // Bottom linear transformation (the NOTs carry the 0x63 affine constant)
+            W t46 = z15 ^ z16;
+            W t47 = z10 ^ z11;
+            W t48 = z5 ^ z13;
+            W t49 = z9 ^ z10;
+            W t50 = z2 ^ z12;
+            W t51 = z2 ^ z5;
+            W t52 = z7 ^ z8;
+            W t53 = z0 ^ z3;
+            W t54 = z6 ^ z7;
+            W t55 = z16 ^ z17;
+            W t56 = z12 ^ t48;
+            W t57 = t50 ^ t53;
+            W t58 = z4 ^ t46;
+            W t59 = z3 ^ t54;
+            W t60 = t46 ^ t57;
+            W t61 = z14 ^ t57;
+            W t62 = t52 ^ t58;
+            W t63 = t49 ^ t58;
+            W t64 = z4 ^ t59;
+            W t65 = t61 ^ t62;
+            W t66 = z1 ^ t63;
+            W s0 = t59 ^ t63;
+            W s6 = t56 ^ ~t62;
+            W s7 = t48 ^ ~t60;
+            W t67 = t64 ^ t65;
+            W s3 = t53 ^ t66;
+            W s4 = t51 ^ t66;
+            W s5 = t47 ^ t65;
+            W s1 = t64 ^ ~s3;
+            W s2 = t55 ^ ~t67;
+
+            q[7] = s0;
+            q[6] = s1;
+            q[5] = s2;
+            q[4] = s3;
+            q[3] = s4;
+            q[2] = s5;
+            q[1] = s6;
+            q[0] = s7;
+        }
+
+        // Inverse affine map A^-1(x): bit i = x[i+2] ^ x[i+5] ^ x[i+7] ^ 0x05[i]
+        template <class W>
+        inline void invAffine(W q[kPlanes])
+        {
+            W r[kPlanes];
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                r[i] = q[(i + 2) & 7] ^ q[(i + 5) & 7] ^ q[(i + 7) & 7];
+            }
+            r[0] = ~r[0];
+            r[2] = ~r[2];
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                q[i] = r[i];
+            }
+        }
+
+        // S^-1 = A^-1 o S o A^-1, because S = A o inv and so inv = A^-1 o S
+        template <class W>
+        inline void invSbox(W q[kPlanes])
+        {
+            invAffine(q);
+            sbox(q);
+            invAffine(q);
+        }
+
+        template <class W>
+        inline void shiftRows(W q[kPlanes])
+        {
+            const W row0 = W::set(0x000000000000FFFFULL);
+            const W r1a = W::set(0x00000000FFF00000ULL), r1b = W::set(0x00000000000F0000ULL);
+            const W r2a = W::set(0x0000FF0000000000ULL), r2b = W::set(0x000000FF00000000ULL);
+            const W r3a = W::set(0xF000000000000000ULL), r3b = W::set(0x0FFF000000000000ULL);
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                W x = q[i];
+                q[i] = (x & row0) | shr<4>(x & r1a) | shl<12>(x & r1b) | shr<8>(x & r2a) | shl<8>(x & r2b) | shr<12>(x & r3a) | shl<4>(x & r3b);
+            }
+        }
+
+        template <class W>
+        inline void invShiftRows(W q[kPlanes])
+        {
+            const W row0 = W::set(0x000000000000FFFFULL);
+            const W r1a = W::set(0x000000000FFF0000ULL), r1b = W::set(0x00000000F0000000ULL);
+            const W r2a = W::set(0x0000FF0000000000ULL), r2b = W::set(0x000000FF00000000ULL);
+            const W r3a = W::set(0xFFF0000000000000ULL), r3b = W::set(0x000F000000000000ULL);
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                W x = q[i];
+                q[i] = (x & row0) | shl<4>(x & r1a) | shr<12>(x & r1b) | shr<8>(x & r2a) | shl<8>(x & r2b) | shr<4>(x & r3a) | shl<12>(x & r3b);
+            }
+        }
+
+        template <class W>
+        inline W rotr16(W x) { return shr<16>(x) | shl<48>(x); }
+
+        template <class W>
+        inline W rotr32(W x) { return shr<32>(x) | shl<32>(x); }
+
+        // out_r = 2*(a_r ^ a_r+1) ^ a_r+1 ^ a_r+2 ^ a_r+3; rotr16 brings row r+1 onto row r
+        // and the multiplication by 2 (xtime) is a plane shuffle with 0x1b folded in.
+        template <class W>
+        inline void mixColumns(W q[kPlanes])
+        {
+            W q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+            W q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+            W r0 = rotr16(q0), r1 = rotr16(q1), r2 = rotr16(q2), r3 = rotr16(q3);
+            W r4 = rotr16(q4), r5 = rotr16(q5), r6 = rotr16(q6), r7 = rotr16(q7);
+
+            q[0] = q7 ^ r7 ^ r0 ^ rotr32(q0 ^ r0);
+            q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ rotr32(q1 ^ r1);
+            q[2] = q1 ^ r1 ^ r2 ^ rotr32(q2 ^ r2);
+            q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ rotr32(q3 ^ r3);
+            q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ rotr32(q4 ^ r4);
+            q[5] = q4 ^ r4 ^ r5 ^ rotr32(q5 ^ r5);
+            q[6] = q5 ^ r5 ^ r6 ^ rotr32(q6 ^ r6);
+            q[7] = q6 ^ r6 ^ r7 ^ rotr32(q7 ^ r7);
+        }
+
+        // InvMixColumns = MixColumns o (a_r ^= 4 * (a_r ^ a_r+2)), the 4 being two xtimes
+        template <class W>
+        inline void invMixColumns(W q[kPlanes])
+        {
+            W t[kPlanes];
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                t[i] = q[i] ^ rotr32(q[i]);
+            }
+            for (int n = 0; n < 2; ++n)
+            {
+                W hi = t[7];
+                t[7] = t[6];
+                t[6] = t[5];
+                t[5] = t[4];
+                t[4] = t[3] ^ hi;
+                t[3] = t[2] ^ hi;
+                t[2] = t[1];
+                t[1] = t[0] ^ hi;
+                t[0] = hi;
+            }
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                q[i] = q[i] ^ t[i];
+            }
+            mixColumns(q);
+        }
+
+        template <class W>
+        inline void addRoundKey(W q[kPlanes], const W *rk)
+        {
+            for (int i = 0; i < kPlanes; ++i)
+            {
+                q[i] = q[i] ^ rk[i];
+            }
+        }
+
+        template <int Rounds, class W>
+        inline void encryptPlanes(W q[kPlanes], const W *sk)
+        {
+            addRoundKey(q, sk);
+            for (int round = 1; round < Rounds; ++round)
+            {
+                sbox(q);
+                shiftRows(q);
+                mixColumns(q);
+                addRoundKey(q, sk + round * kPlanes);
+            }
+            sbox(q);
+            shiftRows(q);
+            addRoundKey(q, sk + Rounds * kPlanes);
+        }
+
+        template <int Rounds, class W>
+        inline void decryptPlanes(W q[kPlanes], const W *sk)
+        {
+            addRoundKey(q, sk + Rounds * kPlanes);
+            for (int round = Rounds - 1; round > 0; --round)
+            {
+                invShiftRows(q);
+                invSbox(q);
+                addRoundKey(q, sk + round * kPlanes);
+                invMixColumns(q);
+            }
+            invShiftRows(q);
+            invSbox(q);
+            addRoundKey(q, sk);
+        }
+
+        /**
+         * Runs `blocks` blocks through the kernel, 4 * W::lanes at a time.
+         * A short tail is zero-padded into a full group, so every call does the same
+         * sequence of operations regardless of the data. `in` and `out` may alias.
+         */
+        template <class W, int Rounds>
+        void run(bool decrypt, const uint64_t *sliceKeys, const uint8_t *in, uint8_t *out, std::size_t blocks)
+        {
+            constexpr int lanes = W::lanes;
+            constexpr std::size_t groupBlocks = 4 * lanes;
+            constexpr int kKeyPlanes = (Rounds + 1) * kPlanes;
+
+            W sk[kKeyPlanes];
+            for (int i = 0; i < kKeyPlanes; ++i)
+            {
+                sk[i] = W::set(sliceKeys[i]);
+            }
+
+            uint8_t tail[16 * groupBlocks];
+            for (std::size_t done = 0; done < blocks; done += groupBlocks)
+            {
+                std::size_t n = blocks - done < groupBlocks ? blocks - done : groupBlocks;
+                const uint8_t *src = in + 16 * done;
+                uint8_t *dst = out + 16 * done;
+                if (n < groupBlocks)
+                {
+                    std::memset(tail, 0, sizeof(tail));
+                    std::memcpy(tail, src, 16 * n);
+                    src = tail;
+                    dst = tail;
+                }
+
+                uint64_t raw[kPlanes][lanes];
+                for (int lane = 0; lane < lanes; ++lane)
+                {
+                    uint64_t w[kPlanes];
+                    interleaveIn(w, src + 64 * lane);
+                    for (int k = 0; k < kPlanes; ++k)
+                        raw[k][lane] = w[k];
+                }
+
+                W q[kPlanes];
+                for (int k = 0; k < kPlanes; ++k)
+                    q[k] = W::load(raw[k]);
+                ortho(q);
+                if (decrypt)
+                    decryptPlanes<Rounds>(q, sk);
+                else
+                    encryptPlanes<Rounds>(q, sk);
+                ortho(q);
+                for (int k = 0; k < kPlanes; ++k)
+                    q[k].store(raw[k]);
+
+                for (int lane = 0; lane < lanes; ++lane)
+                {
+                    uint64_t w[kPlanes];
+                    for (int k = 0; k < kPlanes; ++k)
+                        w[k] = raw[k][lane];
+                    interleaveOut(w, dst + 64 * lane);
+                }
+
+                if (n < groupBlocks)
+                {
+                    std::memcpy(out + 16 * done, tail, 16 * n);
+                }
+            }
+        }
+    } // namespace bitslice
+} // namespace BCKernel
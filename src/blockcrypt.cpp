@@ -1,86 +1,283 @@
 #include "../include/blockcrypt.hpp"
+#include "../include/cpu.hpp"
+#include "aes_kernels.hpp"
+#include "stats_impl.hpp"
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <stdexcept>
 
-BlockCrypt::BlockCrypt(const Key &key)
+namespace
 {
-    keyExpansion(key);
-}
-
-void BlockCrypt::keyExpansion(const Key &key)
-{
-    // This function implements the key expansion phase of the AES algorithm.
-    // It takes the initial cipher key and generates all round keys required for encryption or decryption.
-    // AES requires 44 words (each word = 4 bytes) for the key schedule:
-    // Round 0 key is directly copied from the input key.
-    // Subsequent keys are calculated by performing transformations like RotWord, SubWord, and Rcon operations.
+    using BCTables::gmul;
 
-    // Fill the first round key (round 0) with the key
-    for (int i = 0; i < KEY_SIZE; ++i)
+    // The word engine treats each state column as a big-endian 32-bit word,
+    // so byte 0 of a column ends up in the top 8 bits (matches the Te/Td layout).
+    inline uint32_t loadWord(const uint8_t *p)
     {
-        roundKeys[0][i] = key[i];
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
     }
 
-    uint8_t temp[4];
-    uint8_t rconIndex = 1;
+    inline void storeWord(uint8_t *p, uint32_t w)
+    {
+        p[0] = static_cast<uint8_t>(w >> 24);
+        p[1] = static_cast<uint8_t>(w >> 16);
+        p[2] = static_cast<uint8_t>(w >> 8);
+        p[3] = static_cast<uint8_t>(w);
+    }
 
-    // Expand for each word (44 words total, 0-3 already filled)
-    for (int wordIdx = 4; wordIdx < 44; ++wordIdx)
+    // encryptTTable()/decryptTTable() for N independent blocks at once. A single block is one
+    // long chain of dependent table loads; interleaving N of them per round gives the core N
+    // chains to overlap. Kept small (N <= 4) since each block holds four live words in registers;
+    // the loops are unrolled so s[]/t[] become plain registers instead of stack arrays.
+    // Decryption is the same shape with the Td tables, the inverse S-Box and ShiftRows taking
+    // the columns right-to-left (offset 3 instead of 1).
+    template <int Rounds, std::size_t N, bool Decrypt>
+    void cryptTTableGroup(const uint32_t *rk, const uint8_t *in, uint8_t *out)
     {
-        // Store the previous word in temp
-        int prevWord = wordIdx - 1;
-        for (int j = 0; j < 4; ++j)
+        const uint32_t *T0 = Decrypt ? Td0 : Te0;
+        const uint32_t *T1 = Decrypt ? Td1 : Te1;
+        const uint32_t *T2 = Decrypt ? Td2 : Te2;
+        const uint32_t *T3 = Decrypt ? Td3 : Te3;
+        const uint8_t *S = Decrypt ? invSBox : sBox;
+        constexpr int c1 = Decrypt ? 3 : 1; // column feeding the row-1 byte
+        constexpr int c3 = Decrypt ? 1 : 3; // column feeding the row-3 byte
+
+        uint32_t s[N][4], t[N][4];
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < N; ++i)
         {
-            temp[j] = roundKeys[prevWord / 4][(prevWord % 4) * 4 + j];
+#pragma GCC unroll 4
+            for (int c = 0; c < 4; ++c)
+            {
+                s[i][c] = loadWord(in + i * 16 + c * 4) ^ rk[c];
+            }
         }
 
-        // Apply transformation on every 4th word
-        if (wordIdx % 4 == 0)
+        for (int round = 1; round < Rounds; ++round)
         {
-            // RotWord
-            uint8_t t = temp[0];
-            temp[0] = temp[1];
-            temp[1] = temp[2];
-            temp[2] = temp[3];
-            temp[3] = t;
-
-            // SubWord
-            for (int j = 0; j < 4; ++j)
+            rk += 4;
+#pragma GCC unroll 4
+            for (std::size_t i = 0; i < N; ++i)
+            {
+#pragma GCC unroll 4
+                for (int c = 0; c < 4; ++c)
+                {
+                    t[i][c] = T0[s[i][c] >> 24] ^ T1[(s[i][(c + c1) & 3] >> 16) & 0xff] ^
+                              T2[(s[i][(c + 2) & 3] >> 8) & 0xff] ^ T3[s[i][(c + c3) & 3] & 0xff] ^ rk[c];
+                }
+            }
+#pragma GCC unroll 4
+            for (std::size_t i = 0; i < N; ++i)
             {
-                temp[j] = sBox[temp[j]];
+#pragma GCC unroll 4
+                for (int c = 0; c < 4; ++c)
+                {
+                    s[i][c] = t[i][c];
+                }
             }
+        }
 
-            // add Rcon
-            if (rconIndex >= sizeof(rcon) / sizeof(rcon[0]))
+        rk += 4;
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < N; ++i)
+        {
+#pragma GCC unroll 4
+            for (int c = 0; c < 4; ++c)
             {
-                throw std::runtime_error("Rcon index out of bounds during key expansion!");
+                uint32_t w = (static_cast<uint32_t>(S[s[i][c] >> 24]) << 24) ^
+                             (static_cast<uint32_t>(S[(s[i][(c + c1) & 3] >> 16) & 0xff]) << 16) ^
+                             (static_cast<uint32_t>(S[(s[i][(c + 2) & 3] >> 8) & 0xff]) << 8) ^
+                             static_cast<uint32_t>(S[s[i][(c + c3) & 3] & 0xff]) ^ rk[c];
+                storeWord(out + i * 16 + c * 4, w);
             }
-            // std::cout << "Using rcon[" << static_cast<int>(rconIndex) << "] = " << std::hex << static_cast<int>(rcon[rconIndex]) << std::dec << std::endl;
-            temp[0] ^= rcon[rconIndex++];
         }
+    }
 
-        // Calculate the target position in the roundKeys matrix and XOR it with the value at the same position from 4 words ago
-        for (int j = 0; j < 4; ++j)
+    template <int Rounds, std::size_t N, bool Decrypt>
+    void cryptTTableLanes(const uint32_t *rk, const uint8_t *in, uint8_t *out, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + N <= count; i += N)
         {
-            int targetRound = wordIdx / 4;
-            int targetPos = (wordIdx % 4) * 4 + j;
+            cryptTTableGroup<Rounds, N, Decrypt>(rk, in + i * BLOCK_SIZE, out + i * BLOCK_SIZE);
+        }
+        for (; i < count; ++i)
+        {
+            cryptTTableGroup<Rounds, 1, Decrypt>(rk, in + i * BLOCK_SIZE, out + i * BLOCK_SIZE);
+        }
+    }
 
-            int prevRound = (wordIdx - 4) / 4;
-            int prevPos = ((wordIdx - 4) % 4) * 4 + j;
+    // lanes: 0 = default (4), otherwise rounded down to 4, 2 or 1
+    template <int Rounds, bool Decrypt>
+    void cryptTTableBlocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, std::size_t count, std::size_t lanes)
+    {
+        if (lanes == 0 || lanes >= 4)
+            cryptTTableLanes<Rounds, 4, Decrypt>(rk, in, out, count);
+        else if (lanes >= 2)
+            cryptTTableLanes<Rounds, 2, Decrypt>(rk, in, out, count);
+        else
+            cryptTTableLanes<Rounds, 1, Decrypt>(rk, in, out, count);
+    }
+} // namespace
+
+template <std::size_t KeyBytes>
+BlockCryptBackend BasicBlockCrypt<KeyBytes>::resolveBackend(Backend backend)
+{
+    if (backend == Backend::Auto)
+    {
+        // Without AES-NI prefer the constant-time kernels over the cache-timing-prone T-tables
+        if (supports(Backend::AESNI))
+            return Backend::AESNI;
+        if (supports(Backend::VPerm))
+            return Backend::VPerm;
+        return Backend::Bitsliced;
+    }
+    if (!supports(backend))
+    {
+        throw std::runtime_error(std::string("BlockCrypt backend not available: ") + backendName(backend));
+    }
+    return backend;
+}
 
-            roundKeys.at(targetRound).at(targetPos) =
-                roundKeys.at(prevRound).at(prevPos) ^ temp[j];
+template <std::size_t KeyBytes>
+BasicBlockCrypt<KeyBytes>::BasicBlockCrypt(const Key &key, Backend backend)
+    : engine(resolveBackend(backend))
+{
+    BCStats::detail::countKeyExpansion();
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    if constexpr (KeyBytes == 16)
+    {
+        if (engine == Backend::AESNI)
+        {
+            BCKernel::aesniExpandKey128(key.data(), roundKeys[0].data(), niDecKeys[0].data());
+            return;
         }
     }
+#endif
+    roundKeys = expandKey(key);
+    deriveSchedules();
 }
 
-void BlockCrypt::printRoundKeys() const
+template <std::size_t KeyBytes>
+BasicBlockCrypt<KeyBytes>::BasicBlockCrypt(const Schedule &schedule, Backend backend)
+    : engine(resolveBackend(backend)), roundKeys(schedule)
+{
+    deriveSchedules();
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::deriveSchedules()
+{
+    // Each engine's own form of roundKeys
+    switch (engine)
+    {
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    case Backend::AESNI:
+        BCKernel::aesniInvertKeys<kRounds>(roundKeys[0].data(), niDecKeys[0].data());
+        break;
+#endif
+    case Backend::TTable:
+        wordExpansion();
+        break;
+    case Backend::Bitsliced:
+    case Backend::VPerm:
+        static_assert(std::tuple_size<decltype(sliceKeys)>::value == BCKernel::kSliceKeyWords<kRounds>,
+                      "sliceKeys must match the bitsliced kernel's key layout");
+        BCKernel::bitsliceKeySchedule<kRounds>(roundKeys[0].data(), sliceKeys.data());
+        break;
+    default:
+        break;
+    }
+}
+
+template <std::size_t KeyBytes>
+bool BasicBlockCrypt<KeyBytes>::supports(Backend backend)
+{
+    switch (backend)
+    {
+    case Backend::Auto:
+    case Backend::Reference:
+    case Backend::TTable:
+    case Backend::Bitsliced:
+        return true;
+    case Backend::AESNI:
+#ifdef BLOCKCRYPT_HAVE_AESNI
+        return BCCpu::features().aesni;
+#else
+        return false;
+#endif
+    case Backend::VPerm:
+#ifdef BLOCKCRYPT_HAVE_VPERM
+        return BCCpu::features().ssse3;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+template <std::size_t KeyBytes>
+const char *BasicBlockCrypt<KeyBytes>::backendName(Backend backend)
+{
+    switch (backend)
+    {
+    case Backend::Auto:
+        return "auto";
+    case Backend::Reference:
+        return "reference";
+    case Backend::TTable:
+        return "ttable";
+    case Backend::AESNI:
+        return "aesni";
+    case Backend::Bitsliced:
+        return "bitsliced";
+    case Backend::VPerm:
+        return "vperm";
+    }
+    return "unknown";
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::wordExpansion()
+{
+    // Repack the byte round keys into column words for the T-table engine and derive
+    // the decryption schedule of the "equivalent inverse cipher" (FIPS-197 §5.3.5):
+    // the round keys are used in reverse order and rounds 1..Nr-1 get InvMixColumns applied,
+    // so decryption can run the same fused table-lookup structure as encryption.
+    for (int round = 0; round <= kRounds; ++round)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            encWords[round * 4 + col] = loadWord(&roundKeys[round][col * 4]);
+        }
+    }
+
+    for (int round = 0; round <= kRounds; ++round)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            uint32_t w = encWords[(kRounds - round) * 4 + col];
+            if (round > 0 && round < kRounds)
+            {
+                // Td[S[x]] cancels the inverse S-Box folded into Td, leaving only InvMixColumns
+                w = Td0[sBox[w >> 24]] ^ Td1[sBox[(w >> 16) & 0xff]] ^
+                    Td2[sBox[(w >> 8) & 0xff]] ^ Td3[sBox[w & 0xff]];
+            }
+            decWords[round * 4 + col] = w;
+        }
+    }
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::printRoundKeys() const
 {
     std::cout << "Round Keys:\n";
-    for (int round = 0; round < 11; ++round)
+    for (int round = 0; round <= kRounds; ++round)
     {
         std::cout << "Round " << round << ": ";
-        for (int i = 0; i < KEY_SIZE; ++i)
+        for (int i = 0; i < BLOCK_SIZE; ++i)
         {
             std::cout << std::hex << static_cast<int>(roundKeys[round][i]) << " ";
         }
@@ -88,7 +285,8 @@ void BlockCrypt::printRoundKeys() const
     }
 }
 
-void BlockCrypt::subBytes(Block &block) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::subBytes(Block &block) const
 {
     // This function performs the "SubBytes" step of AES encryption or decryption.
     // It replaces each byte in the block with the corresponding value from the S-Box (substitution box),
@@ -103,7 +301,8 @@ void BlockCrypt::subBytes(Block &block) const
     // printBlock(block, "After subBytes");
 }
 
-void BlockCrypt::invSubBytes(Block &block) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::invSubBytes(Block &block) const
 {
     // This function performs the "InvSubBytes" step of AES decryption.
     // It replaces each byte in the block with the corresponding value from the inverse S-Box (invSBox),
@@ -114,7 +313,8 @@ void BlockCrypt::invSubBytes(Block &block) const
     }
 }
 
-void BlockCrypt::printBlock(Block &block, const std::string &message) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::printBlock(Block &block, const std::string &message) const
 {
     std::cout << message << ": ";
     std::cout << std::endl;
@@ -130,16 +330,19 @@ void BlockCrypt::printBlock(Block &block, const std::string &message) const
     std::cout << std::endl;
 }
 
-inline uint8_t & ::BlockCrypt::cell(Block &b, int row, int col)
+template <std::size_t KeyBytes>
+inline uint8_t &BasicBlockCrypt<KeyBytes>::cell(Block &b, int row, int col)
 {
     return b[col * 4 + row];
 }
-inline uint8_t BlockCrypt::cell(const Block &b, int row, int col)
+template <std::size_t KeyBytes>
+inline uint8_t BasicBlockCrypt<KeyBytes>::cell(const Block &b, int row, int col)
 {
     return b[col * 4 + row];
 }
 
-void BlockCrypt::shiftRows(Block &block) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::shiftRows(Block &block) const
 {
     /*  ⎡ S0  S4  S8  S12 ⎤       ⎡ S0   S4   S8   S12 ⎤
         ⎢ S1  S5  S9  S13 ⎥  →    ⎢ S5   S9   S13  S1  ⎥
@@ -174,7 +377,8 @@ void BlockCrypt::shiftRows(Block &block) const
     // printBlock(block, "After shiftRows: ");
 }
 
-void BlockCrypt::invShiftRows(Block &block) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::invShiftRows(Block &block) const
 {
     /*  ⎡ S0   S4   S8   S12 ⎤       ⎡ S0  S4  S8  S12 ⎤
         ⎢ S5   S9   S13  S1  ⎥  →    ⎢ S1  S5  S9  S13 ⎥
@@ -201,7 +405,8 @@ void BlockCrypt::invShiftRows(Block &block) const
     cell(block, 3, 3) = temp;
 }
 
-void BlockCrypt::addRoundKey(Block &block, const Key &roundKey) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::addRoundKey(Block &block, const Block &roundKey) const
 {
     // This function applies the "AddRoundKey" step of AES encryption or decryption.
     // It XORs each byte of the current block with the corresponding byte of the round key.
@@ -212,41 +417,8 @@ void BlockCrypt::addRoundKey(Block &block, const Key &roundKey) const
     }
 }
 
-/*
- * This function performs multiplication of two 8-bit numbers in the Galois Field GF(2^8),
- * which is widely used in cryptographic algorithms like AES.
- * The multiplication involves bitwise operations, modular addition (XOR),
- * and modular reduction using the AES-specific irreducible polynomial (0x1b).
- * Parameters:
- *   a - The first 8-bit number to be multiplied.
- *   b - The second 8-bit number to be multiplied.
- * Returns:
- *   The result of the multiplication in GF(2^8).
- */
-uint8_t BlockCrypt::gmul(uint8_t a, uint8_t b) const
-{
-    uint8_t p = 0;
-    for (int i = 0; i < 8; ++i)
-    {
-        if (b & 1) // Check if the least significant bit of b is set
-        {
-            p ^= a;
-        }
-        bool high_bit = a & 0x80;
-        a <<= 1;
-        if (high_bit) // Check if the most significant bit of a is set
-        {
-            // If the most significant bit (MSB) was set before shifting (high_bit is true),
-            // apply modular reduction by XORing 'a' with 0x1b (the AES irreducible polynomial).
-            // This ensures the value remains within the boundaries of the Galois Field GF(2^8).
-            a ^= 0x1b;
-        }
-        b >>= 1;
-    }
-    return p;
-}
-
-void BlockCrypt::mixColumns(Block &block) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::mixColumns(Block &block) const
 {
     // This function performs the "MixColumns" step of AES encryption or decryption.
     // printBlock(block, "Before mixColumns");
@@ -267,7 +439,8 @@ void BlockCrypt::mixColumns(Block &block) const
     // printBlock(block, "After mixColumns");
 }
 
-void BlockCrypt::invMixColumns(Block &block) const
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::invMixColumns(Block &block) const
 {
     // This function performs the "InvMixColumns" step of AES decryption.
     for (int col = 0; col < 4; ++col) // Iterate through each column
@@ -285,10 +458,11 @@ void BlockCrypt::invMixColumns(Block &block) const
     }
 }
 
-void BlockCrypt::encrypt(Block &plaintext)
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::encryptReference(Block &plaintext) const
 {
     addRoundKey(plaintext, roundKeys[0]);
-    for (int round = 1; round < 10; ++round)
+    for (int round = 1; round < kRounds; ++round)
     {
         subBytes(plaintext);
         shiftRows(plaintext);
@@ -297,13 +471,14 @@ void BlockCrypt::encrypt(Block &plaintext)
     }
     subBytes(plaintext);
     shiftRows(plaintext);
-    addRoundKey(plaintext, roundKeys[10]);
+    addRoundKey(plaintext, roundKeys[kRounds]);
 }
 
-void BlockCrypt::decrypt(Block &plaintext)
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::decryptReference(Block &plaintext) const
 {
-    addRoundKey(plaintext, roundKeys[10]);
-    for (int round = 9; round > 0; --round)
+    addRoundKey(plaintext, roundKeys[kRounds]);
+    for (int round = kRounds - 1; round > 0; --round)
     {
         invShiftRows(plaintext);
         invSubBytes(plaintext);
@@ -314,3 +489,297 @@ void BlockCrypt::decrypt(Block &plaintext)
     invSubBytes(plaintext);
     addRoundKey(plaintext, roundKeys[0]);
 }
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::encrypt(Block &plaintext) const
+{
+    switch (engine)
+    {
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    case Backend::AESNI:
+        BCKernel::aesniEncryptBlock<kRounds>(roundKeys[0].data(), plaintext.data());
+        return;
+#endif
+#ifdef BLOCKCRYPT_HAVE_VPERM
+    case Backend::VPerm:
+        BCKernel::vpermEncryptBlock<kRounds>(roundKeys[0].data(), plaintext.data());
+        return;
+#endif
+    case Backend::Bitsliced:
+        BCKernel::bitsliceEncrypt<kRounds>(sliceKeys.data(), plaintext.data(), plaintext.data(), 1);
+        return;
+    case Backend::Reference:
+        encryptReference(plaintext);
+        return;
+    default:
+        encryptTTable(plaintext);
+        return;
+    }
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::decrypt(Block &ciphertext) const
+{
+    switch (engine)
+    {
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    case Backend::AESNI:
+        BCKernel::aesniDecryptBlock<kRounds>(niDecKeys[0].data(), ciphertext.data());
+        return;
+#endif
+#ifdef BLOCKCRYPT_HAVE_VPERM
+    case Backend::VPerm:
+        BCKernel::vpermDecryptBlock<kRounds>(roundKeys[0].data(), ciphertext.data());
+        return;
+#endif
+    case Backend::Bitsliced:
+        BCKernel::bitsliceDecrypt<kRounds>(sliceKeys.data(), ciphertext.data(), ciphertext.data(), 1);
+        return;
+    case Backend::Reference:
+        decryptReference(ciphertext);
+        return;
+    default:
+        decryptTTable(ciphertext);
+        return;
+    }
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::encryptBlocks(const uint8_t *in, uint8_t *out, std::size_t count, std::size_t lanes) const
+{
+    BCStats::detail::OpTimer timer(BCStats::Op::EncryptBlocks, count * BLOCK_SIZE);
+    switch (engine)
+    {
+    case Backend::Bitsliced:
+    case Backend::VPerm:
+        BCKernel::bitsliceEncrypt<kRounds>(sliceKeys.data(), in, out, count);
+        return;
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    case Backend::AESNI:
+        BCKernel::aesniEncryptBlocks<kRounds>(roundKeys[0].data(), in, out, count, lanes == 0 ? 8 : lanes);
+        return;
+#endif
+    case Backend::TTable:
+        cryptTTableBlocks<kRounds, false>(encWords.data(), in, out, count, lanes);
+        return;
+    default:
+        break;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Block block;
+        std::memcpy(block.data(), in + i * BLOCK_SIZE, BLOCK_SIZE);
+        encrypt(block);
+        std::memcpy(out + i * BLOCK_SIZE, block.data(), BLOCK_SIZE);
+    }
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::decryptBlocks(const uint8_t *in, uint8_t *out, std::size_t count, std::size_t lanes) const
+{
+    BCStats::detail::OpTimer timer(BCStats::Op::DecryptBlocks, count * BLOCK_SIZE);
+    switch (engine)
+    {
+    case Backend::Bitsliced:
+    case Backend::VPerm:
+        BCKernel::bitsliceDecrypt<kRounds>(sliceKeys.data(), in, out, count);
+        return;
+#ifdef BLOCKCRYPT_HAVE_AESNI
+    case Backend::AESNI:
+        BCKernel::aesniDecryptBlocks<kRounds>(niDecKeys[0].data(), in, out, count, lanes == 0 ? 8 : lanes);
+        return;
+#endif
+    case Backend::TTable:
+        cryptTTableBlocks<kRounds, true>(decWords.data(), in, out, count, lanes);
+        return;
+    default:
+        break;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Block block;
+        std::memcpy(block.data(), in + i * BLOCK_SIZE, BLOCK_SIZE);
+        decrypt(block);
+        std::memcpy(out + i * BLOCK_SIZE, block.data(), BLOCK_SIZE);
+    }
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::encryptTTable(Block &plaintext) const
+{
+    // Each Te lookup performs SubBytes, ShiftRows (through the column the byte is taken from)
+    // and one column of MixColumns at once; four lookups and a round-key XOR produce a column.
+    const uint32_t *rk = encWords.data();
+    uint32_t s0 = loadWord(&plaintext[0]) ^ rk[0];
+    uint32_t s1 = loadWord(&plaintext[4]) ^ rk[1];
+    uint32_t s2 = loadWord(&plaintext[8]) ^ rk[2];
+    uint32_t s3 = loadWord(&plaintext[12]) ^ rk[3];
+    uint32_t t0, t1, t2, t3;
+
+#pragma GCC unroll 14
+    for (int round = 1; round < kRounds; ++round)
+    {
+        rk += 4;
+        t0 = Te0[s0 >> 24] ^ Te1[(s1 >> 16) & 0xff] ^ Te2[(s2 >> 8) & 0xff] ^ Te3[s3 & 0xff] ^ rk[0];
+        t1 = Te0[s1 >> 24] ^ Te1[(s2 >> 16) & 0xff] ^ Te2[(s3 >> 8) & 0xff] ^ Te3[s0 & 0xff] ^ rk[1];
+        t2 = Te0[s2 >> 24] ^ Te1[(s3 >> 16) & 0xff] ^ Te2[(s0 >> 8) & 0xff] ^ Te3[s1 & 0xff] ^ rk[2];
+        t3 = Te0[s3 >> 24] ^ Te1[(s0 >> 16) & 0xff] ^ Te2[(s1 >> 8) & 0xff] ^ Te3[s2 & 0xff] ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    // Final round has no MixColumns: plain S-Box lookups, shifted and recombined
+    rk += 4;
+    t0 = (static_cast<uint32_t>(sBox[s0 >> 24]) << 24) ^ (static_cast<uint32_t>(sBox[(s1 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(sBox[(s2 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(sBox[s3 & 0xff]) ^ rk[0];
+    t1 = (static_cast<uint32_t>(sBox[s1 >> 24]) << 24) ^ (static_cast<uint32_t>(sBox[(s2 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(sBox[(s3 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(sBox[s0 & 0xff]) ^ rk[1];
+    t2 = (static_cast<uint32_t>(sBox[s2 >> 24]) << 24) ^ (static_cast<uint32_t>(sBox[(s3 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(sBox[(s0 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(sBox[s1 & 0xff]) ^ rk[2];
+    t3 = (static_cast<uint32_t>(sBox[s3 >> 24]) << 24) ^ (static_cast<uint32_t>(sBox[(s0 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(sBox[(s1 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(sBox[s2 & 0xff]) ^ rk[3];
+
+    storeWord(&plaintext[0], t0);
+    storeWord(&plaintext[4], t1);
+    storeWord(&plaintext[8], t2);
+    storeWord(&plaintext[12], t3);
+}
+
+template <std::size_t KeyBytes>
+void BasicBlockCrypt<KeyBytes>::decryptTTable(Block &ciphertext) const
+{
+    // Equivalent inverse cipher: same shape as encrypt(), but with Td tables, the inverse
+    // ShiftRows pattern (columns taken right-to-left) and the pre-mixed decWords schedule.
+    const uint32_t *rk = decWords.data();
+    uint32_t s0 = loadWord(&ciphertext[0]) ^ rk[0];
+    uint32_t s1 = loadWord(&ciphertext[4]) ^ rk[1];
+    uint32_t s2 = loadWord(&ciphertext[8]) ^ rk[2];
+    uint32_t s3 = loadWord(&ciphertext[12]) ^ rk[3];
+    uint32_t t0, t1, t2, t3;
+
+#pragma GCC unroll 14
+    for (int round = 1; round < kRounds; ++round)
+    {
+        rk += 4;
+        t0 = Td0[s0 >> 24] ^ Td1[(s3 >> 16) & 0xff] ^ Td2[(s2 >> 8) & 0xff] ^ Td3[s1 & 0xff] ^ rk[0];
+        t1 = Td0[s1 >> 24] ^ Td1[(s0 >> 16) & 0xff] ^ Td2[(s3 >> 8) & 0xff] ^ Td3[s2 & 0xff] ^ rk[1];
+        t2 = Td0[s2 >> 24] ^ Td1[(s1 >> 16) & 0xff] ^ Td2[(s0 >> 8) & 0xff] ^ Td3[s3 & 0xff] ^ rk[2];
+        t3 = Td0[s3 >> 24] ^ Td1[(s2 >> 16) & 0xff] ^ Td2[(s1 >> 8) & 0xff] ^ Td3[s0 & 0xff] ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    rk += 4;
+    t0 = (static_cast<uint32_t>(invSBox[s0 >> 24]) << 24) ^ (static_cast<uint32_t>(invSBox[(s3 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(invSBox[(s2 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(invSBox[s1 & 0xff]) ^ rk[0];
+    t1 = (static_cast<uint32_t>(invSBox[s1 >> 24]) << 24) ^ (static_cast<uint32_t>(invSBox[(s0 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(invSBox[(s3 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(invSBox[s2 & 0xff]) ^ rk[1];
+    t2 = (static_cast<uint32_t>(invSBox[s2 >> 24]) << 24) ^ (static_cast<uint32_t>(invSBox[(s1 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(invSBox[(s0 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(invSBox[s3 & 0xff]) ^ rk[2];
+    t3 = (static_cast<uint32_t>(invSBox[s3 >> 24]) << 24) ^ (static_cast<uint32_t>(invSBox[(s2 >> 16) & 0xff]) << 16) ^
+         (static_cast<uint32_t>(invSBox[(s1 >> 8) & 0xff]) << 8) ^ static_cast<uint32_t>(invSBox[s0 & 0xff]) ^ rk[3];
+
+    storeWord(&ciphertext[0], t0);
+    storeWord(&ciphertext[4], t1);
+    storeWord(&ciphertext[8], t2);
+    storeWord(&ciphertext[12], t3);
+}
+
+// Compile-time checks of expandKey against FIPS-197: the last round key of each Appendix A
+// expansion, and the Appendix C example vectors run through a constexpr copy of the
+// byte-wise cipher. A broken table generator or key schedule fails the build.
+namespace
+{
+    using Block = BlockCrypt::Block;
+
+    constexpr bool sameBlock(const Block &a, const Block &b)
+    {
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i] != b[i])
+                return false;
+        }
+        return true;
+    }
+
+    template <std::size_t KeyBytes>
+    constexpr Block encryptAtCompileTime(const typename BasicBlockCrypt<KeyBytes>::Schedule &rk, Block s)
+    {
+        constexpr int rounds = BasicBlockCrypt<KeyBytes>::kRounds;
+        for (int i = 0; i < 16; ++i)
+            s[i] ^= rk[0][i];
+        for (int round = 1; round <= rounds; ++round)
+        {
+            // SubBytes + ShiftRows: row r of column c comes from column c + r
+            Block t{};
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    t[c * 4 + r] = sBox[s[((c + r) % 4) * 4 + r]];
+            for (int c = 0; round < rounds && c < 4; ++c)
+            {
+                uint8_t a0 = t[c * 4], a1 = t[c * 4 + 1], a2 = t[c * 4 + 2], a3 = t[c * 4 + 3];
+                t[c * 4] = gmul(a0, 2) ^ gmul(a1, 3) ^ a2 ^ a3;
+                t[c * 4 + 1] = a0 ^ gmul(a1, 2) ^ gmul(a2, 3) ^ a3;
+                t[c * 4 + 2] = a0 ^ a1 ^ gmul(a2, 2) ^ gmul(a3, 3);
+                t[c * 4 + 3] = gmul(a0, 3) ^ a1 ^ a2 ^ gmul(a3, 2);
+            }
+            for (int i = 0; i < 16; ++i)
+                s[i] = t[i] ^ rk[round][i];
+        }
+        return s;
+    }
+
+    // Appendix C plaintext, and keys 00 01 02 ... of the required length
+    constexpr Block kFipsPlaintext = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                      0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+    template <std::size_t KeyBytes>
+    constexpr typename BasicBlockCrypt<KeyBytes>::Key countingKey()
+    {
+        typename BasicBlockCrypt<KeyBytes>::Key key{};
+        for (std::size_t i = 0; i < KeyBytes; ++i)
+            key[i] = static_cast<uint8_t>(i);
+        return key;
+    }
+
+    // Appendix A.1: 2b7e1516 28aed2a6 abf71588 09cf4f3c -> w40..w43
+    static_assert(sameBlock(BlockCrypt::expandKey({0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                                   0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c})[10],
+                            {0xd0, 0x14, 0xf9, 0xa8, 0xc9, 0xee, 0x25, 0x89, 0xe1, 0x3f, 0x0c, 0xc8, 0xb6, 0x63, 0x0c, 0xa6}),
+                  "FIPS-197 A.1 key expansion");
+
+    // Appendix A.2: 8e73b0f7 da0e6452 c810f32b 809079e5 62f8ead2 522c6b7b -> w48..w51
+    static_assert(sameBlock(BlockCrypt192::expandKey({0x8e, 0x73, 0xb0, 0xf7, 0xda, 0x0e, 0x64, 0x52,
+                                                      0xc8, 0x10, 0xf3, 0x2b, 0x80, 0x90, 0x79, 0xe5,
+                                                      0x62, 0xf8, 0xea, 0xd2, 0x52, 0x2c, 0x6b, 0x7b})[12],
+                            {0xe9, 0x8b, 0xa0, 0x6f, 0x44, 0x8c, 0x77, 0x3c, 0x8e, 0xcc, 0x72, 0x04, 0x01, 0x00, 0x22, 0x02}),
+                  "FIPS-197 A.2 key expansion");
+
+    // Appendix A.3: 603deb10 15ca71be 2b73aef0 857d7781 1f352c07 3b6108d7 2d9810a3 0914dff4 -> w56..w59
+    static_assert(sameBlock(BlockCrypt256::expandKey({0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+                                                      0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+                                                      0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+                                                      0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4})[14],
+                            {0xfe, 0x48, 0x90, 0xd1, 0xe6, 0x18, 0x8d, 0x0b, 0x04, 0x6d, 0xf3, 0x44, 0x70, 0x6c, 0x63, 0x1e}),
+                  "FIPS-197 A.3 key expansion");
+
+    static_assert(sameBlock(encryptAtCompileTime<16>(BlockCrypt::expandKey(countingKey<16>()), kFipsPlaintext),
+                            {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a}),
+                  "FIPS-197 C.1 AES-128");
+    static_assert(sameBlock(encryptAtCompileTime<24>(BlockCrypt192::expandKey(countingKey<24>()), kFipsPlaintext),
+                            {0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91}),
+                  "FIPS-197 C.2 AES-192");
+    static_assert(sameBlock(encryptAtCompileTime<32>(BlockCrypt256::expandKey(countingKey<32>()), kFipsPlaintext),
+                            {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89}),
+                  "FIPS-197 C.3 AES-256");
+} // namespace
+
+template class BasicBlockCrypt<16>;
+template class BasicBlockCrypt<24>;
+template class BasicBlockCrypt<32>;
@@ -0,0 +1,320 @@
+#include "../include/bufferpool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace BC
+{
+    namespace
+    {
+        // Per-thread free lists keep up to this many bytes per size class (at least one buffer),
+        // the depot up to kDepotBytes per class (at least four); the rest goes back to the system
+        constexpr std::size_t kThreadCacheBytes = std::size_t(8) << 20;
+        constexpr std::size_t kDepotBytes = std::size_t(64) << 20;
+
+        std::size_t classBytes(std::size_t index)
+        {
+            return std::size_t(1) << (index + BufferPool::kMinClassShift);
+        }
+
+        std::size_t classIndex(std::size_t bytes)
+        {
+            if (bytes <= classBytes(0))
+                return 0;
+            unsigned shift = 64 - static_cast<unsigned>(__builtin_clzll(static_cast<unsigned long long>(bytes - 1)));
+            return shift - BufferPool::kMinClassShift;
+        }
+
+        std::size_t threadLimit(std::size_t index)
+        {
+            return std::max<std::size_t>(1, kThreadCacheBytes / classBytes(index));
+        }
+
+        std::size_t depotLimit(std::size_t index)
+        {
+            return std::max<std::size_t>(4, kDepotBytes / classBytes(index));
+        }
+
+        // Bumped from every thread on every acquire/release, so on their own cache lines
+        struct alignas(64) Counters
+        {
+            std::atomic<uint64_t> acquires{0}, threadHits{0}, depotHits{0};
+            std::atomic<uint64_t> systemAllocations{0}, systemFrees{0};
+            std::atomic<uint64_t> bytesInUse{0}, bytesCached{0};
+        };
+
+        // A plain memset before the memory changes hands could be dropped as a dead store
+        void wipe(uint8_t *p, std::size_t n)
+        {
+            std::memset(p, 0, n);
+            __asm__ __volatile__("" : : "r"(p) : "memory");
+        }
+
+        // Free buffers are chained through their first bytes; no bookkeeping memory is needed
+        struct FreeList
+        {
+            uint8_t *head = nullptr;
+            std::size_t count = 0;
+
+            void push(uint8_t *p)
+            {
+                std::memcpy(p, &head, sizeof(head));
+                head = p;
+                ++count;
+            }
+
+            uint8_t *pop()
+            {
+                uint8_t *p = head;
+                std::memcpy(&head, p, sizeof(head));
+                --count;
+                return p;
+            }
+        };
+
+        struct alignas(64) DepotClass
+        {
+            std::mutex lock;
+            FreeList list;
+        };
+
+        // Shared state; never destroyed, since threads may release buffers after main returns
+        struct Shared
+        {
+            Counters counters;
+            DepotClass depot[BufferPool::kClasses];
+        };
+
+        Shared &shared()
+        {
+            static Shared *state = new Shared;
+            return *state;
+        }
+
+        uint8_t *systemAllocate(std::size_t bytes)
+        {
+            void *p = nullptr;
+            std::size_t alignment = bytes >= BufferPool::kPageAlignment ? BufferPool::kPageAlignment : BufferPool::kAlignment;
+            if (::posix_memalign(&p, alignment, bytes) != 0)
+                throw std::bad_alloc();
+            shared().counters.systemAllocations.fetch_add(1, std::memory_order_relaxed);
+            return static_cast<uint8_t *>(p);
+        }
+
+        void systemFree(uint8_t *p)
+        {
+            shared().counters.systemFrees.fetch_add(1, std::memory_order_relaxed);
+            std::free(p);
+        }
+
+        // Hands a cached buffer to the depot, or back to the system if the depot is full
+        void toDepot(std::size_t index, uint8_t *p)
+        {
+            DepotClass &d = shared().depot[index];
+            {
+                std::lock_guard<std::mutex> guard(d.lock);
+                if (d.list.count < depotLimit(index))
+                {
+                    d.list.push(p);
+                    return;
+                }
+            }
+            shared().counters.bytesCached.fetch_sub(classBytes(index), std::memory_order_relaxed);
+            systemFree(p);
+        }
+
+        // Set once the calling thread's cache is gone: buffers released from later thread_local
+        // destructors then go straight to the depot
+        thread_local bool cacheDestroyed = false;
+
+        struct ThreadCache
+        {
+            FreeList lists[BufferPool::kClasses];
+
+            ~ThreadCache()
+            {
+                cacheDestroyed = true;
+                for (std::size_t i = 0; i < BufferPool::kClasses; ++i)
+                {
+                    while (lists[i].count != 0)
+                        toDepot(i, lists[i].pop());
+                }
+            }
+        };
+
+        ThreadCache *threadCache()
+        {
+            if (cacheDestroyed)
+                return nullptr;
+            thread_local ThreadCache cache;
+            return &cache;
+        }
+    } // namespace
+
+    PooledBuffer::PooledBuffer(PooledBuffer &&other) noexcept
+        : base(std::exchange(other.base, nullptr)), length(std::exchange(other.length, 0)),
+          bytes(std::exchange(other.bytes, 0)), used(std::exchange(other.used, 0)),
+          sensitive(std::exchange(other.sensitive, false))
+    {
+    }
+
+    PooledBuffer &PooledBuffer::operator=(PooledBuffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            base = std::exchange(other.base, nullptr);
+            length = std::exchange(other.length, 0);
+            bytes = std::exchange(other.bytes, 0);
+            used = std::exchange(other.used, 0);
+            sensitive = std::exchange(other.sensitive, false);
+        }
+        return *this;
+    }
+
+    PooledBuffer::~PooledBuffer()
+    {
+        release();
+    }
+
+    void PooledBuffer::resize(std::size_t n)
+    {
+        if (n > bytes)
+        {
+            PooledBuffer bigger = BufferPool::instance().acquire(n, sensitive ? BufferPool::Use::Sensitive
+                                                                              : BufferPool::Use::General);
+            if (length != 0)
+                std::memcpy(bigger.base, base, length);
+            *this = std::move(bigger);
+        }
+        length = n;
+        used = std::max(used, n);
+    }
+
+    void PooledBuffer::release()
+    {
+        if (base != nullptr)
+        {
+            if (sensitive)
+                wipe(base, used);
+            BufferPool::instance().release(base, bytes);
+        }
+        base = nullptr;
+        length = 0;
+        bytes = 0;
+        used = 0;
+        sensitive = false;
+    }
+
+    BufferPool &BufferPool::instance()
+    {
+        static BufferPool *pool = new BufferPool;
+        return *pool;
+    }
+
+    std::size_t BufferPool::capacityFor(std::size_t length)
+    {
+        if (length == 0)
+            return 0;
+        if (length > kMaxPooledBytes)
+            return (length + kPageAlignment - 1) / kPageAlignment * kPageAlignment;
+        return classBytes(classIndex(length));
+    }
+
+    PooledBuffer BufferPool::acquire(std::size_t length, Use use)
+    {
+        if (length == 0)
+            return PooledBuffer();
+
+        Counters &c = shared().counters;
+        c.acquires.fetch_add(1, std::memory_order_relaxed);
+        std::size_t bytes = capacityFor(length);
+        if (bytes > kMaxPooledBytes)
+        {
+            uint8_t *p = systemAllocate(bytes);
+            c.bytesInUse.fetch_add(bytes, std::memory_order_relaxed);
+            return PooledBuffer(p, length, bytes, use == Use::Sensitive);
+        }
+
+        std::size_t index = classIndex(bytes);
+        uint8_t *p = nullptr;
+        if (ThreadCache *cache = threadCache(); cache != nullptr && cache->lists[index].count != 0)
+        {
+            p = cache->lists[index].pop();
+            c.threadHits.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            DepotClass &d = shared().depot[index];
+            std::lock_guard<std::mutex> guard(d.lock);
+            if (d.list.count != 0)
+            {
+                p = d.list.pop();
+                c.depotHits.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (p != nullptr)
+            c.bytesCached.fetch_sub(bytes, std::memory_order_relaxed);
+        else
+            p = systemAllocate(bytes);
+        c.bytesInUse.fetch_add(bytes, std::memory_order_relaxed);
+        return PooledBuffer(p, length, bytes, use == Use::Sensitive);
+    }
+
+    void BufferPool::release(uint8_t *base, std::size_t bytes)
+    {
+        Counters &c = shared().counters;
+        c.bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+        if (bytes > kMaxPooledBytes)
+        {
+            systemFree(base);
+            return;
+        }
+
+        std::size_t index = classIndex(bytes);
+        c.bytesCached.fetch_add(bytes, std::memory_order_relaxed);
+        ThreadCache *cache = threadCache();
+        if (cache != nullptr && cache->lists[index].count < threadLimit(index))
+            cache->lists[index].push(base);
+        else
+            toDepot(index, base);
+    }
+
+    void BufferPool::trim()
+    {
+        Shared &s = shared();
+        for (std::size_t i = 0; i < kClasses; ++i)
+        {
+            FreeList drained;
+            if (ThreadCache *cache = threadCache())
+                std::swap(drained, cache->lists[i]);
+            {
+                std::lock_guard<std::mutex> guard(s.depot[i].lock);
+                while (s.depot[i].list.count != 0)
+                    drained.push(s.depot[i].list.pop());
+            }
+            s.counters.bytesCached.fetch_sub(drained.count * classBytes(i), std::memory_order_relaxed);
+            while (drained.count != 0)
+                systemFree(drained.pop());
+        }
+    }
+
+    BufferPool::Stats BufferPool::stats() const
+    {
+        const Counters &c = shared().counters;
+        Stats s;
+        s.acquires = c.acquires.load(std::memory_order_relaxed);
+        s.threadHits = c.threadHits.load(std::memory_order_relaxed);
+        s.depotHits = c.depotHits.load(std::memory_order_relaxed);
+        s.systemAllocations = c.systemAllocations.load(std::memory_order_relaxed);
+        s.systemFrees = c.systemFrees.load(std::memory_order_relaxed);
+        s.bytesInUse = c.bytesInUse.load(std::memory_order_relaxed);
+        s.bytesCached = c.bytesCached.load(std::memory_order_relaxed);
+        return s;
+    }
+} // namespace BC
@@ -0,0 +1,418 @@
+#include "../include/container.hpp"
+#include "../include/CBC.hpp"
+#include "../include/fileio.hpp"
+#include "../include/padding.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace BCFile
+{
+    namespace
+    {
+        constexpr char kMagic[8] = {'B', 'L', 'K', 'C', 'R', 'Y', 'P', 'T'};
+        constexpr char kIndexMagic[8] = {'B', 'C', 'I', 'N', 'D', 'E', 'X', '\0'};
+        constexpr uint32_t kVersion = 1;
+        constexpr std::size_t kMaxChunkBytes = std::size_t(1) << 30; // lengths are stored as u32
+
+        [[noreturn]] void fail(const std::string &what, const std::string &path)
+        {
+            throw std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+        }
+
+        [[noreturn]] void corrupt(const std::string &path, const std::string &why)
+        {
+            throw std::runtime_error("Not a valid container '" + path + "': " + why);
+        }
+
+        void putU32(uint8_t *p, uint32_t v)
+        {
+            for (int i = 0; i < 4; ++i)
+                p[i] = uint8_t(v >> (8 * i));
+        }
+
+        void putU64(uint8_t *p, uint64_t v)
+        {
+            for (int i = 0; i < 8; ++i)
+                p[i] = uint8_t(v >> (8 * i));
+        }
+
+        uint32_t getU32(const uint8_t *p)
+        {
+            uint32_t v = 0;
+            for (int i = 3; i >= 0; --i)
+                v = v << 8 | p[i];
+            return v;
+        }
+
+        uint64_t getU64(const uint8_t *p)
+        {
+            uint64_t v = 0;
+            for (int i = 7; i >= 0; --i)
+                v = v << 8 | p[i];
+            return v;
+        }
+
+        // IV of chunk i: E_K(nonce XOR le64(i)), for `count` consecutive chunks in one call
+        template <std::size_t KeyBytes>
+        void deriveIVs(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &nonce, uint64_t first,
+                       std::size_t count, BlockCrypt::Block *out)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                out[i] = nonce;
+                for (int b = 0; b < 8; ++b)
+                    out[i][b] ^= uint8_t((first + i) >> (8 * b));
+            }
+            aes.encryptBlocks(out[0].data(), out[0].data(), count);
+        }
+
+        // The upper half of the nonce inverted: chunk IVs only ever change the lower half
+        template <std::size_t KeyBytes>
+        BlockCrypt::Block keyCheck(const BasicBlockCrypt<KeyBytes> &aes, const BlockCrypt::Block &nonce)
+        {
+            BlockCrypt::Block block = nonce;
+            for (int b = 8; b < 16; ++b)
+                block[b] ^= 0xff;
+            aes.encrypt(block);
+            return block;
+        }
+
+        void preadAll(int fd, uint8_t *out, std::size_t length, uint64_t offset, const std::string &path)
+        {
+            while (length != 0)
+            {
+                ssize_t n = ::pread(fd, out, length, static_cast<off_t>(offset));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                    fail("Cannot read", path);
+                if (n == 0)
+                    corrupt(path, "unexpected end of file");
+                out += n;
+                offset += static_cast<uint64_t>(n);
+                length -= static_cast<std::size_t>(n);
+            }
+        }
+    } // namespace
+
+    template <std::size_t KeyBytes>
+    BasicContainerWriter<KeyBytes>::BasicContainerWriter(const std::string &path, const Cipher &aes,
+                                                         BC::ThreadPool &pool, const ContainerOptions &options)
+        : aes(aes), pool(pool), path(path), chunkBytes(std::max<std::size_t>(BLOCK_SIZE, (options.chunkBytes + 15) / 16 * 16)),
+          batchChunks(std::max<std::size_t>(2, 2 * pool.size()))
+    {
+        if (chunkBytes > kMaxChunkBytes)
+            throw std::runtime_error("Container chunk size above 1 GiB");
+        if (options.nonce)
+            nonce = *options.nonce;
+        else
+        {
+            std::random_device random;
+            for (std::size_t i = 0; i < nonce.size(); i += 4)
+            {
+                uint32_t r = random();
+                std::memcpy(nonce.data() + i, &r, 4);
+            }
+        }
+
+        // One spare block: the last chunk of the last batch grows by its padding
+        batch = BC::BufferPool::instance().acquire(batchChunks * chunkBytes + BLOCK_SIZE, BC::BufferPool::Use::Sensitive);
+
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            fail("Cannot create", path);
+
+        uint8_t header[kContainerHeaderBytes] = {};
+        std::memcpy(header, kMagic, 8);
+        putU32(header + 8, kVersion);
+        putU32(header + 12, static_cast<uint32_t>(KeyBytes * 8));
+        putU32(header + 16, static_cast<uint32_t>(chunkBytes));
+        std::memcpy(header + 24, nonce.data(), 16);
+        std::memcpy(header + 40, keyCheck(aes, nonce).data(), 8);
+        writeAll(header, sizeof(header));
+        fileOffset = sizeof(header);
+    }
+
+    template <std::size_t KeyBytes>
+    BasicContainerWriter<KeyBytes>::~BasicContainerWriter()
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicContainerWriter<KeyBytes>::writeAll(const uint8_t *data, std::size_t length)
+    {
+        while (length != 0)
+        {
+            ssize_t n = ::write(fd, data, length);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                fail("Cannot write", path);
+            data += n;
+            length -= static_cast<std::size_t>(n);
+        }
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicContainerWriter<KeyBytes>::write(const uint8_t *data, std::size_t length)
+    {
+        if (finished)
+            throw std::runtime_error("Container '" + path + "' is already finished");
+        const std::size_t capacity = batchChunks * chunkBytes;
+        while (length != 0)
+        {
+            // A full batch is only encrypted once more data arrives: the last chunk is padded
+            if (batchUsed == capacity)
+                encryptBatch(false);
+            std::size_t take = std::min(length, capacity - batchUsed);
+            std::memcpy(batch.data() + batchUsed, data, take);
+            batchUsed += take;
+            written += take;
+            data += take;
+            length -= take;
+        }
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicContainerWriter<KeyBytes>::encryptBatch(bool last)
+    {
+        // An empty container still has one (padding-only) chunk
+        std::size_t count = last ? std::max<std::size_t>(1, (batchUsed + chunkBytes - 1) / chunkBytes) : batchChunks;
+        uint64_t first = index.size() / kContainerIndexEntryBytes;
+
+        std::vector<BlockCrypt::Block> ivs(count);
+        deriveIVs(aes, nonce, first, count, ivs.data());
+
+        std::vector<std::size_t> plain(count, chunkBytes), cipher(count, chunkBytes);
+        if (last)
+        {
+            plain.back() = batchUsed - (count - 1) * chunkBytes;
+            cipher.back() = BCPad::paddedLength(plain.back());
+        }
+
+        uint8_t *data = batch.data();
+        pool.parallelFor(count, [&](std::size_t i, std::size_t)
+        {
+            uint8_t *chunk = data + i * chunkBytes;
+            BC::encryptCBC(aes, ivs[i], chunk, plain[i], chunk, cipher[i], last && i + 1 == count);
+        });
+
+        std::size_t total = (count - 1) * chunkBytes + cipher.back();
+        writeAll(data, total);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            uint8_t entry[kContainerIndexEntryBytes];
+            putU64(entry, fileOffset);
+            putU32(entry + 8, static_cast<uint32_t>(cipher[i]));
+            putU32(entry + 12, static_cast<uint32_t>(plain[i]));
+            index.insert(index.end(), entry, entry + sizeof(entry));
+            fileOffset += cipher[i];
+        }
+        batchUsed = 0;
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicContainerWriter<KeyBytes>::finish()
+    {
+        if (finished)
+            return;
+        encryptBatch(true);
+
+        uint8_t trailer[kContainerTrailerBytes];
+        putU64(trailer, fileOffset);
+        putU64(trailer + 8, index.size() / kContainerIndexEntryBytes);
+        putU64(trailer + 16, written);
+        std::memcpy(trailer + 24, kIndexMagic, 8);
+        writeAll(index.data(), index.size());
+        writeAll(trailer, sizeof(trailer));
+
+        finished = true;
+        int closing = fd;
+        fd = -1;
+        if (::close(closing) != 0)
+            fail("Cannot close", path);
+    }
+
+    template <std::size_t KeyBytes>
+    BasicContainerReader<KeyBytes>::BasicContainerReader(const std::string &path, const Cipher &aes)
+        : aes(aes), path(path)
+    {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            fail("Cannot open", path);
+        try
+        {
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+                fail("Cannot stat", path);
+            uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+            if (fileSize < kContainerHeaderBytes + kContainerTrailerBytes)
+                corrupt(path, "too short");
+
+            uint8_t header[kContainerHeaderBytes];
+            preadAll(fd, header, sizeof(header), 0, path);
+            if (std::memcmp(header, kMagic, 8) != 0)
+                corrupt(path, "bad magic");
+            if (getU32(header + 8) != kVersion)
+                corrupt(path, "unsupported version " + std::to_string(getU32(header + 8)));
+            if (getU32(header + 12) != KeyBytes * 8)
+                throw std::runtime_error("Container '" + path + "' was written with AES-" +
+                                         std::to_string(getU32(header + 12)) + ", not AES-" + std::to_string(KeyBytes * 8));
+            chunkBytes = getU32(header + 16);
+            if (chunkBytes == 0 || chunkBytes % BLOCK_SIZE != 0 || chunkBytes > kMaxChunkBytes)
+                corrupt(path, "bad chunk size");
+            std::memcpy(nonce.data(), header + 24, 16);
+            if (std::memcmp(keyCheck(aes, nonce).data(), header + 40, 8) != 0)
+                throw std::runtime_error("Wrong key for container '" + path + "'");
+
+            uint8_t trailer[kContainerTrailerBytes];
+            preadAll(fd, trailer, sizeof(trailer), fileSize - sizeof(trailer), path);
+            if (std::memcmp(trailer + 24, kIndexMagic, 8) != 0)
+                corrupt(path, "no index (unfinished write?)");
+            uint64_t indexOffset = getU64(trailer);
+            uint64_t count = getU64(trailer + 8);
+            plainSize = getU64(trailer + 16);
+            if (count == 0 || count > fileSize / kContainerIndexEntryBytes ||
+                indexOffset + count * kContainerIndexEntryBytes + kContainerTrailerBytes != fileSize)
+                corrupt(path, "bad index position");
+
+            std::vector<uint8_t> raw(count * kContainerIndexEntryBytes);
+            preadAll(fd, raw.data(), raw.size(), indexOffset, path);
+            chunks.resize(count);
+            uint64_t expectOffset = kContainerHeaderBytes, plainTotal = 0;
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                const uint8_t *e = raw.data() + i * kContainerIndexEntryBytes;
+                Chunk &c = chunks[i];
+                c = {getU64(e), getU32(e + 8), getU32(e + 12)};
+                bool lastChunk = i + 1 == count;
+                bool ok = c.offset == expectOffset &&
+                          (lastChunk ? c.plainBytes <= chunkBytes && c.cipherBytes == BCPad::paddedLength(c.plainBytes)
+                                     : c.plainBytes == chunkBytes && c.cipherBytes == chunkBytes);
+                if (!ok)
+                    corrupt(path, "inconsistent index entry " + std::to_string(i));
+                expectOffset += c.cipherBytes;
+                plainTotal += c.plainBytes;
+            }
+            if (expectOffset != indexOffset || plainTotal != plainSize)
+                corrupt(path, "index does not match the data");
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    template <std::size_t KeyBytes>
+    BasicContainerReader<KeyBytes>::~BasicContainerReader()
+    {
+        ::close(fd);
+    }
+
+    template <std::size_t KeyBytes>
+    BlockCrypt::Block BasicContainerReader<KeyBytes>::chunkIV(uint64_t chunk) const
+    {
+        BlockCrypt::Block iv;
+        deriveIVs(aes, nonce, chunk, 1, &iv);
+        return iv;
+    }
+
+    template <std::size_t KeyBytes>
+    std::size_t BasicContainerReader<KeyBytes>::read(uint64_t offset, uint8_t *out, std::size_t length) const
+    {
+        if (offset >= plainSize)
+            return 0;
+        length = static_cast<std::size_t>(std::min<uint64_t>(length, plainSize - offset));
+
+        // Ciphertext of the touched blocks of one chunk plus the block before them
+        BC::PooledBuffer buffer = BC::BufferPool::instance().acquire(
+            std::min(length, chunkBytes) + 2 * BLOCK_SIZE, BC::BufferPool::Use::Sensitive);
+        std::size_t done = 0;
+        while (done < length)
+        {
+            uint64_t pos = offset + done;
+            uint64_t c = pos / chunkBytes;
+            std::size_t start = static_cast<std::size_t>(pos - c * chunkBytes);
+            std::size_t end = std::min<std::size_t>(chunks[c].plainBytes, start + (length - done));
+            std::size_t firstBlock = start / BLOCK_SIZE;
+            std::size_t endBlock = (end + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            std::size_t blocks = endBlock - firstBlock;
+
+            if (buffer.capacity() < (blocks + 1) * BLOCK_SIZE)
+                buffer = BC::BufferPool::instance().acquire((blocks + 1) * BLOCK_SIZE, BC::BufferPool::Use::Sensitive);
+            BlockCrypt::Block iv;
+            uint8_t *cipher = buffer.data() + BLOCK_SIZE;
+            if (firstBlock == 0)
+            {
+                iv = chunkIV(c);
+                preadAll(fd, cipher, blocks * BLOCK_SIZE, chunks[c].offset, path);
+            }
+            else
+            {
+                preadAll(fd, buffer.data(), (blocks + 1) * BLOCK_SIZE, chunks[c].offset + (firstBlock - 1) * BLOCK_SIZE, path);
+                std::memcpy(iv.data(), buffer.data(), BLOCK_SIZE);
+            }
+            BC::decryptCBC(aes, iv, cipher, blocks * BLOCK_SIZE, cipher, blocks * BLOCK_SIZE, false);
+
+            std::memcpy(out + done, cipher + (start - firstBlock * BLOCK_SIZE), end - start);
+            done += end - start;
+        }
+        return length;
+    }
+
+    template <std::size_t KeyBytes>
+    std::size_t BasicContainerReader<KeyBytes>::read(uint8_t *out, std::size_t length)
+    {
+        std::size_t n = read(position, out, length);
+        position += n;
+        return n;
+    }
+
+    template <std::size_t KeyBytes>
+    void BasicContainerReader<KeyBytes>::decryptTo(const std::string &outPath, BC::ThreadPool &pool) const
+    {
+        if (sameFile(path, outPath))
+            throw std::runtime_error("Input and output are the same file");
+        MappedFile in = MappedFile::openRead(path);
+        MappedFile out = MappedFile::createReplacing(outPath, static_cast<std::size_t>(plainSize));
+
+        pool.parallelFor(chunks.size(), [&](std::size_t i, std::size_t)
+        {
+            const Chunk &c = chunks[i];
+            bool lastChunk = i + 1 == chunks.size();
+            std::size_t n = BC::decryptCBC(aes, chunkIV(i), in.data() + c.offset, c.cipherBytes,
+                                           out.data() + i * chunkBytes, c.plainBytes, lastChunk);
+            if (n != c.plainBytes)
+                throw std::runtime_error("Padding of '" + path + "' does not match its index");
+        });
+        out.close(static_cast<std::size_t>(plainSize));
+    }
+
+    bool isContainer(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        char magic[8];
+        bool match = ::pread(fd, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic)) &&
+                     std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+        ::close(fd);
+        return match;
+    }
+
+    template class BasicContainerWriter<16>;
+    template class BasicContainerWriter<24>;
+    template class BasicContainerWriter<32>;
+    template class BasicContainerReader<16>;
+    template class BasicContainerReader<24>;
+    template class BasicContainerReader<32>;
+} // namespace BCFile
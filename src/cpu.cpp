@@ -0,0 +1,47 @@
+#include "../include/cpu.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace BCCpu // BlockCrypt CPU feature detection
+{
+    namespace
+    {
+        Features detect()
+        {
+            Features f;
+#if defined(__x86_64__) || defined(__i386__)
+            unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+                return f;
+
+            f.sse2 = (edx & bit_SSE2) != 0;
+            f.ssse3 = (ecx & bit_SSSE3) != 0;
+            f.aesni = (ecx & bit_AES) != 0;
+            f.pclmul = (ecx & bit_PCLMUL) != 0;
+
+            // AVX2 needs both the CPUID bit and the OS saving the YMM state (XCR0 bits 1 and 2)
+            bool osxsave = (ecx & bit_OSXSAVE) != 0;
+            bool avx = (ecx & bit_AVX) != 0;
+            if (osxsave && avx && __get_cpuid_max(0, nullptr) >= 7)
+            {
+                unsigned int xcr0Lo = 0, xcr0Hi = 0;
+                __asm__ volatile("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+                if ((xcr0Lo & 0x6) == 0x6)
+                {
+                    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+                    f.avx2 = (ebx & bit_AVX2) != 0;
+                }
+            }
+#endif
+            return f;
+        }
+    } // namespace
+
+    const Features &features()
+    {
+        static const Features cached = detect();
+        return cached;
+    }
+} // namespace BCCpu
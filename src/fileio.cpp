@@ -0,0 +1,520 @@
+#include "../include/fileio.hpp"
+#include "../include/CBC.hpp"
+#include "../include/bufferpool.hpp"
+#include "../include/padding.hpp"
+#include "../include/stats.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace BCFile
+{
+    namespace
+    {
+        [[noreturn]] void fail(const std::string &what, const std::string &path)
+        {
+            throw std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+        }
+
+        int openOrFail(const std::string &path, int flags)
+        {
+            int fd = ::open(path.c_str(), flags, 0644);
+            if (fd < 0)
+                fail("Cannot open", path);
+            return fd;
+        }
+
+        std::size_t fileSize(int fd, const std::string &path)
+        {
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+                fail("Cannot stat", path);
+            return static_cast<std::size_t>(st.st_size);
+        }
+
+        void resizeOrFail(int fd, std::size_t size, const std::string &path)
+        {
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                int saved = errno;
+                ::close(fd);
+                errno = saved;
+                fail("Cannot resize", path);
+            }
+        }
+
+        std::size_t paddedSize(std::size_t size)
+        {
+            return size + (BLOCK_SIZE - size % BLOCK_SIZE);
+        }
+
+        constexpr std::size_t kRangeWindowBytes = 1 << 20; // ciphertext per pread in decryptFileCBCRange
+
+        void preadAll(int fd, uint8_t *out, std::size_t length, uint64_t offset, const std::string &path)
+        {
+            while (length != 0)
+            {
+                ssize_t n = ::pread(fd, out, length, static_cast<off_t>(offset));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                    fail("Cannot read", path);
+                if (n == 0)
+                    throw std::runtime_error("Unexpected end of file '" + path + "'");
+                out += n;
+                offset += static_cast<uint64_t>(n);
+                length -= static_cast<std::size_t>(n);
+            }
+        }
+
+        std::size_t cipherFileSize(int fd, const std::string &path)
+        {
+            std::size_t size = fileSize(fd, path);
+            if (size == 0 || size % BLOCK_SIZE != 0)
+                throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+            return size;
+        }
+
+        // `size` is the file's (validated) length; `window` is grown as needed and kept by the caller
+        std::size_t decryptRange(int fd, const std::string &path, std::size_t size, BC::PooledBuffer &window,
+                                 const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                                 uint64_t offset, uint8_t *out, std::size_t length)
+        {
+            if (offset >= size)
+                return 0;
+            std::size_t begin = static_cast<std::size_t>(offset);
+            std::size_t end = begin + std::min(length, size - begin);
+
+            // Each window holds the blocks covering up to kRangeWindowBytes of the range plus
+            // the ciphertext block in front of them, which is the window's chaining value
+            std::size_t windowBytes = std::min(end - begin, kRangeWindowBytes) + 3 * BLOCK_SIZE;
+            if (window.capacity() < windowBytes)
+                window = BC::BufferPool::instance().acquire(windowBytes, BC::BufferPool::Use::Sensitive);
+            std::size_t pos = begin;
+            while (pos < end)
+            {
+                std::size_t pieceEnd = std::min(end, pos + kRangeWindowBytes);
+                std::size_t firstBlock = pos / BLOCK_SIZE;
+                std::size_t endBlock = (pieceEnd + BLOCK_SIZE - 1) / BLOCK_SIZE;
+                std::size_t readFrom = firstBlock == 0 ? 0 : firstBlock - 1;
+
+                BCStats::PhaseTimer read(BCStats::Phase::Read, (endBlock - readFrom) * BLOCK_SIZE);
+                preadAll(fd, window.data(), (endBlock - readFrom) * BLOCK_SIZE, readFrom * BLOCK_SIZE, path);
+                read.stop();
+
+                BlockCrypt::Block chain = iv;
+                const uint8_t *cipher = window.data();
+                if (firstBlock != 0)
+                {
+                    std::memcpy(chain.data(), window.data(), BLOCK_SIZE);
+                    cipher += BLOCK_SIZE;
+                }
+                bool last = endBlock == size / BLOCK_SIZE;
+                std::size_t n = BC::decryptCBCRange(aes, chain, cipher, (endBlock - firstBlock) * BLOCK_SIZE,
+                                                    pos - firstBlock * BLOCK_SIZE, out + (pos - begin), pieceEnd - pos, last);
+                pos += n;
+                if (last)
+                    break; // the padding may have cut the range short
+            }
+            return pos - begin;
+        }
+    } // namespace
+
+    MappedFile::MappedFile(int fd, std::size_t size, bool writable, const MapOptions &options, const std::string &path)
+        : fd(fd), length(size)
+    {
+        if (size == 0)
+            return; // mmap rejects empty mappings; nothing to map anyway
+
+        int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void *p = ::mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            int saved = errno;
+            ::close(fd);
+            errno = saved;
+            fail("Cannot map", path);
+        }
+        base = static_cast<uint8_t *>(p);
+
+        // Advice is a hint: failures (e.g. no THP support for this filesystem) are harmless
+        ::madvise(p, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        if (options.hugePages)
+            ::madvise(p, size, MADV_HUGEPAGE);
+#else
+        (void)options;
+#endif
+    }
+
+    MappedFile MappedFile::openRead(const std::string &path, const MapOptions &options)
+    {
+        int fd = openOrFail(path, O_RDONLY);
+        return MappedFile(fd, fileSize(fd, path), false, options, path);
+    }
+
+    MappedFile MappedFile::create(const std::string &path, std::size_t size, const MapOptions &options)
+    {
+        int fd = openOrFail(path, O_RDWR | O_CREAT | O_TRUNC);
+        resizeOrFail(fd, size, path);
+        return MappedFile(fd, size, true, options, path);
+    }
+
+    MappedFile MappedFile::openReadWrite(const std::string &path, std::size_t size, const MapOptions &options)
+    {
+        int fd = openOrFail(path, O_RDWR);
+        resizeOrFail(fd, size, path);
+        return MappedFile(fd, size, true, options, path);
+    }
+
+    MappedFile MappedFile::createReplacing(const std::string &path, std::size_t size, const MapOptions &options)
+    {
+        std::string target = replacementTarget(path);
+        std::string temp = temporaryPathFor(target);
+        int fd = ::open(temp.c_str(), O_RDWR);
+        if (fd < 0)
+        {
+            int saved = errno;
+            ::unlink(temp.c_str());
+            errno = saved;
+            fail("Cannot open", temp);
+        }
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            int saved = errno;
+            ::close(fd);
+            ::unlink(temp.c_str());
+            errno = saved;
+            fail("Cannot resize", temp);
+        }
+        try
+        {
+            MappedFile file(fd, size, true, options, temp);
+            file.tempPath = temp;
+            file.finalPath = target;
+            return file;
+        }
+        catch (...)
+        {
+            ::unlink(temp.c_str()); // the constructor closed fd
+            throw;
+        }
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : fd(other.fd), base(other.base), length(other.length), tempPath(std::move(other.tempPath)),
+          finalPath(std::move(other.finalPath))
+    {
+        other.fd = -1;
+        other.base = nullptr;
+        other.length = 0;
+        other.tempPath.clear();
+    }
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            fd = other.fd;
+            base = other.base;
+            length = other.length;
+            tempPath = std::move(other.tempPath);
+            finalPath = std::move(other.finalPath);
+            other.fd = -1;
+            other.base = nullptr;
+            other.length = 0;
+            other.tempPath.clear();
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        release();
+    }
+
+    void MappedFile::release() noexcept
+    {
+        if (base != nullptr)
+            ::munmap(base, length);
+        if (fd >= 0)
+            ::close(fd);
+        if (!tempPath.empty())
+            ::unlink(tempPath.c_str()); // never committed
+        base = nullptr;
+        fd = -1;
+        length = 0;
+        tempPath.clear();
+    }
+
+    void MappedFile::close(std::size_t finalSize)
+    {
+        if (base != nullptr)
+            ::munmap(base, length);
+        base = nullptr;
+        if (fd >= 0 && finalSize != length && ::ftruncate(fd, static_cast<off_t>(finalSize)) != 0)
+        {
+            int saved = errno;
+            release();
+            errno = saved;
+            throw std::runtime_error(std::string("Cannot truncate output: ") + std::strerror(errno));
+        }
+        if (!tempPath.empty())
+        {
+            if (::rename(tempPath.c_str(), finalPath.c_str()) != 0)
+            {
+                int saved = errno;
+                release();
+                errno = saved;
+                fail("Cannot replace", finalPath);
+            }
+            tempPath.clear();
+        }
+        release();
+    }
+
+    std::string replacementTarget(const std::string &path)
+    {
+        std::string target = path;
+        if (char *real = ::realpath(path.c_str(), nullptr)) // fails for a new file: path as given
+        {
+            target = real;
+            std::free(real);
+        }
+        return target;
+    }
+
+    std::string temporaryPathFor(const std::string &target)
+    {
+        struct stat st;
+        bool exists = ::stat(target.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+
+        static std::atomic<unsigned> counter{0};
+        for (int attempt = 0;; ++attempt)
+        {
+            std::string temp = target + ".tmp-" + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+            int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                if (errno == EEXIST && attempt < 100)
+                    continue;
+                fail("Cannot create", temp);
+            }
+            if (exists)
+                ::fchmod(fd, st.st_mode & 07777);
+            ::close(fd);
+            return temp;
+        }
+    }
+
+    bool isRegularFile(const std::string &path)
+    {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+
+    bool sameFile(const std::string &a, const std::string &b)
+    {
+        struct stat sa, sb;
+        return ::stat(a.c_str(), &sa) == 0 && ::stat(b.c_str(), &sb) == 0 &&
+               sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+    }
+
+    void encryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                        const BlockCrypt::Block &iv, const MapOptions &options)
+    {
+        encryptFileCBC(inPath, outPath, BlockCrypt(key), iv, options);
+    }
+
+    void encryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                        const BlockCrypt::Block &iv, const MapOptions &options)
+    {
+        if (sameFile(inPath, outPath))
+            throw std::runtime_error("Input and output are the same file; use in-place mode");
+
+        // Page-ins of the mappings happen during the cipher phase
+        BCStats::PhaseTimer read(BCStats::Phase::Read);
+        MappedFile in = MappedFile::openRead(inPath, options);
+        MappedFile out = MappedFile::create(outPath, paddedSize(in.size()), options);
+        read.setBytes(in.size());
+        read.stop();
+
+        BCStats::PhaseTimer cipher(BCStats::Phase::Cipher, in.size());
+        BC::CBCEncryptor enc(aes, iv);
+        std::size_t written = enc.update(in.data(), in.size(), out.data());
+        written += enc.final(out.data() + written);
+        cipher.stop();
+
+        BCStats::PhaseTimer write(BCStats::Phase::Write, written);
+        out.close(written);
+    }
+
+    void decryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                        const BlockCrypt::Block &iv, const MapOptions &options)
+    {
+        decryptFileCBC(inPath, outPath, BlockCrypt(key), iv, options);
+    }
+
+    void decryptFileCBC(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                        const BlockCrypt::Block &iv, const MapOptions &options)
+    {
+        if (sameFile(inPath, outPath))
+            throw std::runtime_error("Input and output are the same file; use in-place mode");
+
+        BCStats::PhaseTimer read(BCStats::Phase::Read);
+        MappedFile in = MappedFile::openRead(inPath, options);
+        if (in.size() == 0 || in.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+
+        // Pre-size to the ciphertext length, trim to the plaintext length at the end. The
+        // decryptor holds back the last block, so out has room for update()'s output. Nothing
+        // replaces outPath until final() has accepted the padding.
+        MappedFile out = MappedFile::createReplacing(outPath, in.size(), options);
+        read.setBytes(in.size());
+        read.stop();
+
+        BCStats::PhaseTimer cipher(BCStats::Phase::Cipher, in.size());
+        BC::CBCDecryptor dec(aes, iv);
+        std::size_t written = dec.update(in.data(), in.size(), out.data());
+        written += dec.final(out.data() + written);
+        cipher.stop();
+
+        BCStats::PhaseTimer write(BCStats::Phase::Write, written);
+        out.close(written);
+    }
+
+    void encryptFileCBCInPlace(const std::string &path, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                               const MapOptions &options)
+    {
+        encryptFileCBCInPlace(path, BlockCrypt(key), iv, options);
+    }
+
+    void encryptFileCBCInPlace(const std::string &path, const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                               const MapOptions &options)
+    {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0)
+            fail("Cannot stat", path);
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+
+        // Grow to the padded length first; CBC encryption only ever reads ahead of what it writes
+        BCStats::PhaseTimer read(BCStats::Phase::Read, size);
+        MappedFile file = MappedFile::openReadWrite(path, paddedSize(size), options);
+        read.stop();
+
+        BCStats::PhaseTimer cipher(BCStats::Phase::Cipher, size);
+        BC::CBCEncryptor enc(aes, iv);
+        std::size_t written = enc.update(file.data(), size, file.data());
+        written += enc.final(file.data() + written);
+        cipher.stop();
+
+        BCStats::PhaseTimer write(BCStats::Phase::Write, written);
+        file.close(written);
+    }
+
+    void decryptFileCBCInPlace(const std::string &path, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                               const MapOptions &options)
+    {
+        decryptFileCBCInPlace(path, BlockCrypt(key), iv, options);
+    }
+
+    void decryptFileCBCInPlace(const std::string &path, const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                               const MapOptions &options)
+    {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0)
+            fail("Cannot stat", path);
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        if (size == 0 || size % BLOCK_SIZE != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+
+        BCStats::PhaseTimer read(BCStats::Phase::Read, size);
+        MappedFile file = MappedFile::openReadWrite(path, size, options);
+        read.stop();
+
+        // Check the padding of the last block before overwriting anything
+        {
+            BlockCrypt::Block prev = iv;
+            if (size >= 2 * BLOCK_SIZE)
+                std::memcpy(prev.data(), file.data() + size - 2 * BLOCK_SIZE, BLOCK_SIZE);
+            BC::CBCDecryptor probe(aes, prev);
+            std::vector<uint8_t> last(file.data() + size - BLOCK_SIZE, file.data() + size);
+            std::vector<uint8_t> plain;
+            probe.update(last, plain);
+            probe.final(plain); // throws on corrupt padding
+        }
+
+        BCStats::PhaseTimer cipher(BCStats::Phase::Cipher, size);
+        BC::CBCDecryptor dec(aes, iv);
+        std::size_t written = dec.update(file.data(), size, file.data());
+        written += dec.final(file.data() + written);
+        cipher.stop();
+
+        BCStats::PhaseTimer write(BCStats::Phase::Write, written);
+        file.close(written);
+    }
+
+    std::size_t decryptFileCBCRange(const std::string &inPath, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                                    uint64_t offset, uint8_t *out, std::size_t length)
+    {
+        return decryptFileCBCRange(inPath, BlockCrypt(key), iv, offset, out, length);
+    }
+
+    std::size_t decryptFileCBCRange(const std::string &inPath, const BlockCrypt &aes, const BlockCrypt::Block &iv,
+                                    uint64_t offset, uint8_t *out, std::size_t length)
+    {
+        int fd = openOrFail(inPath, O_RDONLY);
+        try
+        {
+            BC::PooledBuffer window;
+            std::size_t n = decryptRange(fd, inPath, cipherFileSize(fd, inPath), window, aes, iv, offset, out, length);
+            ::close(fd);
+            return n;
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    CBCRangeReader::CBCRangeReader(const std::string &path, const BlockCrypt &aes, const BlockCrypt::Block &iv)
+        : aes(aes), iv(iv), path(path), fd(openOrFail(path, O_RDONLY))
+    {
+        try
+        {
+            cipherSize = cipherFileSize(fd, path);
+            // Decrypting the final block checks the padding and yields the plaintext length
+            uint8_t tail[BLOCK_SIZE];
+            std::size_t last = cipherSize - BLOCK_SIZE;
+            plainSize = last + decryptRange(fd, path, cipherSize, window, aes, iv, last, tail, BLOCK_SIZE);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    CBCRangeReader::~CBCRangeReader()
+    {
+        ::close(fd);
+    }
+
+    std::size_t CBCRangeReader::read(uint64_t offset, uint8_t *out, std::size_t length)
+    {
+        if (offset >= plainSize)
+            return 0;
+        length = static_cast<std::size_t>(std::min<uint64_t>(length, plainSize - offset));
+        return decryptRange(fd, path, cipherSize, window, aes, iv, offset, out, length);
+    }
+} // namespace BCFile
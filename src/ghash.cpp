@@ -0,0 +1,128 @@
+#include "ghash.hpp"
+#include "aes_kernels.hpp"
+#include "../include/cpu.hpp"
+#include <algorithm>
+
+namespace BC
+{
+    namespace detail
+    {
+        namespace
+        {
+            inline uint64_t loadBE64(const uint8_t *p)
+            {
+                uint64_t v = 0;
+                for (int i = 0; i < 8; ++i)
+                    v = (v << 8) | p[i];
+                return v;
+            }
+
+            inline void storeBE64(uint8_t *p, uint64_t v)
+            {
+                for (int i = 7; i >= 0; --i)
+                {
+                    p[i] = static_cast<uint8_t>(v);
+                    v >>= 8;
+                }
+            }
+
+            // Reduction of the 4 bits shifted out of the low end per step, pre-multiplied by R
+            constexpr uint64_t kLast4[16] = {
+                0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+                0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+        } // namespace
+
+        GHash::GHash(const BlockCrypt::Block &h, bool allowClmul)
+        {
+#ifdef BLOCKCRYPT_HAVE_PCLMUL
+            clmul = allowClmul && BCCpu::features().pclmul && BCCpu::features().ssse3;
+            if (clmul)
+                BCKernel::ghashClmulInit(h.data(), hPowers);
+#else
+            (void)allowClmul;
+            clmul = false;
+#endif
+
+            // Table for the fallback: entry 8 is H, entries 4, 2, 1 are H*x, H*x^2, H*x^3 (GCM's
+            // bit order is reflected, so "times x" is a right shift), the rest are XOR sums.
+            uint64_t hi = loadBE64(h.data());
+            uint64_t lo = loadBE64(h.data() + 8);
+            hTableHi[0] = hTableLo[0] = 0;
+            hTableHi[8] = hi;
+            hTableLo[8] = lo;
+            for (int i = 4; i > 0; i >>= 1)
+            {
+                uint64_t reduce = (lo & 1) ? 0xe100000000000000ULL : 0;
+                lo = (hi << 63) | (lo >> 1);
+                hi = (hi >> 1) ^ reduce;
+                hTableHi[i] = hi;
+                hTableLo[i] = lo;
+            }
+            for (int i = 2; i <= 8; i *= 2)
+            {
+                for (int j = 1; j < i; ++j)
+                {
+                    hTableHi[i + j] = hTableHi[i] ^ hTableHi[j];
+                    hTableLo[i + j] = hTableLo[i] ^ hTableLo[j];
+                }
+            }
+        }
+
+        void GHash::multiplyH()
+        {
+            // Horner over the 32 nibbles from the last one: shift Z by 4 bits (reducing the bits
+            // that fall off), then add nibble * H from the table
+            uint64_t zh = 0, zl = 0;
+            for (int i = 15; i >= 0; --i)
+            {
+                for (int nibble : {state[i] & 0xf, state[i] >> 4})
+                {
+                    uint64_t rem = zl & 0xf;
+                    zl = (zh << 60) | (zl >> 4);
+                    zh = (zh >> 4) ^ (kLast4[rem] << 48);
+                    zh ^= hTableHi[nibble];
+                    zl ^= hTableLo[nibble];
+                }
+            }
+            storeBE64(state.data(), zh);
+            storeBE64(state.data() + 8, zl);
+        }
+
+        void GHash::absorb(const uint8_t *data, std::size_t blocks)
+        {
+#ifdef BLOCKCRYPT_HAVE_PCLMUL
+            if (clmul)
+            {
+                BCKernel::ghashClmul(state.data(), hPowers, data, blocks);
+                return;
+            }
+#endif
+            for (std::size_t b = 0; b < blocks; ++b, data += 16)
+            {
+                for (int i = 0; i < 16; ++i)
+                    state[i] ^= data[i];
+                multiplyH();
+            }
+        }
+
+        void GHash::update(const uint8_t *data, std::size_t length)
+        {
+            absorb(data, length / 16);
+            std::size_t tail = length % 16;
+            if (tail != 0)
+            {
+                uint8_t last[16] = {};
+                std::copy_n(data + length - tail, tail, last);
+                absorb(last, 1);
+            }
+        }
+
+        void GHash::lengths(uint64_t aadBytes, uint64_t textBytes)
+        {
+            uint8_t block[16];
+            storeBE64(block, aadBytes * 8);
+            storeBE64(block + 8, textBytes * 8);
+            absorb(block, 1);
+        }
+    } // namespace detail
+} // namespace BC
@@ -0,0 +1,47 @@
+#pragma once
+
+// Internal GHASH (the GCM authenticator) with a PCLMULQDQ kernel and a portable fallback.
+
+#include <cstddef>
+#include <cstdint>
+#include "../include/blockcrypt.hpp"
+
+namespace BC
+{
+    namespace detail
+    {
+        class GHash
+        {
+        public:
+            /**
+             * @param h The hash subkey H = E_K(0^128).
+             * @param allowClmul Use the PCLMULQDQ kernel when the CPU has it; false forces the
+             *                   portable table (GCM does so for the software AES backends).
+             */
+            explicit GHash(const BlockCrypt::Block &h, bool allowClmul = true);
+
+            /**
+             * Absorbs `length` bytes. Only the last call before lengths() may pass a length that
+             * is not a multiple of 16; the partial block is zero padded as GCM specifies.
+             */
+            void update(const uint8_t *data, std::size_t length);
+
+            // Absorbs the final len(A) || len(C) block (lengths in bytes, encoded in bits)
+            void lengths(uint64_t aadBytes, uint64_t textBytes);
+
+            void reset() { state = {}; }
+            const BlockCrypt::Block &digest() const { return state; }
+            bool usesClmul() const { return clmul; }
+
+        private:
+            void absorb(const uint8_t *data, std::size_t blocks);
+            void multiplyH(); // state = state * H with the 4-bit tables
+
+            BlockCrypt::Block state{};
+            bool clmul;
+            alignas(16) uint8_t hPowers[8 * 16]; // PCLMULQDQ: H^1..H^8
+            uint64_t hTableHi[16];               // portable: i*H for every 4-bit i (Shoup's method)
+            uint64_t hTableLo[16];
+        };
+    } // namespace detail
+} // namespace BC
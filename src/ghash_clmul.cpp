@@ -0,0 +1,124 @@
+#include "aes_kernels.hpp"
+
+#ifdef BLOCKCRYPT_HAVE_PCLMUL
+#include <wmmintrin.h> // PCLMULQDQ
+#include <tmmintrin.h> // SSSE3 (PSHUFB)
+
+namespace BCKernel
+{
+    namespace
+    {
+        // GHASH is defined on bit-reflected values. Byte-swapping each block turns that into
+        // plain polynomial order up to a one-bit shift, which reduce() folds in (Gueron &
+        // Kounavis, "Intel Carry-Less Multiplication Instruction and its Usage for Computing
+        // the GCM Mode").
+        inline __m128i byteSwap(__m128i x)
+        {
+            const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            return _mm_shuffle_epi8(x, mask);
+        }
+
+        inline __m128i load(const uint8_t *p)
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        }
+
+        inline void store(uint8_t *p, __m128i v)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+        }
+
+        // Unreduced 256-bit carry-less product a*b, accumulated into hi:lo. Products of
+        // several blocks can be summed this way and reduced once (aggregated reduction).
+        inline void mulAccumulate(__m128i a, __m128i b, __m128i &lo, __m128i &hi)
+        {
+            __m128i l = _mm_clmulepi64_si128(a, b, 0x00);
+            __m128i h = _mm_clmulepi64_si128(a, b, 0x11);
+            __m128i m = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+            lo = _mm_xor_si128(lo, _mm_xor_si128(l, _mm_slli_si128(m, 8)));
+            hi = _mm_xor_si128(hi, _mm_xor_si128(h, _mm_srli_si128(m, 8)));
+        }
+
+        // Shifts hi:lo left by one bit (undoing the reflection) and reduces modulo
+        // x^128 + x^7 + x^2 + x + 1
+        inline __m128i reduce(__m128i lo, __m128i hi)
+        {
+            __m128i carryLo = _mm_srli_epi32(lo, 31);
+            __m128i carryHi = _mm_srli_epi32(hi, 31);
+            lo = _mm_slli_epi32(lo, 1);
+            hi = _mm_slli_epi32(hi, 1);
+            __m128i cross = _mm_srli_si128(carryLo, 12);
+            carryHi = _mm_slli_si128(carryHi, 4);
+            carryLo = _mm_slli_si128(carryLo, 4);
+            lo = _mm_or_si128(lo, carryLo);
+            hi = _mm_or_si128(_mm_or_si128(hi, carryHi), cross);
+
+            __m128i a = _mm_slli_epi32(lo, 31);
+            __m128i b = _mm_slli_epi32(lo, 30);
+            __m128i c = _mm_slli_epi32(lo, 25);
+            a = _mm_xor_si128(_mm_xor_si128(a, b), c);
+            __m128i spill = _mm_srli_si128(a, 4);
+            lo = _mm_xor_si128(lo, _mm_slli_si128(a, 12));
+
+            __m128i d = _mm_srli_epi32(lo, 1);
+            __m128i e = _mm_srli_epi32(lo, 2);
+            __m128i f = _mm_srli_epi32(lo, 7);
+            d = _mm_xor_si128(_mm_xor_si128(d, e), _mm_xor_si128(f, spill));
+            return _mm_xor_si128(hi, _mm_xor_si128(lo, d));
+        }
+
+        inline __m128i multiply(__m128i a, __m128i b)
+        {
+            __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+            mulAccumulate(a, b, lo, hi);
+            return reduce(lo, hi);
+        }
+    } // namespace
+
+    void ghashClmulInit(const uint8_t *h, uint8_t *hPowers)
+    {
+        __m128i h1 = byteSwap(load(h));
+        __m128i p = h1;
+        store(hPowers, p);
+        for (int i = 1; i < kGhashPowers; ++i)
+        {
+            p = multiply(p, h1);
+            store(hPowers + i * 16, p);
+        }
+    }
+
+    void ghashClmul(uint8_t *state, const uint8_t *hPowers, const uint8_t *data, std::size_t blocks)
+    {
+        __m128i x = byteSwap(load(state));
+
+        // Eight blocks per step: X' = (X ^ C0)*H^8 ^ C1*H^7 ^ ... ^ C7*H, one reduction for all
+        __m128i hp[kGhashPowers];
+        for (int i = 0; i < kGhashPowers; ++i)
+        {
+            hp[i] = load(hPowers + i * 16);
+        }
+
+        for (; blocks >= 8; blocks -= 8, data += 128)
+        {
+            __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+            mulAccumulate(_mm_xor_si128(x, byteSwap(load(data))), hp[7], lo, hi);
+            mulAccumulate(byteSwap(load(data + 16)), hp[6], lo, hi);
+            mulAccumulate(byteSwap(load(data + 32)), hp[5], lo, hi);
+            mulAccumulate(byteSwap(load(data + 48)), hp[4], lo, hi);
+            mulAccumulate(byteSwap(load(data + 64)), hp[3], lo, hi);
+            mulAccumulate(byteSwap(load(data + 80)), hp[2], lo, hi);
+            mulAccumulate(byteSwap(load(data + 96)), hp[1], lo, hi);
+            mulAccumulate(byteSwap(load(data + 112)), hp[0], lo, hi);
+            x = reduce(lo, hi);
+        }
+
+        for (; blocks > 0; --blocks, data += 16)
+        {
+            x = multiply(_mm_xor_si128(x, byteSwap(load(data))), hp[0]);
+        }
+
+        store(state, byteSwap(x));
+    }
+} // namespace BCKernel
+
+#endif // BLOCKCRYPT_HAVE_PCLMUL
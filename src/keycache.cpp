@@ -0,0 +1,103 @@
+#include "../include/keycache.hpp"
+#include <cstring>
+
+namespace BC
+{
+    std::size_t KeyCache::KeyHash::operator()(const BlockCrypt::Key &key) const
+    {
+        // Fold the two 64-bit halves and finish with a multiplicative mix; keys are
+        // effectively random bytes, so this spreads them evenly over shards and buckets
+        uint64_t a, b;
+        std::memcpy(&a, key.data(), 8);
+        std::memcpy(&b, key.data() + 8, 8);
+        uint64_t h = (a ^ (b * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    KeyCache::KeyCache(std::size_t capacity, std::size_t shards, BlockCrypt::Backend backend)
+        : shardCount(shards == 0 ? 1 : shards), backend(backend)
+    {
+        this->shards.reset(new Shard[shardCount]);
+        shardCapacity = (capacity + shardCount - 1) / shardCount;
+        if (shardCapacity == 0)
+            shardCapacity = 1;
+    }
+
+    KeyCache::Shard &KeyCache::shardFor(const BlockCrypt::Key &key)
+    {
+        std::size_t hash = KeyHash()(key);
+        // The low bits pick the hash bucket inside the shard; use the high bits for the shard
+        return shards[(hash >> 16) % shardCount];
+    }
+
+    std::shared_ptr<const BlockCrypt> KeyCache::get(const BlockCrypt::Key &key)
+    {
+        Shard &shard = shardFor(key);
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end())
+            {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second->second;
+            }
+        }
+
+        // Expand outside the lock so other lookups on this shard are not held up
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        auto aes = std::make_shared<const BlockCrypt>(key, backend);
+
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            // Another thread inserted the same key meanwhile; keep its entry
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return it->second->second;
+        }
+
+        if (shard.lru.size() >= shardCapacity)
+        {
+            shard.index.erase(shard.lru.back().first);
+            shard.lru.pop_back();
+            shard.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.lru.emplace_front(key, aes);
+        shard.index.emplace(key, shard.lru.begin());
+        return aes;
+    }
+
+    KeyCache::Stats KeyCache::stats() const
+    {
+        Stats total;
+        for (std::size_t i = 0; i < shardCount; ++i)
+        {
+            total.hits += shards[i].hits.load(std::memory_order_relaxed);
+            total.misses += shards[i].misses.load(std::memory_order_relaxed);
+            total.evictions += shards[i].evictions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::size_t KeyCache::size() const
+    {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < shardCount; ++i)
+        {
+            std::lock_guard<std::mutex> guard(shards[i].lock);
+            total += shards[i].lru.size();
+        }
+        return total;
+    }
+
+    void KeyCache::clear()
+    {
+        for (std::size_t i = 0; i < shardCount; ++i)
+        {
+            std::lock_guard<std::mutex> guard(shards[i].lock);
+            shards[i].index.clear();
+            shards[i].lru.clear();
+        }
+    }
+} // namespace BC
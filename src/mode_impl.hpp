@@ -0,0 +1,42 @@
+#pragma once
+
+// Internal building blocks shared by the serial and parallel mode implementations.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "../include/blockcrypt.hpp"
+
+namespace BC
+{
+    namespace detail
+    {
+        // dst[i] = a[i] ^ b[i]. Written as a flat loop over 64-bit words so the compiler turns
+        // it into a vector pass (memcpy keeps it alignment-safe); dst may alias a or b.
+        inline void xorBytes(uint8_t *dst, const uint8_t *a, const uint8_t *b, std::size_t bytes)
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= bytes; i += 8)
+            {
+                uint64_t x, y;
+                std::memcpy(&x, a + i, 8);
+                std::memcpy(&y, b + i, 8);
+                x ^= y;
+                std::memcpy(dst + i, &x, 8);
+            }
+            for (; i < bytes; ++i)
+            {
+                dst[i] = a[i] ^ b[i];
+            }
+        }
+
+        /**
+         * Decrypts `blocks` CBC blocks of `data` in place. `prev` holds the IV (or the
+         * ciphertext block preceding `data`) on entry and the last ciphertext block on return,
+         * so consecutive calls chain like one long message.
+         */
+        template <std::size_t KeyBytes>
+        void decryptCBCInPlace(const BasicBlockCrypt<KeyBytes> &aes, uint8_t *data, std::size_t blocks,
+                               BlockCrypt::Block &prev, std::size_t lanes);
+    } // namespace detail
+} // namespace BC
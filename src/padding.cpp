@@ -1,34 +1,49 @@
 #include "../include/padding.hpp"
+#include "stats_impl.hpp"
+#include <cstring>
 #include <stdexcept>
 
 namespace BCPad // BlockCrypt Padding
 {
     void addPKCS7(std::vector<uint8_t> &buf, std::size_t blk)
     {
+        // One resize instead of a push_back per byte: at most one reallocation
         std::size_t missing = blk - (buf.size() % blk);
-        if (missing == 0)
-            missing = blk;
-
-        for (std::size_t i = 0; i < missing; i++)
-        {
-            buf.push_back(static_cast<uint8_t>(missing));
-        };
+        buf.resize(buf.size() + missing, static_cast<uint8_t>(missing));
     }
 
     void removePKCS7(std::vector<uint8_t> &buf, std::size_t blk)
     {
-        if (buf.empty())
+        buf.resize(unpaddedLength(buf.data(), buf.size(), blk));
+    }
+
+    std::size_t writePKCS7(uint8_t *block, std::size_t used, std::size_t blk)
+    {
+        std::size_t missing = blk - used;
+        std::memset(block + used, static_cast<int>(missing), missing);
+        return missing;
+    }
+
+    std::size_t unpaddedLength(const uint8_t *data, std::size_t length, std::size_t blk)
+    {
+        if (length == 0)
             throw std::runtime_error("Tried to remove PCKS7 padding from an Empty Buffer");
 
-        uint8_t pad = buf.back();
-        if (pad == 0 || pad > blk)
+        uint8_t pad = data[length - 1];
+        if (pad == 0 || pad > blk || pad > length)
+        {
+            BCStats::detail::countPaddingError();
             throw std::runtime_error("Error while removing padding. Padding corrupt");
+        }
 
         for (std::size_t i = 0; i < pad; i++)
         {
-            if (buf[buf.size() - i - 1] != pad)
+            if (data[length - i - 1] != pad)
+            {
+                BCStats::detail::countPaddingError();
                 throw std::runtime_error("Error while removing padding. Padding corrupt");
+            }
         }
-        buf.resize(buf.size() - pad);
+        return length - pad;
     }
 } // namespace BCPad
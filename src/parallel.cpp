@@ -0,0 +1,129 @@
+#include "../include/parallel.hpp"
+#include "../include/padding.hpp"
+#include "../include/CTR.hpp"
+#include "mode_impl.hpp"
+#include "stats_impl.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace BC
+{
+    namespace
+    {
+        constexpr std::size_t kChunkBlocks = kParallelChunkBytes / BLOCK_SIZE;
+
+        // Per-worker copy of the expanded key. Workers read their schedule on every round, so
+        // each copy starts on its own cache line and never shares one with a neighbour's.
+        struct alignas(64) WorkerCipher
+        {
+            BlockCrypt aes;
+        };
+
+        std::vector<WorkerCipher> cipherPerWorker(const BlockCrypt::Key &key, const ThreadPool &pool)
+        {
+            return std::vector<WorkerCipher>(pool.size(), WorkerCipher{BlockCrypt(key)});
+        }
+
+        std::size_t chunkCount(std::size_t blocks)
+        {
+            return (blocks + kChunkBlocks - 1) / kChunkBlocks;
+        }
+
+        template <typename Fn>
+        void forEachChunk(ThreadPool &pool, std::size_t blocks, Fn &&fn)
+        {
+            pool.parallelFor(chunkCount(blocks), [&](std::size_t chunk, std::size_t worker)
+            {
+                BCStats::detail::Nested counted; // by the calling thread, for the whole buffer
+                std::size_t first = chunk * kChunkBlocks;
+                fn(worker, first, std::min(kChunkBlocks, blocks - first));
+            });
+        }
+    } // namespace
+
+    void encryptECBParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, ThreadPool &pool, bool pad)
+    {
+        if (pad)
+            BCPad::addPKCS7(data);
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB input is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::EncryptECB, data.size());
+        std::vector<WorkerCipher> ciphers = cipherPerWorker(key, pool);
+        uint8_t *base = data.data();
+        forEachChunk(pool, data.size() / BLOCK_SIZE, [&](std::size_t worker, std::size_t first, std::size_t n)
+        {
+            uint8_t *p = base + first * BLOCK_SIZE;
+            ciphers[worker].aes.encryptBlocks(p, p, n);
+        });
+    }
+
+    void decryptECBParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, ThreadPool &pool, bool pad)
+    {
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("ECB ciphertext is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptECB, data.size());
+        std::vector<WorkerCipher> ciphers = cipherPerWorker(key, pool);
+        uint8_t *base = data.data();
+        forEachChunk(pool, data.size() / BLOCK_SIZE, [&](std::size_t worker, std::size_t first, std::size_t n)
+        {
+            uint8_t *p = base + first * BLOCK_SIZE;
+            ciphers[worker].aes.decryptBlocks(p, p, n);
+        });
+
+        if (pad)
+            BCPad::removePKCS7(data);
+    }
+
+    void decryptCBCParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &iv,
+                            ThreadPool &pool, bool pad)
+    {
+        if (data.size() % BLOCK_SIZE != 0)
+            throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+
+        BCStats::detail::OpTimer timer(BCStats::Op::DecryptCBC, data.size());
+        std::size_t blocks = data.size() / BLOCK_SIZE;
+        uint8_t *base = data.data();
+
+        // Chunk k chains from the last ciphertext block of chunk k-1; grab those before any
+        // chunk overwrites its ciphertext with plaintext.
+        std::vector<BlockCrypt::Block> chunkIvs(chunkCount(blocks));
+        for (std::size_t k = 0; k < chunkIvs.size(); ++k)
+        {
+            if (k == 0)
+                chunkIvs[k] = iv;
+            else
+                std::copy_n(base + (k * kChunkBlocks - 1) * BLOCK_SIZE, BLOCK_SIZE, chunkIvs[k].begin());
+        }
+
+        std::vector<WorkerCipher> ciphers = cipherPerWorker(key, pool);
+        forEachChunk(pool, blocks, [&](std::size_t worker, std::size_t first, std::size_t n)
+        {
+            BlockCrypt::Block prev = chunkIvs[first / kChunkBlocks];
+            detail::decryptCBCInPlace(ciphers[worker].aes, base + first * BLOCK_SIZE, n, prev, 0);
+        });
+
+        if (pad)
+            BCPad::removePKCS7(data);
+    }
+
+    void cryptCTRParallel(std::vector<uint8_t> &data, const BlockCrypt::Key &key, const BlockCrypt::Block &counter,
+                          ThreadPool &pool, uint64_t offset)
+    {
+        // Every chunk derives its own counter from its stream offset, so no state is shared
+        BCStats::detail::OpTimer timer(BCStats::Op::CTR, data.size());
+        std::vector<WorkerCipher> ciphers = cipherPerWorker(key, pool);
+        uint8_t *base = data.data();
+        std::size_t length = data.size();
+        std::size_t chunks = (length + kParallelChunkBytes - 1) / kParallelChunkBytes;
+
+        pool.parallelFor(chunks, [&](std::size_t chunk, std::size_t worker)
+        {
+            BCStats::detail::Nested counted;
+            std::size_t first = chunk * kParallelChunkBytes;
+            std::size_t n = std::min(kParallelChunkBytes, length - first);
+            cryptCTR(ciphers[worker].aes, counter, offset + first, base + first, n);
+        });
+    }
+} // namespace BC
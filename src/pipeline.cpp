@@ -0,0 +1,334 @@
+#include "../include/fileio.hpp"
+#include "../include/CBC.hpp"
+#include "../include/bufferpool.hpp"
+#include "../include/stats.hpp"
+#include "uring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace BCFile
+{
+    namespace
+    {
+        // O_DIRECT wants buffers, offsets and lengths aligned to the device's logical block
+        // size; 4 KB covers every common device
+        constexpr std::size_t kAlign = 4096;
+
+        std::size_t alignUp(std::size_t n)
+        {
+            return (n + kAlign - 1) / kAlign * kAlign;
+        }
+
+        [[noreturn]] void fail(const std::string &what, const std::string &path)
+        {
+            throw std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+        }
+
+        // Closes the descriptor on every exit path
+        struct FileHandle
+        {
+            int fd = -1;
+            bool direct = false;
+            ~FileHandle()
+            {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        };
+
+        // Opens with O_DIRECT when asked; filesystems without it (tmpfs, some network and
+        // FUSE filesystems) reject the flag with EINVAL, and those files use buffered I/O
+        void openFile(FileHandle &file, const std::string &path, int flags, bool direct)
+        {
+#ifdef O_DIRECT
+            if (direct)
+            {
+                file.fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+                if (file.fd >= 0)
+                {
+                    file.direct = true;
+                    return;
+                }
+                if (errno != EINVAL)
+                    fail("Cannot open", path);
+            }
+#else
+            (void)direct;
+#endif
+            file.fd = ::open(path.c_str(), flags, 0644);
+            if (file.fd < 0)
+                fail("Cannot open", path);
+        }
+
+        // The output goes to a temporary file next to its destination that is renamed over it
+        // only once every chunk has been written (as with MappedFile::createReplacing), so a
+        // failure, e.g. bad padding on the last chunk, leaves an existing output untouched
+        struct TemporaryOutput
+        {
+            std::string target;
+            std::string path; // empty once committed
+
+            void create(const std::string &outPath)
+            {
+                target = replacementTarget(outPath);
+                path = temporaryPathFor(target);
+            }
+
+            void commit()
+            {
+                if (::rename(path.c_str(), target.c_str()) != 0)
+                    fail("Cannot replace", target);
+                path.clear();
+            }
+
+            ~TemporaryOutput()
+            {
+                if (!path.empty())
+                    ::unlink(path.c_str());
+            }
+        };
+
+        /**
+         * Transforms chunk `index` (`length` bytes, the last one if `last`) in place and
+         * returns the number of output bytes. Chunks are handed over strictly in order.
+         */
+        using ChunkFn = std::function<std::size_t(std::size_t index, uint8_t *data, std::size_t length, bool last)>;
+
+        /**
+         * The read -> transform -> write ring. Chunk k lives in buffer k % buffers; its read is
+         * submitted as soon as that buffer's previous write has completed, and its write right
+         * after the transform, so up to buffers - 1 transfers are in flight while the CPU works.
+         * Input chunk k is at offset k * chunk and its output at the same offset.
+         */
+        void runPipeline(const std::string &inPath, const std::string &outPath, const PipelineOptions &options,
+                         const std::function<void(std::size_t inputSize)> &checkInput, const ChunkFn &transform)
+        {
+            if (sameFile(inPath, outPath))
+                throw std::runtime_error("Input and output are the same file; use in-place mode");
+
+            TemporaryOutput temp;
+            FileHandle in, out, inTail, outTail; // before the queue, which must finish with them first
+            openFile(in, inPath, O_RDONLY, options.direct);
+            struct stat st;
+            if (::fstat(in.fd, &st) != 0)
+                fail("Cannot stat", inPath);
+            std::size_t size = static_cast<std::size_t>(st.st_size);
+            checkInput(size);
+            temp.create(outPath);
+            openFile(out, temp.path, O_WRONLY, options.direct);
+
+            const std::size_t chunk = alignUp(std::max<std::size_t>(options.chunkBytes, 1));
+            const std::size_t chunks = std::max<std::size_t>(1, (size + chunk - 1) / chunk); // an empty input still pads
+            const unsigned depth = std::max(3u, options.buffers);
+
+            // Room for one extra block per buffer: encryption pads the last chunk. Pool buffers
+            // of this size are page aligned, as O_DIRECT needs, and reused across files
+            const std::size_t capacity = chunk + kAlign;
+            std::vector<BC::PooledBuffer> buffers;
+            for (unsigned i = 0; i < depth; ++i)
+                buffers.push_back(BC::BufferPool::instance().acquire(capacity, BC::BufferPool::Use::Sensitive));
+
+            enum class Phase
+            {
+                Free,
+                Reading,
+                Ready,
+                Writing
+            };
+            struct Slot
+            {
+                Phase phase = Phase::Free;
+                std::size_t index = 0;   // chunk held by this buffer
+                std::size_t want = 0;    // bytes of the current transfer
+                std::size_t request = 0; // want, rounded up for O_DIRECT
+                std::size_t done = 0;
+            };
+            std::vector<Slot> slots(depth);
+
+            // Declared after the buffers: its destructor waits for in-flight requests first
+            detail::IoQueue io(2 * depth, options.uring);
+
+            auto tag = [](std::size_t slot, bool isWrite) { return static_cast<uint64_t>(slot) * 2 + (isWrite ? 1 : 0); };
+            auto offsetOf = [&](const Slot &s) { return static_cast<uint64_t>(s.index) * chunk; };
+
+            std::size_t nextRead = 0;
+            auto startReads = [&]
+            {
+                while (nextRead < chunks && slots[nextRead % depth].phase == Phase::Free)
+                {
+                    std::size_t slot = nextRead % depth;
+                    Slot &s = slots[slot];
+                    s.index = nextRead++;
+                    s.want = std::min(chunk, size - std::min(size, offsetOf(s)));
+                    s.request = in.direct ? alignUp(s.want) : s.want;
+                    s.done = 0;
+                    if (s.want == 0)
+                    {
+                        s.phase = Phase::Ready;
+                        continue;
+                    }
+                    s.phase = Phase::Reading;
+                    io.read(in.fd, buffers[slot].data(), s.request, offsetOf(s), tag(slot, false));
+                }
+                io.submit();
+            };
+
+            // A partial transfer leaves the rest at an offset O_DIRECT rejects (not 4 KB aligned),
+            // so remainders go through a buffered descriptor of the same file, opened on demand
+            auto tailFd = [](FileHandle &file, FileHandle &tail, const std::string &path, int flags)
+            {
+                if (!file.direct)
+                    return file.fd;
+                if (tail.fd < 0)
+                    openFile(tail, path, flags, false);
+                return tail.fd;
+            };
+
+            // Completions can be partial (signals, page cache pressure): the rest is resubmitted
+            auto complete = [&](const detail::IoCompletion &c)
+            {
+                std::size_t slot = static_cast<std::size_t>(c.tag / 2);
+                bool isWrite = (c.tag & 1) != 0;
+                Slot &s = slots[slot];
+                if (c.result < 0)
+                {
+                    errno = static_cast<int>(-c.result);
+                    fail(isWrite ? "Cannot write" : "Cannot read", isWrite ? outPath : inPath);
+                }
+                s.done += static_cast<std::size_t>(c.result);
+                if (s.done >= s.want)
+                {
+                    s.phase = isWrite ? Phase::Free : Phase::Ready;
+                    return;
+                }
+                if (c.result == 0)
+                    throw std::runtime_error(isWrite ? "Short write to '" + outPath + "'"
+                                                     : "Unexpected end of file in '" + inPath + "'");
+                uint8_t *p = buffers[slot].data() + s.done;
+                if (isWrite)
+                    io.write(tailFd(out, outTail, temp.path, O_WRONLY), p, s.want - s.done, offsetOf(s) + s.done, c.tag);
+                else
+                    io.read(tailFd(in, inTail, inPath, O_RDONLY), p, s.want - s.done, offsetOf(s) + s.done, c.tag);
+                io.submit();
+            };
+
+            std::size_t outputSize = 0;
+            startReads();
+            for (std::size_t k = 0; k < chunks; ++k)
+            {
+                std::size_t slot = k % depth;
+                Slot &s = slots[slot];
+                detail::IoCompletion c;
+                BCStats::PhaseTimer waitRead(BCStats::Phase::Read); // stalls only: reads overlap the rest
+                while (s.phase != Phase::Ready || s.index != k)
+                {
+                    io.next(c, true);
+                    complete(c);
+                    startReads();
+                }
+                waitRead.setBytes(s.want);
+                waitRead.stop();
+
+                bool last = k + 1 == chunks;
+                uint8_t *data = buffers[slot].data();
+                BCStats::PhaseTimer cipher(BCStats::Phase::Cipher, s.want);
+                std::size_t produced = transform(k, data, s.want, last);
+                cipher.stop();
+                outputSize = offsetOf(s) + produced;
+
+                // O_DIRECT writes whole blocks; the tail past `produced` is cut off below
+                s.want = produced;
+                s.request = out.direct ? alignUp(produced) : produced;
+                std::memset(data + produced, 0, s.request - produced);
+                s.done = 0;
+                if (produced == 0)
+                {
+                    s.phase = Phase::Free;
+                }
+                else
+                {
+                    s.phase = Phase::Writing;
+                    io.write(out.fd, data, s.request, offsetOf(s), tag(slot, true));
+                }
+
+                while (io.next(c, false))
+                    complete(c);
+                startReads();
+            }
+
+            BCStats::PhaseTimer waitWrite(BCStats::Phase::Write, outputSize);
+            detail::IoCompletion c;
+            while (io.inFlight() > 0)
+            {
+                io.next(c, true);
+                complete(c);
+            }
+            if (::ftruncate(out.fd, static_cast<off_t>(outputSize)) != 0)
+                fail("Cannot resize", outPath);
+            temp.commit();
+        }
+    } // namespace
+
+    void encryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options)
+    {
+        encryptFileCBCPipelined(inPath, outPath, BlockCrypt(key), iv, options);
+    }
+
+    void encryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options)
+    {
+        BlockCrypt::Block chain = iv;
+        auto encryptChunk = [&](std::size_t, uint8_t *data, std::size_t length, bool last)
+        {
+            // Full chunks are block aligned; only the last one is padded
+            std::size_t produced = BC::encryptCBC(aes, chain, data, length, data, length + BLOCK_SIZE, last);
+            if (!last)
+                std::memcpy(chain.data(), data + produced - BLOCK_SIZE, BLOCK_SIZE);
+            return produced;
+        };
+        runPipeline(inPath, outPath, options, [](std::size_t) {}, encryptChunk);
+    }
+
+    void decryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt::Key &key,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options)
+    {
+        decryptFileCBCPipelined(inPath, outPath, BlockCrypt(key), iv, options);
+    }
+
+    void decryptFileCBCPipelined(const std::string &inPath, const std::string &outPath, const BlockCrypt &aes,
+                                 const BlockCrypt::Block &iv, const PipelineOptions &options)
+    {
+        auto checkInput = [](std::size_t size)
+        {
+            if (size == 0 || size % BLOCK_SIZE != 0)
+                throw std::runtime_error("CBC ciphertext is not a multiple of the block size");
+        };
+        BlockCrypt::Block chain = iv;
+        auto decryptChunk = [&](std::size_t, uint8_t *data, std::size_t length, bool last)
+        {
+            // The chunk's last ciphertext block chains into the next chunk; save it before
+            // decrypting over it
+            BlockCrypt::Block next;
+            std::memcpy(next.data(), data + length - BLOCK_SIZE, BLOCK_SIZE);
+            std::size_t produced = BC::decryptCBC(aes, chain, data, length, data, length, last);
+            chain = next;
+            return produced;
+        };
+        runPipeline(inPath, outPath, options, checkInput, decryptChunk);
+    }
+
+    bool uringAvailable()
+    {
+        return detail::ringSupported();
+    }
+} // namespace BCFile
@@ -0,0 +1,337 @@
+#include "../include/stats.hpp"
+#include "stats_impl.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace BCStats
+{
+    uint64_t Timing::percentileNs(double p) const
+    {
+        uint64_t total = 0;
+        for (uint64_t n : histogram)
+            total += n;
+        if (total == 0)
+            return 0;
+
+        uint64_t target = static_cast<uint64_t>(static_cast<double>(total) * p / 100.0 + 0.5);
+        target = target == 0 ? 1 : target;
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += histogram[i];
+            if (seen >= target)
+                return uint64_t(1) << (i + 1);
+        }
+        return uint64_t(1) << kBuckets;
+    }
+
+    const char *opName(Op op)
+    {
+        switch (op)
+        {
+        case Op::EncryptBlocks:
+            return "blocks.encrypt";
+        case Op::DecryptBlocks:
+            return "blocks.decrypt";
+        case Op::EncryptECB:
+            return "ecb.encrypt";
+        case Op::DecryptECB:
+            return "ecb.decrypt";
+        case Op::EncryptCBC:
+            return "cbc.encrypt";
+        case Op::DecryptCBC:
+            return "cbc.decrypt";
+        case Op::CTR:
+            return "ctr";
+        case Op::SealGCM:
+            return "gcm.seal";
+        case Op::OpenGCM:
+            return "gcm.open";
+        case Op::EncryptXTS:
+            return "xts.encrypt";
+        case Op::DecryptXTS:
+            return "xts.decrypt";
+        default:
+            return "unknown";
+        }
+    }
+
+    const char *phaseName(Phase phase)
+    {
+        switch (phase)
+        {
+        case Phase::Read:
+            return "read";
+        case Phase::Cipher:
+            return "cipher";
+        case Phase::Write:
+            return "write";
+        default:
+            return "unknown";
+        }
+    }
+
+#ifdef BLOCKCRYPT_STATS
+    namespace
+    {
+        // Written only by the owning thread, so a relaxed load + store (a plain add, no locked
+        // instruction) is enough; the atomics only make concurrent snapshot() reads well defined
+        struct Counter
+        {
+            std::atomic<uint64_t> value{0};
+
+            void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+            uint64_t get() const { return value.load(std::memory_order_relaxed); }
+            void clear() { value.store(0, std::memory_order_relaxed); }
+        };
+
+        struct TimingCounters
+        {
+            Counter calls, bytes, blocks, nanoseconds;
+            Counter histogram[kBuckets];
+
+            void add(std::size_t n, uint64_t ns)
+            {
+                calls.add(1);
+                bytes.add(n);
+                blocks.add((n + 15) / 16);
+                nanoseconds.add(ns);
+                std::size_t bucket = ns == 0 ? 0 : static_cast<std::size_t>(63 - __builtin_clzll(ns));
+                histogram[bucket < kBuckets ? bucket : kBuckets - 1].add(1);
+            }
+
+            void addTo(Timing &t) const
+            {
+                t.calls += calls.get();
+                t.bytes += bytes.get();
+                t.blocks += blocks.get();
+                t.nanoseconds += nanoseconds.get();
+                for (std::size_t i = 0; i < kBuckets; ++i)
+                    t.histogram[i] += histogram[i].get();
+            }
+
+            void clear()
+            {
+                calls.clear();
+                bytes.clear();
+                blocks.clear();
+                nanoseconds.clear();
+                for (Counter &c : histogram)
+                    c.clear();
+            }
+        };
+
+        // Bumped by reset(). Counters are only ever written by their own thread, which clears
+        // them when it sees a newer epoch: clearing them from reset() itself could race with
+        // an add() in flight and bring the old value back
+        std::atomic<uint64_t> resetEpoch{0};
+
+        // One per thread, on its own cache lines so threads never share a written line
+        struct alignas(64) ThreadCounters
+        {
+            TimingCounters ops[kOps];
+            TimingCounters phases[kPhases];
+            Counter keyExpansions, paddingErrors;
+            unsigned depth = 0;
+            std::atomic<uint64_t> epoch{resetEpoch.load(std::memory_order_relaxed)}; // of the values held
+
+            // Counters from before the last reset() count as zero until the owner clears them
+            bool current() const
+            {
+                return epoch.load(std::memory_order_acquire) == resetEpoch.load(std::memory_order_relaxed);
+            }
+
+            void addTo(Snapshot &s) const
+            {
+                for (std::size_t i = 0; i < kOps; ++i)
+                    ops[i].addTo(s.ops[i]);
+                for (std::size_t i = 0; i < kPhases; ++i)
+                    phases[i].addTo(s.phases[i]);
+                s.keyExpansions += keyExpansions.get();
+                s.paddingErrors += paddingErrors.get();
+            }
+
+            void clear()
+            {
+                for (TimingCounters &t : ops)
+                    t.clear();
+                for (TimingCounters &t : phases)
+                    t.clear();
+                keyExpansions.clear();
+                paddingErrors.clear();
+            }
+        };
+
+        // Live threads' counters plus the totals of threads that have exited
+        struct Registry
+        {
+            std::mutex lock;
+            std::vector<ThreadCounters *> live;
+            Snapshot retired;
+        };
+
+        Registry &registry()
+        {
+            static Registry *instance = new Registry; // never destroyed: threads may exit after main
+            return *instance;
+        }
+
+        struct LocalCounters
+        {
+            ThreadCounters *counters = new ThreadCounters;
+
+            LocalCounters()
+            {
+                Registry &r = registry();
+                std::lock_guard<std::mutex> guard(r.lock);
+                r.live.push_back(counters);
+            }
+
+            ~LocalCounters()
+            {
+                Registry &r = registry();
+                {
+                    std::lock_guard<std::mutex> guard(r.lock);
+                    if (counters->current())
+                        counters->addTo(r.retired);
+                    for (std::size_t i = 0; i < r.live.size(); ++i)
+                    {
+                        if (r.live[i] == counters)
+                        {
+                            r.live[i] = r.live.back();
+                            r.live.pop_back();
+                            break;
+                        }
+                    }
+                }
+                delete counters;
+            }
+        };
+
+        ThreadCounters &local()
+        {
+            thread_local LocalCounters slot;
+            return *slot.counters;
+        }
+
+        // The calling thread's counters, first cleared if reset() has run since they were written
+        ThreadCounters &counters()
+        {
+            ThreadCounters &t = local();
+            uint64_t e = resetEpoch.load(std::memory_order_acquire);
+            if (t.epoch.load(std::memory_order_relaxed) != e)
+            {
+                t.clear();
+                t.epoch.store(e, std::memory_order_release);
+            }
+            return t;
+        }
+    } // namespace
+
+    namespace detail
+    {
+        uint64_t now()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now().time_since_epoch())
+                                             .count());
+        }
+
+        unsigned &depth()
+        {
+            return local().depth;
+        }
+
+        void record(Op op, std::size_t bytes, uint64_t nanoseconds)
+        {
+            counters().ops[static_cast<std::size_t>(op)].add(bytes, nanoseconds);
+        }
+
+        void record(Phase phase, std::size_t bytes, uint64_t nanoseconds)
+        {
+            counters().phases[static_cast<std::size_t>(phase)].add(bytes, nanoseconds);
+        }
+
+        void countKeyExpansion()
+        {
+            counters().keyExpansions.add(1);
+        }
+
+        void countPaddingError()
+        {
+            counters().paddingErrors.add(1);
+        }
+    } // namespace detail
+
+    bool enabled()
+    {
+        return true;
+    }
+
+    Snapshot snapshot()
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        Snapshot s = r.retired;
+        for (const ThreadCounters *t : r.live)
+        {
+            if (t->current())
+                t->addTo(s);
+        }
+        return s;
+    }
+
+    void reset()
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.retired = Snapshot{};
+        resetEpoch.fetch_add(1, std::memory_order_release); // each thread clears its own on its next add
+    }
+
+    PhaseTimer::PhaseTimer(Phase phase, std::size_t bytes) : phase(phase), bytes(bytes), start(detail::now())
+    {
+    }
+
+    PhaseTimer::~PhaseTimer()
+    {
+        stop();
+    }
+
+    void PhaseTimer::stop()
+    {
+        if (running)
+            detail::record(phase, bytes, detail::now() - start);
+        running = false;
+    }
+#else
+    bool enabled()
+    {
+        return false;
+    }
+
+    Snapshot snapshot()
+    {
+        return Snapshot{};
+    }
+
+    void reset()
+    {
+    }
+
+    PhaseTimer::PhaseTimer(Phase phase, std::size_t bytes) : phase(phase), bytes(bytes), start(0)
+    {
+    }
+
+    PhaseTimer::~PhaseTimer()
+    {
+    }
+
+    void PhaseTimer::stop()
+    {
+        running = false;
+    }
+#endif
+} // namespace BCStats
@@ -0,0 +1,80 @@
+#pragma once
+
+// Internal: the recording side of BCStats. With BLOCKCRYPT_STATS undefined every hook below
+// is an empty inline function or an empty object, so instrumented call sites compile to
+// exactly what they were before.
+
+#include <cstddef>
+#include <cstdint>
+#include "../include/stats.hpp"
+
+namespace BCStats
+{
+    namespace detail
+    {
+#ifdef BLOCKCRYPT_STATS
+        uint64_t now(); // monotonic nanoseconds
+
+        // Outermost-operation depth of the calling thread (see BCStats::Op)
+        unsigned &depth();
+
+        void record(Op op, std::size_t bytes, uint64_t nanoseconds);
+        void record(Phase phase, std::size_t bytes, uint64_t nanoseconds);
+        void countKeyExpansion();
+        void countPaddingError();
+
+        /**
+         * Counts and times one operation over `bytes` bytes, unless an operation is already
+         * running on this thread (then the outer one accounts for the bytes).
+         */
+        class OpTimer
+        {
+        public:
+            OpTimer(Op op, std::size_t bytes) : op(op), bytes(bytes), outermost(depth()++ == 0)
+            {
+                if (outermost)
+                    start = now();
+            }
+            ~OpTimer()
+            {
+                --depth();
+                if (outermost)
+                    record(op, bytes, now() - start);
+            }
+            OpTimer(const OpTimer &) = delete;
+            OpTimer &operator=(const OpTimer &) = delete;
+
+        private:
+            Op op;
+            std::size_t bytes;
+            bool outermost;
+            uint64_t start = 0;
+        };
+
+        // Marks pool workers as running on behalf of an operation counted on another thread
+        class Nested
+        {
+        public:
+            Nested() { ++depth(); }
+            ~Nested() { --depth(); }
+            Nested(const Nested &) = delete;
+            Nested &operator=(const Nested &) = delete;
+        };
+#else
+        class OpTimer
+        {
+        public:
+            constexpr OpTimer(Op, std::size_t) {}
+        };
+
+        class Nested
+        {
+        public:
+            constexpr Nested() {}
+        };
+
+        inline void countKeyExpansion() {}
+        inline void countPaddingError() {}
+#endif
+    } // namespace detail
+} // namespace BCStats
@@ -0,0 +1,152 @@
+#include "../include/threadpool.hpp"
+
+namespace BC
+{
+    ThreadPool::ThreadPool(std::size_t workers)
+    {
+        if (workers == 0)
+            workers = std::thread::hardware_concurrency();
+        workerCount = workers == 0 ? 1 : workers;
+        queues.reset(new Queue[workerCount]);
+
+        threads.reserve(workerCount - 1);
+        for (std::size_t w = 1; w < workerCount; ++w)
+        {
+            threads.emplace_back(&ThreadPool::workerLoop, this, w);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &t : threads)
+        {
+            t.join();
+        }
+    }
+
+    void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)> &task)
+    {
+        if (count == 0)
+            return;
+
+        // Nothing to share: skip the wake-up round trip
+        if (count == 1 || workerCount == 1)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                task(i, 0);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> run(runLock);
+
+        // Contiguous slices keep neighbouring chunks on the same worker until stealing kicks in
+        for (std::size_t w = 0; w < workerCount; ++w)
+        {
+            std::size_t begin = count * w / workerCount;
+            std::size_t end = count * (w + 1) / workerCount;
+            std::lock_guard<std::mutex> guard(queues[w].lock);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                queues[w].tasks.push_back(i);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            job = &task;
+            error = nullptr;
+            busyWorkers = workerCount - 1;
+            ++generation;
+        }
+        wake.notify_all();
+
+        runTasks(0);
+
+        {
+            std::unique_lock<std::mutex> guard(stateLock);
+            finished.wait(guard, [this] { return busyWorkers == 0; });
+            job = nullptr;
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void ThreadPool::workerLoop(std::size_t worker)
+    {
+        std::size_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> guard(stateLock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+
+            runTasks(worker);
+
+            {
+                std::lock_guard<std::mutex> guard(stateLock);
+                if (--busyWorkers == 0)
+                    finished.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::runTasks(std::size_t worker)
+    {
+        // All tasks are queued before the workers wake up, so once every queue is empty
+        // there is nothing left to wait for.
+        std::size_t index;
+        while (takeTask(worker, index))
+        {
+            try
+            {
+                (*job)(index, worker);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+
+    bool ThreadPool::takeTask(std::size_t worker, std::size_t &index)
+    {
+        {
+            Queue &own = queues[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.tasks.empty())
+            {
+                index = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        // Steal from the back, the end the owner reaches last
+        for (std::size_t step = 1; step < workerCount; ++step)
+        {
+            Queue &victim = queues[(worker + step) % workerCount];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty())
+            {
+                index = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace BC
@@ -0,0 +1,252 @@
+#include "uring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BLOCKCRYPT_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace BCFile
+{
+    namespace detail
+    {
+        namespace
+        {
+#ifdef BLOCKCRYPT_HAVE_URING
+            constexpr uint8_t kOpRead = IORING_OP_READ;
+            constexpr uint8_t kOpWrite = IORING_OP_WRITE;
+
+            int ringSetup(unsigned entries, io_uring_params &params)
+            {
+                return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            }
+
+            int ringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+            {
+                return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+            }
+
+            /**
+             * IORING_OP_READ/WRITE arrived in Linux 5.6, together with IORING_REGISTER_PROBE.
+             * A 5.1-5.5 kernel creates the ring but fails every such request with EINVAL, so
+             * the ring is only used when the probe confirms both opcodes.
+             */
+            bool ringHasReadWrite(int fd)
+            {
+                constexpr unsigned kOps = 256;
+                std::vector<uint8_t> storage(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op), 0);
+                auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+                if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, kOps) < 0)
+                    return false;
+                auto supported = [&](uint8_t op)
+                { return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0; };
+                return supported(kOpRead) && supported(kOpWrite);
+            }
+
+            // The kernel reads the SQ tail and writes the CQ tail concurrently with us
+            unsigned loadAcquire(const unsigned *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+            void storeRelease(unsigned *p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+            template <typename T>
+            T *at(void *base, uint32_t offset)
+            {
+                return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+            }
+#else
+            constexpr uint8_t kOpRead = 0;
+            constexpr uint8_t kOpWrite = 1;
+#endif
+        } // namespace
+
+        IoQueue::IoQueue(unsigned depth, bool useRing)
+        {
+#ifdef BLOCKCRYPT_HAVE_URING
+            if (!useRing)
+                return;
+
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            int fd = ringSetup(depth, params);
+            if (fd < 0)
+                return; // ENOSYS, EPERM (seccomp, io_uring_disabled), ...: use the blocking fallback
+            if (!ringHasReadWrite(fd))
+            {
+                ::close(fd);
+                return;
+            }
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single)
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+            sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            cqRing = single ? sqRing
+                            : ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            sqes = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+            {
+                if (sqes != MAP_FAILED)
+                    ::munmap(sqes, sqesSize);
+                if (!single && cqRing != MAP_FAILED)
+                    ::munmap(cqRing, cqRingSize);
+                if (sqRing != MAP_FAILED)
+                    ::munmap(sqRing, sqRingSize);
+                sqRing = cqRing = sqes = nullptr;
+                ::close(fd);
+                return;
+            }
+
+            sqHead = at<unsigned>(sqRing, params.sq_off.head);
+            sqTail = at<unsigned>(sqRing, params.sq_off.tail);
+            sqMask = at<unsigned>(sqRing, params.sq_off.ring_mask);
+            sqArray = at<unsigned>(sqRing, params.sq_off.array);
+            cqHead = at<unsigned>(cqRing, params.cq_off.head);
+            cqTail = at<unsigned>(cqRing, params.cq_off.tail);
+            cqMask = at<unsigned>(cqRing, params.cq_off.ring_mask);
+            cqes = at<io_uring_cqe>(cqRing, params.cq_off.cqes);
+            sqEntries = params.sq_entries;
+            ringFd = fd;
+#else
+            (void)depth;
+            (void)useRing;
+#endif
+        }
+
+        IoQueue::~IoQueue()
+        {
+            // The kernel may still be copying into or out of the caller's buffers
+            try
+            {
+                IoCompletion ignored;
+                submit();
+                while (pending > 0)
+                    next(ignored, true);
+            }
+            catch (const std::exception &)
+            {
+                // The ring is unusable; closing it below makes the kernel cancel what is left
+            }
+#ifdef BLOCKCRYPT_HAVE_URING
+            if (ringFd >= 0)
+            {
+                ::munmap(sqes, sqesSize);
+                if (cqRing != sqRing)
+                    ::munmap(cqRing, cqRingSize);
+                ::munmap(sqRing, sqRingSize);
+                ::close(ringFd);
+            }
+#endif
+        }
+
+        void IoQueue::read(int fd, uint8_t *buffer, std::size_t length, uint64_t offset, uint64_t tag)
+        {
+            queue(kOpRead, fd, buffer, length, offset, tag);
+        }
+
+        void IoQueue::write(int fd, const uint8_t *buffer, std::size_t length, uint64_t offset, uint64_t tag)
+        {
+            queue(kOpWrite, fd, const_cast<uint8_t *>(buffer), length, offset, tag);
+        }
+
+        void IoQueue::queue(uint8_t opcode, int fd, uint8_t *buffer, std::size_t length, uint64_t offset, uint64_t tag)
+        {
+            ++pending;
+#ifdef BLOCKCRYPT_HAVE_URING
+            if (ringFd >= 0)
+            {
+                unsigned tail = *sqTail;
+                if (tail - loadAcquire(sqHead) == sqEntries)
+                {
+                    --pending;
+                    throw std::runtime_error("io_uring submission queue is full");
+                }
+                unsigned index = tail & *sqMask;
+                io_uring_sqe &sqe = static_cast<io_uring_sqe *>(sqes)[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = opcode;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<uint64_t>(buffer);
+                sqe.len = static_cast<uint32_t>(length);
+                sqe.off = offset;
+                sqe.user_data = tag;
+                sqArray[index] = index;
+                storeRelease(sqTail, tail + 1);
+                ++unsubmitted;
+                return;
+            }
+#endif
+            // Blocking fallback: perform the request now and report it from next()
+            ssize_t n = opcode == kOpRead ? ::pread(fd, buffer, length, static_cast<off_t>(offset))
+                                          : ::pwrite(fd, buffer, length, static_cast<off_t>(offset));
+            done.push_back({tag, n < 0 ? -static_cast<int64_t>(errno) : static_cast<int64_t>(n)});
+        }
+
+        void IoQueue::submit()
+        {
+#ifdef BLOCKCRYPT_HAVE_URING
+            while (ringFd >= 0 && unsubmitted > 0)
+            {
+                int n = ringEnter(ringFd, unsubmitted, 0, 0);
+                if (n < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                        continue;
+                    throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+                }
+                unsubmitted -= static_cast<unsigned>(n);
+            }
+#endif
+        }
+
+        bool IoQueue::next(IoCompletion &completion, bool block)
+        {
+            if (pending == 0)
+                return false;
+#ifdef BLOCKCRYPT_HAVE_URING
+            if (ringFd >= 0)
+            {
+                for (;;)
+                {
+                    unsigned head = *cqHead;
+                    if (head != loadAcquire(cqTail))
+                    {
+                        const io_uring_cqe &cqe = static_cast<io_uring_cqe *>(cqes)[head & *cqMask];
+                        completion = {cqe.user_data, cqe.res};
+                        storeRelease(cqHead, head + 1);
+                        --pending;
+                        return true;
+                    }
+                    if (!block)
+                        return false;
+                    if (ringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                        throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+                }
+            }
+#endif
+            (void)block;
+            completion = done.front();
+            done.pop_front();
+            --pending;
+            return true;
+        }
+
+        bool ringSupported()
+        {
+            IoQueue probe(1, true);
+            return probe.usesRing();
+        }
+    } // namespace detail
+} // namespace BCFile
@@ -0,0 +1,72 @@
+#pragma once
+
+// Internal: a minimal asynchronous read/write queue for the pipelined file path. On Linux it
+// drives an io_uring directly through the io_uring_setup/io_uring_enter system calls (no
+// liburing dependency); where io_uring is missing or not permitted it degrades to blocking
+// pread/pwrite that complete immediately, so callers run the same code either way.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace BCFile
+{
+    namespace detail
+    {
+        struct IoCompletion
+        {
+            uint64_t tag;   // value passed to read()/write()
+            int64_t result; // bytes transferred, or -errno
+        };
+
+        class IoQueue
+        {
+        public:
+            /**
+             * @param depth Most requests that will ever be in flight at once.
+             * @param useRing Try io_uring first; false forces the blocking fallback.
+             */
+            IoQueue(unsigned depth, bool useRing);
+            ~IoQueue(); // waits for requests still in flight, so their buffers can be freed afterwards
+
+            IoQueue(const IoQueue &) = delete;
+            IoQueue &operator=(const IoQueue &) = delete;
+
+            // Queue a request; nothing reaches the kernel before submit()
+            void read(int fd, uint8_t *buffer, std::size_t length, uint64_t offset, uint64_t tag);
+            void write(int fd, const uint8_t *buffer, std::size_t length, uint64_t offset, uint64_t tag);
+            void submit();
+
+            /**
+             * Takes one completion. With `block` it waits for one if none is ready; without
+             * it returns false immediately when nothing has completed yet.
+             */
+            bool next(IoCompletion &completion, bool block);
+
+            std::size_t inFlight() const { return pending; }
+            bool usesRing() const { return ringFd >= 0; }
+
+        private:
+            void queue(uint8_t opcode, int fd, uint8_t *buffer, std::size_t length, uint64_t offset, uint64_t tag);
+
+            int ringFd = -1;
+            std::size_t pending = 0;  // queued or submitted, not yet taken by next()
+            unsigned unsubmitted = 0; // SQEs queued since the last submit()
+
+            // Ring mappings (see io_uring_setup(2))
+            void *sqRing = nullptr;
+            void *cqRing = nullptr;
+            void *sqes = nullptr;
+            std::size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+            unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+            unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+            unsigned sqEntries = 0;
+            void *cqes = nullptr;
+
+            std::deque<IoCompletion> done; // blocking fallback: results of requests already performed
+        };
+
+        // True if this kernel lets the process create an io_uring with IORING_OP_READ/WRITE
+        bool ringSupported();
+    } // namespace detail
+} // namespace BCFile
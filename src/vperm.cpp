@@ -0,0 +1,286 @@
+#include "aes_kernels.hpp"
+
+#ifdef BLOCKCRYPT_HAVE_VPERM
+#include <array>
+#include <tmmintrin.h> // SSSE3 (PSHUFB)
+
+// Vector-permute AES: the S-Box is evaluated in the tower field GF((2^4)^2), where
+// inverting a byte only needs inverses of 4-bit values. PSHUFB performs sixteen
+// 16-entry lookups at once with the table held in a register, so every nibble
+// operation is a constant-time shuffle and no 256-byte table is ever touched.
+//
+// Representation: the AES field GF(2^8) = GF(2)[x]/(x^8+x^4+x^3+x+1) is mapped onto
+// GF(16)[t]/(t^2 + t + L), GF(16) = GF(2)[z]/(z^4+z+1). For an element u*t + v we work
+// with i = L*u and k = v; then, with j = i ^ k and a = 1/L,
+//     io = j ^ 1/(1/i ^ a/k),   jo = i ^ 1/(1/j ^ a/k)
+// satisfy 1/io = v', 1/jo = v' ^ (u' ^ v')/L for the inverse u'*t + v'. The output
+// tables absorb the final 1/x, the way back to the AES basis and (for encryption)
+// the affine map. 1/0 is encoded as 0x80 so PSHUFB turns "infinity" into 0.
+
+namespace BCKernel
+{
+    namespace
+    {
+        struct VPermTables
+        {
+            std::array<uint8_t, 16> inv{}, aDiv{};
+            std::array<uint8_t, 16> encInLo{}, encInHi{}, encOut1{}, encOut2{};
+            std::array<uint8_t, 16> decInLo{}, decInHi{}, decOut1{}, decOut2{};
+        };
+
+        constexpr uint8_t gf16Mul(uint8_t a, uint8_t b)
+        {
+            unsigned p = 0;
+            for (int i = 0; i < 4; ++i)
+                if ((b >> i) & 1)
+                    p ^= static_cast<unsigned>(a) << i;
+            for (int i = 7; i >= 4; --i)
+                if ((p >> i) & 1)
+                    p ^= 0x13u << (i - 4);
+            return static_cast<uint8_t>(p);
+        }
+
+        constexpr uint8_t gf16Inv(uint8_t a)
+        {
+            for (uint8_t b = 1; b < 16; ++b)
+                if (gf16Mul(a, b) == 1)
+                    return b;
+            return 0;
+        }
+
+        // Multiplication in GF(16)[t]/(t^2 + t + lambda), elements packed as (u << 4) | v
+        constexpr uint8_t towerMul(uint8_t x, uint8_t y, uint8_t lambda)
+        {
+            uint8_t u1 = x >> 4, v1 = x & 15, u2 = y >> 4, v2 = y & 15;
+            uint8_t uu = gf16Mul(u1, u2);
+            uint8_t u = uu ^ gf16Mul(u1, v2) ^ gf16Mul(u2, v1);
+            uint8_t v = gf16Mul(uu, lambda) ^ gf16Mul(v1, v2);
+            return static_cast<uint8_t>((u << 4) | v);
+        }
+
+        // Linear part of the AES affine map: bit i = x[i] ^ x[i+4] ^ x[i+5] ^ x[i+6] ^ x[i+7]
+        constexpr uint8_t affineLinear(uint8_t x)
+        {
+            uint8_t r = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                int b = ((x >> i) ^ (x >> ((i + 4) & 7)) ^ (x >> ((i + 5) & 7)) ^ (x >> ((i + 6) & 7)) ^ (x >> ((i + 7) & 7))) & 1;
+                r |= static_cast<uint8_t>(b << i);
+            }
+            return r;
+        }
+
+        // Linear part of the inverse affine map: bit i = x[i+2] ^ x[i+5] ^ x[i+7]
+        constexpr uint8_t invAffineLinear(uint8_t x)
+        {
+            uint8_t r = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                int b = ((x >> ((i + 2) & 7)) ^ (x >> ((i + 5) & 7)) ^ (x >> ((i + 7) & 7))) & 1;
+                r |= static_cast<uint8_t>(b << i);
+            }
+            return r;
+        }
+
+        constexpr VPermTables makeVPermTables()
+        {
+            VPermTables t{};
+
+            // lambda: smallest value making t^2 + t + lambda irreducible (not of the form s^2 + s)
+            uint8_t lambda = 0;
+            for (uint8_t l = 1; l < 16 && lambda == 0; ++l)
+            {
+                bool isTrace = false;
+                for (uint8_t s = 0; s < 16; ++s)
+                    if ((gf16Mul(s, s) ^ s) == l)
+                        isTrace = true;
+                if (!isTrace)
+                    lambda = l;
+            }
+
+            // g: a root of the AES polynomial inside the tower field; x -> sum(bit_i * g^i) is the isomorphism
+            std::array<uint8_t, 8> gPow{};
+            for (unsigned g = 2; g < 256; ++g)
+            {
+                uint8_t p[9] = {1, 0, 0, 0, 0, 0, 0, 0, 0};
+                for (int i = 1; i < 9; ++i)
+                    p[i] = towerMul(p[i - 1], static_cast<uint8_t>(g), lambda);
+                if ((p[8] ^ p[4] ^ p[3] ^ p[1] ^ p[0]) == 0)
+                {
+                    for (int i = 0; i < 8; ++i)
+                        gPow[i] = p[i];
+                    break;
+                }
+            }
+
+            std::array<uint8_t, 256> toTower{}, fromTower{};
+            for (unsigned x = 0; x < 256; ++x)
+            {
+                uint8_t r = 0;
+                for (int i = 0; i < 8; ++i)
+                    if ((x >> i) & 1)
+                        r ^= gPow[i];
+                toTower[x] = r;
+                fromTower[r] = static_cast<uint8_t>(x);
+            }
+
+            // AES byte -> packed (i << 4) | k
+            auto toIK = [&](uint8_t x)
+            {
+                uint8_t tw = toTower[x];
+                return static_cast<uint8_t>((gf16Mul(lambda, tw >> 4) << 4) | (tw & 15));
+            };
+            // (1/io, 1/jo) -> inverse in the AES basis
+            auto fromC = [&](uint8_t c1, uint8_t c2)
+            {
+                uint8_t u = gf16Mul(lambda, c1 ^ c2) ^ c1;
+                return fromTower[(u << 4) | c1];
+            };
+
+            uint8_t a = gf16Inv(lambda);
+            uint8_t decConst = toIK(0x05); // A^-1(y) = invAffineLinear(y) ^ 0x05
+            for (uint8_t n = 0; n < 16; ++n)
+            {
+                uint8_t nInv = gf16Inv(n);
+                t.inv[n] = n ? nInv : 0x80;
+                t.aDiv[n] = n ? gf16Mul(a, nInv) : 0x80;
+
+                t.encInLo[n] = toIK(n);
+                t.encInHi[n] = toIK(static_cast<uint8_t>(n << 4));
+                t.encOut1[n] = n ? affineLinear(fromC(nInv, 0)) : 0;
+                t.encOut2[n] = n ? affineLinear(fromC(0, nInv)) : 0;
+
+                t.decInLo[n] = toIK(invAffineLinear(n)) ^ decConst;
+                t.decInHi[n] = toIK(invAffineLinear(static_cast<uint8_t>(n << 4)));
+                t.decOut1[n] = n ? fromC(nInv, 0) : 0;
+                t.decOut2[n] = n ? fromC(0, nInv) : 0;
+            }
+            return t;
+        }
+
+        constexpr VPermTables kTables = makeVPermTables();
+
+        inline __m128i loadTable(const std::array<uint8_t, 16> &t)
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.data()));
+        }
+
+        inline __m128i load(const uint8_t *p)
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        }
+
+        // All constants live in registers for the whole block
+        struct Context
+        {
+            __m128i low4 = _mm_set1_epi8(0x0f);
+            __m128i inv = loadTable(kTables.inv);
+            __m128i aDiv = loadTable(kTables.aDiv);
+            __m128i inLo, inHi, out1, out2;
+            // state byte index = col * 4 + row
+            __m128i shiftRows = _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11);
+            __m128i invShiftRows = _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+            __m128i rot1 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+            __m128i rot2 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+            __m128i rot3 = _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+            __m128i poly = _mm_set1_epi8(0x1b);
+
+            explicit Context(bool decrypt)
+                : inLo(loadTable(decrypt ? kTables.decInLo : kTables.encInLo)),
+                  inHi(loadTable(decrypt ? kTables.decInHi : kTables.encInHi)),
+                  out1(loadTable(decrypt ? kTables.decOut1 : kTables.encOut1)),
+                  out2(loadTable(decrypt ? kTables.decOut2 : kTables.encOut2))
+            {
+            }
+
+            // S-Box (or inverse S-Box, depending on the tables) on all 16 bytes
+            __m128i sub(__m128i x) const
+            {
+                __m128i lo = _mm_and_si128(x, low4);
+                __m128i hi = _mm_and_si128(_mm_srli_epi32(x, 4), low4);
+                __m128i ik = _mm_xor_si128(_mm_shuffle_epi8(inLo, lo), _mm_shuffle_epi8(inHi, hi));
+
+                __m128i k = _mm_and_si128(ik, low4);
+                __m128i i = _mm_and_si128(_mm_srli_epi32(ik, 4), low4);
+                __m128i j = _mm_xor_si128(i, k);
+                __m128i ak = _mm_shuffle_epi8(aDiv, k);
+                __m128i iak = _mm_xor_si128(_mm_shuffle_epi8(inv, i), ak);
+                __m128i jak = _mm_xor_si128(_mm_shuffle_epi8(inv, j), ak);
+                __m128i io = _mm_xor_si128(j, _mm_shuffle_epi8(inv, iak));
+                __m128i jo = _mm_xor_si128(i, _mm_shuffle_epi8(inv, jak));
+
+                return _mm_xor_si128(_mm_shuffle_epi8(out1, io), _mm_shuffle_epi8(out2, jo));
+            }
+
+            __m128i xtime(__m128i x) const
+            {
+                __m128i carry = _mm_and_si128(_mm_cmplt_epi8(x, _mm_setzero_si128()), poly);
+                return _mm_xor_si128(_mm_add_epi8(x, x), carry);
+            }
+
+            // out_r = 2 * (a_r ^ a_r+1) ^ a_r+1 ^ a_r+2 ^ a_r+3 within every column
+            __m128i mix(__m128i x) const
+            {
+                __m128i r1 = _mm_shuffle_epi8(x, rot1);
+                __m128i r2 = _mm_shuffle_epi8(x, rot2);
+                __m128i r3 = _mm_shuffle_epi8(x, rot3);
+                return _mm_xor_si128(_mm_xor_si128(xtime(_mm_xor_si128(x, r1)), r1), _mm_xor_si128(r2, r3));
+            }
+
+            // InvMixColumns = MixColumns o (a_r ^= 4 * (a_r ^ a_r+2))
+            __m128i invMix(__m128i x) const
+            {
+                __m128i t = _mm_xor_si128(x, _mm_shuffle_epi8(x, rot2));
+                return mix(_mm_xor_si128(x, xtime(xtime(t))));
+            }
+        };
+    } // namespace
+
+    template <int Rounds>
+    void vpermEncryptBlock(const uint8_t *roundKeys, uint8_t *block)
+    {
+        const Context ctx(false);
+        const __m128i k63 = _mm_set1_epi8(0x63);
+
+        __m128i s = _mm_xor_si128(load(block), load(roundKeys));
+        for (int round = 1; round < Rounds; ++round)
+        {
+            s = _mm_xor_si128(ctx.sub(s), k63);
+            s = _mm_shuffle_epi8(s, ctx.shiftRows);
+            s = ctx.mix(s);
+            s = _mm_xor_si128(s, load(roundKeys + round * 16));
+        }
+        s = _mm_xor_si128(ctx.sub(s), k63);
+        s = _mm_shuffle_epi8(s, ctx.shiftRows);
+        s = _mm_xor_si128(s, load(roundKeys + Rounds * 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(block), s);
+    }
+
+    template <int Rounds>
+    void vpermDecryptBlock(const uint8_t *roundKeys, uint8_t *block)
+    {
+        const Context ctx(true);
+
+        __m128i s = _mm_xor_si128(load(block), load(roundKeys + Rounds * 16));
+        for (int round = Rounds - 1; round > 0; --round)
+        {
+            s = _mm_shuffle_epi8(s, ctx.invShiftRows);
+            s = ctx.sub(s);
+            s = _mm_xor_si128(s, load(roundKeys + round * 16));
+            s = ctx.invMix(s);
+        }
+        s = _mm_shuffle_epi8(s, ctx.invShiftRows);
+        s = ctx.sub(s);
+        s = _mm_xor_si128(s, load(roundKeys));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(block), s);
+    }
+
+    template void vpermEncryptBlock<10>(const uint8_t *, uint8_t *);
+    template void vpermEncryptBlock<12>(const uint8_t *, uint8_t *);
+    template void vpermEncryptBlock<14>(const uint8_t *, uint8_t *);
+    template void vpermDecryptBlock<10>(const uint8_t *, uint8_t *);
+    template void vpermDecryptBlock<12>(const uint8_t *, uint8_t *);
+    template void vpermDecryptBlock<14>(const uint8_t *, uint8_t *);
+} // namespace BCKernel
+
+#endif // BLOCKCRYPT_HAVE_VPERM
@@ -0,0 +1,43 @@
+# End-to-end check of the streaming path (input from a pipe, -O a regular file): run with
+#   cmake -DBLOCKCRYPT=<path to blockcrypt> -DWORK_DIR=<scratch dir> -P cli_stream.cmake
+# A decryption that fails on the padding must leave an existing -O file as it was and no
+# temporary file behind; a successful one must replace it.
+
+set(KEY 2b7e151628aed2a6abf7158809cf4f3c)
+set(WRONG_KEY 2b7e151628aed2a6abf7158809cf4f3d)
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+string(REPEAT "streamed through stdin-" 9000 TEXT)
+file(WRITE "${WORK_DIR}/plain.txt" "${TEXT}")
+
+execute_process(COMMAND "${BLOCKCRYPT}" encrypt -k ${KEY} -O "${WORK_DIR}/cipher.bin"
+                INPUT_FILE "${WORK_DIR}/plain.txt" RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "streaming encryption failed (${result})")
+endif()
+
+file(WRITE "${WORK_DIR}/out.txt" "existing output")
+execute_process(COMMAND "${BLOCKCRYPT}" decrypt -k ${WRONG_KEY} -O "${WORK_DIR}/out.txt"
+                INPUT_FILE "${WORK_DIR}/cipher.bin" RESULT_VARIABLE result ERROR_QUIET)
+if(result EQUAL 0)
+    message(FATAL_ERROR "decryption with the wrong key should have failed")
+endif()
+file(READ "${WORK_DIR}/out.txt" kept)
+if(NOT kept STREQUAL "existing output")
+    message(FATAL_ERROR "failed decryption modified the existing output")
+endif()
+file(GLOB leftovers "${WORK_DIR}/out.txt.tmp-*")
+if(leftovers)
+    message(FATAL_ERROR "failed decryption left ${leftovers} behind")
+endif()
+
+execute_process(COMMAND "${BLOCKCRYPT}" decrypt -k ${KEY} -O "${WORK_DIR}/out.txt"
+                INPUT_FILE "${WORK_DIR}/cipher.bin" RESULT_VARIABLE result)
+file(SHA256 "${WORK_DIR}/plain.txt" plain)
+file(SHA256 "${WORK_DIR}/out.txt" restored)
+if(NOT result EQUAL 0 OR NOT plain STREQUAL restored)
+    message(FATAL_ERROR "streaming decryption did not restore the input")
+endif()
+
+file(REMOVE_RECURSE "${WORK_DIR}")
@@ -3,7 +3,64 @@
 #include "blockcrypt.hpp"
 #include "padding.hpp"
 #include "CBC.hpp"
+#include "bufferpool.hpp"
+#include "ECB.hpp"
+#include "CTR.hpp"
+#include "container.hpp"
+#include "GCM.hpp"
+#include "fileio.hpp"
+#include "keycache.hpp"
+#include "parallel.hpp"
+#include "stats.hpp"
+#include "threadpool.hpp"
+#include "XTS.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <random>
+#include <system_error>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // A fresh directory for the file tests, removed again when the test ends (also when a
+    // REQUIRE fails halfway)
+    struct TempDir
+    {
+        fs::path path;
+
+        explicit TempDir(const fs::path &base = fs::temp_directory_path())
+            : path(base / ("blockcrypt_test_" + std::to_string(std::random_device{}())))
+        {
+            fs::create_directories(path);
+        }
+        ~TempDir()
+        {
+            std::error_code ignored;
+            fs::remove_all(path, ignored);
+        }
+        TempDir(const TempDir &) = delete;
+        TempDir &operator=(const TempDir &) = delete;
+
+        fs::path operator/(const std::string &name) const { return path / name; }
+    };
+
+    std::vector<uint8_t> readFile(const fs::path &p)
+    {
+        std::ifstream in(p, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+    }
+
+    void writeFile(const fs::path &p, const std::vector<uint8_t> &data)
+    {
+        std::ofstream out(p, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), data.size());
+    }
+} // namespace
 
 // ------------ Basic Correctness: Single Round-Trip Test ------------
 /*
@@ -238,6 +295,169 @@ TEST_CASE("NIST AES-128 ECB vector", "[nist][ecb]")
     REQUIRE(ct == expect);
 }
 
+/*
+ * T-table engine vs. byte-wise reference
+ *
+ * `encrypt`/`decrypt` run the 32-bit word engine (Te/Td tables and the
+ * equivalent inverse cipher schedule), while `encryptReference`/`decryptReference`
+ * still walk through subBytes/shiftRows/mixColumns/addRoundKey one byte at a time.
+ *
+ * Both paths must reproduce the NIST ECB vector above and the FIPS-197 Appendix C.1
+ * example, and must agree with each other on a batch of random keys and blocks.
+ */
+TEST_CASE("T-table engine matches byte-wise reference", "[nist][ecb][ttable]")
+{
+    SECTION("NIST SP800-38A ECB block")
+    {
+        BlockCrypt::Key key = {
+            0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+            0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+        BlockCrypt::Block pt = {
+            0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96,
+            0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A};
+        BlockCrypt::Block expect = {
+            0x3A, 0xD7, 0x7B, 0xB4, 0x0D, 0x7A, 0x36, 0x60,
+            0xA8, 0x9E, 0xCA, 0xF3, 0x24, 0x66, 0xEF, 0x97};
+
+        BlockCrypt aes(key);
+        auto fast = pt;
+        auto ref = pt;
+        aes.encrypt(fast);
+        aes.encryptReference(ref);
+        REQUIRE(fast == expect);
+        REQUIRE(ref == expect);
+
+        aes.decrypt(fast);
+        aes.decryptReference(ref);
+        REQUIRE(fast == pt);
+        REQUIRE(ref == pt);
+    }
+
+    SECTION("FIPS-197 Appendix C.1 block")
+    {
+        BlockCrypt::Key key = {
+            0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+            0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+        BlockCrypt::Block pt = {
+            0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+            0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+        BlockCrypt::Block expect = {
+            0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+            0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A};
+
+        BlockCrypt aes(key);
+        auto ct = pt;
+        aes.encrypt(ct);
+        REQUIRE(ct == expect);
+        aes.decrypt(ct);
+        REQUIRE(ct == pt);
+    }
+
+    SECTION("random keys and blocks")
+    {
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<int> dist(0, 255);
+
+        for (int ki = 0; ki < 50; ++ki)
+        {
+            BlockCrypt::Key key{};
+            for (auto &b : key)
+                b = static_cast<uint8_t>(dist(rng));
+            BlockCrypt aes(key);
+
+            for (int bi = 0; bi < 50; ++bi)
+            {
+                BlockCrypt::Block blk{};
+                for (auto &b : blk)
+                    b = static_cast<uint8_t>(dist(rng));
+
+                auto fast = blk;
+                auto ref = blk;
+                aes.encrypt(fast);
+                aes.encryptReference(ref);
+                REQUIRE(fast == ref);
+
+                aes.decrypt(fast);
+                aes.decryptReference(ref);
+                REQUIRE(fast == blk);
+                REQUIRE(ref == blk);
+            }
+        }
+    }
+}
+
+/*
+ * Backend cross-check
+ *
+ * BlockCrypt picks its engine at construction time (AES-NI when CPUID reports it,
+ * the T-table engine otherwise). This test forces every backend that is available
+ * on the current machine and checks that:
+ *  - each one reproduces the NIST ECB vector,
+ *  - each one agrees with the byte-wise reference on random keys and blocks,
+ *  - Auto never resolves to an unavailable backend.
+ * Backends missing on this CPU are skipped rather than failed.
+ */
+TEST_CASE("All available backends agree with the reference", "[nist][ecb][backend]")
+{
+    using Backend = BlockCrypt::Backend;
+    const Backend backends[] = {Backend::Reference, Backend::TTable, Backend::AESNI, Backend::Bitsliced, Backend::VPerm};
+
+    BlockCrypt::Key nistKey = {
+        0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+        0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    BlockCrypt::Block nistPt = {
+        0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96,
+        0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A};
+    BlockCrypt::Block nistCt = {
+        0x3A, 0xD7, 0x7B, 0xB4, 0x0D, 0x7A, 0x36, 0x60,
+        0xA8, 0x9E, 0xCA, 0xF3, 0x24, 0x66, 0xEF, 0x97};
+
+    REQUIRE(BlockCrypt::supports(BlockCrypt(nistKey).backend()));
+
+    for (Backend backend : backends)
+    {
+        if (!BlockCrypt::supports(backend))
+        {
+            WARN("skipping unavailable backend " << BlockCrypt::backendName(backend));
+            continue;
+        }
+        INFO("backend " << BlockCrypt::backendName(backend));
+
+        BlockCrypt aes(nistKey, backend);
+        REQUIRE(aes.backend() == backend);
+        auto blk = nistPt;
+        aes.encrypt(blk);
+        REQUIRE(blk == nistCt);
+        aes.decrypt(blk);
+        REQUIRE(blk == nistPt);
+
+        std::mt19937 rng{7};
+        std::uniform_int_distribution<int> dist(0, 255);
+        for (int ki = 0; ki < 20; ++ki)
+        {
+            BlockCrypt::Key key{};
+            for (auto &b : key)
+                b = static_cast<uint8_t>(dist(rng));
+            BlockCrypt fast(key, backend);
+            BlockCrypt ref(key, Backend::Reference);
+
+            for (int bi = 0; bi < 20; ++bi)
+            {
+                BlockCrypt::Block in{};
+                for (auto &b : in)
+                    b = static_cast<uint8_t>(dist(rng));
+                auto a = in;
+                auto r = in;
+                fast.encrypt(a);
+                ref.encrypt(r);
+                REQUIRE(a == r);
+                fast.decrypt(a);
+                REQUIRE(a == in);
+            }
+        }
+    }
+}
+
 // helper to turn a hex string into a BlockCrypt::Block
 static std::vector<uint8_t> hexBytes(const std::string &hex)
 {
@@ -289,4 +509,1742 @@ TEST_CASE("NIST AES-128 CBC vector", "[nist][cbc]")
     // 6) Decrypt back in-place
     decryptCBC(plaintext, key, iv, false);
     REQUIRE(plaintext == hexBytes(ptHex));
-}
\ No newline at end of file
+}
+
+/*
+ * AES-192 / AES-256 on every backend
+ *
+ * BasicBlockCrypt<KeyBytes> fixes the round count and schedule length at compile time.
+ * For each key size this checks the FIPS-197 Appendix C example cipher, then runs every
+ * available backend against the byte-wise reference on random keys, both one block at a
+ * time and through encryptBlocks/decryptBlocks (which take the multi-block kernels).
+ */
+template <class Cipher>
+static void checkKeySize(const std::string &keyHex, const std::string &ctHex)
+{
+    using Backend = typename Cipher::Backend;
+    const Backend backends[] = {Backend::Reference, Backend::TTable, Backend::AESNI, Backend::Bitsliced, Backend::VPerm};
+
+    typename Cipher::Key fipsKey;
+    auto keyBytes = hexBytes(keyHex);
+    REQUIRE(keyBytes.size() == fipsKey.size());
+    std::copy(keyBytes.begin(), keyBytes.end(), fipsKey.begin());
+
+    BlockCrypt::Block fipsPt, fipsCt;
+    auto pt = hexBytes("00112233445566778899AABBCCDDEEFF");
+    auto ct = hexBytes(ctHex);
+    std::copy_n(pt.begin(), 16, fipsPt.begin());
+    std::copy_n(ct.begin(), 16, fipsCt.begin());
+
+    for (Backend backend : backends)
+    {
+        if (!Cipher::supports(backend))
+            continue;
+        INFO("AES-" << Cipher::kKeySize * 8 << " backend " << Cipher::backendName(backend));
+
+        Cipher aes(fipsKey, backend);
+        auto blk = fipsPt;
+        aes.encrypt(blk);
+        REQUIRE(blk == fipsCt);
+        aes.decrypt(blk);
+        REQUIRE(blk == fipsPt);
+
+        std::mt19937 rng{static_cast<unsigned>(Cipher::kRounds)};
+        std::uniform_int_distribution<int> dist(0, 255);
+        for (int ki = 0; ki < 8; ++ki)
+        {
+            typename Cipher::Key key;
+            for (auto &b : key)
+                b = static_cast<uint8_t>(dist(rng));
+            Cipher fast(key, backend);
+            Cipher ref(key, Backend::Reference);
+
+            std::vector<uint8_t> data(37 * 16);
+            for (auto &b : data)
+                b = static_cast<uint8_t>(dist(rng));
+            std::vector<uint8_t> expected = data;
+            for (std::size_t off = 0; off < expected.size(); off += 16)
+            {
+                BlockCrypt::Block b;
+                std::copy_n(expected.begin() + off, 16, b.begin());
+                ref.encryptReference(b);
+                std::copy(b.begin(), b.end(), expected.begin() + off);
+            }
+
+            std::vector<uint8_t> out(data.size());
+            fast.encryptBlocks(data.data(), out.data(), data.size() / 16);
+            REQUIRE(out == expected);
+            fast.decryptBlocks(out.data(), out.data(), out.size() / 16);
+            REQUIRE(out == data);
+        }
+    }
+}
+
+TEST_CASE("FIPS-197 AES-192 and AES-256 on all backends", "[nist][ecb][backend][keysize]")
+{
+    STATIC_REQUIRE(BlockCrypt::kRounds == 10);
+    STATIC_REQUIRE(BlockCrypt192::kRounds == 12);
+    STATIC_REQUIRE(BlockCrypt256::kRounds == 14);
+
+    checkKeySize<BlockCrypt>("000102030405060708090A0B0C0D0E0F", "69C4E0D86A7B0430D8CDB78070B4C55A");
+    checkKeySize<BlockCrypt192>("000102030405060708090A0B0C0D0E0F1011121314151617", "DDA97CA4864CDFE06EAF70A0EC0D7191");
+    checkKeySize<BlockCrypt256>("000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F",
+                                "8EA2B7CA516745BFEAFC49904B496089");
+}
+
+/*
+ * NIST SP 800-38A F.2.3 / F.2.5: CBC-AES192 and CBC-AES256, through the templated
+ * context overloads of encryptCBC/decryptCBC (same plaintext and IV as the AES-128 case).
+ */
+TEST_CASE("NIST AES-192 and AES-256 CBC vectors", "[nist][cbc][keysize]")
+{
+    const std::string ptHex =
+        "6BC1BEE22E409F96E93D7E117393172A"
+        "AE2D8A571E03AC9C9EB76FAC45AF8E51"
+        "30C81C46A35CE411E5FBC1191A0A52EF"
+        "F69F2445DF4F9B17AD2B417BE66C3710";
+    BlockCrypt::Block iv;
+    auto ivBytes = hexBytes("000102030405060708090A0B0C0D0E0F");
+    std::copy_n(ivBytes.begin(), 16, iv.begin());
+
+    SECTION("AES-192")
+    {
+        BlockCrypt192::Key key;
+        auto k = hexBytes("8E73B0F7DA0E6452C810F32B809079E562F8EAD2522C6B7B");
+        std::copy(k.begin(), k.end(), key.begin());
+        BlockCrypt192 aes(key);
+
+        auto data = hexBytes(ptHex);
+        BC::encryptCBC(data, aes, iv, false);
+        REQUIRE(data == hexBytes("4F021DB243BC633D7178183A9FA071E8"
+                                 "B4D9ADA9AD7DEDF4E5E738763F69145A"
+                                 "571B242012FB7AE07FA9BAAC3DF102E0"
+                                 "08B0E27988598881D920A9E64F5615CD"));
+        BC::decryptCBC(data, aes, iv, false);
+        REQUIRE(data == hexBytes(ptHex));
+    }
+
+    SECTION("AES-256")
+    {
+        BlockCrypt256::Key key;
+        auto k = hexBytes("603DEB1015CA71BE2B73AEF0857D77811F352C073B6108D72D9810A30914DFF4");
+        std::copy(k.begin(), k.end(), key.begin());
+        BlockCrypt256 aes(key);
+
+        auto data = hexBytes(ptHex);
+        BC::encryptCBC(data, aes, iv, false);
+        REQUIRE(data == hexBytes("F58C4C04D6E5F1BA779EABFB5F7BFBD6"
+                                 "9CFC4E967EDB808D679F777BC6702C7D"
+                                 "39F23369A9D9BACFA530E26304231461"
+                                 "B2EB05E2C39BE9FCDA6C19078C6A9D1B"));
+        BC::decryptCBC(data, aes, iv, false);
+        REQUIRE(data == hexBytes(ptHex));
+    }
+}
+
+/*
+ * Bitsliced multi-block kernel
+ *
+ * The bitsliced backend encrypts whole groups of blocks (4, 8 or 16 depending on
+ * the instruction set) and zero-pads a short tail into a full group. This test runs
+ * every block count from 1 up to a few groups, so full groups, partial groups and
+ * the single-block path are all covered, and compares each block against the
+ * byte-wise reference. It also checks the in-place (in == out) case and the
+ * ECB wrapper with padding on top of it.
+ */
+TEST_CASE("Bitsliced bulk ECB matches reference", "[ecb][bitslice]")
+{
+    BlockCrypt::Key key = {
+        0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+        0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    BlockCrypt sliced(key, BlockCrypt::Backend::Bitsliced);
+    BlockCrypt ref(key, BlockCrypt::Backend::Reference);
+
+    std::mt19937 rng{1234};
+    std::uniform_int_distribution<int> dist(0, 255);
+
+    for (std::size_t count = 1; count <= 50; ++count)
+    {
+        INFO("block count " << count);
+        std::vector<uint8_t> pt(count * 16);
+        for (auto &b : pt)
+            b = static_cast<uint8_t>(dist(rng));
+
+        std::vector<uint8_t> expected = pt;
+        ref.encryptBlocks(expected.data(), expected.data(), count);
+
+        std::vector<uint8_t> ct(pt.size());
+        sliced.encryptBlocks(pt.data(), ct.data(), count);
+        REQUIRE(ct == expected);
+
+        sliced.decryptBlocks(ct.data(), ct.data(), count); // in place
+        REQUIRE(ct == pt);
+    }
+
+    std::vector<uint8_t> msg(1000, 0x5A);
+    auto original = msg;
+    BC::encryptECB(msg, key);
+    REQUIRE(msg.size() == 1008);
+    BC::decryptECB(msg, key);
+    REQUIRE(msg == original);
+
+    std::vector<uint8_t> ragged(17, 0);
+    REQUIRE_THROWS_AS(BC::decryptECB(ragged, key), std::runtime_error);
+}
+
+/*
+ * CBC decryption in batches
+ *
+ * decryptCBC decrypts up to 64 blocks per batch and chains them afterwards.
+ * A 200-block message crosses several batch boundaries (and ends in a partial
+ * batch); the result must match a straightforward block-by-block CBC decryption
+ * done with the byte-wise reference engine, whatever number of blocks the engine
+ * keeps in flight (1 to 8, 0 = engine default).
+ */
+TEST_CASE("CBC decryption across batch boundaries", "[cbc]")
+{
+    BlockCrypt::Key key{
+        0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0xF6, 0x07, 0x18,
+        0x29, 0x3A, 0x4B, 0x5C, 0x6D, 0x7E, 0x8F, 0x90};
+    BlockCrypt::Block iv{
+        0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE,
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF};
+
+    std::vector<uint8_t> ct(200 * 16);
+    for (std::size_t i = 0; i < ct.size(); ++i)
+        ct[i] = static_cast<uint8_t>(i * 7 + 3);
+
+    BlockCrypt ref(key, BlockCrypt::Backend::Reference);
+    std::vector<uint8_t> expected(ct.size());
+    BlockCrypt::Block prev = iv;
+    for (std::size_t i = 0; i < ct.size(); i += 16)
+    {
+        BlockCrypt::Block blk;
+        std::copy_n(ct.begin() + i, 16, blk.begin());
+        BlockCrypt::Block dec = blk;
+        ref.decrypt(dec);
+        for (int b = 0; b < 16; ++b)
+            expected[i + b] = dec[b] ^ prev[b];
+        prev = blk;
+    }
+
+    for (std::size_t lanes : {0, 1, 2, 3, 4, 8})
+    {
+        std::vector<uint8_t> buf = ct;
+        BC::decryptCBC(buf, key, iv, false, lanes);
+        INFO("lanes = " << lanes);
+        REQUIRE(buf == expected);
+    }
+}
+
+/*
+ * Interleaved multi-block encryption and decryption
+ *
+ * The AES-NI and T-table engines encrypt and decrypt groups of 2, 4 or 8 blocks
+ * with their rounds interleaved, finishing the remainder one block at a time.
+ * For every lane setting and block counts that do and do not fill whole groups,
+ * each block must match what encrypt()/decrypt() produce for it on its own,
+ * also when the output overwrites the input.
+ */
+TEST_CASE("Interleaved encryptBlocks/decryptBlocks match single-block calls", "[ecb][backend]")
+{
+    BlockCrypt::Key key{
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+    std::vector<uint8_t> in(19 * 16);
+    for (std::size_t i = 0; i < in.size(); ++i)
+        in[i] = static_cast<uint8_t>(i * 13 + 5);
+
+    using Backend = BlockCrypt::Backend;
+    for (Backend backend : {Backend::Reference, Backend::TTable, Backend::AESNI, Backend::Bitsliced})
+    {
+        if (!BlockCrypt::supports(backend))
+            continue;
+        BlockCrypt aes(key, backend);
+
+        for (std::size_t lanes : {0, 1, 2, 4, 8})
+        {
+            for (std::size_t count = 0; count <= 19; ++count)
+            {
+                std::vector<uint8_t> enc(count * 16), dec(count * 16);
+                aes.encryptBlocks(in.data(), enc.data(), count, lanes);
+                aes.decryptBlocks(in.data(), dec.data(), count, lanes);
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    BlockCrypt::Block e, d;
+                    std::copy_n(in.begin() + i * 16, 16, e.begin());
+                    d = e;
+                    aes.encrypt(e);
+                    aes.decrypt(d);
+                    INFO(BlockCrypt::backendName(backend) << " lanes=" << lanes << " count=" << count << " block=" << i);
+                    REQUIRE(std::equal(e.begin(), e.end(), enc.begin() + i * 16));
+                    REQUIRE(std::equal(d.begin(), d.end(), dec.begin() + i * 16));
+                }
+
+                std::vector<uint8_t> inPlace(in.begin(), in.begin() + count * 16);
+                aes.encryptBlocks(inPlace.data(), inPlace.data(), count, lanes);
+                REQUIRE(inPlace == enc);
+            }
+        }
+    }
+}
+
+/*
+ * Work-stealing thread pool
+ *
+ * parallelFor must run every index exactly once, whatever the pool size, and
+ * report worker ids inside [0, size()). An exception thrown by any task has to
+ * reach the caller, and the pool must stay usable afterwards.
+ */
+TEST_CASE("ThreadPool runs every task once and propagates exceptions", "[parallel]")
+{
+    for (std::size_t workers : {1, 2, 3, 8})
+    {
+        BC::ThreadPool pool(workers);
+        REQUIRE(pool.size() == workers);
+
+        std::vector<std::atomic<int>> hits(1000);
+        std::atomic<bool> badWorker{false};
+        pool.parallelFor(hits.size(), [&](std::size_t i, std::size_t worker)
+        {
+            hits[i]++;
+            if (worker >= pool.size())
+                badWorker = true;
+        });
+        for (auto &h : hits)
+            REQUIRE(h == 1);
+        REQUIRE_FALSE(badWorker);
+
+        REQUIRE_THROWS_AS(pool.parallelFor(50, [](std::size_t i, std::size_t)
+        {
+            if (i == 17)
+                throw std::runtime_error("task failed");
+        }), std::runtime_error);
+
+        std::atomic<std::size_t> sum{0};
+        pool.parallelFor(10, [&](std::size_t i, std::size_t) { sum += i; });
+        REQUIRE(sum == 45);
+    }
+}
+
+/*
+ * Parallel modes against the serial ones
+ *
+ * The parallel variants split the buffer into 64 KB chunks. Sizes below one
+ * chunk, an exact multiple of chunks and a ragged tail (with padding) must all
+ * produce exactly what encryptECB / decryptECB / decryptCBC produce, for pools
+ * of several sizes (including more workers than chunks).
+ */
+TEST_CASE("Parallel ECB and CBC match the serial modes", "[parallel][ecb][cbc]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x4d, 0x4d, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block iv{
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+    for (std::size_t size : {std::size_t(0), std::size_t(100), BC::kParallelChunkBytes - 16,
+                             3 * BC::kParallelChunkBytes, 3 * BC::kParallelChunkBytes + 5 * 16 + 7})
+    {
+        std::vector<uint8_t> plain(size);
+        for (std::size_t i = 0; i < size; ++i)
+            plain[i] = static_cast<uint8_t>(i * 31 + 11);
+
+        std::vector<uint8_t> ecb = plain;
+        BC::encryptECB(ecb, key);
+        std::vector<uint8_t> cbc = plain;
+        BC::encryptCBC(cbc, key, iv);
+
+        for (std::size_t workers : {1, 2, 3, 4})
+        {
+            BC::ThreadPool pool(workers);
+            INFO("size = " << size << ", workers = " << workers);
+
+            std::vector<uint8_t> buf = plain;
+            BC::encryptECBParallel(buf, key, pool);
+            REQUIRE(buf == ecb);
+            BC::decryptECBParallel(buf, key, pool);
+            REQUIRE(buf == plain);
+
+            buf = cbc;
+            BC::decryptCBCParallel(buf, key, iv, pool);
+            REQUIRE(buf == plain);
+        }
+    }
+
+    BC::ThreadPool pool(2);
+    std::vector<uint8_t> ragged(33, 0);
+    REQUIRE_THROWS_AS(BC::decryptCBCParallel(ragged, key, iv, pool), std::runtime_error);
+    REQUIRE_THROWS_AS(BC::decryptECBParallel(ragged, key, pool), std::runtime_error);
+}
+
+/*
+ * NIST SP 800-38A F.5.1 CTR-AES128.Encrypt
+ *
+ * Four blocks with initial counter block f0f1...feff. Encrypting and decrypting
+ * are the same operation in CTR, so applying cryptCTR twice must also return
+ * the plaintext. A message that is not block aligned simply yields a shorter
+ * ciphertext (no padding).
+ */
+TEST_CASE("NIST AES-128 CTR vector", "[nist][ctr]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block counter{
+        0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+        0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+
+    std::vector<uint8_t> plain{
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+    std::vector<uint8_t> expected{
+        0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26, 0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+        0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff, 0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+        0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e, 0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+        0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1, 0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee};
+
+    std::vector<uint8_t> buf = plain;
+    BC::cryptCTR(buf, key, counter);
+    REQUIRE(buf == expected);
+    BC::cryptCTR(buf, key, counter);
+    REQUIRE(buf == plain);
+
+    std::vector<uint8_t> partial(plain.begin(), plain.begin() + 37);
+    BC::cryptCTR(partial, key, counter);
+    REQUIRE(partial == std::vector<uint8_t>(expected.begin(), expected.begin() + 37));
+}
+
+/*
+ * CTR random access
+ *
+ * Processing any byte range [offset, offset + len) on its own must give the
+ * same bytes as processing the whole stream, including ranges that start and
+ * end in the middle of a block and ones longer than one keystream batch. The
+ * counter is a 128-bit big-endian integer: starting at ...ff ff ff ff must
+ * carry into the nonce half (values cross-checked with openssl aes-128-ctr).
+ */
+TEST_CASE("CTR random access and counter carry", "[ctr]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BC::Nonce nonce{0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77};
+
+    BlockCrypt::Block counter = BC::makeCounterBlock(nonce, 0xffffffffffffffffULL);
+    std::vector<uint8_t> carry(48, 0);
+    BC::cryptCTR(carry, key, counter);
+    std::vector<uint8_t> expectedCarry{
+        0xf6, 0x27, 0xce, 0xad, 0xf0, 0x2f, 0x7c, 0xb5, 0x3b, 0xf1, 0x1c, 0x06, 0x1f, 0xf3, 0xbd, 0xfc,
+        0x6c, 0x9c, 0x04, 0xee, 0x5f, 0xae, 0x03, 0xd6, 0x68, 0xef, 0x7e, 0xa6, 0x56, 0x02, 0xd7, 0x3a,
+        0x39, 0x4b, 0x96, 0x35, 0x0f, 0x51, 0x6b, 0x84, 0xc2, 0x5f, 0xb7, 0x7c, 0x53, 0x06, 0x62, 0x67};
+    REQUIRE(carry == expectedCarry);
+
+    std::vector<uint8_t> stream(5000);
+    for (std::size_t i = 0; i < stream.size(); ++i)
+        stream[i] = static_cast<uint8_t>(i * 7 + 1);
+    std::vector<uint8_t> whole = stream;
+    counter = BC::makeCounterBlock(nonce, 42);
+    BC::cryptCTR(whole, key, counter);
+
+    BlockCrypt aes(key);
+    std::mt19937 rng(1234);
+    for (int trial = 0; trial < 200; ++trial)
+    {
+        std::size_t offset = rng() % stream.size();
+        std::size_t len = rng() % (stream.size() - offset + 1);
+        std::vector<uint8_t> part(stream.begin() + offset, stream.begin() + offset + len);
+        BC::cryptCTR(aes, counter, offset, part.data(), part.size());
+        INFO("offset = " << offset << ", len = " << len);
+        REQUIRE(std::equal(part.begin(), part.end(), whole.begin() + offset));
+    }
+
+    for (std::size_t workers : {1, 3})
+    {
+        BC::ThreadPool pool(workers);
+        std::vector<uint8_t> big(2 * BC::kParallelChunkBytes + 1000);
+        for (std::size_t i = 0; i < big.size(); ++i)
+            big[i] = static_cast<uint8_t>(i);
+        std::vector<uint8_t> serial = big;
+        BC::cryptCTR(serial, key, counter, 3);
+        BC::cryptCTRParallel(big, key, counter, pool, 3);
+        REQUIRE(big == serial);
+    }
+}
+
+/*
+ * AES-GCM test vectors
+ *
+ * Test Cases 1-5 from McGrew & Viega, "The Galois/Counter Mode of Operation":
+ * empty message, one zero block, four blocks, a ragged message with AAD and an
+ * 8-byte IV (which goes through the GHASH-derived initial counter). Each one is
+ * run with the AES-NI/PCLMULQDQ path and with software backends that use the
+ * portable table GHASH. Opening must return the plaintext.
+ */
+TEST_CASE("AES-128-GCM test vectors", "[nist][gcm]")
+{
+    struct Vector
+    {
+        const char *name;
+        std::vector<uint8_t> key, plain, iv, aad, cipher, tag;
+    };
+    const std::vector<Vector> vectors{
+        {"Test Case 1",
+         {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+         {},
+         {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+         {},
+         {},
+         {0x58, 0xe2, 0xfc, 0xce, 0xfa, 0x7e, 0x30, 0x61, 0x36, 0x7f, 0x1d, 0x57, 0xa4, 0xe7, 0x45, 0x5a}},
+        {"Test Case 2",
+         {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+         {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+         {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+         {},
+         {0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92, 0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78},
+         {0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd, 0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf}},
+        {"Test Case 3",
+         {0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08},
+         {0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+          0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+          0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+          0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55},
+         {0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88},
+         {},
+         {0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+          0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+          0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+          0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85},
+         {0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6, 0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4}},
+        {"Test Case 4",
+         {0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08},
+         {0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+          0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+          0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+          0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39},
+         {0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88},
+         {0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+          0xab, 0xad, 0xda, 0xd2},
+         {0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+          0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+          0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+          0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91},
+         {0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47}},
+        {"Test Case 5",
+         {0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08},
+         {0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+          0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+          0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+          0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39},
+         {0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad},
+         {0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+          0xab, 0xad, 0xda, 0xd2},
+         {0x61, 0x35, 0x3b, 0x4c, 0x28, 0x06, 0x93, 0x4a, 0x77, 0x7f, 0xf5, 0x1f, 0xa2, 0x2a, 0x47, 0x55,
+          0x69, 0x9b, 0x2a, 0x71, 0x4f, 0xcd, 0xc6, 0xf8, 0x37, 0x66, 0xe5, 0xf9, 0x7b, 0x6c, 0x74, 0x23,
+          0x73, 0x80, 0x69, 0x00, 0xe4, 0x9f, 0x24, 0xb2, 0x2b, 0x09, 0x75, 0x44, 0xd4, 0x89, 0x6b, 0x42,
+          0x49, 0x89, 0xb5, 0xe1, 0xeb, 0xac, 0x0f, 0x07, 0xc2, 0x3f, 0x45, 0x98},
+         {0x36, 0x12, 0xd2, 0xe7, 0x9e, 0x3b, 0x07, 0x85, 0x56, 0x1b, 0xe1, 0x4a, 0xac, 0xa2, 0xfc, 0xcb}},
+    };
+
+    using Backend = BlockCrypt::Backend;
+    for (Backend backend : {Backend::Auto, Backend::TTable, Backend::Bitsliced})
+    {
+        for (const Vector &v : vectors)
+        {
+            INFO(v.name << " [" << BlockCrypt::backendName(backend) << "]");
+            BlockCrypt::Key key;
+            std::copy(v.key.begin(), v.key.end(), key.begin());
+            BC::GCM gcm(key, backend);
+
+            std::vector<uint8_t> buf = v.plain;
+            BC::GCM::Tag tag = gcm.encrypt(v.iv.data(), v.iv.size(), v.aad.data(), v.aad.size(), buf.data(), buf.size());
+            REQUIRE(buf == v.cipher);
+            REQUIRE(std::equal(tag.begin(), tag.end(), v.tag.begin()));
+
+            gcm.decrypt(v.iv.data(), v.iv.size(), v.aad.data(), v.aad.size(), buf.data(), buf.size(), tag);
+            REQUIRE(buf == v.plain);
+        }
+    }
+}
+
+/*
+ * GCM authentication failures and long messages
+ *
+ * Flipping one bit of the ciphertext, the AAD or the tag must make decryptGCM
+ * throw and leave no plaintext behind. A multi-kilobyte message (several fused
+ * batches, ragged tail, AAD that is not block aligned) must give the same
+ * ciphertext and tag on the PCLMULQDQ and table GHASH paths and round-trip.
+ * Messages, AAD and IVs longer than SP 800-38D allows must be rejected.
+ */
+TEST_CASE("GCM rejects tampering and agrees across GHASH paths", "[gcm]")
+{
+    BlockCrypt::Key key{
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+        0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08};
+    std::vector<uint8_t> iv{0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88};
+    std::vector<uint8_t> aad(37);
+    for (std::size_t i = 0; i < aad.size(); ++i)
+        aad[i] = static_cast<uint8_t>(i * 3);
+
+    std::vector<uint8_t> plain(5000 + 11);
+    for (std::size_t i = 0; i < plain.size(); ++i)
+        plain[i] = static_cast<uint8_t>(i * 17 + 2);
+
+    std::vector<uint8_t> ct = plain;
+    BC::GCM::Tag tag = BC::encryptGCM(ct, key, iv, aad);
+
+    BC::GCM portable(key, BlockCrypt::Backend::TTable);
+    std::vector<uint8_t> ct2 = plain;
+    BC::GCM::Tag tag2 = portable.encrypt(iv.data(), iv.size(), aad.data(), aad.size(), ct2.data(), ct2.size());
+    REQUIRE(ct2 == ct);
+    REQUIRE(tag2 == tag);
+
+    std::vector<uint8_t> buf = ct;
+    BC::decryptGCM(buf, key, iv, tag, aad);
+    REQUIRE(buf == plain);
+
+    buf = ct;
+    buf[4321] ^= 0x04;
+    REQUIRE_THROWS_AS(BC::decryptGCM(buf, key, iv, tag, aad), std::runtime_error);
+    REQUIRE(std::all_of(buf.begin(), buf.end(), [](uint8_t b) { return b == 0; }));
+
+    buf = ct;
+    std::vector<uint8_t> badAad = aad;
+    badAad[36] ^= 0x80;
+    REQUIRE_THROWS_AS(BC::decryptGCM(buf, key, iv, tag, badAad), std::runtime_error);
+
+    buf = ct;
+    BC::GCM::Tag badTag = tag;
+    badTag[15] ^= 0x01;
+    REQUIRE_THROWS_AS(BC::decryptGCM(buf, key, iv, badTag, aad), std::runtime_error);
+
+    REQUIRE_THROWS_AS(BC::encryptGCM(buf, key, std::vector<uint8_t>{}), std::runtime_error);
+
+    // Lengths past the SP 800-38D limits are refused before the buffers are touched (hence null)
+    if constexpr (sizeof(std::size_t) >= 8)
+    {
+        BC::GCM gcm(key);
+        const std::size_t tooLong = static_cast<std::size_t>(BC::GCM::kMaxDataBytes) + 1;
+        const std::size_t aadTooLong = static_cast<std::size_t>(BC::GCM::kMaxAadBytes) + 1;
+        REQUIRE_THROWS_AS(gcm.encrypt(iv.data(), iv.size(), nullptr, 0, nullptr, tooLong), std::runtime_error);
+        REQUIRE_THROWS_AS(gcm.decrypt(iv.data(), iv.size(), nullptr, 0, nullptr, tooLong, tag), std::runtime_error);
+        REQUIRE_THROWS_AS(gcm.encrypt(iv.data(), iv.size(), nullptr, aadTooLong, nullptr, 0), std::runtime_error);
+        REQUIRE_THROWS_AS(gcm.decrypt(nullptr, aadTooLong, nullptr, 0, nullptr, 0, tag), std::runtime_error);
+    }
+}
+
+/*
+ * Streaming CBC contexts
+ *
+ * Feeding a message to CBCEncryptor / CBCDecryptor in random-sized chunks
+ * (including empty ones and chunks smaller than a block) must produce exactly
+ * the bytes of one-shot encryptCBC / decryptCBC, with and without padding,
+ * also when each chunk is processed in place. Truncated ciphertext and a
+ * corrupt padding block must be reported by final().
+ */
+TEST_CASE("Streaming CBC matches one-shot CBC", "[cbc][stream]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block iv{
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+    std::mt19937 rng(99);
+
+    for (std::size_t size : {0, 1, 15, 16, 17, 160, 4099})
+    {
+        for (bool pad : {true, false})
+        {
+            if (!pad && size % 16 != 0)
+                continue;
+            INFO("size = " << size << ", pad = " << pad);
+
+            std::vector<uint8_t> plain(size);
+            for (std::size_t i = 0; i < size; ++i)
+                plain[i] = static_cast<uint8_t>(rng());
+            std::vector<uint8_t> expected = plain;
+            BC::encryptCBC(expected, key, iv, pad);
+
+            BC::CBCEncryptor enc(key, iv, pad);
+            std::vector<uint8_t> ct;
+            for (std::size_t pos = 0; pos < size;)
+            {
+                std::size_t n = std::min<std::size_t>(rng() % 40, size - pos);
+                enc.update(std::vector<uint8_t>(plain.begin() + pos, plain.begin() + pos + n), ct);
+                pos += n;
+            }
+            enc.final(ct);
+            REQUIRE(ct == expected);
+
+            // In place through the pointer interface, with a shared expanded key
+            BlockCrypt aes(key);
+            BC::CBCDecryptor dec(aes, iv, pad);
+            std::vector<uint8_t> pt;
+            for (std::size_t pos = 0; pos < ct.size();)
+            {
+                std::size_t n = std::min<std::size_t>(rng() % 40, ct.size() - pos);
+                std::vector<uint8_t> chunk(ct.begin() + pos, ct.begin() + pos + n);
+                chunk.resize(n + 15);
+                std::size_t produced = dec.update(chunk.data(), n, chunk.data());
+                pt.insert(pt.end(), chunk.begin(), chunk.begin() + produced);
+                pos += n;
+            }
+            dec.final(pt);
+            REQUIRE(pt == plain);
+        }
+    }
+
+    BC::CBCDecryptor truncated(key, iv);
+    std::vector<uint8_t> out;
+    truncated.update(std::vector<uint8_t>(20, 0x42), out);
+    REQUIRE_THROWS_AS(truncated.final(out), std::runtime_error);
+
+    BC::CBCDecryptor badPad(key, iv);
+    badPad.update(std::vector<uint8_t>(32, 0x42), out);
+    REQUIRE_THROWS_AS(badPad.final(out), std::runtime_error);
+
+    BC::CBCEncryptor ragged(key, iv, false);
+    ragged.update(std::vector<uint8_t>(5, 1), out);
+    REQUIRE_THROWS_AS(ragged.final(out), std::runtime_error);
+}
+
+/*
+ * Buffer-based CBC
+ *
+ * encryptCBC / decryptCBC on caller-supplied buffers must match the vector API
+ * and the streaming contexts byte for byte, out of place and in place, while
+ * needing no more room than the padded ciphertext (encryption) or the bare
+ * plaintext (decryption). A buffer that is one byte short must be refused.
+ */
+TEST_CASE("Buffer-based CBC into caller-supplied memory", "[cbc][buffer]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block iv{
+        0x0f, 0x0e, 0x0d, 0x0c, 0x0b, 0x0a, 0x09, 0x08,
+        0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00};
+    BlockCrypt aes(key);
+    std::mt19937 rng(14);
+
+    for (std::size_t size : {0, 1, 15, 16, 17, 31, 32, 1000, 4096})
+    {
+        INFO("size = " << size);
+        std::vector<uint8_t> plain(size);
+        for (auto &b : plain)
+            b = static_cast<uint8_t>(rng());
+
+        // Reference: the streaming encryptor, which never goes through the buffer API
+        BC::CBCEncryptor enc(aes, iv);
+        std::vector<uint8_t> expected;
+        enc.update(plain, expected);
+        enc.final(expected);
+        REQUIRE(expected.size() == BCPad::paddedLength(size));
+
+        std::vector<uint8_t> ct(expected.size());
+        REQUIRE(BC::encryptCBC(aes, iv, plain.data(), size, ct.data(), ct.size()) == ct.size());
+        REQUIRE(ct == expected);
+        REQUIRE_THROWS_AS(BC::encryptCBC(aes, iv, plain.data(), size, ct.data(), ct.size() - 1), std::runtime_error);
+
+        std::vector<uint8_t> inPlace(expected.size());
+        std::copy(plain.begin(), plain.end(), inPlace.begin());
+        BC::encryptCBC(aes, iv, inPlace.data(), size, inPlace.data(), inPlace.size());
+        REQUIRE(inPlace == expected);
+
+        std::vector<uint8_t> viaVector = plain;
+        BC::encryptCBC(viaVector, aes, iv);
+        REQUIRE(viaVector == expected);
+
+        // Exactly `size` bytes of room are enough; the padding never touches `out`
+        std::vector<uint8_t> pt(size);
+        for (std::size_t lanes : {0, 1, 4})
+        {
+            std::fill(pt.begin(), pt.end(), 0);
+            REQUIRE(BC::decryptCBC(aes, iv, ct.data(), ct.size(), pt.data(), pt.size(), true, lanes) == size);
+            REQUIRE(pt == plain);
+        }
+        if (size > 0)
+        {
+            REQUIRE_THROWS_AS(BC::decryptCBC(aes, iv, ct.data(), ct.size(), pt.data(), size - 1), std::runtime_error);
+        }
+
+        REQUIRE(BC::decryptCBC(aes, iv, inPlace.data(), inPlace.size(), inPlace.data(), inPlace.size()) == size);
+        REQUIRE(std::equal(plain.begin(), plain.end(), inPlace.begin()));
+    }
+
+    // Unpadded, block-aligned data round-trips without any extra room
+    std::vector<uint8_t> data(256), out(256), back(256);
+    for (auto &b : data)
+        b = static_cast<uint8_t>(rng());
+    REQUIRE(BC::encryptCBC(aes, iv, data.data(), data.size(), out.data(), out.size(), false) == 256);
+    REQUIRE(BC::decryptCBC(aes, iv, out.data(), out.size(), back.data(), back.size(), false) == 256);
+    REQUIRE(back == data);
+    REQUIRE_THROWS_AS(BC::encryptCBC(aes, iv, data.data(), 255, out.data(), out.size(), false), std::runtime_error);
+    REQUIRE_THROWS_AS(BC::decryptCBC(aes, iv, out.data(), 255, back.data(), back.size()), std::runtime_error);
+    REQUIRE_THROWS_AS(BC::decryptCBC(aes, iv, out.data(), 0, back.data(), back.size()), std::runtime_error);
+
+    // BCPad helpers used by the buffer API
+    uint8_t block[16] = {'a', 'b', 'c'};
+    REQUIRE(BCPad::writePKCS7(block, 3) == 13);
+    REQUIRE(block[3] == 13);
+    REQUIRE(block[15] == 13);
+    REQUIRE(BCPad::unpaddedLength(block, 16) == 3);
+    block[4] = 12;
+    REQUIRE_THROWS_AS(BCPad::unpaddedLength(block, 16), std::runtime_error);
+    REQUIRE(BCPad::paddedLength(0) == 16);
+    REQUIRE(BCPad::paddedLength(16) == 32);
+}
+
+/*
+ * Multi-buffer CBC
+ *
+ * encryptCBCBatch runs several independent messages through the cipher side by
+ * side and refills a lane as soon as its message ends. With messages of mixed
+ * lengths (including empty ones), every lane count and every backend, each job
+ * must come out exactly as encryptCBC would produce it on its own, in place or
+ * not. A misaligned unpadded job must be rejected before anything is written.
+ */
+TEST_CASE("Multi-buffer CBC matches per-message CBC", "[cbc][batch]")
+{
+    BlockCrypt::Key key{
+        0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+        0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81};
+    std::mt19937 rng(16);
+
+    std::vector<std::vector<uint8_t>> plain(37);
+    std::vector<BlockCrypt::Block> ivs(plain.size());
+    for (std::size_t j = 0; j < plain.size(); ++j)
+    {
+        plain[j].resize(j % 5 == 0 ? 0 : rng() % 200);
+        for (auto &b : plain[j])
+            b = static_cast<uint8_t>(rng());
+        for (auto &b : ivs[j])
+            b = static_cast<uint8_t>(rng());
+    }
+
+    using Backend = BlockCrypt::Backend;
+    for (Backend backend : {Backend::TTable, Backend::AESNI, Backend::Bitsliced})
+    {
+        if (!BlockCrypt::supports(backend))
+            continue;
+        BlockCrypt aes(key, backend);
+
+        for (std::size_t lanes : {0, 1, 3, 8, 16})
+        {
+            INFO(BlockCrypt::backendName(backend) << " lanes=" << lanes);
+            std::vector<std::vector<uint8_t>> out(plain.size());
+            std::vector<BC::CBCJob> jobs(plain.size());
+            for (std::size_t j = 0; j < plain.size(); ++j)
+            {
+                out[j].resize(BCPad::paddedLength(plain[j].size()));
+                // Every other job in place
+                if (j % 2)
+                    std::copy(plain[j].begin(), plain[j].end(), out[j].begin());
+                jobs[j] = {j % 2 ? out[j].data() : plain[j].data(), out[j].data(), plain[j].size(), ivs[j]};
+            }
+
+            BC::encryptCBCBatch(aes, jobs.data(), jobs.size(), true, lanes);
+
+            for (std::size_t j = 0; j < plain.size(); ++j)
+            {
+                std::vector<uint8_t> expected = plain[j];
+                BC::encryptCBC(expected, aes, ivs[j]);
+                REQUIRE(jobs[j].written == expected.size());
+                REQUIRE(out[j] == expected);
+            }
+        }
+    }
+
+    // Without padding: block-aligned messages only
+    BlockCrypt aes(key);
+    std::vector<uint8_t> a(64, 1), b(48, 2), ca(64), cb(48);
+    std::vector<BC::CBCJob> jobs = {{a.data(), ca.data(), a.size(), ivs[0]}, {b.data(), cb.data(), b.size(), ivs[1]}};
+    BC::encryptCBCBatch(aes, jobs.data(), jobs.size(), false);
+    BC::decryptCBC(ca, aes, ivs[0], false);
+    BC::decryptCBC(cb, aes, ivs[1], false);
+    REQUIRE(ca == a);
+    REQUIRE(cb == b);
+
+    jobs[1].length = 47;
+    std::fill(ca.begin(), ca.end(), 0);
+    REQUIRE_THROWS_AS(BC::encryptCBCBatch(aes, jobs.data(), jobs.size(), false), std::runtime_error);
+    REQUIRE(std::all_of(ca.begin(), ca.end(), [](uint8_t x) { return x == 0; }));
+}
+
+/*
+ * Memory-mapped file encryption
+ *
+ * encryptFileCBC / decryptFileCBC map input and output and must write exactly
+ * the bytes encryptCBC produces (including for an empty file, which becomes
+ * one padding block). The in-place variants grow and shrink the file; a
+ * decryption with the wrong key must fail on the padding check and leave the
+ * file (or the existing output) as it was.
+ */
+TEST_CASE("Memory-mapped CBC file encryption", "[cbc][file]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block iv{
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+    TempDir dir;
+    fs::path plainPath = dir / "plain.bin", cipherPath = dir / "cipher.bin", outPath = dir / "out.bin";
+
+    for (std::size_t size : {0, 5, 16, 70'001})
+    {
+        INFO("size = " << size);
+        std::vector<uint8_t> plain(size);
+        for (std::size_t i = 0; i < size; ++i)
+            plain[i] = static_cast<uint8_t>(i * 29 + 3);
+        std::vector<uint8_t> expected = plain;
+        BC::encryptCBC(expected, key, iv);
+        writeFile(plainPath, plain);
+
+        BCFile::encryptFileCBC(plainPath.string(), cipherPath.string(), key, iv);
+        REQUIRE(readFile(cipherPath) == expected);
+        BCFile::decryptFileCBC(cipherPath.string(), outPath.string(), key, iv);
+        REQUIRE(readFile(outPath) == plain);
+
+        // A failed decryption leaves the output as it was (or absent) and no temporary behind
+        BlockCrypt::Key wrong = key;
+        wrong[0] ^= 1;
+        REQUIRE_THROWS_AS(BCFile::decryptFileCBC(cipherPath.string(), outPath.string(), wrong, iv), std::runtime_error);
+        REQUIRE(readFile(outPath) == plain);
+        REQUIRE_THROWS_AS(BCFile::decryptFileCBC(cipherPath.string(), (dir / "new.bin").string(), wrong, iv),
+                          std::runtime_error);
+        REQUIRE_FALSE(fs::exists(dir / "new.bin"));
+        REQUIRE(std::distance(fs::directory_iterator(dir.path), fs::directory_iterator()) == 3);
+
+        BCFile::encryptFileCBCInPlace(plainPath.string(), key, iv);
+        REQUIRE(readFile(plainPath) == expected);
+
+        REQUIRE_THROWS_AS(BCFile::decryptFileCBCInPlace(plainPath.string(), wrong, iv), std::runtime_error);
+        REQUIRE(readFile(plainPath) == expected);
+
+        BCFile::decryptFileCBCInPlace(plainPath.string(), key, iv);
+        REQUIRE(readFile(plainPath) == plain);
+    }
+
+    REQUIRE_THROWS_AS(BCFile::encryptFileCBC(plainPath.string(), plainPath.string(), key, iv), std::runtime_error);
+    REQUIRE_THROWS_AS(BCFile::encryptFileCBC((dir / "missing").string(), outPath.string(), key, iv), std::runtime_error);
+}
+
+/*
+ * Expanded-key cache and prebuilt-context overloads
+ *
+ * The CBC/ECB overloads taking a BlockCrypt must match the key-based ones.
+ * KeyCache must hand out the same context for repeated keys (counting hits
+ * and misses), evict the least recently used key of a full shard, and stay
+ * consistent when many threads look up overlapping keys at once.
+ */
+TEST_CASE("KeyCache and prebuilt cipher contexts", "[cbc][keycache]")
+{
+    auto makeKey = [](unsigned n)
+    {
+        BlockCrypt::Key key{};
+        for (int i = 0; i < 16; ++i)
+            key[i] = static_cast<uint8_t>(n * 31 + i);
+        return key;
+    };
+    BlockCrypt::Block iv{};
+
+    std::vector<uint8_t> msg(100, 0x5a);
+    std::vector<uint8_t> byKey = msg, byCtx = msg;
+    BC::encryptCBC(byKey, makeKey(1), iv);
+    BlockCrypt ctx(makeKey(1));
+    BC::encryptCBC(byCtx, ctx, iv);
+    REQUIRE(byCtx == byKey);
+    BC::decryptCBC(byCtx, ctx, iv);
+    REQUIRE(byCtx == msg);
+
+    std::vector<uint8_t> ecb = msg;
+    BC::encryptECB(ecb, ctx);
+    BC::decryptECB(ecb, ctx);
+    REQUIRE(ecb == msg);
+
+    // One shard of capacity 2 makes the LRU order observable
+    BC::KeyCache small(2, 1);
+    auto a = small.get(makeKey(1));
+    auto b = small.get(makeKey(2));
+    REQUIRE(small.get(makeKey(1)) == a); // hit, 1 becomes most recent
+    small.get(makeKey(3));               // evicts 2
+    REQUIRE(small.size() == 2);
+    REQUIRE(small.get(makeKey(1)) == a);
+    REQUIRE(small.get(makeKey(2)) != b); // re-expanded
+    BC::KeyCache::Stats st = small.stats();
+    REQUIRE(st.hits == 2);
+    REQUIRE(st.misses == 4);
+    REQUIRE(st.evictions == 2);
+
+    std::vector<uint8_t> cached = msg;
+    BC::encryptCBC(cached, *small.get(makeKey(1)), iv);
+    REQUIRE(cached == byKey);
+
+    // Concurrent lookups: every thread must get a context for the right key
+    BC::KeyCache shared(64, 8);
+    BC::ThreadPool pool(4);
+    std::atomic<int> wrong{0};
+    pool.parallelFor(4000, [&](std::size_t i, std::size_t)
+    {
+        unsigned n = static_cast<unsigned>(i % 100);
+        BlockCrypt::Block block{};
+        shared.get(makeKey(n))->encrypt(block);
+        BlockCrypt::Block expected{};
+        BlockCrypt(makeKey(n)).encrypt(expected);
+        if (block != expected)
+            ++wrong;
+    });
+    REQUIRE(wrong == 0);
+    st = shared.stats();
+    REQUIRE(st.hits + st.misses == 4000);
+    REQUIRE(shared.size() <= 64);
+}
+
+/*
+ * AES-XTS
+ *
+ * IEEE 1619-2007 vectors: a full 32-byte data unit (vector 2), ciphertext
+ * stealing for 17..20-byte units (vectors 15-18) and a 512-byte AES-256-XTS
+ * unit (vector 10). Then round trips for every length from 16 to 100 bytes
+ * on all backends, and the parallel sector batch against the serial one.
+ */
+TEST_CASE("AES-XTS vectors, ciphertext stealing and sector batches", "[xts]")
+{
+    auto keyOf = [](const std::string &hex)
+    {
+        BlockCrypt::Key key{};
+        auto bytes = hexBytes(hex);
+        std::copy(bytes.begin(), bytes.end(), key.begin());
+        return key;
+    };
+
+    {
+        BC::XTS xts(keyOf("11111111111111111111111111111111"), keyOf("22222222222222222222222222222222"));
+        std::vector<uint8_t> data(32, 0x44);
+        xts.encryptSector(0x3333333333, data.data(), data.size());
+        REQUIRE(data == hexBytes("C454185E6A16936E39334038ACEF838BFB186FFF7480ADC4289382ECD6D394F0"));
+        xts.decryptSector(0x3333333333, data.data(), data.size());
+        REQUIRE(data == std::vector<uint8_t>(32, 0x44));
+    }
+
+    const char *stealing[] = {
+        "6C1625DB4671522D3D7599601DE7CA09ED",
+        "D069444B7A7E0CAB09E24447D24DEB1FEDBF",
+        "E5DF1351C0544BA1350B3363CD8EF4BEEDBF9D",
+        "9D84C813F719AA2C7BE3F66171C7C5C2EDBF9DAC",
+    };
+    BC::XTS cts(keyOf("FFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F0"), keyOf("BFBEBDBCBBBAB9B8B7B6B5B4B3B2B1B0"));
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        std::vector<uint8_t> plain(17 + i);
+        for (std::size_t j = 0; j < plain.size(); ++j)
+            plain[j] = static_cast<uint8_t>(j);
+        std::vector<uint8_t> data = plain;
+        cts.encryptSector(0x123456789a, data.data(), data.size());
+        REQUIRE(data == hexBytes(stealing[i]));
+        cts.decryptSector(0x123456789a, data.data(), data.size());
+        REQUIRE(data == plain);
+    }
+
+    {
+        BC::XTS256::Key k1{}, k2{};
+        auto b1 = hexBytes("2718281828459045235360287471352662497757247093699959574966967627");
+        auto b2 = hexBytes("3141592653589793238462643383279502884197169399375105820974944592");
+        std::copy(b1.begin(), b1.end(), k1.begin());
+        std::copy(b2.begin(), b2.end(), k2.begin());
+        BC::XTS256 xts(k1, k2);
+        std::vector<uint8_t> plain(512);
+        for (std::size_t j = 0; j < plain.size(); ++j)
+            plain[j] = static_cast<uint8_t>(j);
+        std::vector<uint8_t> data = plain;
+        xts.encryptSector(0xff, data.data(), data.size());
+        std::vector<uint8_t> head(data.begin(), data.begin() + 32), tail(data.end() - 32, data.end());
+        REQUIRE(head == hexBytes("1C3B3A102F770386E4836C99E370CF9BEA00803F5E482357A4AE12D414A3E63B"));
+        REQUIRE(tail == hexBytes("773DAD38014BD2092FA755C824BB5E54C4F36FFDA9FCEA70B9C6E693E148C151"));
+        xts.decryptSector(0xff, data.data(), data.size());
+        REQUIRE(data == plain);
+    }
+
+    // Every backend must agree with the default one, including for stolen tails
+    std::vector<uint8_t> plain(100);
+    for (std::size_t j = 0; j < plain.size(); ++j)
+        plain[j] = static_cast<uint8_t>(j * 7 + 3);
+    for (auto backend : {BlockCrypt::Backend::Reference, BlockCrypt::Backend::TTable, BlockCrypt::Backend::AESNI,
+                         BlockCrypt::Backend::Bitsliced, BlockCrypt::Backend::VPerm})
+    {
+        if (!BlockCrypt::supports(backend))
+            continue;
+        BC::XTS xts(keyOf("FFFEFDFCFBFAF9F8F7F6F5F4F3F2F1F0"), keyOf("BFBEBDBCBBBAB9B8B7B6B5B4B3B2B1B0"), backend);
+        for (std::size_t len = 16; len <= plain.size(); ++len)
+        {
+            std::vector<uint8_t> expected(plain.begin(), plain.begin() + len);
+            std::vector<uint8_t> data = expected;
+            cts.encryptSector(len, expected.data(), len);
+            xts.encryptSector(len, data.data(), len);
+            REQUIRE(data == expected);
+            xts.decryptSector(len, data.data(), len);
+            REQUIRE(std::equal(data.begin(), data.end(), plain.begin()));
+        }
+    }
+
+    uint8_t shortSector[15] = {};
+    REQUIRE_THROWS_AS(cts.encryptSector(0, shortSector, sizeof(shortSector)), std::runtime_error);
+    REQUIRE_THROWS_AS(BC::XTS(keyOf("00"), keyOf("00")), std::runtime_error);
+
+    // 4 KB pages and odd-sized sectors, serial vs spread over a pool
+    BC::ThreadPool pool(4);
+    for (std::size_t sectorSize : {std::size_t(4096), std::size_t(520)})
+    {
+        std::size_t count = 61;
+        std::vector<uint8_t> pages(sectorSize * count);
+        for (std::size_t j = 0; j < pages.size(); ++j)
+            pages[j] = static_cast<uint8_t>(j * 13 + 5);
+        std::vector<uint8_t> serial = pages, parallel = pages;
+        cts.encryptSectors(1000, serial.data(), sectorSize, count);
+        cts.encryptSectors(1000, parallel.data(), sectorSize, count, pool);
+        REQUIRE(parallel == serial);
+
+        std::vector<uint8_t> one(pages.begin() + 7 * sectorSize, pages.begin() + 8 * sectorSize);
+        cts.encryptSector(1007, one.data(), sectorSize);
+        REQUIRE(std::equal(one.begin(), one.end(), serial.begin() + 7 * sectorSize));
+
+        cts.decryptSectors(1000, parallel.data(), sectorSize, count, pool);
+        REQUIRE(parallel == pages);
+        cts.decryptSectors(1000, serial.data(), sectorSize, count);
+        REQUIRE(serial == pages);
+    }
+}
+
+/*
+ * Compile-time key schedules
+ *
+ * expandKey runs in a constant expression, and a context built from that
+ * schedule must encrypt and decrypt exactly like one built from the key, on
+ * every backend (each derives its own schedule form from the round keys).
+ */
+TEST_CASE("constexpr key schedule and Schedule constructor", "[nist][ecb][backend][keysize]")
+{
+    static constexpr BlockCrypt::Key kKey = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                             0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    static constexpr BlockCrypt::Schedule kSchedule = BlockCrypt::expandKey(kKey);
+    static_assert(kSchedule[0][0] == 0x2b && kSchedule[10][15] == 0xa6);
+
+    BlockCrypt256::Key key256{};
+    for (std::size_t i = 0; i < key256.size(); ++i)
+        key256[i] = static_cast<uint8_t>(i * 11 + 1);
+
+    for (auto backend : {BlockCrypt::Backend::Reference, BlockCrypt::Backend::TTable, BlockCrypt::Backend::AESNI,
+                         BlockCrypt::Backend::Bitsliced, BlockCrypt::Backend::VPerm})
+    {
+        if (!BlockCrypt::supports(backend))
+            continue;
+
+        BlockCrypt fromKey(kKey, backend), fromSchedule(kSchedule, backend);
+        BlockCrypt::Block a = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+                               0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34};
+        BlockCrypt::Block b = a;
+        fromKey.encrypt(a);
+        fromSchedule.encrypt(b);
+        REQUIRE(b == a);
+        REQUIRE(b == BlockCrypt::Block{0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+                                       0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32}); // FIPS-197 Appendix B
+        fromSchedule.decrypt(b);
+        REQUIRE(b == BlockCrypt::Block{0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+                                       0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34});
+
+        BlockCrypt256 wideKey(key256, backend), wideSchedule(BlockCrypt256::expandKey(key256), backend);
+        std::vector<uint8_t> x(64 * 16), y;
+        for (std::size_t i = 0; i < x.size(); ++i)
+            x[i] = static_cast<uint8_t>(i);
+        y = x;
+        wideKey.encryptBlocks(x.data(), x.data(), 64);
+        wideSchedule.encryptBlocks(y.data(), y.data(), 64);
+        REQUIRE(x == y);
+        wideSchedule.decryptBlocks(y.data(), y.data(), 64);
+        wideKey.decryptBlocks(x.data(), x.data(), 64);
+        REQUIRE(x == y);
+    }
+}
+
+/*
+ * Pipelined (io_uring) file encryption
+ *
+ * The read/encrypt/write ring must produce the same bytes as one-shot CBC for
+ * empty, sub-block, single-chunk and many-chunk files, whether it runs on
+ * io_uring or the blocking fallback, with and without O_DIRECT, and with the
+ * smallest ring (3 buffers of 4 KB) so every buffer is reused many times.
+ * A decryption with the wrong key must leave the output as it was.
+ * The files live under the build tree rather than the system temp directory,
+ * which is usually tmpfs: there O_DIRECT is refused and only the buffered
+ * path would run.
+ */
+TEST_CASE("Pipelined CBC file encryption", "[cbc][file][uring]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block iv{
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+    TempDir dir(BLOCKCRYPT_TEST_SCRATCH_DIR);
+    fs::path plainPath = dir / "plain.bin", cipherPath = dir / "cipher.bin", outPath = dir / "out.bin";
+
+    for (bool uring : {true, false})
+    {
+        for (bool direct : {false, true})
+        {
+            BCFile::PipelineOptions options;
+            options.chunkBytes = 4096;
+            options.buffers = 3;
+            options.uring = uring;
+            options.direct = direct;
+
+            for (std::size_t size : {0, 5, 4096, 4096 * 7 + 4080, 100'003})
+            {
+                INFO("uring = " << uring << ", direct = " << direct << ", size = " << size);
+                std::vector<uint8_t> plain(size);
+                for (std::size_t i = 0; i < size; ++i)
+                    plain[i] = static_cast<uint8_t>(i * 29 + 3);
+                std::vector<uint8_t> expected = plain;
+                BC::encryptCBC(expected, key, iv);
+                writeFile(plainPath, plain);
+
+                BCFile::encryptFileCBCPipelined(plainPath.string(), cipherPath.string(), key, iv, options);
+                REQUIRE(readFile(cipherPath) == expected);
+                BCFile::decryptFileCBCPipelined(cipherPath.string(), outPath.string(), key, iv, options);
+                REQUIRE(readFile(outPath) == plain);
+            }
+        }
+    }
+
+    // Default options: 1 MB chunks, io_uring where available
+    std::vector<uint8_t> big(3 * 1024 * 1024 + 77);
+    for (std::size_t i = 0; i < big.size(); ++i)
+        big[i] = static_cast<uint8_t>(i * 13);
+    writeFile(plainPath, big);
+    BCFile::encryptFileCBC(plainPath.string(), outPath.string(), key, iv);
+    BCFile::encryptFileCBCPipelined(plainPath.string(), cipherPath.string(), key, iv);
+    REQUIRE(readFile(cipherPath) == readFile(outPath));
+
+    // A failed decryption leaves an existing output as it was, a new one absent, and no temporary
+    BlockCrypt::Key wrong = key;
+    wrong[0] ^= 1;
+    std::vector<uint8_t> before = readFile(outPath);
+    REQUIRE_THROWS_AS(BCFile::decryptFileCBCPipelined(cipherPath.string(), outPath.string(), wrong, iv), std::runtime_error);
+    REQUIRE(readFile(outPath) == before);
+    REQUIRE_THROWS_AS(BCFile::decryptFileCBCPipelined(cipherPath.string(), (dir / "new.bin").string(), wrong, iv),
+                      std::runtime_error);
+    REQUIRE_FALSE(fs::exists(dir / "new.bin"));
+    REQUIRE(std::distance(fs::directory_iterator(dir.path), fs::directory_iterator()) == 3);
+    writeFile(plainPath, {1, 2, 3});
+    REQUIRE_THROWS_AS(BCFile::decryptFileCBCPipelined(plainPath.string(), outPath.string(), key, iv), std::runtime_error);
+    REQUIRE_THROWS_AS(BCFile::encryptFileCBCPipelined(plainPath.string(), plainPath.string(), key, iv), std::runtime_error);
+}
+
+/*
+ * One expanded key shared by concurrent file jobs (the batch command)
+ *
+ * Workers of a ThreadPool encrypt and decrypt many files through the
+ * BlockCrypt-taking BCFile overloads, all with the same const context; every
+ * result must equal the key-based single-file functions, mapped and pipelined.
+ */
+TEST_CASE("Shared cipher context across concurrent file jobs", "[cbc][file][batch]")
+{
+    BlockCrypt::Key key{
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    BlockCrypt::Block iv{
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+    const BlockCrypt aes(key);
+
+    TempDir dir;
+    constexpr std::size_t kFiles = 24;
+    auto name = [&](const char *kind, std::size_t i) { return (dir / (kind + std::to_string(i))).string(); };
+    for (std::size_t i = 0; i < kFiles; ++i)
+    {
+        std::vector<uint8_t> plain(i * 997 % 20'000);
+        for (std::size_t j = 0; j < plain.size(); ++j)
+            plain[j] = static_cast<uint8_t>(j * 7 + i);
+        writeFile(name("plain", i), plain);
+        BCFile::encryptFileCBC(name("plain", i), name("single", i), key, iv);
+    }
+
+    BCFile::PipelineOptions pipeline;
+    pipeline.chunkBytes = 4096;
+    BC::ThreadPool pool(4);
+    pool.parallelFor(kFiles, [&](std::size_t i, std::size_t)
+    {
+        if (i % 2 == 0)
+            BCFile::encryptFileCBC(name("plain", i), name("cipher", i), aes, iv);
+        else
+            BCFile::encryptFileCBCPipelined(name("plain", i), name("cipher", i), aes, iv, pipeline);
+        BCFile::decryptFileCBC(name("cipher", i), name("restored", i), aes, iv);
+    });
+
+    for (std::size_t i = 0; i < kFiles; ++i)
+    {
+        INFO("file " << i);
+        REQUIRE(readFile(name("cipher", i)) == readFile(name("single", i)));
+        REQUIRE(readFile(name("restored", i)) == readFile(name("plain", i)));
+    }
+}
+
+// ------------ Runtime statistics (BCStats) ------------
+/*
+    With BLOCKCRYPT_STATS every BC:: operation is counted once, on the thread that called it:
+    the raw block calls inside CBC and the chunks the parallel functions hand to pool workers
+    must not show up as operations of their own. Key expansions and rejected padding are
+    counted separately. reset() may run while other threads hold counts. Without
+    BLOCKCRYPT_STATS the snapshot stays all zeros.
+*/
+TEST_CASE("Runtime statistics count outermost operations", "[stats]")
+{
+    BlockCrypt::Key key{};
+    BlockCrypt::Block iv{};
+    BCStats::reset();
+
+    std::vector<uint8_t> data(1000, 0x42);
+    BC::encryptCBC(data, key, iv); // 1008 bytes after padding, one key expansion
+    std::vector<uint8_t> corrupt = data;
+    corrupt.back() ^= 0xff;
+    REQUIRE_THROWS_AS(BC::decryptCBC(corrupt, key, iv), std::runtime_error);
+
+    BC::ThreadPool pool(2);
+    std::vector<uint8_t> big(BC::kParallelChunkBytes * 3, 7);
+    BC::cryptCTRParallel(big, key, BC::makeCounterBlock({}), pool);
+
+    BCStats::Snapshot s = BCStats::snapshot();
+    const BCStats::Timing &cbcEnc = s.ops[static_cast<std::size_t>(BCStats::Op::EncryptCBC)];
+    const BCStats::Timing &cbcDec = s.ops[static_cast<std::size_t>(BCStats::Op::DecryptCBC)];
+    const BCStats::Timing &ctr = s.ops[static_cast<std::size_t>(BCStats::Op::CTR)];
+    const BCStats::Timing &raw = s.ops[static_cast<std::size_t>(BCStats::Op::EncryptBlocks)];
+
+    if (!BCStats::enabled())
+    {
+        REQUIRE(cbcEnc.calls == 0);
+        REQUIRE(s.keyExpansions == 0);
+        return;
+    }
+
+    REQUIRE(cbcEnc.calls == 1);
+    REQUIRE(cbcEnc.bytes == 1000);
+    REQUIRE(cbcEnc.blocks == 63);
+    REQUIRE(cbcDec.calls == 1);
+    REQUIRE(ctr.calls == 1);
+    REQUIRE(ctr.bytes == big.size());
+    REQUIRE(raw.calls == 0); // CTR's keystream blocks belong to the CTR call
+    REQUIRE(s.keyExpansions == 3);
+    REQUIRE(s.paddingErrors == 1);
+
+    uint64_t inHistogram = 0;
+    for (uint64_t n : ctr.histogram)
+        inHistogram += n;
+    REQUIRE(inHistogram == 1);
+    REQUIRE(ctr.percentileNs(50) > 0);
+
+    BCStats::reset();
+    REQUIRE(BCStats::snapshot().ops[static_cast<std::size_t>(BCStats::Op::EncryptCBC)].calls == 0);
+
+    // A reset while another thread holds counts: they vanish from snapshots at once, and the
+    // thread starts again from zero on its next operation instead of resurrecting them
+    auto cbcCalls = [] { return BCStats::snapshot().ops[static_cast<std::size_t>(BCStats::Op::EncryptCBC)].calls; };
+    std::atomic<int> step{0};
+    std::thread worker([&]
+    {
+        std::vector<uint8_t> msg(100, 1);
+        for (int i = 0; i < 5; ++i)
+            BC::encryptCBC(msg, key, iv);
+        step = 1;
+        while (step != 2)
+            std::this_thread::yield();
+        BC::encryptCBC(msg, key, iv);
+        step = 3;
+        while (step != 4)
+            std::this_thread::yield();
+    });
+    while (step != 1)
+        std::this_thread::yield();
+    REQUIRE(cbcCalls() == 5);
+    BCStats::reset();
+    REQUIRE(cbcCalls() == 0);
+    step = 2;
+    while (step != 3)
+        std::this_thread::yield();
+    REQUIRE(cbcCalls() == 1);
+    step = 4;
+    worker.join();
+    REQUIRE(cbcCalls() == 1); // the exited thread's count is kept
+}
+
+// ------------ Buffer pool ------------
+/*
+    Pool buffers are 64-byte aligned (page aligned from 4 KB), sized to a power-of-two class,
+    and a buffer released on a thread is what that thread gets back next time, without a new
+    system allocation. Buffers released on an exiting thread reach other threads through the
+    depot. The pooled CBC/ECB overloads must agree with the vector ones. The pool is shared by
+    the whole test run, so the checks use differences of its counters.
+*/
+TEST_CASE("Buffer pool alignment, reuse and pooled cipher overloads", "[pool]")
+{
+    BC::BufferPool &pool = BC::BufferPool::instance();
+
+    REQUIRE(BC::BufferPool::capacityFor(1) == 64);
+    REQUIRE(BC::BufferPool::capacityFor(65) == 128);
+    REQUIRE(BC::BufferPool::capacityFor(4096) == 4096);
+    REQUIRE(pool.acquire(0).data() == nullptr);
+
+    for (std::size_t n : {std::size_t(1), std::size_t(100), std::size_t(5000), std::size_t(1) << 20})
+    {
+        BC::PooledBuffer buf = pool.acquire(n);
+        REQUIRE(buf.size() == n);
+        REQUIRE(buf.capacity() == BC::BufferPool::capacityFor(n));
+        std::size_t alignment = n >= BC::BufferPool::kPageAlignment ? BC::BufferPool::kPageAlignment : BC::BufferPool::kAlignment;
+        REQUIRE(reinterpret_cast<std::uintptr_t>(buf.data()) % alignment == 0);
+    }
+
+    // Steady state: the same class acquired again comes from this thread's list
+    uint8_t *first;
+    {
+        BC::PooledBuffer buf = pool.acquire(3000);
+        first = buf.data();
+    }
+    BC::BufferPool::Stats before = pool.stats();
+    for (int i = 0; i < 100; ++i)
+    {
+        BC::PooledBuffer buf = pool.acquire(2100 + i);
+        REQUIRE(buf.data() == first);
+    }
+    BC::BufferPool::Stats after = pool.stats();
+    REQUIRE(after.acquires - before.acquires == 100);
+    REQUIRE(after.threadHits - before.threadHits == 100);
+    REQUIRE(after.systemAllocations == before.systemAllocations);
+    REQUIRE(after.bytesInUse == before.bytesInUse);
+
+    // Growing past the capacity keeps the contents
+    BC::PooledBuffer grow = pool.acquire(60);
+    for (std::size_t i = 0; i < grow.size(); ++i)
+        grow[i] = uint8_t(i);
+    grow.resize(64);
+    REQUIRE(grow.capacity() == 64);
+    grow.resize(1000);
+    REQUIRE(grow.capacity() == 1024);
+    for (std::size_t i = 0; i < 60; ++i)
+        REQUIRE(grow[i] == uint8_t(i));
+    grow.release();
+    REQUIRE(grow.empty());
+
+    // Sensitive buffers come back zeroed up to the largest size they had; the first bytes hold
+    // the free-list link while the memory sits in the pool
+    uint8_t *secret;
+    {
+        BC::PooledBuffer buf = pool.acquire(5000, BC::BufferPool::Use::Sensitive);
+        std::memset(buf.data(), 0xa5, buf.size());
+        buf.resize(100);
+        secret = buf.data();
+    }
+    {
+        BC::PooledBuffer buf = pool.acquire(5000);
+        REQUIRE(buf.data() == secret);
+        REQUIRE(std::all_of(buf.begin() + sizeof(void *), buf.end(), [](uint8_t b) { return b == 0; }));
+    }
+    {
+        // Growing moves the contents to a sensitive buffer and wipes the old one
+        BC::PooledBuffer buf = pool.acquire(100, BC::BufferPool::Use::Sensitive);
+        std::memset(buf.data(), 0x5a, buf.size());
+        uint8_t *small = buf.data();
+        buf.resize(200);
+        std::memset(buf.data(), 0x5a, buf.size());
+        BC::PooledBuffer reused = pool.acquire(100);
+        REQUIRE(reused.data() == small);
+        REQUIRE(std::all_of(reused.begin() + sizeof(void *), reused.end(), [](uint8_t b) { return b == 0; }));
+        uint8_t *large = buf.data();
+        buf.release();
+        BC::PooledBuffer reusedLarge = pool.acquire(200);
+        REQUIRE(reusedLarge.data() == large);
+        REQUIRE(std::all_of(reusedLarge.begin() + sizeof(void *), reusedLarge.end(), [](uint8_t b) { return b == 0; }));
+    }
+
+    // A buffer of a class nobody else uses, released on an exiting thread, is found via the depot
+    constexpr std::size_t kOdd = (std::size_t(1) << 25) + 1; // the 64 MB class
+    uint64_t depotHits = pool.stats().depotHits;
+    std::thread([&] { pool.acquire(kOdd); }).join();
+    REQUIRE(pool.acquire(kOdd).size() == kOdd);
+    REQUIRE(pool.stats().depotHits == depotHits + 1);
+
+    pool.trim();
+    REQUIRE(pool.stats().bytesCached == 0);
+
+    // Pooled overloads: padding goes into the spare capacity
+    BlockCrypt::Key key{};
+    key[0] = 1;
+    BlockCrypt::Block iv{};
+    iv[15] = 9;
+    BlockCrypt aes(key);
+    std::vector<uint8_t> plain(1000);
+    for (std::size_t i = 0; i < plain.size(); ++i)
+        plain[i] = uint8_t(i * 13);
+
+    std::vector<uint8_t> expected = plain;
+    BC::encryptCBC(expected, aes, iv);
+    BC::PooledBuffer buf = pool.acquire(plain.size());
+    std::memcpy(buf.data(), plain.data(), plain.size());
+    uint8_t *base = buf.data();
+    BC::encryptCBC(buf, aes, iv);
+    REQUIRE(buf.data() == base);
+    REQUIRE(std::vector<uint8_t>(buf.begin(), buf.end()) == expected);
+    BC::decryptCBC(buf, aes, iv);
+    REQUIRE(std::vector<uint8_t>(buf.begin(), buf.end()) == plain);
+
+    expected = plain;
+    BC::encryptECB(expected, aes);
+    BC::encryptECB(buf, aes);
+    REQUIRE(std::vector<uint8_t>(buf.begin(), buf.end()) == expected);
+    BC::decryptECB(buf, aes);
+    REQUIRE(std::vector<uint8_t>(buf.begin(), buf.end()) == plain);
+}
+
+// ------------ Chunked container format ------------
+/*
+    A container written in pieces of odd sizes must decode to the original data, whether in
+    full (decryptTo, chunks in parallel) or through random byte ranges that start and end
+    inside blocks and chunks. Every chunk is plain CBC under IV_i = E_K(nonce XOR i), so the
+    first chunk can be checked against BC::encryptCBC. Empty inputs, inputs that end exactly
+    on a chunk boundary, a wrong key, a wrong key size and a truncated file are covered.
+*/
+TEST_CASE("Chunked container round trip and random-access reads", "[container][file]")
+{
+    BlockCrypt::Key key{};
+    for (std::size_t i = 0; i < key.size(); ++i)
+        key[i] = uint8_t(0x10 + i);
+    const BlockCrypt aes(key);
+    BC::ThreadPool pool(3);
+
+    TempDir dir;
+    fs::path containerPath = dir / "data.bcc", outPath = dir / "out.bin";
+
+    BCFile::ContainerOptions options;
+    options.chunkBytes = 1000; // rounded up to 1008
+    options.nonce = BlockCrypt::Block{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+
+    std::mt19937 rng(24);
+    for (std::size_t size : {0, 1, 1008, 1009, 2016, 20'000, 50'407})
+    {
+        std::vector<uint8_t> plain(size);
+        for (uint8_t &b : plain)
+            b = uint8_t(rng());
+
+        {
+            BCFile::ContainerWriter writer(containerPath.string(), aes, pool, options);
+            for (std::size_t pos = 0; pos < size;)
+            {
+                std::size_t piece = std::min<std::size_t>(size - pos, 1 + rng() % 3000);
+                writer.write(plain.data() + pos, piece);
+                pos += piece;
+            }
+            writer.finish();
+            REQUIRE(writer.plaintextSize() == size);
+        }
+
+        BCFile::ContainerReader reader(containerPath.string(), aes);
+        REQUIRE(BCFile::isContainer(containerPath.string()));
+        REQUIRE(reader.size() == size);
+        REQUIRE(reader.chunkSize() == 1008);
+        REQUIRE(reader.chunkCount() == std::max<uint64_t>(1, (size + 1007) / 1008));
+
+        reader.decryptTo(outPath.string(), pool);
+        REQUIRE(readFile(outPath) == plain);
+
+        for (int r = 0; r < 40 && size != 0; ++r)
+        {
+            uint64_t offset = rng() % size;
+            std::size_t length = rng() % 2500;
+            std::vector<uint8_t> got(length);
+            std::size_t n = reader.read(offset, got.data(), length);
+            REQUIRE(n == std::min<uint64_t>(length, size - offset));
+            REQUIRE(std::equal(got.begin(), got.begin() + n, plain.begin() + offset));
+        }
+
+        // Cursor reads in small steps cover the whole plaintext
+        std::vector<uint8_t> streamed;
+        uint8_t piece[333];
+        reader.seek(0);
+        while (std::size_t n = reader.read(piece, sizeof(piece)))
+            streamed.insert(streamed.end(), piece, piece + n);
+        REQUIRE(streamed == plain);
+        REQUIRE(reader.read(size, piece, 1) == 0);
+
+        if (size >= 1009)
+        {
+            BlockCrypt::Block iv = *options.nonce;
+            aes.encrypt(iv); // chunk 0: nonce XOR 0
+            std::vector<uint8_t> first(plain.begin(), plain.begin() + 1008);
+            BC::encryptCBC(first, aes, iv, false);
+            std::vector<uint8_t> file = readFile(containerPath);
+            REQUIRE(std::equal(first.begin(), first.end(), file.begin() + BCFile::kContainerHeaderBytes));
+        }
+    }
+
+    BlockCrypt::Key otherKey = key;
+    otherKey[0] ^= 1;
+    REQUIRE_THROWS_AS(BCFile::ContainerReader(containerPath.string(), BlockCrypt(otherKey)), std::runtime_error);
+    REQUIRE_THROWS_AS(BCFile::ContainerReader256(containerPath.string(), BlockCrypt256(BlockCrypt256::Key{})),
+                      std::runtime_error);
+
+    fs::resize_file(containerPath, fs::file_size(containerPath) - 1);
+    REQUIRE_THROWS_AS(BCFile::ContainerReader(containerPath.string(), aes), std::runtime_error);
+    REQUIRE_FALSE(BCFile::isContainer(outPath.string()));
+
+    // A chunk size of 0 is clamped to one block; a corrupt last chunk fails decryptTo
+    // without leaving an output file behind
+    {
+        BCFile::ContainerOptions tiny;
+        tiny.chunkBytes = 0;
+        std::vector<uint8_t> plain(100, 0x33);
+        {
+            BCFile::ContainerWriter writer(containerPath.string(), aes, pool, tiny);
+            writer.write(plain.data(), plain.size());
+            writer.finish();
+        }
+        {
+            BCFile::ContainerReader reader(containerPath.string(), aes);
+            REQUIRE(reader.chunkSize() == 16);
+            REQUIRE(reader.chunkCount() == 7);
+            std::vector<uint8_t> got(plain.size());
+            REQUIRE(reader.read(0, got.data(), got.size()) == plain.size());
+            REQUIRE(got == plain);
+        }
+
+        std::fstream file(containerPath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(BCFile::kContainerHeaderBytes + 6 * 16);
+        char byte = static_cast<char>(file.get() ^ 0x01);
+        file.seekp(BCFile::kContainerHeaderBytes + 6 * 16);
+        file.put(byte);
+        file.close();
+        fs::remove(outPath);
+        BCFile::ContainerReader reader(containerPath.string(), aes);
+        REQUIRE_THROWS_AS(reader.decryptTo(outPath.string(), pool), std::runtime_error);
+        REQUIRE_FALSE(fs::exists(outPath));
+    }
+
+    // AES-256 containers use the same layout
+    BlockCrypt256::Key key256{};
+    key256[31] = 7;
+    const BlockCrypt256 aes256(key256);
+    std::vector<uint8_t> plain(5000, 0x5a);
+    {
+        BCFile::ContainerWriter256 writer(containerPath.string(), aes256, pool);
+        writer.write(plain.data(), plain.size());
+        writer.finish();
+    }
+    BCFile::ContainerReader256 reader(containerPath.string(), aes256);
+    std::vector<uint8_t> tail(100);
+    REQUIRE(reader.read(4900, tail.data(), tail.size()) == 100);
+    REQUIRE(std::equal(tail.begin(), tail.end(), plain.begin() + 4900));
+}
+
+// ------------ CBC byte-range decryption ------------
+/*
+    decryptCBCRange must return exactly the slice of the full decryptCBC output for any range:
+    starting and ending mid-block, on block boundaries, inside or past the padding, and past
+    the end. Corrupt padding only matters to ranges that reach the final block. The file
+    variant is checked on a file larger than its 1 MB read window, so ranges cross windows.
+*/
+TEST_CASE("CBC byte-range decryption of buffers and files", "[cbc][range][file]")
+{
+    std::mt19937 rng(25);
+    BlockCrypt::Block iv;
+    for (uint8_t &b : iv)
+        b = uint8_t(rng());
+
+    BlockCrypt256::Key key256{};
+    for (std::size_t i = 0; i < key256.size(); ++i)
+        key256[i] = uint8_t(3 * i + 1);
+    const BlockCrypt256 aes256(key256);
+
+    for (std::size_t size : {0, 1, 15, 16, 17, 47, 48, 1000, 4111})
+    {
+        std::vector<uint8_t> plain(size);
+        for (uint8_t &b : plain)
+            b = uint8_t(rng());
+        for (bool pad : {true, false})
+        {
+            std::vector<uint8_t> message = plain;
+            if (!pad)
+                message.resize(size - size % 16);
+            std::vector<uint8_t> cipher = message;
+            BC::encryptCBC(cipher, aes256, iv, pad);
+
+            for (int r = 0; r < 200; ++r)
+            {
+                uint64_t offset = rng() % (cipher.size() + 20);
+                std::size_t length = rng() % 3 == 0 ? rng() % 40 : rng() % (cipher.size() + 40);
+                std::vector<uint8_t> got = BC::decryptCBCRange(cipher, aes256, iv, offset, length, pad);
+                std::size_t from = static_cast<std::size_t>(std::min<uint64_t>(offset, message.size()));
+                std::size_t to = std::min(message.size(), from + length);
+                REQUIRE(got == std::vector<uint8_t>(message.begin() + from, message.begin() + to));
+            }
+        }
+    }
+
+    // Only ranges reaching the final block look at the padding
+    BlockCrypt::Key key{};
+    key[5] = 9;
+    const BlockCrypt aes(key);
+    std::vector<uint8_t> cipher(100, 0x42);
+    BC::encryptCBC(cipher, aes, iv); // 112 bytes
+    cipher.back() ^= 0x80;           // padding now decrypts to garbage
+    REQUIRE(BC::decryptCBCRange(cipher, aes, iv, 10, 80) == std::vector<uint8_t>(80, 0x42));
+    REQUIRE_THROWS_AS(BC::decryptCBCRange(cipher, aes, iv, 90, 20), std::runtime_error);
+    std::vector<uint8_t> misaligned(20);
+    REQUIRE_THROWS_AS(BC::decryptCBCRange(misaligned, aes, iv, 0, 4), std::runtime_error);
+
+    TempDir dir;
+    fs::path plainPath = dir / "plain.bin", cipherPath = dir / "cipher.bin";
+    std::vector<uint8_t> plain((5 << 19) + 7); // 2.5 MB + 7
+    for (uint8_t &b : plain)
+        b = uint8_t(rng());
+    writeFile(plainPath, plain);
+    BCFile::encryptFileCBC(plainPath.string(), cipherPath.string(), aes, iv);
+
+    std::vector<uint64_t> offsets = {0, 5, 16, (1 << 20) - 3, plain.size() - 100, plain.size() - 1, plain.size(), plain.size() + 9};
+    for (int r = 0; r < 20; ++r)
+        offsets.push_back(rng() % plain.size());
+    for (uint64_t offset : offsets)
+    {
+        std::size_t length = rng() % 2 == 0 ? rng() % 5000 : rng() % (3 << 20);
+        std::vector<uint8_t> got(length);
+        std::size_t n = BCFile::decryptFileCBCRange(cipherPath.string(), aes, iv, offset, got.data(), got.size());
+        std::size_t from = static_cast<std::size_t>(std::min<uint64_t>(offset, plain.size()));
+        REQUIRE(n == std::min(length, plain.size() - from));
+        REQUIRE(std::equal(got.begin(), got.begin() + n, plain.begin() + from));
+    }
+
+    // The reader knows the plaintext size up front and serves the same slices from one descriptor
+    BCFile::CBCRangeReader reader(cipherPath.string(), aes, iv);
+    REQUIRE(reader.size() == plain.size());
+    for (uint64_t offset : offsets)
+    {
+        std::size_t length = rng() % (3 << 20);
+        std::vector<uint8_t> got(length);
+        std::size_t n = reader.read(offset, got.data(), got.size());
+        std::size_t from = static_cast<std::size_t>(std::min<uint64_t>(offset, plain.size()));
+        REQUIRE(n == std::min(length, plain.size() - from));
+        REQUIRE(std::equal(got.begin(), got.begin() + n, plain.begin() + from));
+    }
+
+    // ...and rejects a wrong key or a misaligned file before returning anything
+    BlockCrypt::Key wrong = key;
+    wrong[0] ^= 1;
+    REQUIRE_THROWS_AS(BCFile::CBCRangeReader(cipherPath.string(), BlockCrypt(wrong), iv), std::runtime_error);
+    REQUIRE_THROWS_AS(BCFile::CBCRangeReader(plainPath.string(), aes, iv), std::runtime_error);
+}